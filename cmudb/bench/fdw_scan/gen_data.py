@@ -0,0 +1,111 @@
+#!/usr/bin/python
+"""
+Generates data for the columnar scan benchmark (see README.md).
+
+The rows are the ChickenFarm chickens of db721_fdw/chicken_farm_gen.py, so
+that both extensions scan exactly the same data. For every scale (number of
+rows) it writes into OUTPUT_DIR/<rows>/:
+- chicken.db721         single db721 file
+- chicken.parquet       single parquet file
+- chicken_<i>.parquet   the same rows split into sorted files for merge scans
+
+pyarrow is required for the parquet files.
+"""
+import argparse
+import os
+import random
+import sys
+
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                "..", "..", "extensions", "db721_fdw"))
+from chicken_farm_gen import ChickenFarm, Db721Serializer, Mutation  # noqa: E402
+
+SEED = 15721
+ROWS_PER_BLOCK = 50000
+SORTED_FILES = 4
+
+
+def generate_chickens(num_rows):
+    """Same mix of farms as chicken_farm_gen.main(), scaled to num_rows."""
+    rand = random.Random(SEED)
+    incubator_1 = ChickenFarm("Incubator", max_age_weeks=2)
+    layer_1 = ChickenFarm("Eggscellent", sexes=["FEMALE"], min_age_weeks=4 * 6, max_age_weeks=52 * 3)
+    layer_2 = ChickenFarm("Eggstraordinaire", sexes=["FEMALE"], min_age_weeks=52 * 1, max_age_weeks=52 * 3)
+    broiler_1 = ChickenFarm("Breakfast Lunch Dinner", min_age_weeks=0, max_age_weeks=6)
+    broiler_2 = ChickenFarm("Dish of the Day", sexes=["MALE"], min_age_weeks=0, max_age_weeks=8)
+    broiler_3 = ChickenFarm("Cheep Birds", min_age_weeks=0, max_age_weeks=6, mutation=Mutation.woody)
+    runs = [
+        (5, [broiler_3]),
+        (3, [layer_1, layer_2]),
+        (3, [broiler_1, broiler_2, broiler_3, layer_1]),
+        (1, [incubator_1]),
+    ]
+    total_weight = sum(weight for weight, _ in runs)
+
+    chickens = []
+    for i, (weight, farms) in enumerate(runs):
+        run_rows = num_rows * weight // total_weight
+        if i == len(runs) - 1:
+            run_rows = num_rows - len(chickens)
+        for _ in range(run_rows):
+            chicken_id = len(chickens) + 1
+            farm = rand.choice(farms)
+            chickens.append(farm.generate_chicken(chicken_id, SEED + chicken_id))
+    return chickens
+
+
+def write_db721(chickens, path):
+    with open(path, "wb") as f:
+        serializer = Db721Serializer("Chicken", f, ROWS_PER_BLOCK)
+        serializer.write_col("identifier", "int", [c.identifier for c in chickens])
+        serializer.write_col("farm_name", "str", [c.farm_name for c in chickens])
+        serializer.write_col("weight_model", "str", [c.weight_model for c in chickens])
+        serializer.write_col("sex", "str", [c.sex for c in chickens])
+        serializer.write_col("age_weeks", "float", [c.age_weeks for c in chickens])
+        serializer.write_col("weight_g", "float", [c.weight_grams for c in chickens])
+        serializer.write_col("notes", "str", [c.notes for c in chickens])
+        serializer.finalize()
+
+
+def write_parquet(chickens, path):
+    table = pa.table({
+        "identifier": pa.array([c.identifier for c in chickens], pa.int32()),
+        "farm_name": pa.array([c.farm_name for c in chickens], pa.string()),
+        "weight_model": pa.array([c.weight_model for c in chickens], pa.string()),
+        "sex": pa.array([c.sex for c in chickens], pa.string()),
+        "age_weeks": pa.array([c.age_weeks for c in chickens], pa.float32()),
+        "weight_g": pa.array([c.weight_grams for c in chickens], pa.float32()),
+        "notes": pa.array([c.notes for c in chickens], pa.string()),
+    })
+    pq.write_table(table, path, row_group_size=ROWS_PER_BLOCK)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate columnar scan benchmark data.")
+    parser.add_argument("--rows", default="100000,1000000",
+                        help="comma separated list of scales (number of rows)")
+    parser.add_argument("--output-dir", default="data", help="where to put generated files")
+    args = parser.parse_args()
+
+    for num_rows in [int(r) for r in args.rows.split(",")]:
+        scale_dir = os.path.join(args.output_dir, str(num_rows))
+        os.makedirs(scale_dir, exist_ok=True)
+
+        chickens = generate_chickens(num_rows)
+        write_db721(chickens, os.path.join(scale_dir, "chicken.db721"))
+        write_parquet(chickens, os.path.join(scale_dir, "chicken.parquet"))
+
+        # Rows are dealt round-robin, so each file is sorted by identifier
+        # but the files overlap and have to be merged.
+        for i in range(SORTED_FILES):
+            write_parquet(chickens[i::SORTED_FILES],
+                          os.path.join(scale_dir, f"chicken_{i}.parquet"))
+
+        print(f"Wrote {num_rows} rows to '{scale_dir}'.")
+
+
+if __name__ == "__main__":
+    main()
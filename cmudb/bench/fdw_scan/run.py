@@ -0,0 +1,220 @@
+#!/usr/bin/python
+"""
+Columnar scan benchmark for db721_fdw and parquet_fdw (see README.md).
+
+    run.py [--build] [--output results.json] ...   run the benchmark
+    run.py compare BASE.json NEW.json              compare two runs
+
+Every query is executed with EXPLAIN (ANALYZE, TIMING OFF) so that only the
+executor time is measured and no rows are sent to the client. The median of
+--repeat runs is reported after --warmup runs.
+"""
+import argparse
+import datetime
+import json
+import os
+import statistics
+import subprocess
+import sys
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+EXTENSIONS_DIR = os.path.join(BENCH_DIR, "..", "..", "extensions")
+
+COLUMNS = """
+    identifier      integer,
+    farm_name       varchar,
+    weight_model    varchar,
+    sex             varchar,
+    age_weeks       real,
+    weight_g        real,
+    notes           varchar
+"""
+
+SORTED_FILES = 4
+
+# name -> (query, settings, extensions supporting it)
+QUERIES = {
+    "full_scan": ("SELECT * FROM {table}", {}, ("db721", "parquet")),
+    "projection": ("SELECT identifier, weight_g FROM {table}", {}, ("db721", "parquet")),
+    "selective_range": ("SELECT * FROM {table} WHERE identifier < {rows} / 100", {}, ("db721", "parquet")),
+    "selective_string": ("SELECT * FROM {table} WHERE farm_name = 'Incubator'", {}, ("db721", "parquet")),
+    "sorted_merge": ("SELECT * FROM {table}_multi ORDER BY identifier", {}, ("parquet",)),
+    "parallel_scan": ("SELECT * FROM {table}_multi",
+                      {"max_parallel_workers_per_gather": "4",
+                       "parallel_setup_cost": "0",
+                       "parallel_tuple_cost": "0",
+                       "min_parallel_table_scan_size": "0"},
+                      ("parquet",)),
+}
+
+
+def psql(args, sql):
+    cmd = [os.path.join(args.bindir, "psql"), "-X", "-q", "-A", "-t",
+           "-v", "ON_ERROR_STOP=1", "-p", str(args.port), "-d", args.dbname, "-c", sql]
+    return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+
+def pg_config(args, option):
+    return subprocess.run([args.pg_config, option], check=True, capture_output=True,
+                          text=True).stdout.strip()
+
+
+def build(args):
+    for ext in ("db721_fdw", "parquet_fdw"):
+        subprocess.run(["make", "-C", os.path.join(EXTENSIONS_DIR, ext), "install",
+                        f"-j{os.cpu_count() or 1}", f"PG_CONFIG={args.pg_config}"], check=True)
+
+
+def setup(args, scale_dir, rows):
+    data = os.path.abspath(scale_dir)
+    multi_files = [os.path.join(data, f"chicken_{i}.parquet") for i in range(SORTED_FILES)]
+    multi = " ".join(multi_files)
+    psql(args, f"""
+        DROP EXTENSION IF EXISTS db721_fdw CASCADE;
+        DROP EXTENSION IF EXISTS parquet_fdw CASCADE;
+        CREATE EXTENSION db721_fdw;
+        CREATE EXTENSION parquet_fdw;
+        CREATE SERVER db721_srv FOREIGN DATA WRAPPER db721_fdw;
+        CREATE SERVER parquet_srv FOREIGN DATA WRAPPER parquet_fdw;
+        CREATE USER MAPPING FOR CURRENT_USER SERVER parquet_srv;
+        CREATE FOREIGN TABLE db721 ({COLUMNS}) SERVER db721_srv
+            OPTIONS (filename '{data}/chicken.db721', tablename 'Chicken');
+        CREATE FOREIGN TABLE parquet ({COLUMNS}) SERVER parquet_srv
+            OPTIONS (filename '{data}/chicken.parquet');
+        CREATE FOREIGN TABLE parquet_multi ({COLUMNS}) SERVER parquet_srv
+            OPTIONS (filename '{multi}', sorted 'identifier');
+    """)
+    # Keyed by table name, as the *_multi tables scan other files
+    return {
+        "db721": os.path.getsize(os.path.join(data, "chicken.db721")),
+        "parquet": os.path.getsize(os.path.join(data, "chicken.parquet")),
+        "parquet_multi": sum(os.path.getsize(f) for f in multi_files),
+    }
+
+
+def workers_launched(plan):
+    """Sum of "Workers Launched" over the Gather nodes of the plan, or None."""
+    launched = plan.get("Workers Launched")
+    for child in plan.get("Plans", []):
+        n = workers_launched(child)
+        if n is not None:
+            launched = (launched or 0) + n
+    return launched
+
+
+def run_query(args, sql, settings):
+    prologue = "".join(f"SET {name} = {value}; " for name, value in settings.items())
+    out = psql(args, f"{prologue}EXPLAIN (ANALYZE, TIMING OFF, FORMAT JSON) {sql}")
+    plan = json.loads(out)[0]
+    return plan["Execution Time"], plan["Plan"]["Actual Rows"], workers_launched(plan["Plan"])
+
+
+def run(args):
+    if args.build:
+        build(args)
+
+    results = []
+    for rows in [int(r) for r in args.rows.split(",")]:
+        scale_dir = os.path.join(args.data_dir, str(rows))
+        sizes = setup(args, scale_dir, rows)
+
+        for name, (query, settings, extensions) in QUERIES.items():
+            if args.queries and name not in args.queries.split(","):
+                continue
+            for ext in extensions:
+                if args.fdw and ext not in args.fdw.split(","):
+                    continue
+                sql = query.format(table=ext, rows=rows)
+                table = f"{ext}_multi" if "{table}_multi" in query else ext
+                for _ in range(args.warmup):
+                    run_query(args, sql, settings)
+                times = []
+                workers = []
+                for _ in range(args.repeat):
+                    ms, rows_out, launched = run_query(args, sql, settings)
+                    times.append(ms)
+                    workers.append(launched)
+                median = statistics.median(times)
+                result = {
+                    "fdw": ext,
+                    "rows": rows,
+                    "query": name,
+                    "median_ms": round(median, 3),
+                    "min_ms": round(min(times), 3),
+                    "max_ms": round(max(times), 3),
+                    "rows_out": rows_out,
+                    # Throughput is relative to the data scanned, not returned
+                    "rows_per_sec": round(rows / median * 1000),
+                    "bytes_per_sec": round(sizes[table] / median * 1000),
+                }
+                if "max_parallel_workers_per_gather" in settings:
+                    # A parallel query run without workers measures nothing
+                    result["workers_launched"] = min(w or 0 for w in workers)
+                    if result["workers_launched"] == 0:
+                        sys.exit(f"{ext} {rows} {name}: no parallel workers were launched "
+                                 f"(plan has no Gather or max_worker_processes is exhausted)")
+                results.append(result)
+                print(f"{ext:8} {rows:>10} {name:18} {median:10.2f} ms "
+                      f"{result['rows_per_sec']:>12} rows/s {result['bytes_per_sec']:>14} B/s")
+
+    commit = subprocess.run(["git", "-C", BENCH_DIR, "rev-parse", "HEAD"],
+                            capture_output=True, text=True).stdout.strip()
+    report = {
+        "commit": commit,
+        "timestamp": datetime.datetime.now().isoformat(timespec="seconds"),
+        "pg_version": pg_config(args, "--version"),
+        "repeat": args.repeat,
+        "results": results,
+    }
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"Wrote results of {commit[:10]} to '{args.output}'.")
+
+
+def compare(base_path, new_path):
+    with open(base_path) as f:
+        base = json.load(f)
+    with open(new_path) as f:
+        new = json.load(f)
+
+    key = lambda r: (r["fdw"], r["rows"], r["query"])  # noqa: E731
+    base_results = {key(r): r for r in base["results"]}
+
+    print(f"base: {base['commit'][:10]}  new: {new['commit'][:10]}")
+    print(f"{'fdw':8} {'rows':>10} {'query':18} {'base ms':>10} {'new ms':>10} {'speedup':>8}")
+    for r in new["results"]:
+        b = base_results.get(key(r))
+        if b is None:
+            continue
+        speedup = b["median_ms"] / r["median_ms"] if r["median_ms"] else float("inf")
+        print(f"{r['fdw']:8} {r['rows']:>10} {r['query']:18} "
+              f"{b['median_ms']:10.2f} {r['median_ms']:10.2f} {speedup:7.2f}x")
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == "compare":
+        if len(sys.argv) != 4:
+            sys.exit("usage: run.py compare BASE.json NEW.json")
+        compare(sys.argv[2], sys.argv[3])
+        return
+
+    parser = argparse.ArgumentParser(description="Run columnar scan benchmark.")
+    parser.add_argument("--pg-config", default="pg_config", help="pg_config of the target installation")
+    parser.add_argument("--port", default=int(os.environ.get("PGPORT", 5432)), type=int)
+    parser.add_argument("--dbname", default=os.environ.get("PGDATABASE", "postgres"))
+    parser.add_argument("--data-dir", default="data", help="output directory of gen_data.py")
+    parser.add_argument("--rows", default="100000,1000000", help="comma separated list of scales")
+    parser.add_argument("--fdw", default="", help="comma separated subset of: db721,parquet")
+    parser.add_argument("--queries", default="", help="comma separated subset of: " + ",".join(QUERIES))
+    parser.add_argument("--warmup", default=1, type=int)
+    parser.add_argument("--repeat", default=5, type=int)
+    parser.add_argument("--build", action="store_true", help="build and install both extensions first")
+    parser.add_argument("--output", default="results.json")
+    args = parser.parse_args()
+    args.bindir = pg_config(args, "--bindir")
+
+    run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,9 @@
+CREATE FUNCTION parquet_export(
+    query      text,
+    path       text,
+    options    jsonb default NULL)
+RETURNS BIGINT
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+REVOKE ALL ON FUNCTION parquet_export(text, text, jsonb) FROM PUBLIC;
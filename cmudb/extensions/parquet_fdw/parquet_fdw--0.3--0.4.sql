@@ -0,0 +1,4 @@
+CREATE FUNCTION parquet_fdw_reset_cache()
+RETURNS VOID
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
@@ -0,0 +1,393 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "parquet/file_reader.h"
+
+#include "cache.hpp"
+#include "common.hpp"
+
+extern "C"
+{
+#include "utils/timestamp.h"
+}
+
+
+int parquet_fdw_metadata_cache_size = 262144;     /* kB */
+
+struct SummaryEntry
+{
+    std::shared_ptr<FileSummary>        summary;
+    std::list<std::string>::iterator    lru_pos;
+    size_t                              charge;     /* see summary_charge() */
+};
+
+struct FileListEntry
+{
+    std::vector<std::string>    filenames;
+    TimestampTz                 expires;
+};
+
+/*
+ * Backend local caches. File summaries are evicted in LRU order once their
+ * estimated memory exceeds parquet_fdw.metadata_cache_size.
+ */
+static std::unordered_map<std::string, SummaryEntry>    summaries;
+static std::list<std::string>                           summaries_lru;
+static size_t                                           summaries_bytes = 0;
+static std::unordered_map<std::string, FileListEntry>   file_lists;
+
+
+template <typename DType>
+static std::shared_ptr<parquet::Statistics>
+merge_typed_stats(parquet::FileMetaData *meta, int col)
+{
+    auto merged = parquet::MakeStatistics<DType>(meta->schema()->Column(col));
+
+    for (int r = 0; r < meta->num_row_groups(); ++r)
+    {
+        auto rowgroup = meta->RowGroup(r);
+
+        /* Empty row groups don't affect the result */
+        if (!rowgroup->num_rows())
+            continue;
+
+        auto stats = rowgroup->ColumnChunk(col)->statistics();
+
+        /* One row group without statistics makes the file ones useless */
+        if (!stats || !stats->HasMinMax())
+            return nullptr;
+
+        merged->Merge(*std::static_pointer_cast<parquet::TypedStatistics<DType>>(stats));
+    }
+
+    return merged;
+}
+
+/*
+ * FileSummary::file_stats
+ *      Return statistics of the leaf column merged over all the row groups
+ *      of the file or nullptr if any of the row groups lacks them.
+ */
+std::shared_ptr<parquet::Statistics>
+FileSummary::file_stats(int column_index)
+{
+    std::shared_ptr<parquet::Statistics>    res;
+
+    if (column_index < 0 || column_index >= (int) stats.size())
+        return nullptr;
+
+    if (stats_ready[column_index])
+        return stats[column_index];
+
+    switch (meta->schema()->Column(column_index)->physical_type())
+    {
+        case parquet::Type::BOOLEAN:
+            res = merge_typed_stats<parquet::BooleanType>(meta.get(), column_index);
+            break;
+        case parquet::Type::INT32:
+            res = merge_typed_stats<parquet::Int32Type>(meta.get(), column_index);
+            break;
+        case parquet::Type::INT64:
+            res = merge_typed_stats<parquet::Int64Type>(meta.get(), column_index);
+            break;
+        case parquet::Type::FLOAT:
+            res = merge_typed_stats<parquet::FloatType>(meta.get(), column_index);
+            break;
+        case parquet::Type::DOUBLE:
+            res = merge_typed_stats<parquet::DoubleType>(meta.get(), column_index);
+            break;
+        case parquet::Type::BYTE_ARRAY:
+            res = merge_typed_stats<parquet::ByteArrayType>(meta.get(), column_index);
+            break;
+        case parquet::Type::FIXED_LEN_BYTE_ARRAY:
+            res = merge_typed_stats<parquet::FLBAType>(meta.get(), column_index);
+            break;
+        default:
+            /* INT96 statistics are deprecated and unreliable */
+            break;
+    }
+
+    stats[column_index] = res;
+    stats_ready[column_index] = true;
+
+    return res;
+}
+
+/*
+ * load_file_summary
+ *      Read footer of the file bypassing the cache. No postgres functions are
+ *      called here other than thread-safe strerror_r(), so it's safe to use
+ *      from worker threads.
+ */
+static std::shared_ptr<FileSummary>
+load_file_summary(const char *filename)
+{
+    parquet::ArrowReaderProperties  props;
+    struct stat     st;
+
+    if (stat(filename, &st) != 0)
+    {
+        /* strerror() would use a static buffer shared by all the threads */
+        char    errbuf[PG_STRERROR_R_BUFLEN];
+
+        throw Error("%s ('%s')", strerror_r(errno, errbuf, sizeof(errbuf)),
+                    filename);
+    }
+
+    auto summary = std::make_shared<FileSummary>();
+
+    summary->meta = parquet::ParquetFileReader::OpenFile(filename, false)->metadata();
+    summary->dev = st.st_dev;
+    summary->ino = st.st_ino;
+    summary->mtime = st.st_mtim;
+    summary->size = st.st_size;
+    summary->stats.resize(summary->meta->num_columns());
+    summary->stats_ready.assign(summary->meta->num_columns(), false);
+
+    /*
+     * Manifest keeps pointers to its own fields, so it's built in place and
+     * is never copied.
+     */
+    if (!parquet::arrow::SchemaManifest::Make(summary->meta->schema(), nullptr,
+                                              props, &summary->manifest).ok())
+        throw Error("error creating arrow schema ('%s')", filename);
+
+    return summary;
+}
+
+static void
+remove_file_summary(std::unordered_map<std::string, SummaryEntry>::iterator it)
+{
+    summaries_bytes -= it->second.charge;
+    summaries_lru.erase(it->second.lru_pos);
+    summaries.erase(it);
+}
+
+/*
+ * lookup_file_summary
+ *      Return cached summary of the file unless the file has changed since it
+ *      was cached.
+ */
+static std::shared_ptr<FileSummary>
+lookup_file_summary(const char *filename)
+{
+    struct stat     st;
+    auto            it = summaries.find(filename);
+
+    if (it == summaries.end())
+        return nullptr;
+
+    if (stat(filename, &st) != 0)
+        throw Error("%s ('%s')", strerror(errno), filename);
+
+    SummaryEntry   &entry = it->second;
+    FileSummary    *cached = entry.summary.get();
+
+    /*
+     * Files rewritten within the same second or replaced by renaming another
+     * file over them are told apart by the nanoseconds and the inode.
+     */
+    if (cached->dev == st.st_dev &&
+        cached->ino == st.st_ino &&
+        cached->mtime.tv_sec == st.st_mtim.tv_sec &&
+        cached->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+        cached->size == st.st_size)
+    {
+        summaries_lru.splice(summaries_lru.begin(), summaries_lru,
+                             entry.lru_pos);
+        return entry.summary;
+    }
+
+    /* The file has changed */
+    remove_file_summary(it);
+
+    return nullptr;
+}
+
+/*
+ * summary_charge
+ *      Estimate memory taken by a cached summary. Parsed footers take about
+ *      twice the size of their serialized form; the file level statistics
+ *      are merged lazily, so only their slots are counted.
+ */
+static size_t
+summary_charge(const std::string &filename, const FileSummary *summary)
+{
+    return sizeof(SummaryEntry) + sizeof(FileSummary) + 2 * filename.size() +
+        2 * (size_t) summary->meta->size() +
+        summary->stats.size() * (sizeof(std::shared_ptr<parquet::Statistics>) + 1);
+}
+
+static void
+store_file_summary(const char *filename, std::shared_ptr<FileSummary> summary)
+{
+    size_t      limit = (size_t) parquet_fdw_metadata_cache_size * 1024;
+    size_t      charge;
+
+    if (parquet_fdw_metadata_cache_size <= 0)
+        return;
+
+    /*
+     * The same file may be listed more than once, in which case it's loaded
+     * and stored several times. Drop the older entry along with its LRU node.
+     */
+    auto it = summaries.find(filename);
+    if (it != summaries.end())
+        remove_file_summary(it);
+
+    charge = summary_charge(filename, summary.get());
+    if (charge > limit)
+        return;
+
+    while (summaries_bytes + charge > limit)
+        remove_file_summary(summaries.find(summaries_lru.back()));
+
+    summaries_lru.push_front(filename);
+    summaries[filename] = {summary, summaries_lru.begin(), charge};
+    summaries_bytes += charge;
+}
+
+/*
+ * get_file_summary
+ *      Return metadata of the file reading its footer only if there is no
+ *      cached version or the file has changed since it was cached.
+ */
+std::shared_ptr<FileSummary>
+get_file_summary(const char *filename)
+{
+    auto summary = lookup_file_summary(filename);
+
+    if (!summary)
+    {
+        summary = load_file_summary(filename);
+        store_file_summary(filename, summary);
+    }
+
+    return summary;
+}
+
+/*
+ * get_file_summaries
+ *      Same as get_file_summary() for a bunch of files. Footers missing from
+ *      the cache are read by up to `nthreads` threads (including the calling
+ *      one). Error is thrown if any of the files can't be read.
+ */
+std::vector<std::shared_ptr<FileSummary>>
+get_file_summaries(const std::vector<std::string> &filenames, int nthreads)
+{
+    std::vector<std::shared_ptr<FileSummary>> res(filenames.size());
+    std::vector<size_t>         missing;
+    std::vector<std::string>    errors;
+    std::vector<std::thread>    workers;
+    std::atomic<size_t>         next(0);
+
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        res[i] = lookup_file_summary(filenames[i].c_str());
+        if (!res[i])
+            missing.push_back(i);
+    }
+
+    errors.resize(missing.size());
+
+    auto worker = [&]()
+    {
+        size_t  j;
+
+        while ((j = next++) < missing.size())
+        {
+            try
+            {
+                res[missing[j]] = load_file_summary(filenames[missing[j]].c_str());
+            }
+            catch (const std::exception &e)
+            {
+                errors[j] = e.what();
+            }
+        }
+    };
+
+    for (int t = 1; t < nthreads && (size_t) t < missing.size(); ++t)
+    {
+        try
+        {
+            workers.emplace_back(worker);
+        }
+        catch (const std::system_error &)
+        {
+            /* Go on with the threads we've got */
+            break;
+        }
+    }
+    worker();
+
+    for (auto &w : workers)
+        w.join();
+
+    for (size_t j = 0; j < missing.size(); ++j)
+    {
+        if (!errors[j].empty())
+            throw Error("%s", errors[j].c_str());
+        store_file_summary(filenames[missing[j]].c_str(), res[missing[j]]);
+    }
+
+    return res;
+}
+
+/*
+ * get_cached_file_list
+ *      Look up the list of files previously returned by files_func for the
+ *      given key. Returns false if there is none or it has expired.
+ */
+bool
+get_cached_file_list(const std::string &key, std::vector<std::string> &filenames)
+{
+    auto it = file_lists.find(key);
+
+    if (it == file_lists.end())
+        return false;
+
+    if (GetCurrentTimestamp() >= it->second.expires)
+    {
+        file_lists.erase(it);
+        return false;
+    }
+
+    filenames = it->second.filenames;
+    return true;
+}
+
+/*
+ * cache_file_list
+ *      Remember the list of files for `ttl` seconds.
+ */
+void
+cache_file_list(const std::string &key,
+                const std::vector<std::string> &filenames, int ttl)
+{
+    FileListEntry  &entry = file_lists[key];
+
+    entry.filenames = filenames;
+    entry.expires = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+                                                (int64) ttl * 1000);
+}
+
+/*
+ * reset_caches
+ *      Forget all cached file lists and file metadata.
+ */
+void
+reset_caches()
+{
+    summaries.clear();
+    summaries_lru.clear();
+    summaries_bytes = 0;
+    file_lists.clear();
+}
@@ -0,0 +1,56 @@
+#ifndef PARQUET_FDW_CACHE_HPP
+#define PARQUET_FDW_CACHE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <time.h>
+
+#include "parquet/arrow/schema.h"
+#include "parquet/metadata.h"
+#include "parquet/statistics.h"
+
+
+/*
+ * FileSummary
+ *      Metadata of a parquet file kept across queries. Besides the footer
+ *      itself it holds min/max statistics of every column merged over all
+ *      the row groups, so that the whole file can be excluded by the filters
+ *      without looking at individual row groups. Entries are validated
+ *      against identity (device and inode), modification time with
+ *      nanosecond precision and size of the file on every lookup.
+ */
+struct FileSummary
+{
+    std::shared_ptr<parquet::FileMetaData>  meta;
+    parquet::arrow::SchemaManifest          manifest;
+
+    dev_t       dev;
+    ino_t       ino;
+    struct timespec mtime;
+    off_t       size;
+
+    /* File level statistics per leaf column, merged lazily */
+    std::vector<std::shared_ptr<parquet::Statistics>>  stats;
+    std::vector<bool>                                   stats_ready;
+
+    std::shared_ptr<parquet::Statistics> file_stats(int column_index);
+};
+
+/* Max memory of cached file metadata in kilobytes (GUC) */
+extern int parquet_fdw_metadata_cache_size;
+
+std::shared_ptr<FileSummary> get_file_summary(const char *filename);
+std::vector<std::shared_ptr<FileSummary>>
+get_file_summaries(const std::vector<std::string> &filenames, int nthreads);
+
+bool get_cached_file_list(const std::string &key,
+                          std::vector<std::string> &filenames);
+void cache_file_list(const std::string &key,
+                     const std::vector<std::string> &filenames, int ttl);
+
+void reset_caches();
+
+#endif
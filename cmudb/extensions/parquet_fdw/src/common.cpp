@@ -9,6 +9,7 @@ extern "C"
 #include "utils/date.h"
 #include "utils/memutils.h"
 #include "utils/memdebug.h"
+#include "utils/numeric.h"
 #include "utils/timestamp.h"
 }
 
@@ -69,6 +70,8 @@ to_postgres_type(int arrow_type)
             return TIMESTAMPOID;
         case arrow::Type::DATE32:
             return DATEOID;
+        case arrow::Type::DECIMAL128:
+            return NUMERICOID;
         default:
             return InvalidOid;
     }
@@ -104,16 +107,13 @@ bytes_to_postgres_type(const char *bytes, Size len, const arrow::DataType *arrow
             return PointerGetDatum(cstring_to_text_with_len(bytes, len));
         case arrow::Type::TIMESTAMP:
             {
-                TimestampTz ts;
                 auto tstype = (arrow::TimestampType *) arrow_type;
 
-                to_postgres_timestamp(tstype, *(int64 *) bytes, ts);
-                return TimestampGetDatum(ts);
+                return TimestampGetDatum(to_postgres_timestamp(tstype->unit(),
+                                                               *(int64 *) bytes));
             }
-            break;
         case arrow::Type::DATE32:
-            return DateADTGetDatum(*(int32 *) bytes +
-                                   (UNIX_EPOCH_JDATE - POSTGRES_EPOCH_JDATE));
+            return DateADTGetDatum(*(int32 *) bytes + PARQUET_EPOCH_DAYS_OFFSET);
         default:
             return PointerGetDatum(NULL);
     }
@@ -171,10 +171,23 @@ void datum_to_jsonb(Datum value, Oid typoid, bool isnull, FmgrInfo *outfunc,
             if (iskey) {
                 char    *strval;
 
-                strval = DatumGetCString(FunctionCall1(outfunc, value));
+                /* Print integers directly rather than via output function */
+                if (typoid == INT2OID || typoid == INT4OID || typoid == INT8OID)
+                {
+                    int64   ival = typoid == INT8OID ?
+                        DatumGetInt64(value) : DatumGetInt32(value);
+
+                    strval = (char *) palloc(MAXINT8LEN + 1);
+                    pg_lltoa(ival, strval);
+                    jb.val.string.len = strlen(strval);
+                }
+                else
+                {
+                    strval = DatumGetCString(FunctionCall1(outfunc, value));
+                    jb.val.string.len = strlen(strval);
+                }
 
                 jb.type = jbvString;
-                jb.val.string.len = strlen(strval);
                 jb.val.string.val = strval;
             }
             else {
@@ -184,10 +197,10 @@ void datum_to_jsonb(Datum value, Oid typoid, bool isnull, FmgrInfo *outfunc,
                 {
                     case INT2OID:
                     case INT4OID:
-                        numeric = DirectFunctionCall1(int4_numeric, value);
+                        numeric = NumericGetDatum(int64_to_numeric(DatumGetInt32(value)));
                         break;
                     case INT8OID:
-                        numeric = DirectFunctionCall1(int8_numeric, value);
+                        numeric = NumericGetDatum(int64_to_numeric(DatumGetInt64(value)));
                         break;
                     case FLOAT4OID:
                         numeric = DirectFunctionCall1(float4_numeric, value);
@@ -206,11 +219,12 @@ void datum_to_jsonb(Datum value, Oid typoid, bool isnull, FmgrInfo *outfunc,
         }
         case TEXTOID:
         {
-            char *str = TextDatumGetCString(value);
+            /* Jsonb copies the string when serialized, no need to do it here */
+            text   *str = DatumGetTextPP(value);
 
             jb.type = jbvString;
-            jb.val.string.len = strlen(str);
-            jb.val.string.val = str;
+            jb.val.string.len = VARSIZE_ANY_EXHDR(str);
+            jb.val.string.val = VARDATA_ANY(str);
             break;
         }
         default:
@@ -288,3 +302,141 @@ string_to_int32(const char *s)
 
 	return (int32) l;
 }
+
+/*
+ * has_typed_stats
+ *      Whether min/max statistics of the column can be converted into postgres
+ *      values by bytes_to_postgres_type(). Encoding of decimal statistics
+ *      depends on the physical type of the column (INT32, INT64 or
+ *      FIXED_LEN_BYTE_ARRAY) which cannot be told from the Arrow type.
+ */
+bool
+has_typed_stats(const arrow::DataType *arrow_type)
+{
+    return arrow_type->id() != arrow::Type::DECIMAL128;
+}
+
+/*
+ * to_postgres_timestamp
+ *      Convert Arrow timestamp of the given unit into postgres timestamp.
+ *      Nanoseconds are truncated to microseconds.
+ */
+Timestamp
+to_postgres_timestamp(arrow::TimeUnit::type unit, int64 value)
+{
+    switch (unit)
+    {
+        case arrow::TimeUnit::SECOND:
+            return value * USECS_PER_SEC + PARQUET_EPOCH_USECS_OFFSET;
+        case arrow::TimeUnit::MILLI:
+            return value * 1000 + PARQUET_EPOCH_USECS_OFFSET;
+        case arrow::TimeUnit::MICRO:
+            return value + PARQUET_EPOCH_USECS_OFFSET;
+        case arrow::TimeUnit::NANO:
+            /* round towards minus infinity to keep timestamps ordered */
+            return value / 1000 - (value % 1000 < 0) + PARQUET_EPOCH_USECS_OFFSET;
+        default:
+            throw Error("parquet_fdw: timestamp of unknown precision: %d", unit);
+    }
+}
+
+/*
+ * convert_timestamps
+ *      Convert an array of Arrow timestamps into postgres timestamps. The unit
+ *      is resolved once for the whole array so that the loops are simple
+ *      enough to be vectorized by compiler. Values at NULL positions are
+ *      converted too; the result is just ignored.
+ */
+void
+convert_timestamps(arrow::TimeUnit::type unit, const int64 *src,
+                   Timestamp *dst, int64 n)
+{
+    int64   scale;
+
+    switch (unit)
+    {
+        case arrow::TimeUnit::SECOND:
+            scale = USECS_PER_SEC;
+            break;
+        case arrow::TimeUnit::MILLI:
+            scale = 1000;
+            break;
+        case arrow::TimeUnit::MICRO:
+            for (int64 i = 0; i < n; ++i)
+                dst[i] = src[i] + PARQUET_EPOCH_USECS_OFFSET;
+            return;
+        case arrow::TimeUnit::NANO:
+            for (int64 i = 0; i < n; ++i)
+                dst[i] = src[i] / 1000 - (src[i] % 1000 < 0) +
+                    PARQUET_EPOCH_USECS_OFFSET;
+            return;
+        default:
+            throw Error("parquet_fdw: timestamp of unknown precision: %d", unit);
+    }
+
+    for (int64 i = 0; i < n; ++i)
+        dst[i] = src[i] * scale + PARQUET_EPOCH_USECS_OFFSET;
+}
+
+/*
+ * convert_dates
+ *      Convert an array of Arrow dates into postgres dates.
+ */
+void
+convert_dates(const int32 *src, DateADT *dst, int64 n)
+{
+    for (int64 i = 0; i < n; ++i)
+        dst[i] = src[i] + PARQUET_EPOCH_DAYS_OFFSET;
+}
+
+/*
+ * decimal_to_numeric
+ *      Convert Arrow decimal into postgres numeric. Values which fit into
+ *      int64 are converted directly, others go through their text form.
+ */
+Datum
+decimal_to_numeric(const arrow::Decimal128 &value, int32 scale)
+{
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    char            errstr[ERROR_STR_LEN];
+    std::string     str;
+    Datum           res = (Datum) 0;
+    bool            fits_int64;
+
+    /* High 64 bits are just the sign extension of the low ones */
+    fits_int64 = value.high_bits() == ((int64) value.low_bits() < 0 ? -1 : 0);
+
+    /* int64_div_fast_to_numeric() may overflow with larger scales */
+    if (!fits_int64 || scale < 0 || scale > 9)
+        str = value.ToString(scale);
+
+    PG_TRY();
+    {
+        if (str.empty())
+            res = NumericGetDatum(int64_div_fast_to_numeric((int64) value.low_bits(),
+                                                            scale));
+        else
+            res = DirectFunctionCall3(numeric_in,
+                                      CStringGetDatum(str.c_str()),
+                                      ObjectIdGetDatum(InvalidOid),
+                                      Int32GetDatum(-1));
+    }
+    PG_CATCH();
+    {
+        ErrorData *errdata;
+
+        MemoryContextSwitchTo(ccxt);
+        error = true;
+        errdata = CopyErrorData();
+        FlushErrorState();
+
+        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+        FreeErrorData(errdata);
+    }
+    PG_END_TRY();
+    if (error)
+        throw Error("parquet_fdw: failed to convert decimal: %s", errstr);
+
+    return res;
+}
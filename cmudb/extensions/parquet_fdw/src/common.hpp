@@ -9,6 +9,8 @@
 extern "C"
 {
 #include "postgres.h"
+#include "datatype/timestamp.h"
+#include "utils/date.h"
 #include "utils/jsonb.h"
 }
 
@@ -19,26 +21,12 @@ extern "C"
 #define JsonbPGetDatum JsonbGetDatum
 #endif
 
-#define to_postgres_timestamp(tstype, i, ts)                    \
-    switch ((tstype)->unit()) {                                 \
-        case arrow::TimeUnit::SECOND:                           \
-            ts = time_t_to_timestamptz((i));                    \
-            break;                                              \
-        case arrow::TimeUnit::MILLI:                            \
-            ts = time_t_to_timestamptz((i) / 1000);             \
-            ts = TimestampTzPlusMilliseconds(ts, i % 1000);     \
-            break;                                              \
-        case arrow::TimeUnit::MICRO:                            \
-            ts = time_t_to_timestamptz((i) / 1000000);          \
-            ts = ((ts) + (i % 1000000));                        \
-            break;                                              \
-        case arrow::TimeUnit::NANO:                             \
-            ts = time_t_to_timestamptz((i) / 1000000000);       \
-            break;                                              \
-        default:                                                \
-            elog(ERROR, "Timestamp of unknown precision: %d",   \
-                 (tstype)->unit());                             \
-    }
+/*
+ * Parquet dates and timestamps count from unix epoch (1970-01-01) while
+ * postgres ones count from 2000-01-01.
+ */
+#define PARQUET_EPOCH_DAYS_OFFSET   (UNIX_EPOCH_JDATE - POSTGRES_EPOCH_JDATE)
+#define PARQUET_EPOCH_USECS_OFFSET  ((int64) PARQUET_EPOCH_DAYS_OFFSET * USECS_PER_DAY)
 
 
 struct Error : std::exception
@@ -64,5 +52,12 @@ arrow::Type::type get_arrow_list_elem_type(arrow::DataType *type);
 void datum_to_jsonb(Datum value, Oid typoid, bool isnull, FmgrInfo *outfunc,
                     JsonbParseState *result, bool iskey);
 int32 string_to_int32(const char *s);
+bool has_typed_stats(const arrow::DataType *arrow_type);
+
+Timestamp to_postgres_timestamp(arrow::TimeUnit::type unit, int64 value);
+void convert_timestamps(arrow::TimeUnit::type unit, const int64 *src,
+                        Timestamp *dst, int64 n);
+void convert_dates(const int32 *src, DateADT *dst, int64 n);
+Datum decimal_to_numeric(const arrow::Decimal128 &value, int32 scale);
 
 #endif
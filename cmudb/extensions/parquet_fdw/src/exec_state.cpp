@@ -1,9 +1,12 @@
 #include "exec_state.hpp"
-#include "heap.hpp"
+#include "loser_tree.hpp"
 
 #include <sys/time.h>
-#include <functional>
-#include <list>
+
+extern "C"
+{
+#include "miscadmin.h"
+}
 
 
 #if PG_VERSION_NUM < 110000
@@ -52,6 +55,62 @@ public:
     }
 };
 
+/*
+ * AggregateExecutionState
+ *      Returns a single tuple of aggregate values computed by planner from
+ *      row group statistics (see parquetGetForeignUpperPaths()).
+ */
+class AggregateExecutionState : public ParquetFdwExecutionState
+{
+private:
+    List   *values;     /* List of Consts */
+    bool    done;
+
+public:
+    AggregateExecutionState(List *values)
+        : values(values), done(false)
+    {}
+    bool next(TupleTableSlot *slot, bool)
+    {
+        ListCell   *lc;
+        int         i = 0;
+
+        if (done)
+            return false;
+
+        foreach (lc, values)
+        {
+            Const  *c = (Const *) lfirst(lc);
+
+            slot->tts_values[i] = c->constvalue;
+            slot->tts_isnull[i] = c->constisnull;
+            i++;
+        }
+        ExecStoreVirtualTuple(slot);
+        done = true;
+
+        return true;
+    }
+    void rescan(void)
+    {
+        done = false;
+    }
+    void add_file(const char *, List *)
+    {
+        Assert(false && "add_file is not supported for AggregateExecutionState");
+    }
+    void set_coordinator(ParallelCoordinator *) {}
+    Size estimate_coord_size()
+    {
+        Assert(false && "estimate_coord_size is not supported for AggregateExecutionState");
+        return 0;
+    }
+    void init_coord()
+    {
+        Assert(false && "init_coord is not supported for AggregateExecutionState");
+    }
+};
+
 
 class SingleFileExecutionState : public ParquetFdwExecutionState
 {
@@ -63,6 +122,7 @@ private:
     std::set<int>       attrs_used;
     bool                use_mmap;
     bool                use_threads;
+    bool                pre_buffer;
 
 public:
     MemoryContext       estate_cxt;
@@ -71,9 +131,10 @@ public:
                              TupleDesc tuple_desc,
                              std::set<int> attrs_used,
                              bool use_threads,
-                             bool use_mmap)
+                             bool use_mmap,
+                             bool pre_buffer)
         : cxt(cxt), tuple_desc(tuple_desc), attrs_used(attrs_used),
-          use_mmap(use_mmap), use_threads(use_threads)
+          use_mmap(use_mmap), use_threads(use_threads), pre_buffer(pre_buffer)
     { }
 
     ~SingleFileExecutionState()
@@ -97,6 +158,21 @@ public:
         reader->rescan();
     }
 
+    bool ready()
+    {
+        return reader->ready();
+    }
+
+    int wait_event_fd()
+    {
+        return reader->wait_event_fd();
+    }
+
+    void clear_wait_event()
+    {
+        reader->clear_wait_event();
+    }
+
     void add_file(const char *filename, List *rowgroups)
     {
         ListCell           *lc;
@@ -106,10 +182,12 @@ public:
             rg.push_back(lfirst_int(lc));
 
         reader = create_parquet_reader(filename, cxt);
-        reader->set_options(use_threads, use_mmap);
+        reader->set_options(use_threads, use_mmap, pre_buffer);
         reader->set_rowgroups_list(rg);
         reader->open();
         reader->create_column_mapping(tuple_desc, attrs_used);
+        if (!runtime_filters.empty())
+            reader->set_runtime_filters(&runtime_filters);
     }
 
     void set_coordinator(ParallelCoordinator *coord)
@@ -150,6 +228,7 @@ private:
     std::set<int>           attrs_used;
     bool                    use_threads;
     bool                    use_mmap;
+    bool                    pre_buffer;
 
     ParallelCoordinator    *coord;
 
@@ -170,10 +249,12 @@ private:
 
         r = create_parquet_reader(files[cur_reader].filename.c_str(), cxt, cur_reader);
         r->set_rowgroups_list(files[cur_reader].rowgroups);
-        r->set_options(use_threads, use_mmap);
+        r->set_options(use_threads, use_mmap, pre_buffer);
         r->set_coordinator(coord);
         r->open();
         r->create_column_mapping(tuple_desc, attrs_used);
+        if (!runtime_filters.empty())
+            r->set_runtime_filters(&runtime_filters);
 
         cur_reader++;
 
@@ -185,10 +266,11 @@ public:
                             TupleDesc tuple_desc,
                             std::set<int> attrs_used,
                             bool use_threads,
-                            bool use_mmap)
+                            bool use_mmap,
+                            bool pre_buffer)
         : reader(NULL), cur_reader(0), cxt(cxt), tuple_desc(tuple_desc),
           attrs_used(attrs_used), use_threads(use_threads), use_mmap(use_mmap),
-          coord(NULL)
+          pre_buffer(pre_buffer), coord(NULL)
     { }
 
     ~MultifileExecutionState()
@@ -238,9 +320,45 @@ public:
         return res;
     }
 
+    /*
+     * Start over from the first file. Rescans are frequent for the inner side
+     * of parameterized nested loop, so the first reader is reused if it is
+     * still open.
+     */
     void rescan(void)
     {
-        reader->rescan();
+        if (reader && (coord || reader->id() != 0))
+        {
+            delete reader;
+            reader = NULL;
+        }
+
+        if (reader)
+        {
+            reader->rescan();
+            cur_reader = 1;
+        }
+        else
+            cur_reader = 0;
+    }
+
+    /*
+     * Opening of the next file is synchronous, only reading of row groups
+     * within a file is waited for asynchronously.
+     */
+    bool ready()
+    {
+        return reader == NULL || reader->ready();
+    }
+
+    int wait_event_fd()
+    {
+        return reader->wait_event_fd();
+    }
+
+    void clear_wait_event()
+    {
+        reader->clear_wait_event();
     }
 
     void add_file(const char *filename, List *rowgroups)
@@ -283,8 +401,22 @@ class MultifileMergeExecutionStateBase : public ParquetFdwExecutionState
 protected:
     struct ReaderSlot
     {
-        int             reader_id;
         TupleTableSlot *slot;
+        Datum           key;        /* leading sort key, abbreviated if the */
+        bool            key_isnull; /* sort support provides abbreviation   */
+
+        ReaderSlot() : slot(NULL), key((Datum) 0), key_isnull(true) {}
+    };
+
+    /* Comparator used by loser tree; inlined in the tree code */
+    struct SlotCompare
+    {
+        MultifileMergeExecutionStateBase *state;
+
+        int operator()(const ReaderSlot &a, const ReaderSlot &b) const
+        {
+            return state->compare_slots(a, b);
+        }
     };
 
 protected:
@@ -293,57 +425,97 @@ protected:
     MemoryContext       cxt;
     TupleDesc           tuple_desc;
     std::set<int>       attrs_used;
-    std::list<SortSupportData> sort_keys;
+    std::vector<SortSupportData> sort_keys;
     bool                use_threads;
     bool                use_mmap;
+    bool                pre_buffer;
     ParallelCoordinator *coord;
 
     /*
-     * Heap is used to store tuples in prioritized manner along with file
-     * number. Priority is given to the tuples with minimal key. Once next
-     * tuple is requested it is being taken from the top of the heap and a new
-     * tuple from the same file is read and inserted back into the heap. Then
-     * heap is rebuilt to sustain its properties. The idea is taken from
-     * nodeGatherMerge.c in PostgreSQL but reimplemented using STL.
+     * Tournament (loser) tree is used to store tuples in prioritized manner,
+     * one leaf per file. Priority is given to the tuples with minimal key.
+     * Once next tuple is requested it is being taken from the winner's leaf
+     * and a new tuple from the same file is read into that leaf. Then only
+     * the matches on the path from the leaf to the root are replayed, i.e.
+     * log2(N) comparisons per tuple. The leading key of every leaf is cached
+     * (abbreviated if possible) so that most comparisons are resolved without
+     * touching the tuples at all.
      */
-    Heap<ReaderSlot>    slots;
+    LoserTree<ReaderSlot, SlotCompare> slots;
     bool                slots_initialized;
 
 protected:
+    /*
+     * cache_key
+     *      Extract the leading sort key from the slot and convert it into
+     *      abbreviated form if sort support provides one.
+     */
+    inline void cache_key(ReaderSlot &rs)
+    {
+        SortSupport ssup = &sort_keys[0];
+
+        rs.key = rs.slot->tts_values[ssup->ssup_attno - 1];
+        rs.key_isnull = rs.slot->tts_isnull[ssup->ssup_attno - 1];
+
+        if (ssup->abbrev_converter && !rs.key_isnull)
+            rs.key = ssup->abbrev_converter(rs.key, ssup);
+    }
+
     /*
      * compare_slots
-     *      Compares two slots according to sort keys. Returns true if a > b,
-     *      false otherwise. The function is stolen from nodeGatherMerge.c
-     *      (postgres) and adapted.
+     *      Compares two slots according to sort keys. Returns negative value
+     *      if a < b, zero if they are equal and positive value otherwise. The
+     *      logic mirrors comparetup_heap() from tuplesort.c.
+     *
+     *      Slots are always virtual and fully populated by readers so we can
+     *      access tts_values/tts_isnull directly bypassing slot_getattr().
      */
-    bool compare_slots(const ReaderSlot &a, const ReaderSlot &b)
+    inline int compare_slots(const ReaderSlot &a, const ReaderSlot &b)
     {
         TupleTableSlot *s1 = a.slot;
         TupleTableSlot *s2 = b.slot;
+        SortSupport     ssup = &sort_keys[0];
+        int             compare;
 
         Assert(!TupIsNull(s1));
         Assert(!TupIsNull(s2));
 
-        for (auto sort_key: sort_keys)
+        /* Compare the leading (possibly abbreviated) keys first */
+        compare = ApplySortComparator(a.key, a.key_isnull,
+                                      b.key, b.key_isnull,
+                                      ssup);
+        if (compare != 0)
+            return compare;
+
+        /* Abbreviated keys are equal, need to compare the full values */
+        if (ssup->abbrev_converter)
         {
-            AttrNumber  attno = sort_key.ssup_attno;
-            Datum       datum1,
-                        datum2;
-            bool        isNull1,
-                        isNull2;
-            int         compare;
-
-            datum1 = slot_getattr(s1, attno, &isNull1);
-            datum2 = slot_getattr(s2, attno, &isNull2);
-
-            compare = ApplySortComparator(datum1, isNull1,
-                                          datum2, isNull2,
-                                          &sort_key);
+            AttrNumber  attno = ssup->ssup_attno - 1;
+
+            compare = ApplySortAbbrevFullComparator(s1->tts_values[attno],
+                                                    s1->tts_isnull[attno],
+                                                    s2->tts_values[attno],
+                                                    s2->tts_isnull[attno],
+                                                    ssup);
             if (compare != 0)
-                return (compare > 0);
+                return compare;
         }
 
-        return false;
+        for (size_t i = 1; i < sort_keys.size(); ++i)
+        {
+            ssup = &sort_keys[i];
+            AttrNumber  attno = ssup->ssup_attno - 1;
+
+            compare = ApplySortComparator(s1->tts_values[attno],
+                                          s1->tts_isnull[attno],
+                                          s2->tts_values[attno],
+                                          s2->tts_isnull[attno],
+                                          ssup);
+            if (compare != 0)
+                return compare;
+        }
+
+        return 0;
     }
 
     void set_coordinator(ParallelCoordinator *coord)
@@ -373,11 +545,10 @@ private:
      */
     void initialize_slots()
     {
-        std::function<bool(const ReaderSlot &, const ReaderSlot &)> cmp =
-            [this] (const ReaderSlot &a, const ReaderSlot &b) { return compare_slots(a, b); };
         int i = 0;
 
-        slots.init(readers.size(), cmp);
+        Assert(!sort_keys.empty());
+        slots.init(readers.size(), SlotCompare{this});
         for (auto reader: readers)
         {
             ReaderSlot    rs;
@@ -395,12 +566,14 @@ private:
             if (reader->next(rs.slot) == RS_SUCCESS)
             {
                 ExecStoreVirtualTuple(rs.slot);
-                rs.reader_id = i;
-                slots.append(rs);
+                PG_TRY_INLINE({ cache_key(rs); }, "sort key extraction failed");
+                slots.set(i, rs);
             }
+            else
+                slots[i] = rs;  /* keep the slot for rescan/cleanup */
             ++i;
         }
-        PG_TRY_INLINE({ slots.heapify(); }, "heapify failed");
+        PG_TRY_INLINE({ slots.build(); }, "building merge tree failed");
         slots_initialized = true;
     }
 
@@ -408,9 +581,10 @@ public:
     MultifileMergeExecutionState(MemoryContext cxt,
                                  TupleDesc tuple_desc,
                                  std::set<int> attrs_used,
-                                 std::list<SortSupportData> sort_keys,
+                                 std::vector<SortSupportData> sort_keys,
                                  bool use_threads,
-                                 bool use_mmap)
+                                 bool use_mmap,
+                                 bool pre_buffer)
     {
         this->cxt = cxt;
         this->tuple_desc = tuple_desc;
@@ -418,6 +592,7 @@ public:
         this->sort_keys = sort_keys;
         this->use_threads = use_threads;
         this->use_mmap = use_mmap;
+        this->pre_buffer = pre_buffer;
         this->slots_initialized = false;
     }
 
@@ -425,8 +600,9 @@ public:
     {
 #if PG_VERSION_NUM < 110000
         /* Destroy tuple slots if any */
-        for (int i = 0; i < slots.size(); i++)
-            ExecDropSingleTupleTableSlot(slots[i].slot);
+        for (size_t i = 0; i < slots.capacity(); i++)
+            if (slots[i].slot)
+                ExecDropSingleTupleTableSlot(slots[i].slot);
 #endif
 
         for (auto it: readers)
@@ -442,7 +618,8 @@ public:
             return false;
 
         /* Copy slot with the smallest key into the resulting slot */
-        const ReaderSlot &head = slots.head();
+        ReaderSlot &head = slots.head();
+        int         reader_id = slots.winner();
         PG_TRY_INLINE(
             {
                 ExecCopySlot(slot, head.slot);
@@ -452,34 +629,28 @@ public:
 
         /*
          * Try to read another record from the same reader as in the head slot.
-         * In case of success the new record makes it into the heap and the
-         * heap gets reheapified. Else if there are no more records in the
-         * reader then current head is removed from the heap and heap gets
-         * reheapified.
+         * In case of success the new record takes the place of the head in
+         * the tree and the matches on its path are replayed. Else if there
+         * are no more records in the reader then its leaf is deactivated.
          */
-        if (readers[head.reader_id]->next(head.slot) == RS_SUCCESS)
+        if (readers[reader_id]->next(head.slot) == RS_SUCCESS)
         {
             ExecStoreVirtualTuple(head.slot);
-            PG_TRY_INLINE({ slots.heapify_head(); }, "heapify failed");
-        }
-        else
-        {
-#if PG_VERSION_NUM < 110000
-            /* Release slot resources */
             PG_TRY_INLINE(
                 {
-                    ExecDropSingleTupleTableSlot(head.slot);
-                }, "failed to drop a tuple slot"
+                    cache_key(head);
+                    slots.replay_head();
+                }, "merge tree update failed"
             );
-#endif
-            slots.pop();
         }
+        else
+            PG_TRY_INLINE({ slots.pop(); }, "merge tree update failed");
+
         return true;
     }
 
     void rescan(void)
     {
-        /* TODO: clean binheap */
         for (auto reader: readers)
             reader->rescan();
         slots.clear();
@@ -498,9 +669,11 @@ public:
 
         r = create_parquet_reader(filename, cxt, reader_id);
         r->set_rowgroups_list(rg);
-        r->set_options(use_threads, use_mmap);
+        r->set_options(use_threads, use_mmap, pre_buffer);
         r->open();
         r->create_column_mapping(tuple_desc, attrs_used);
+        if (!runtime_filters.empty())
+            r->set_runtime_filters(&runtime_filters);
         readers.push_back(r);
     }
 };
@@ -529,13 +702,20 @@ private:
      */
     void initialize_slots()
     {
-        std::function<bool(const ReaderSlot &, const ReaderSlot &)> cmp =
-            [this] (const ReaderSlot &a, const ReaderSlot &b) { return compare_slots(a, b); };
-        int i = 0;
+        int     i = 0;
+        size_t  budget;
 
         this->ts_active.resize(readers.size(), 0);
 
-        slots.init(readers.size(), cmp);
+        /*
+         * Every reader keeps a batch of rows materialized even when its file
+         * is closed. Split work_mem between them so that the merge of many
+         * files doesn't blow up memory.
+         */
+        budget = (size_t) work_mem * 1024L / Max(readers.size(), 1);
+
+        Assert(!sort_keys.empty());
+        slots.init(readers.size(), SlotCompare{this});
         for (auto reader: readers)
         {
             ReaderSlot    rs;
@@ -550,18 +730,21 @@ private:
                 }, "failed to create a TupleTableSlot"
             );
 
+            reader->set_memory_budget(budget);
             activate_reader(reader);
             reader->create_column_mapping(tuple_desc, attrs_used);
 
             if (reader->next(rs.slot) == RS_SUCCESS)
             {
                 ExecStoreVirtualTuple(rs.slot);
-                rs.reader_id = i;
-                slots.append(rs);
+                PG_TRY_INLINE({ cache_key(rs); }, "sort key extraction failed");
+                slots.set(i, rs);
             }
+            else
+                slots[i] = rs;  /* keep the slot for rescan/cleanup */
             ++i;
         }
-        PG_TRY_INLINE({ slots.heapify(); }, "heapify failed");
+        PG_TRY_INLINE({ slots.build(); }, "building merge tree failed");
         slots_initialized = true;
     }
 
@@ -615,9 +798,10 @@ public:
     CachingMultifileMergeExecutionState(MemoryContext cxt,
                                         TupleDesc tuple_desc,
                                         std::set<int> attrs_used,
-                                        std::list<SortSupportData> sort_keys,
+                                        std::vector<SortSupportData> sort_keys,
                                         bool use_threads,
                                         bool use_mmap,
+                                        bool pre_buffer,
                                         int max_open_files)
         : num_active_readers(0), max_open_files(max_open_files)
     {
@@ -627,6 +811,7 @@ public:
         this->sort_keys = sort_keys;
         this->use_threads = use_threads;
         this->use_mmap = use_mmap;
+        this->pre_buffer = pre_buffer;
         this->slots_initialized = false;
     }
 
@@ -634,8 +819,9 @@ public:
     {
 #if PG_VERSION_NUM < 110000
         /* Destroy tuple slots if any */
-        for (int i = 0; i < slots.size(); i++)
-            ExecDropSingleTupleTableSlot(slots[i].slot);
+        for (size_t i = 0; i < slots.capacity(); i++)
+            if (slots[i].slot)
+                ExecDropSingleTupleTableSlot(slots[i].slot);
 #endif
 
         for (auto it: readers)
@@ -651,7 +837,8 @@ public:
             return false;
 
         /* Copy slot with the smallest key into the resulting slot */
-        const ReaderSlot &head = slots.head();
+        ReaderSlot &head = slots.head();
+        int         reader_id = slots.winner();
         PG_TRY_INLINE(
             {
                 ExecCopySlot(slot, head.slot);
@@ -661,36 +848,33 @@ public:
 
         /*
          * Try to read another record from the same reader as in the head slot.
-         * In case of success the new record makes it into the heap and the
-         * heap gets reheapified. If next() returns RS_INACTIVE try to reopen
-         * reader and retry. If there are no more records in the reader then
-         * current head is removed from the heap and heap gets reheapified.
+         * In case of success the new record takes the place of the head in
+         * the tree and the matches on its path are replayed. If next()
+         * returns RS_INACTIVE try to reopen reader and retry. If there are no
+         * more records in the reader then its leaf is deactivated.
          */
         while (true) {
-            ReadStatus status = readers[head.reader_id]->next(head.slot);
+            ReadStatus status = readers[reader_id]->next(head.slot);
 
             switch(status)
             {
                 case RS_SUCCESS:
                     ExecStoreVirtualTuple(head.slot);
-                    PG_TRY_INLINE({ slots.heapify_head(); }, "heapify failed");
+                    PG_TRY_INLINE(
+                        {
+                            cache_key(head);
+                            slots.replay_head();
+                        }, "merge tree update failed"
+                    );
                     return true;
 
                 case RS_INACTIVE:
                     /* Reactivate reader and retry */
-                    activate_reader(readers[head.reader_id]);
+                    activate_reader(readers[reader_id]);
                     break;
 
                 case RS_EOF:
-#if PG_VERSION_NUM < 110000
-                    /* Release slot resources */
-                    PG_TRY_INLINE(
-                        {
-                            ExecDropSingleTupleTableSlot(head.slot);
-                        }, "failed to drop a tuple slot"
-                    );
-#endif
-                    slots.pop();
+                    PG_TRY_INLINE({ slots.pop(); }, "merge tree update failed");
                     return true;
             }
         }
@@ -698,7 +882,6 @@ public:
 
     void rescan(void)
     {
-        /* TODO: clean binheap */
         for (auto reader: readers)
             reader->rescan();
         slots.clear();
@@ -717,7 +900,7 @@ public:
 
         r = create_parquet_reader(filename, cxt, reader_id, true);
         r->set_rowgroups_list(rg);
-        r->set_options(use_threads, use_mmap);
+        r->set_options(use_threads, use_mmap, pre_buffer);
         readers.push_back(r);
     }
 
@@ -731,9 +914,10 @@ ParquetFdwExecutionState *create_parquet_execution_state(ReaderType reader_type,
                                                          MemoryContext reader_cxt,
                                                          TupleDesc tuple_desc,
                                                          std::set<int> &attrs_used,
-                                                         std::list<SortSupportData> sort_keys,
+                                                         std::vector<SortSupportData> sort_keys,
                                                          bool use_threads,
                                                          bool use_mmap,
+                                                         bool pre_buffer,
                                                          int32_t max_open_files)
 {
     switch (reader_type)
@@ -743,21 +927,27 @@ ParquetFdwExecutionState *create_parquet_execution_state(ReaderType reader_type,
         case RT_SINGLE:
             return new SingleFileExecutionState(reader_cxt, tuple_desc,
                                                 attrs_used, use_threads,
-                                                use_mmap);
+                                                use_mmap, pre_buffer);
         case RT_MULTI:
             return new MultifileExecutionState(reader_cxt, tuple_desc,
                                                attrs_used, use_threads,
-                                               use_mmap);
+                                               use_mmap, pre_buffer);
         case RT_MULTI_MERGE:
             return new MultifileMergeExecutionState(reader_cxt, tuple_desc,
                                                     attrs_used, sort_keys, 
-                                                    use_threads, use_mmap);
+                                                    use_threads, use_mmap,
+                                                    pre_buffer);
         case RT_CACHING_MULTI_MERGE:
             return new CachingMultifileMergeExecutionState(reader_cxt, tuple_desc,
                                                            attrs_used, sort_keys, 
                                                            use_threads, use_mmap,
-                                                           max_open_files);
+                                                           pre_buffer, max_open_files);
         default:
             throw std::runtime_error("unknown reader type");
     }
 }
+
+ParquetFdwExecutionState *create_aggregate_execution_state(List *values)
+{
+    return new AggregateExecutionState(values);
+}
@@ -1,8 +1,8 @@
 #ifndef PARQUET_FDW_EXEC_STATE_HPP
 #define PARQUET_FDW_EXEC_STATE_HPP
 
-#include <list>
 #include <set>
+#include <vector>
 
 #include "reader.hpp"
 
@@ -11,6 +11,7 @@ extern "C"
 #include "postgres.h"
 #include "access/tupdesc.h"
 #include "executor/tuptable.h"
+#include "nodes/primnodes.h"
 #include "utils/sortsupport.h"
 }
 
@@ -21,7 +22,8 @@ enum ReaderType
     RT_SINGLE,
     RT_MULTI,
     RT_MULTI_MERGE,
-    RT_CACHING_MULTI_MERGE
+    RT_CACHING_MULTI_MERGE,
+    RT_AGGREGATE
 };
 
 class ParquetFdwExecutionState
@@ -34,15 +36,36 @@ public:
     virtual void set_coordinator(ParallelCoordinator *coord) = 0;
     virtual Size estimate_coord_size() = 0;
     virtual void init_coord() = 0;
+
+    /*
+     * Asynchronous execution support. ready() tells whether next() can return
+     * a tuple without waiting for I/O; otherwise wait_event_fd() becomes
+     * readable once it can.
+     */
+    virtual bool ready() { return true; }
+    virtual int wait_event_fd() { return -1; }
+    virtual void clear_wait_event() {}
+
+    /*
+     * Runtime filters (see RuntimeFilter). Caller computes their values before
+     * the first tuple is read and after every rescan, i.e. whenever
+     * 'runtime_filters_valid' is false. Values are allocated in
+     * 'runtime_filters_cxt'.
+     */
+    std::vector<RuntimeFilter>  runtime_filters;
+    MemoryContext               runtime_filters_cxt = NULL;
+    bool                        runtime_filters_valid = false;
 };
 
 ParquetFdwExecutionState *create_parquet_execution_state(ReaderType reader_type,
                                                          MemoryContext reader_cxt,
                                                          TupleDesc tuple_desc,
                                                          std::set<int> &attrs_used,
-                                                         std::list<SortSupportData> sort_keys,
+                                                         std::vector<SortSupportData> sort_keys,
                                                          bool use_threads,
                                                          bool use_mmap,
+                                                         bool pre_buffer,
                                                          int32_t max_open_files);
+ParquetFdwExecutionState *create_aggregate_execution_state(List *values);
 
 #endif
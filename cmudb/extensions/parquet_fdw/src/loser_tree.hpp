@@ -0,0 +1,163 @@
+#ifndef PARQUET_FDW_LOSER_TREE_HPP
+#define PARQUET_FDW_LOSER_TREE_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/*
+ * LoserTree
+ *      Tournament tree for k-way merging. Every inner node keeps the loser of
+ *      the match played in it while the overall winner is stored separately.
+ *      Once the winner's input is advanced only the matches on the path from
+ *      its leaf to the root have to be replayed, which takes exactly
+ *      ceil(log2(k)) comparisons (binary heap needs up to twice as many).
+ *
+ *      `Compare` is a functor type returning a negative, zero or positive
+ *      value like ApplySortComparator() does. It is a template parameter so
+ *      that the comparison can be inlined (no std::function or virtual
+ *      calls).
+ *
+ *      Leaves are addressed by input number. Exhausted inputs are marked as
+ *      inactive and lose every match.
+ */
+template<class T, class Compare>
+class LoserTree
+{
+private:
+    std::vector<T>      _leaves;
+    std::vector<bool>   _active;
+    std::vector<int>    _nodes;     /* losers; _nodes[0] is the winner */
+    size_t              _k;
+    Compare             _cmp;
+
+private:
+    /* Returns true if input `a` wins the match against input `b` */
+    inline bool beats(int a, int b)
+    {
+        int     cmp;
+
+        if (!_active[a])
+            return false;
+        if (!_active[b])
+            return true;
+
+        cmp = _cmp(_leaves[a], _leaves[b]);
+
+        /* prefer the lower input number on ties to keep the merge stable */
+        return cmp != 0 ? cmp < 0 : a < b;
+    }
+
+    /*
+     * Play all the matches in subtree rooted at `node` and return the winner.
+     * Nodes [1, k) are inner nodes, [k, 2k) are leaves.
+     */
+    int build(size_t node)
+    {
+        int     left, right;
+
+        if (node >= _k)
+            return node - _k;
+
+        left = build(node * 2);
+        right = build(node * 2 + 1);
+
+        if (beats(right, left))
+        {
+            _nodes[node] = left;
+            return right;
+        }
+        _nodes[node] = right;
+        return left;
+    }
+
+public:
+    LoserTree() : _k(0) {}
+
+    void init(size_t k, Compare cmp)
+    {
+        _k = k;
+        _cmp = cmp;
+        _leaves.assign(k, T());
+        _active.assign(k, false);
+        _nodes.assign(k > 0 ? k : 1, 0);
+    }
+
+    size_t capacity()
+    {
+        return _k;
+    }
+
+    T& operator[](int idx)
+    {
+        return _leaves[idx];
+    }
+
+    /*
+     * Set the initial value for the input. Used for initialization only,
+     * call build() after all the inputs are set.
+     */
+    void set(int idx, const T &value)
+    {
+        _leaves[idx] = value;
+        _active[idx] = true;
+    }
+
+    /*
+     * Play the entire tournament.
+     */
+    void build()
+    {
+        if (_k > 0)
+            _nodes[0] = build(1);
+    }
+
+    bool empty()
+    {
+        return _k == 0 || !_active[_nodes[0]];
+    }
+
+    void clear()
+    {
+        _active.assign(_k, false);
+    }
+
+    int winner()
+    {
+        return _nodes[0];
+    }
+
+    T& head()
+    {
+        return _leaves[_nodes[0]];
+    }
+
+    /*
+     * Replay the matches on the path from the winner's leaf to the root after
+     * its value was changed (i.e. the next value from the same input was
+     * read into the head).
+     */
+    void replay_head()
+    {
+        int     winner = _nodes[0];
+
+        for (size_t node = (winner + _k) / 2; node > 0; node /= 2)
+        {
+            if (beats(_nodes[node], winner))
+                std::swap(_nodes[node], winner);
+        }
+        _nodes[0] = winner;
+    }
+
+    /*
+     * Mark the winner's input as exhausted and replay the matches.
+     */
+    void pop()
+    {
+        _active[_nodes[0]] = false;
+        replay_head();
+    }
+};
+
+#endif
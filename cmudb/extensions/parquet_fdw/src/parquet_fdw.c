@@ -23,6 +23,11 @@ extern void parquetGetForeignRelSize(PlannerInfo *root,
 extern void parquetGetForeignPaths(PlannerInfo *root,
                     RelOptInfo *baserel,
                     Oid foreigntableid);
+extern void parquetGetForeignUpperPaths(PlannerInfo *root,
+                                        UpperRelationKind stage,
+                                        RelOptInfo *input_rel,
+                                        RelOptInfo *output_rel,
+                                        void *extra);
 extern ForeignScan *parquetGetForeignPlan(PlannerInfo *root,
                       RelOptInfo *baserel,
                       Oid foreigntableid,
@@ -56,6 +61,10 @@ extern void parquetInitializeWorkerForeignScan(ForeignScanState *node,
                                                shm_toc *toc,
                                                void *coordinate);
 extern void parquetShutdownForeignScan(ForeignScanState *node);
+extern bool parquetIsForeignPathAsyncCapable(ForeignPath *path);
+extern void parquetForeignAsyncRequest(AsyncRequest *areq);
+extern void parquetForeignAsyncConfigureWait(AsyncRequest *areq);
+extern void parquetForeignAsyncNotify(AsyncRequest *areq);
 extern List *parquetImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid);
 extern Datum parquet_fdw_validator_impl(PG_FUNCTION_ARGS);
 
@@ -63,6 +72,10 @@ extern Datum parquet_fdw_validator_impl(PG_FUNCTION_ARGS);
 extern bool parquet_fdw_use_threads;
 extern bool enable_multifile;
 extern bool enable_multifile_merge;
+extern bool enable_aggregate_pushdown;
+extern int parquet_fdw_metadata_cache_size;
+extern int parquet_fdw_import_threads;
+extern char *parquet_fdw_schema_cache_directory;
 
 void
 _PG_init(void)
@@ -99,6 +112,55 @@ _PG_init(void)
 							NULL,
 							NULL,
 							NULL);
+
+	DefineCustomBoolVariable("parquet_fdw.enable_aggregate_pushdown",
+							"Enables computing aggregates from row group statistics",
+							NULL,
+							&enable_aggregate_pushdown,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("parquet_fdw.metadata_cache_size",
+							"Sets the maximum memory used to cache file metadata",
+							"Zero disables the cache.",
+							&parquet_fdw_metadata_cache_size,
+							262144,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("parquet_fdw.import_threads",
+							"Sets the number of threads reading file metadata in IMPORT FOREIGN SCHEMA",
+							NULL,
+							&parquet_fdw_import_threads,
+							8,
+							1,
+							256,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomStringVariable("parquet_fdw.schema_cache_directory",
+							   "Sets the directory where the schemas of imported files are kept",
+							   "A relative path is relative to the data directory. "
+							   "An empty string disables the persistent schema cache.",
+							   &parquet_fdw_schema_cache_directory,
+							   "parquet_fdw_schemas",
+							   PGC_SUSET,
+							   0,
+							   NULL,
+							   NULL,
+							   NULL);
 }
 
 PG_FUNCTION_INFO_V1(parquet_fdw_validator);
@@ -117,6 +179,7 @@ parquet_fdw_handler(PG_FUNCTION_ARGS)
     fdwroutine->GetForeignRelSize = parquetGetForeignRelSize;
     fdwroutine->GetForeignPaths = parquetGetForeignPaths;
     fdwroutine->GetForeignPlan = parquetGetForeignPlan;
+    fdwroutine->GetForeignUpperPaths = parquetGetForeignUpperPaths;
     fdwroutine->BeginForeignScan = parquetBeginForeignScan;
     fdwroutine->IterateForeignScan = parquetIterateForeignScan;
     fdwroutine->ReScanForeignScan = parquetReScanForeignScan;
@@ -129,6 +192,10 @@ parquet_fdw_handler(PG_FUNCTION_ARGS)
     fdwroutine->ReInitializeDSMForeignScan = parquetReInitializeDSMForeignScan;
     fdwroutine->InitializeWorkerForeignScan = parquetInitializeWorkerForeignScan;
     fdwroutine->ShutdownForeignScan = parquetShutdownForeignScan;
+    fdwroutine->IsForeignPathAsyncCapable = parquetIsForeignPathAsyncCapable;
+    fdwroutine->ForeignAsyncRequest = parquetForeignAsyncRequest;
+    fdwroutine->ForeignAsyncConfigureWait = parquetForeignAsyncConfigureWait;
+    fdwroutine->ForeignAsyncNotify = parquetForeignAsyncNotify;
     fdwroutine->ImportForeignSchema = parquetImportForeignSchema;
 
     PG_RETURN_POINTER(fdwroutine);
@@ -15,15 +15,17 @@
 #include "arrow/api.h"
 #include "arrow/io/api.h"
 #include "arrow/array.h"
+#include "arrow/util/compression.h"
 #include "parquet/arrow/reader.h"
 #include "parquet/arrow/schema.h"
 #include "parquet/exception.h"
 #include "parquet/file_reader.h"
 #include "parquet/statistics.h"
 
-#include "heap.hpp"
+#include "cache.hpp"
 #include "exec_state.hpp"
 #include "reader.hpp"
+#include "writer.hpp"
 #include "common.hpp"
 
 extern "C"
@@ -35,10 +37,16 @@ extern "C"
 #include "access/sysattr.h"
 #include "access/nbtree.h"
 #include "access/reloptions.h"
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_authid.h"
 #include "catalog/pg_foreign_table.h"
+#include "catalog/pg_namespace.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
+#include "common/hashfn.h"
 #include "commands/explain.h"
+#include "executor/execAsync.h"
+#include "executor/executor.h"
 #include "executor/spi.h"
 #include "executor/tuptable.h"
 #include "foreign/foreign.h"
@@ -56,13 +64,19 @@ extern "C"
 #include "parser/parse_func.h"
 #include "parser/parse_oper.h"
 #include "parser/parse_type.h"
+#include "storage/fd.h"
+#include "storage/latch.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/jsonb.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/memdebug.h"
+#include "utils/pg_locale.h"
 #include "utils/regproc.h"
 #include "utils/rel.h"
+#include "utils/sampling.h"
 #include "utils/timestamp.h"
 #include "utils/typcache.h"
 
@@ -83,6 +97,13 @@ extern "C"
 }
 
 
+/* parquet_export() defaults */
+#define DEFAULT_EXPORT_ROW_GROUP_SIZE   (1024 * 1024)
+#define EXPORT_FETCH_ROWS               10000
+
+/* Min number of rows read from a row group sampled by ANALYZE */
+#define ANALYZE_MIN_ROWGROUP_ROWS       300
+
 /* from costsize.c */
 #define LOG2(x)  (log(x) / 0.693147180559945)
 
@@ -93,6 +114,9 @@ extern "C"
 
 bool enable_multifile;
 bool enable_multifile_merge;
+bool enable_aggregate_pushdown;
+int  parquet_fdw_import_threads = 8;
+char *parquet_fdw_schema_cache_directory = NULL;
 
 
 static void find_cmp_func(FmgrInfo *finfo, Oid type1, Oid type2);
@@ -120,11 +144,39 @@ struct ParquetFdwPlanState
     Bitmapset  *attrs_used;     /* attributes actually used in query */
     bool        use_mmap;
     bool        use_threads;
+    bool        pre_buffer;
     int32       max_open_files;
     bool        files_in_order;
     List       *rowgroups;      /* List of Lists (per filename) */
     uint64      matched_rows;
     ReaderType  type;
+    List       *agg_exprs;      /* aggregates answered from statistics */
+    List       *agg_values;     /* and their values (List of Consts) */
+};
+
+/*
+ * Aggregate which can be computed from row group statistics
+ */
+enum StatsAggKind
+{
+    SA_COUNT_STAR = 0,
+    SA_COUNT,
+    SA_MIN,
+    SA_MAX
+};
+
+struct StatsAgg
+{
+    StatsAggKind    kind;
+    AttrNumber      attnum;     /* aggregated attribute (except count(*)) */
+    Oid             restype;    /* aggregate result type */
+
+    /* Accumulated state */
+    int64           count;
+    bool            isnull;     /* no min/max value seen yet */
+    Datum           value;      /* min/max value of type 'valtype' */
+    Oid             valtype;    /* default postgres type of arrow column */
+    FmgrInfo        cmpfunc;
 };
 
 static int
@@ -268,6 +320,73 @@ extract_rowgroup_filters(List *scan_clauses,
     }
 }
 
+/*
+ * is_runtime_filter_clause
+ *      Check whether clause has form "VAR OP EXPR" (or "EXPR OP VAR") where
+ *      VAR is a column of the relation, OP is a btree operator and EXPR is
+ *      not known at planning time but can be computed before the scan starts,
+ *      e.g. it references outer relation of a parameterized path or a query
+ *      parameter. If so, return the operator in the "VAR OP EXPR" form.
+ */
+static bool
+is_runtime_filter_clause(PlannerInfo *root, Index relid, Expr *clause,
+                         Var **var, Expr **value, Oid *opno)
+{
+    OpExpr     *expr;
+    Expr       *left, *right;
+    Var        *v;
+    Expr       *e;
+    Oid         op;
+
+    if (IsA(clause, RestrictInfo))
+        clause = ((RestrictInfo *) clause)->clause;
+
+    if (!IsA(clause, OpExpr))
+        return false;
+
+    expr = (OpExpr *) clause;
+    if (list_length(expr->args) != 2)
+        return false;
+
+    left = (Expr *) linitial(expr->args);
+    right = (Expr *) lsecond(expr->args);
+
+    if (IsA(left, Var) && (Index) ((Var *) left)->varno == relid)
+    {
+        v = (Var *) left;
+        e = right;
+        op = expr->opno;
+    }
+    else if (IsA(right, Var) && (Index) ((Var *) right)->varno == relid)
+    {
+        v = (Var *) right;
+        e = left;
+        op = get_commutator(expr->opno);
+    }
+    else
+        return false;
+
+    /* Constants are handled by planner, see extract_rowgroup_filters() */
+    if (v->varattno <= 0 || v->varlevelsup != 0 || IsA(e, Const))
+        return false;
+
+    if (!OidIsValid(op) || get_strategy(v->vartype, op, BTREE_AM_OID) == 0)
+        return false;
+
+    if (bms_is_member(relid, pull_varnos(root, (Node *) e)) ||
+        contain_volatile_functions((Node *) e))
+        return false;
+
+    if (var)
+        *var = v;
+    if (value)
+        *value = e;
+    if (opno)
+        *opno = op;
+
+    return true;
+}
+
 static Const *
 convert_const(Const *c, Oid dst_oid)
 {
@@ -379,6 +498,10 @@ row_group_matches_filter(parquet::Statistics *stats,
         filter->value = convert_const(filter->value,
                                       to_postgres_type(arrow_type->id()));
     }
+    /* Cannot tell anything without typed statistics */
+    if (!has_typed_stats(arrow_type))
+        return true;
+
     val = filter->value->constvalue;
 
     find_cmp_func(&finfo,
@@ -458,6 +581,70 @@ row_group_matches_filter(parquet::Statistics *stats,
     return true;
 }
 
+/*
+ * row_group_fully_matches_filter
+ *      Check whether all the rows of the row group satisfy the filter, i.e.
+ *      both min and max values are within the filter range and there are no
+ *      NULLs in the column.
+ */
+static bool
+row_group_fully_matches_filter(parquet::Statistics *stats,
+                               const arrow::DataType *arrow_type,
+                               RowGroupFilter *filter)
+{
+    FmgrInfo    finfo;
+    Datum       val;
+    Datum       lower,
+                upper;
+    int         collid = filter->value->constcollid;
+    int         l, u;
+
+    /* jsonb key existence cannot be decided by statistics alone */
+    if (filter->is_key || arrow_type->id() == arrow::Type::MAP ||
+        !has_typed_stats(arrow_type))
+        return false;
+
+    if (filter->value->constisnull)
+        return false;
+
+    if (!stats->HasMinMax() || !stats->HasNullCount() || stats->null_count() > 0)
+        return false;
+
+    /* Statistics are ordered bytewise which only matches the C collation */
+    if (arrow_type->id() == arrow::Type::STRING && !lc_collate_is_c(collid))
+        return false;
+
+    val = filter->value->constvalue;
+    find_cmp_func(&finfo,
+                  filter->value->consttype,
+                  to_postgres_type(arrow_type->id()));
+
+    std::string min = std::move(stats->EncodeMin());
+    std::string max = std::move(stats->EncodeMax());
+
+    lower = bytes_to_postgres_type(min.c_str(), min.length(), arrow_type);
+    upper = bytes_to_postgres_type(max.c_str(), max.length(), arrow_type);
+
+    l = FunctionCall2Coll(&finfo, collid, val, lower);
+    u = FunctionCall2Coll(&finfo, collid, val, upper);
+
+    switch (filter->strategy)
+    {
+        case BTLessStrategyNumber:
+            return u > 0;
+        case BTLessEqualStrategyNumber:
+            return u >= 0;
+        case BTGreaterStrategyNumber:
+            return l < 0;
+        case BTGreaterEqualStrategyNumber:
+            return l <= 0;
+        case BTEqualStrategyNumber:
+            return l == 0 && u == 0;
+        default:
+            return false;
+    }
+}
+
 typedef enum
 {
     PS_START = 0,
@@ -533,11 +720,129 @@ parse_filenames_list(const char *str)
     return filenames;
 }
 
+/*
+ * Parquet leaf column the row group filter refers to
+ */
+struct FilterColumn
+{
+    RowGroupFilter         *filter;
+    const arrow::DataType  *arrow_type;
+    int                     column_index;
+};
+
+/*
+ * find_filter_columns
+ *      Match filters to parquet columns by name. Filters on columns missing
+ *      from the file or on complex types (other than map keys) are skipped.
+ */
+static std::vector<FilterColumn>
+find_filter_columns(const parquet::arrow::SchemaManifest &manifest,
+                    TupleDesc tupleDesc,
+                    std::list<RowGroupFilter> &filters)
+{
+    std::vector<FilterColumn> res;
+
+    for (auto &filter : filters)
+    {
+        char    pg_colname[NAMEDATALEN];
+
+        tolowercase(NameStr(TupleDescAttr(tupleDesc, filter.attnum - 1)->attname),
+                    pg_colname);
+
+        /*
+         * Search for the column with the same name as filtered attribute
+         */
+        for (auto &schema_field : manifest.schema_fields)
+        {
+            char        arrow_colname[NAMEDATALEN];
+            auto       &field = schema_field.field;
+            int         column_index;
+
+            /* Skip complex objects (lists, structs except maps) */
+            if (schema_field.column_index == -1
+                && field->type()->id() != arrow::Type::MAP)
+                continue;
+
+            if (field->name().length() > NAMEDATALEN)
+                throw Error("parquet column name '%s' is too long (max: %d)",
+                            field->name().c_str(), NAMEDATALEN - 1);
+            tolowercase(field->name().c_str(), arrow_colname);
+
+            if (strcmp(pg_colname, arrow_colname) != 0)
+                continue;
+
+            if (field->type()->id() == arrow::Type::MAP)
+            {
+                /*
+                 * Extract `key` column of the map.
+                 * See `create_column_mapping()` for some details on
+                 * map structure.
+                 */
+                Assert(schema_field.children.size() == 1);
+                auto &strct = schema_field.children[0];
+
+                Assert(strct.children.size() == 2);
+                auto &key = strct.children[0];
+                column_index = key.column_index;
+            }
+            else
+                column_index = schema_field.column_index;
+
+            /* Found it! */
+            res.push_back({&filter, field->type().get(), column_index});
+            break;
+        }
+    }
+
+    return res;
+}
+
+/*
+ * stats_match_filter
+ *      Exception safe wrapper around row_group_matches_filter().
+ */
+static bool
+stats_match_filter(parquet::Statistics *stats, const FilterColumn &col)
+{
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    bool            match = true;
+    char            errstr[ERROR_STR_LEN];
+
+    PG_TRY();
+    {
+        match = row_group_matches_filter(stats, col.arrow_type, col.filter);
+    }
+    PG_CATCH();
+    {
+        ErrorData *errdata;
+
+        MemoryContextSwitchTo(ccxt);
+        error = true;
+        errdata = CopyErrorData();
+        FlushErrorState();
+
+        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+        FreeErrorData(errdata);
+    }
+    PG_END_TRY();
+    if (error)
+        throw Error("row group filter match failed: %s", errstr);
+
+    return match;
+}
+
 /*
  * extract_rowgroups_list
  *      Analyze query predicates and using min/max statistics determine which
  *      row groups satisfy clauses. Store resulting row group list to
  *      fdw_private.
+ *
+ * Metadata comes from the per backend cache (see cache.cpp), so the file is
+ * only opened when it hasn't been seen before or has changed since. Before
+ * looking at individual row groups the filters are checked against the
+ * statistics merged over the whole file, which lets us skip files that
+ * cannot contain matching rows at once.
  */
 List *
 extract_rowgroups_list(const char *filename,
@@ -546,34 +851,37 @@ extract_rowgroups_list(const char *filename,
                        uint64 *matched_rows,
                        uint64 *total_rows) noexcept
 {
-    std::unique_ptr<parquet::arrow::FileReader> reader;
-    arrow::Status   status;
     List           *rowgroups = NIL;
     std::string     error;
 
-    /* Open parquet file to read meta information */
     try
     {
-        status = parquet::arrow::FileReader::Make(
-                arrow::default_memory_pool(),
-                parquet::ParquetFileReader::OpenFile(filename, false),
-                &reader);
+        auto summary = get_file_summary(filename);
+        auto &meta = summary->meta;
+        auto columns = find_filter_columns(summary->manifest, tupleDesc, filters);
+        bool skip_file = false;
 
-        if (!status.ok())
-            throw Error("failed to open Parquet file: %s ('%s')",
-                        status.message().c_str(), filename);
+        /* Check the file level statistics first */
+        for (auto &col : columns)
+        {
+            auto stats = summary->file_stats(col.column_index);
 
-        auto meta = reader->parquet_reader()->metadata();
-        parquet::ArrowReaderProperties  props;
-        parquet::arrow::SchemaManifest  manifest;
+            if (stats && !stats_match_filter(stats.get(), col))
+            {
+                skip_file = true;
+                break;
+            }
+        }
 
-        status = parquet::arrow::SchemaManifest::Make(meta->schema(), nullptr,
-                                                      props, &manifest);
-        if (!status.ok())
-            throw Error("error creating arrow schema ('%s')", filename);
+        if (skip_file)
+        {
+            elog(DEBUG1, "parquet_fdw: skip file '%s'", filename);
+            *total_rows += meta->num_rows();
+            return NIL;
+        }
 
         /* Check each row group whether it matches the filters */
-        for (int r = 0; r < reader->num_row_groups(); r++)
+        for (int r = 0; r < meta->num_row_groups(); r++)
         {
             bool match = true;
             auto rowgroup = meta->RowGroup(r);
@@ -582,97 +890,20 @@ extract_rowgroups_list(const char *filename,
             if (!rowgroup->num_rows())
                 continue;
 
-            for (auto &filter : filters)
+            for (auto &col : columns)
             {
-                AttrNumber      attnum;
-                char            pg_colname[NAMEDATALEN];
-
-                attnum = filter.attnum - 1;
-                tolowercase(NameStr(TupleDescAttr(tupleDesc, attnum)->attname),
-                            pg_colname);
+                auto stats = rowgroup->ColumnChunk(col.column_index)->statistics();
 
                 /*
-                 * Search for the column with the same name as filtered attribute
+                 * If at least one filter doesn't match rowgroup exclude
+                 * the current row group and proceed with the next one.
                  */
-                for (auto &schema_field : manifest.schema_fields)
+                if (stats && !stats_match_filter(stats.get(), col))
                 {
-                    MemoryContext   ccxt = CurrentMemoryContext;
-                    bool            error = false;
-                    char            errstr[ERROR_STR_LEN];
-                    char            arrow_colname[NAMEDATALEN];
-                    auto           &field = schema_field.field;
-                    int             column_index;
-
-                    /* Skip complex objects (lists, structs except maps) */
-                    if (schema_field.column_index == -1
-                        && field->type()->id() != arrow::Type::MAP)
-                        continue;
-
-                    if (field->name().length() > NAMEDATALEN)
-                        throw Error("parquet column name '%s' is too long (max: %d)",
-                                    field->name().c_str(), NAMEDATALEN - 1);
-                    tolowercase(field->name().c_str(), arrow_colname);
-
-                    if (strcmp(pg_colname, arrow_colname) != 0)
-                        continue;
-
-                    if (field->type()->id() == arrow::Type::MAP)
-                    {
-                        /*
-                         * Extract `key` column of the map.
-                         * See `create_column_mapping()` for some details on
-                         * map structure.
-                         */
-                        Assert(schema_field.children.size() == 1);
-                        auto &strct = schema_field.children[0];
-
-                        Assert(strct.children.size() == 2);
-                        auto &key = strct.children[0];
-                        column_index = key.column_index;
-                    }
-                    else
-                        column_index = schema_field.column_index;
-
-                    /* Found it! */
-                    std::shared_ptr<parquet::Statistics>  stats;
-                    auto column = rowgroup->ColumnChunk(column_index);
-                    stats = column->statistics();
-
-                    PG_TRY();
-                    {
-                        /*
-                         * If at least one filter doesn't match rowgroup exclude
-                         * the current row group and proceed with the next one.
-                         */
-                        if (stats && !row_group_matches_filter(stats.get(),
-                                                               field->type().get(),
-                                                               &filter))
-                        {
-                            match = false;
-                            elog(DEBUG1, "parquet_fdw: skip rowgroup %d", r + 1);
-                        }
-                    }
-                    PG_CATCH();
-                    {
-                        ErrorData *errdata;
-
-                        MemoryContextSwitchTo(ccxt);
-                        error = true;
-                        errdata = CopyErrorData();
-                        FlushErrorState();
-
-                        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
-                        FreeErrorData(errdata);
-                    }
-                    PG_END_TRY();
-                    if (error)
-                        throw Error("row group filter match failed: %s", errstr);
-                    break;
-                }  /* loop over columns */
-
-                if (!match)
+                    match = false;
+                    elog(DEBUG1, "parquet_fdw: skip rowgroup %d", r + 1);
                     break;
-
+                }
             }  /* loop over filters */
 
             /* All the filters match this rowgroup */
@@ -697,105 +928,449 @@ extract_rowgroups_list(const char *filename,
     return rowgroups;
 }
 
-struct FieldInfo
+/*
+ * find_schema_field
+ *      Find top level primitive column by postgres attribute name.
+ */
+static const parquet::arrow::SchemaField *
+find_schema_field(const parquet::arrow::SchemaManifest &manifest,
+                  TupleDesc tupleDesc, AttrNumber attnum)
 {
-    char    name[NAMEDATALEN];
-    Oid     oid;
-};
+    char    pg_colname[NAMEDATALEN];
+
+    tolowercase(NameStr(TupleDescAttr(tupleDesc, attnum - 1)->attname),
+                pg_colname);
+
+    for (auto &schema_field : manifest.schema_fields)
+    {
+        char    arrow_colname[NAMEDATALEN];
+        auto   &field = schema_field.field;
+
+        /* Skip complex objects (lists, structs, maps) */
+        if (schema_field.column_index == -1)
+            continue;
+
+        if (field->name().length() > NAMEDATALEN)
+            throw Error("parquet column name '%s' is too long (max: %d)",
+                        field->name().c_str(), NAMEDATALEN - 1);
+        tolowercase(field->name().c_str(), arrow_colname);
+
+        if (strcmp(pg_colname, arrow_colname) == 0)
+            return &schema_field;
+    }
+
+    return nullptr;
+}
 
 /*
- * extract_parquet_fields
- *      Read parquet file and return a list of its fields
+ * aggregate_rowgroups_stats
+ *      Accumulate aggregates from min/max and null count statistics of the
+ *      previously selected row groups of the file. Returns false if the file
+ *      doesn't have required statistics or if any of the row groups only
+ *      partially matches the filters (then the actual rows must be read).
  */
-static List *
-extract_parquet_fields(const char *path) noexcept
+static bool
+aggregate_rowgroups_stats(const char *filename,
+                          List *rowgroups,
+                          TupleDesc tupleDesc,
+                          std::list<RowGroupFilter> &filters,
+                          std::vector<StatsAgg> &aggs) noexcept
 {
-    List           *res = NIL;
     std::string     error;
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            result = true;
 
     try
     {
-        std::unique_ptr<parquet::arrow::FileReader> reader;
-        parquet::ArrowReaderProperties props;
-        parquet::arrow::SchemaManifest manifest;
-        arrow::Status   status;
-        FieldInfo      *fields;
+        auto summary = get_file_summary(filename);
+        auto &meta = summary->meta;
+        auto &manifest = summary->manifest;
+        ListCell       *lc;
 
-        status = parquet::arrow::FileReader::Make(
-                    arrow::default_memory_pool(),
-                    parquet::ParquetFileReader::OpenFile(path, false),
-                    &reader);
-        if (!status.ok())
-            throw Error("failed to open Parquet file %s ('%s')",
-                        status.message().c_str(), path);
+        foreach (lc, rowgroups)
+        {
+            auto rowgroup = meta->RowGroup(lfirst_int(lc));
 
-        auto p_schema = reader->parquet_reader()->metadata()->schema();
-        if (!parquet::arrow::SchemaManifest::Make(p_schema, nullptr, props, &manifest).ok())
-            throw Error("error creating arrow schema ('%s')", path);
+            /* Every filter must be satisfied by all the rows of row group */
+            for (auto &filter : filters)
+            {
+                const parquet::arrow::SchemaField *field;
+                std::shared_ptr<parquet::Statistics>  stats;
 
-        fields = (FieldInfo *) exc_palloc(
-                sizeof(FieldInfo) * manifest.schema_fields.size());
+                field = find_schema_field(manifest, tupleDesc, filter.attnum);
+                if (!field)
+                    return false;
 
-        for (auto &schema_field : manifest.schema_fields)
-        {
-            auto   &field = schema_field.field;
-            auto   &type = field->type();
-            Oid     pg_type;
+                stats = rowgroup->ColumnChunk(field->column_index)->statistics();
+                if (!stats)
+                    return false;
 
-            switch (type->id())
+                PG_TRY();
+                {
+                    result = row_group_fully_matches_filter(stats.get(),
+                                                            field->field->type().get(),
+                                                            &filter);
+                }
+                PG_CATCH();
+                {
+                    MemoryContextSwitchTo(ccxt);
+                    FlushErrorState();
+                    result = false;
+                }
+                PG_END_TRY();
+                if (!result)
+                    return false;
+            }
+
+            for (auto &agg : aggs)
             {
-                case arrow::Type::LIST:
+                const parquet::arrow::SchemaField *field;
+                std::shared_ptr<parquet::Statistics>  stats;
+                const arrow::DataType *arrow_type;
+                bool    failed = false;
+
+                if (agg.kind == SA_COUNT_STAR)
                 {
-                    arrow::Type::type subtype_id;
-                    Oid     pg_subtype;
-                    bool    error = false;
+                    agg.count += rowgroup->num_rows();
+                    continue;
+                }
 
-                    if (type->num_fields() != 1)
-                        throw Error("lists of structs are not supported ('%s')", path);
+                field = find_schema_field(manifest, tupleDesc, agg.attnum);
+                if (!field)
+                    return false;
 
-                    subtype_id = get_arrow_list_elem_type(type.get());
-                    pg_subtype = to_postgres_type(subtype_id);
+                stats = rowgroup->ColumnChunk(field->column_index)->statistics();
+                if (!stats || !stats->HasNullCount())
+                    return false;
 
-                    /* This sucks I know... */
-                    PG_TRY();
+                if (agg.kind == SA_COUNT)
+                {
+                    agg.count += rowgroup->num_rows() - stats->null_count();
+                    continue;
+                }
+
+                /* min() or max() */
+                if (!stats->HasMinMax())
+                {
+                    /* Only NULLs in this row group, nothing to aggregate */
+                    if (stats->null_count() == rowgroup->num_rows())
+                        continue;
+                    return false;
+                }
+
+                arrow_type = field->field->type().get();
+                if (to_postgres_type(arrow_type->id()) != agg.valtype ||
+                    !has_typed_stats(arrow_type))
+                    return false;
+
+                std::string bytes = agg.kind == SA_MIN ?
+                    stats->EncodeMin() : stats->EncodeMax();
+
+                PG_TRY();
+                {
+                    Datum   val = bytes_to_postgres_type(bytes.c_str(),
+                                                         bytes.length(),
+                                                         arrow_type);
+                    int     cmpres;
+
+                    if (agg.isnull)
                     {
-                        pg_type = get_array_type(pg_subtype);
+                        agg.value = val;
+                        agg.isnull = false;
                     }
-                    PG_CATCH();
+                    else
                     {
-                        error = true;
+                        cmpres = DatumGetInt32(FunctionCall2(&agg.cmpfunc,
+                                                             val, agg.value));
+                        if ((agg.kind == SA_MIN && cmpres < 0) ||
+                            (agg.kind == SA_MAX && cmpres > 0))
+                            agg.value = val;
                     }
-                    PG_END_TRY();
-
-                    if (error)
-                        throw Error("failed to get the type of array elements for %d",
-                                    pg_subtype);
-                    break;
                 }
-                case arrow::Type::MAP:
-                    pg_type = JSONBOID;
-                    break;
-                default:
-                    pg_type = to_postgres_type(type->id());
+                PG_CATCH();
+                {
+                    MemoryContextSwitchTo(ccxt);
+                    FlushErrorState();
+                    failed = true;
+                }
+                PG_END_TRY();
+                if (failed)
+                    return false;
             }
+        }
+    }
+    catch(const std::exception& e) {
+        error = e.what();
+    }
+    if (!error.empty()) {
+        elog(ERROR,
+             "parquet_fdw: failed to read statistics from Parquet file: %s ('%s')",
+             error.c_str(), filename);
+    }
 
-            if (pg_type != InvalidOid)
-            {
-                if (field->name().length() > 63)
-                    throw Error("field name '%s' in '%s' is too long",
-                                field->name().c_str(), path);
+    return true;
+}
 
-                memcpy(fields->name, field->name().c_str(), field->name().length() + 1);
-                fields->oid = pg_type;
-                res = lappend(res, fields++);
-            }
-            else
+struct FieldInfo
+{
+    char    name[NAMEDATALEN];
+    Oid     oid;
+};
+
+/*
+ * schema_to_fields
+ *      Convert parquet schema of the file into a list of FieldInfo
+ */
+static List *
+schema_to_fields(const parquet::arrow::SchemaManifest &manifest, const char *path)
+{
+    List           *res = NIL;
+    FieldInfo      *fields;
+
+    fields = (FieldInfo *) exc_palloc(
+            sizeof(FieldInfo) * manifest.schema_fields.size());
+
+    for (auto &schema_field : manifest.schema_fields)
+    {
+        auto   &field = schema_field.field;
+        auto   &type = field->type();
+        Oid     pg_type;
+
+        switch (type->id())
+        {
+            case arrow::Type::LIST:
             {
-                throw Error("cannot convert field '%s' of type '%s' in '%s'",
-                            field->name().c_str(), type->name().c_str(), path);
+                arrow::DataType *subtype = type.get();
+                Oid     pg_subtype;
+                bool    error = false;
+
+                if (type->num_fields() != 1)
+                    throw Error("lists of structs are not supported ('%s')", path);
+
+                /* Nested lists are read as multidimensional arrays */
+                while (subtype->id() == arrow::Type::LIST)
+                    subtype = subtype->field(0)->type().get();
+                pg_subtype = to_postgres_type(subtype->id());
+
+                /* This sucks I know... */
+                PG_TRY();
+                {
+                    pg_type = get_array_type(pg_subtype);
+                }
+                PG_CATCH();
+                {
+                    error = true;
+                }
+                PG_END_TRY();
+
+                if (error)
+                    throw Error("failed to get the type of array elements for %d",
+                                pg_subtype);
+                break;
             }
+            case arrow::Type::MAP:
+                pg_type = JSONBOID;
+                break;
+            default:
+                pg_type = to_postgres_type(type->id());
+        }
+
+        if (pg_type != InvalidOid)
+        {
+            if (field->name().length() > 63)
+                throw Error("field name '%s' in '%s' is too long",
+                            field->name().c_str(), path);
+
+            memcpy(fields->name, field->name().c_str(), field->name().length() + 1);
+            fields->oid = pg_type;
+            res = lappend(res, fields++);
+        }
+        else
+        {
+            throw Error("cannot convert field '%s' of type '%s' in '%s'",
+                        field->name().c_str(), type->name().c_str(), path);
+        }
+    }
+
+    return res;
+}
+
+/*
+ * Persistent schema cache
+ *
+ * The fields inferred from a file are saved in
+ * parquet_fdw.schema_cache_directory, one cache file per parquet file, so
+ * that imports in later sessions don't have to read and convert the footers
+ * of files that haven't changed. A cache file is named after the hash of the
+ * parquet file path; it stores the path itself, the identity, modification
+ * time and size of the parquet file at the time its footer was read, and the
+ * FieldInfo array. Cache files are replaced atomically by renaming, and any
+ * that can't be read or doesn't match the file is ignored, so the directory
+ * may be removed at any time.
+ */
+#define SCHEMA_CACHE_MAGIC      0x50514653      /* "PQFS" */
+#define SCHEMA_CACHE_VERSION    1
+
+struct SchemaCacheHeader
+{
+    uint32      magic;
+    uint32      version;
+    uint64      dev;
+    uint64      ino;
+    int64       mtime_sec;
+    int64       mtime_nsec;
+    int64       size;
+    uint32      pathlen;
+    uint32      nfields;
+};
+
+static void
+schema_cache_filename(char *buf, size_t buflen, const char *path)
+{
+    uint64      hash;
+
+    hash = hash_bytes_extended((const unsigned char *) path, strlen(path), 0);
+    snprintf(buf, buflen, "%s/%016llx", parquet_fdw_schema_cache_directory,
+             (unsigned long long) hash);
+}
+
+/*
+ * load_cached_fields
+ *      Return the fields of the file saved by an earlier import, or NIL if
+ *      there are none or the file has changed since.
+ */
+static List *
+load_cached_fields(const char *path)
+{
+    char        cachefile[MAXPGPATH];
+    SchemaCacheHeader hdr;
+    struct stat st;
+    char       *cachedpath;
+    FieldInfo  *fields;
+    List       *res = NIL;
+    int         fd;
+    bool        valid;
+
+    if (parquet_fdw_schema_cache_directory == NULL ||
+        parquet_fdw_schema_cache_directory[0] == '\0')
+        return NIL;
+
+    if (stat(path, &st) != 0)
+        return NIL;
+
+    schema_cache_filename(cachefile, sizeof(cachefile), path);
+    if ((fd = OpenTransientFile(cachefile, O_RDONLY | PG_BINARY)) < 0)
+        return NIL;
+
+    valid = read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        hdr.magic == SCHEMA_CACHE_MAGIC &&
+        hdr.version == SCHEMA_CACHE_VERSION &&
+        hdr.dev == (uint64) st.st_dev &&
+        hdr.ino == (uint64) st.st_ino &&
+        hdr.mtime_sec == (int64) st.st_mtim.tv_sec &&
+        hdr.mtime_nsec == (int64) st.st_mtim.tv_nsec &&
+        hdr.size == (int64) st.st_size &&
+        hdr.pathlen == strlen(path) &&
+        hdr.nfields > 0 && hdr.nfields <= MaxHeapAttributeNumber;
+
+    if (valid)
+    {
+        cachedpath = (char *) palloc(hdr.pathlen);
+        fields = (FieldInfo *) palloc(sizeof(FieldInfo) * hdr.nfields);
+
+        /* Different paths may hash to the same cache file */
+        valid = read(fd, cachedpath, hdr.pathlen) == (ssize_t) hdr.pathlen &&
+            memcmp(cachedpath, path, hdr.pathlen) == 0 &&
+            read(fd, fields, sizeof(FieldInfo) * hdr.nfields) ==
+                (ssize_t) (sizeof(FieldInfo) * hdr.nfields);
+        pfree(cachedpath);
+
+        for (uint32 i = 0; valid && i < hdr.nfields; i++)
+        {
+            fields[i].name[NAMEDATALEN - 1] = '\0';
+            res = lappend(res, &fields[i]);
         }
     }
+    CloseTransientFile(fd);
+
+    return res;
+}
+
+/*
+ * store_cached_fields
+ *      Save the fields inferred from the footer described by `summary`.
+ *      Failures are not reported, the cache only saves work.
+ */
+static void
+store_cached_fields(const char *path, const FileSummary *summary, List *fields)
+{
+    char        cachefile[MAXPGPATH];
+    char        tmpfile[MAXPGPATH];
+    SchemaCacheHeader hdr;
+    ListCell   *lc;
+    int         fd;
+    bool        ok;
+
+    if (parquet_fdw_schema_cache_directory == NULL ||
+        parquet_fdw_schema_cache_directory[0] == '\0' || fields == NIL)
+        return;
+
+    if (MakePGDirectory(parquet_fdw_schema_cache_directory) != 0 &&
+        errno != EEXIST)
+        return;
+
+    schema_cache_filename(cachefile, sizeof(cachefile), path);
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp.%d", cachefile, MyProcPid);
+
+    fd = OpenTransientFile(tmpfile, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+    if (fd < 0)
+        return;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SCHEMA_CACHE_MAGIC;
+    hdr.version = SCHEMA_CACHE_VERSION;
+    hdr.dev = summary->dev;
+    hdr.ino = summary->ino;
+    hdr.mtime_sec = summary->mtime.tv_sec;
+    hdr.mtime_nsec = summary->mtime.tv_nsec;
+    hdr.size = summary->size;
+    hdr.pathlen = strlen(path);
+    hdr.nfields = list_length(fields);
+
+    ok = write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        write(fd, path, hdr.pathlen) == (ssize_t) hdr.pathlen;
+    foreach (lc, fields)
+    {
+        if (!ok)
+            break;
+        ok = write(fd, lfirst(lc), sizeof(FieldInfo)) == sizeof(FieldInfo);
+    }
+
+    if (CloseTransientFile(fd) != 0 || !ok ||
+        rename(tmpfile, cachefile) != 0)
+        unlink(tmpfile);
+}
+
+/*
+ * extract_parquet_fields
+ *      Read parquet file and return a list of its fields
+ */
+static List *
+extract_parquet_fields(const char *path) noexcept
+{
+    List           *res;
+    std::string     error;
+
+    if ((res = load_cached_fields(path)) != NIL)
+        return res;
+
+    try
+    {
+        auto summary = get_file_summary(path);
+
+        res = schema_to_fields(summary->manifest, path);
+        store_cached_fields(path, summary.get(), res);
+    }
     catch (std::exception &e)
     {
         error = e.what();
@@ -945,9 +1520,18 @@ OidFunctionCall1NullableArg(Oid functionId, Datum arg, bool argisnull)
     return result;
 }
 
+/*
+ * get_filenames_from_userfunc
+ *      Call files_func to get the list of files. If `ttl` is positive the
+ *      result is cached for that many seconds per function, argument and
+ *      current user. The function is identified by its OID, as the name may
+ *      resolve to a different function under another search_path.
+ */
 static List *
-get_filenames_from_userfunc(const char *funcname, const char *funcarg)
+get_filenames_from_userfunc(const char *funcname, const char *funcarg, int ttl)
 {
+    std::vector<std::string> cached;
+    std::string key;
     Jsonb      *j = NULL;
     Oid         funcid;
     List       *f = stringToQualifiedNameList(funcname);
@@ -959,10 +1543,24 @@ get_filenames_from_userfunc(const char *funcname, const char *funcarg)
     List       *res = NIL;
     ArrayType  *arr;
 
+    funcid = LookupFuncName(f, 1, &jsonboid, false);
+
+    if (ttl > 0)
+    {
+        key = std::to_string(funcid) + '\0' + (funcarg ? funcarg : "") + '\0' +
+            std::to_string(GetUserId());
+
+        if (get_cached_file_list(key, cached))
+        {
+            for (auto &filename : cached)
+                res = lappend(res, makeString(pstrdup(filename.c_str())));
+            return res;
+        }
+    }
+
     if (funcarg)
         j = DatumGetJsonbP(DirectFunctionCall1(jsonb_in, CStringGetDatum(funcarg)));
 
-    funcid = LookupFuncName(f, 1, &jsonboid, false);
     filenames = OidFunctionCall1NullableArg(funcid, (Datum) j, funcarg == NULL);
 
     arr = DatumGetArrayTypeP(filenames);
@@ -984,8 +1582,13 @@ get_filenames_from_userfunc(const char *funcname, const char *funcarg)
         if (nulls[i])
             elog(ERROR, "user function returned an array containing NULL value(s)");
         res = lappend(res, makeString(TextDatumGetCString(values[i])));
+        if (ttl > 0)
+            cached.push_back(strVal(llast(res)));
     }
 
+    if (ttl > 0)
+        cache_file_list(key, cached, ttl);
+
     return res;
 }
 
@@ -996,9 +1599,11 @@ get_table_options(Oid relid, ParquetFdwPlanState *fdw_private)
     ListCell     *lc;
     char         *funcname = NULL;
     char         *funcarg = NULL;
+    int           files_func_ttl = 0;
 
     fdw_private->use_mmap = false;
     fdw_private->use_threads = false;
+    fdw_private->pre_buffer = false;
     fdw_private->max_open_files = 0;
     fdw_private->files_in_order = false;
     table = GetForeignTable(relid);
@@ -1019,6 +1624,10 @@ get_table_options(Oid relid, ParquetFdwPlanState *fdw_private)
         {
             funcarg = defGetString(def);
         }
+        else if (strcmp(def->defname, "files_func_ttl") == 0)
+        {
+            files_func_ttl = string_to_int32(defGetString(def));
+        }
         else if (strcmp(def->defname, "sorted") == 0)
         {
             fdw_private->attrs_sorted =
@@ -1032,6 +1641,10 @@ get_table_options(Oid relid, ParquetFdwPlanState *fdw_private)
         {
             fdw_private->use_threads = defGetBoolean(def);
         }
+        else if (strcmp(def->defname, "pre_buffer") == 0)
+        {
+            fdw_private->pre_buffer = defGetBoolean(def);
+        }
         else if (strcmp(def->defname, "max_open_files") == 0)
         {
             /* check that int value is valid */
@@ -1046,7 +1659,8 @@ get_table_options(Oid relid, ParquetFdwPlanState *fdw_private)
     }
 
     if (funcname)
-        fdw_private->filenames = get_filenames_from_userfunc(funcname, funcarg);
+        fdw_private->filenames = get_filenames_from_userfunc(funcname, funcarg,
+                                                             files_func_ttl);
 }
 
 extern "C" void
@@ -1197,6 +1811,137 @@ cost_merge(Path *path, uint32 nfiles, Cost input_startup_cost,
     path->total_cost = (startup_cost + run_cost + input_total_cost);
 }
 
+/*
+ * ec_member_matches_var
+ *      Callback for generate_implied_equalities_for_column(). Matches
+ *      equivalence class member which is the given column of the foreign
+ *      table.
+ */
+static bool
+ec_member_matches_var(PlannerInfo * /* root */, RelOptInfo * /* rel */,
+                      EquivalenceClass * /* ec */, EquivalenceMember *em,
+                      void *arg)
+{
+    return equal(em->em_expr, arg);
+}
+
+/*
+ * add_parameterized_paths
+ *      Create paths parameterized by the outer relations of join clauses
+ *      suitable as runtime filters (see is_runtime_filter_clause()). On every
+ *      rescan of the inner side of nested loop the scan then skips row groups
+ *      and rows which don't match current outer values.
+ */
+static void
+add_parameterized_paths(PlannerInfo *root, RelOptInfo *baserel,
+                        Cost startup_cost, Cost run_cost)
+{
+    ParquetFdwPlanState *fdw_private = (ParquetFdwPlanState *) baserel->fdw_private;
+    List       *clauses = NIL;
+    List       *ppi_list = NIL;
+    int         nrowgroups = 0;
+    ListCell   *lc;
+
+    /* Join clauses not derived from equivalence classes */
+    foreach (lc, baserel->joininfo)
+    {
+        RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+        if (join_clause_is_movable_to(rinfo, baserel))
+            clauses = lappend(clauses, rinfo);
+    }
+
+    /* Equality join clauses derived from equivalence classes */
+    if (baserel->has_eclass_joins)
+    {
+        foreach (lc, baserel->reltarget->exprs)
+        {
+            Var    *var = (Var *) lfirst(lc);
+
+            if (!IsA(var, Var) || (Index) var->varno != baserel->relid)
+                continue;
+
+            clauses = list_concat(clauses,
+                generate_implied_equalities_for_column(root, baserel,
+                                                       ec_member_matches_var,
+                                                       (void *) var,
+                                                       baserel->lateral_referencers));
+        }
+    }
+
+    foreach (lc, clauses)
+    {
+        RestrictInfo   *rinfo = (RestrictInfo *) lfirst(lc);
+        Relids          required_outer;
+
+        if (!is_runtime_filter_clause(root, baserel->relid, rinfo->clause,
+                                      NULL, NULL, NULL))
+            continue;
+
+        required_outer = bms_union(rinfo->clause_relids, baserel->lateral_relids);
+        required_outer = bms_del_member(required_outer, baserel->relid);
+        if (bms_is_empty(required_outer))
+            continue;
+
+        ppi_list = list_append_unique_ptr(ppi_list,
+                                          get_baserel_parampathinfo(root, baserel,
+                                                                    required_outer));
+    }
+
+    foreach (lc, fdw_private->rowgroups)
+        nrowgroups += list_length((List *) lfirst(lc));
+
+    foreach (lc, ppi_list)
+    {
+        ParamPathInfo          *param_info = (ParamPathInfo *) lfirst(lc);
+        ParquetFdwPlanState    *private_param;
+        Cost                    param_run_cost = run_cost;
+        ListCell               *lc2;
+        Path                   *path;
+
+        /*
+         * Statistics of row groups allow to skip most of them only if data is
+         * sorted by the filtered column so that min/max ranges don't overlap.
+         * Otherwise assume that every rescan reads everything.
+         */
+        foreach (lc2, param_info->ppi_clauses)
+        {
+            RestrictInfo   *rinfo = (RestrictInfo *) lfirst(lc2);
+            Var            *var;
+
+            if (fdw_private->attrs_sorted != NIL &&
+                is_runtime_filter_clause(root, baserel->relid, rinfo->clause,
+                                         &var, NULL, NULL) &&
+                var->varattno == linitial_int(fdw_private->attrs_sorted))
+            {
+                Selectivity sel;
+
+                sel = clauselist_selectivity(root, param_info->ppi_clauses,
+                                             baserel->relid, JOIN_INNER, NULL);
+                param_run_cost *= Max(sel, 1.0 / Max(nrowgroups, 1));
+                break;
+            }
+        }
+
+        private_param = (ParquetFdwPlanState *) palloc(sizeof(ParquetFdwPlanState));
+        memcpy(private_param, fdw_private, sizeof(ParquetFdwPlanState));
+
+        path = (Path *) create_foreignscan_path(root, baserel,
+                                                NULL,	/* default pathtarget */
+                                                param_info->ppi_rows,
+                                                startup_cost,
+                                                startup_cost + param_run_cost,
+                                                NIL,    /* no pathkeys */
+                                                param_info->ppi_req_outer,
+                                                NULL,	/* no extra plan */
+                                                (List *) private_param);
+        if (!enable_multifile && private_param->type == RT_MULTI)
+            path->total_cost += disable_cost;
+
+        add_path(baserel, path);
+    }
+}
+
 extern "C" void
 parquetGetForeignPaths(PlannerInfo *root,
                        RelOptInfo *baserel,
@@ -1304,6 +2049,9 @@ parquetGetForeignPaths(PlannerInfo *root,
     if (fdw_private->type == RT_TRIVIAL)
         return;
 
+    /* Paths for the inner side of nested loop joins */
+    add_parameterized_paths(root, baserel, startup_cost, run_cost);
+
     /* Create a separate path with pathkeys for sorted parquet files. */
     if (is_sorted)
     {
@@ -1416,8 +2164,231 @@ parquetGetForeignPaths(PlannerInfo *root,
     }
 }
 
+/*
+ * make_stats_agg
+ *      Check whether aggregate can be computed from row group statistics and
+ *      initialize its state if so.
+ */
+static bool
+make_stats_agg(Expr *expr, Index relid, StatsAgg &agg)
+{
+    Aggref     *aggref;
+    char       *aggname;
+    Var        *var;
+
+    if (!IsA(expr, Aggref))
+        return false;
+    aggref = (Aggref *) expr;
+
+    if (aggref->aggfilter || aggref->aggdistinct || aggref->aggorder ||
+        aggref->aggkind != AGGKIND_NORMAL || aggref->agglevelsup != 0 ||
+        aggref->aggsplit != AGGSPLIT_SIMPLE)
+        return false;
+
+    if (get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+        return false;
+    aggname = get_func_name(aggref->aggfnoid);
+
+    agg.restype = aggref->aggtype;
+    agg.count = 0;
+    agg.isnull = true;
+    agg.value = (Datum) 0;
+
+    if (strcmp(aggname, "count") == 0 && aggref->aggstar)
+    {
+        agg.kind = SA_COUNT_STAR;
+        return true;
+    }
+
+    if (list_length(aggref->args) != 1)
+        return false;
+
+    var = (Var *) ((TargetEntry *) linitial(aggref->args))->expr;
+    if (!IsA(var, Var) || (Index) var->varno != relid || var->varattno <= 0)
+        return false;
+    agg.attnum = var->varattno;
+
+    if (strcmp(aggname, "count") == 0)
+    {
+        agg.kind = SA_COUNT;
+        return true;
+    }
+
+    if (strcmp(aggname, "min") == 0)
+        agg.kind = SA_MIN;
+    else if (strcmp(aggname, "max") == 0)
+        agg.kind = SA_MAX;
+    else
+        return false;
+
+    /*
+     * Only types whose statistics are exact. Floats are excluded as parquet
+     * writers leave NaNs out of statistics, and strings as min/max values
+     * may be truncated.
+     */
+    switch (var->vartype)
+    {
+        case INT2OID:
+        case INT4OID:
+        case INT8OID:
+        case DATEOID:
+        case TIMESTAMPOID:
+            break;
+        default:
+            return false;
+    }
+
+    agg.valtype = var->vartype;
+    find_cmp_func(&agg.cmpfunc, agg.valtype, agg.valtype);
+
+    return true;
+}
+
+/*
+ * parquetGetForeignUpperPaths
+ *      Answer simple ungrouped aggregates (count, min and max) using row group
+ *      statistics without reading the data. This is only possible when every
+ *      scan clause is satisfied by all the rows of the selected row groups.
+ */
+extern "C" void
+parquetGetForeignUpperPaths(PlannerInfo *root,
+                            UpperRelationKind stage,
+                            RelOptInfo *input_rel,
+                            RelOptInfo *output_rel,
+                            void *extra)
+{
+    ParquetFdwPlanState *fdw_private;
+    ParquetFdwPlanState *agg_private;
+    GroupPathExtraData  *group_extra = (GroupPathExtraData *) extra;
+    std::vector<StatsAgg> aggs;
+    std::list<RowGroupFilter> filters;
+    PathTarget     *target;
+    Relation        rel;
+    TupleDesc       tupleDesc;
+    List           *agg_values = NIL;
+    ListCell       *lc, *lc2;
+    Path           *path;
+    int             i;
+    bool            ok = true;
+    std::string     error;
+
+    if (!enable_aggregate_pushdown || stage != UPPERREL_GROUP_AGG)
+        return;
+
+    /* Already done */
+    if (output_rel->fdw_private)
+        return;
+
+    if (input_rel->reloptkind != RELOPT_BASEREL || !input_rel->fdw_private)
+        return;
+
+    if (root->parse->groupClause || root->parse->groupingSets ||
+        root->hasHavingQual || group_extra->havingQual)
+        return;
+
+    fdw_private = (ParquetFdwPlanState *) input_rel->fdw_private;
+    if (fdw_private->type == RT_TRIVIAL || fdw_private->type == RT_AGGREGATE)
+        return;
+
+    target = root->upper_targets[UPPERREL_GROUP_AGG];
+    if (target == NULL || target->exprs == NIL)
+        return;
+
+    try
+    {
+        foreach (lc, target->exprs)
+        {
+            StatsAgg    agg;
+
+            memset(&agg, 0, sizeof(StatsAgg));
+            if (!make_stats_agg((Expr *) lfirst(lc), input_rel->relid, agg))
+                return;
+            aggs.push_back(agg);
+        }
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    /* Every scan clause must be covered by row group statistics */
+    extract_rowgroup_filters(input_rel->baserestrictinfo, filters);
+    if ((int) filters.size() != list_length(input_rel->baserestrictinfo))
+        return;
+
+    rel = table_open(root->simple_rte_array[input_rel->relid]->relid,
+                     AccessShareLock);
+    tupleDesc = RelationGetDescr(rel);
+
+    forboth (lc, fdw_private->filenames, lc2, fdw_private->rowgroups)
+    {
+        char *filename = strVal(lfirst(lc));
+
+        if (!aggregate_rowgroups_stats(filename, (List *) lfirst(lc2),
+                                       tupleDesc, filters, aggs))
+        {
+            ok = false;
+            break;
+        }
+    }
+    table_close(rel, AccessShareLock);
+
+    if (!ok)
+        return;
+
+    /* Build the resulting values */
+    i = 0;
+    foreach (lc, target->exprs)
+    {
+        StatsAgg   &agg = aggs[i++];
+        Const      *c;
+
+        if (agg.kind == SA_COUNT_STAR || agg.kind == SA_COUNT)
+            c = makeConst(INT8OID, -1, InvalidOid, sizeof(int64),
+                          Int64GetDatum(agg.count), false, FLOAT8PASSBYVAL);
+        else
+        {
+            int16   typlen;
+            bool    typbyval;
+
+            get_typlenbyval(agg.valtype, &typlen, &typbyval);
+            c = makeConst(agg.valtype, -1, InvalidOid, typlen,
+                          agg.value, agg.isnull, typbyval);
+            if (!agg.isnull && agg.valtype != agg.restype)
+                c = convert_const(c, agg.restype);
+        }
+        agg_values = lappend(agg_values, c);
+    }
+
+    agg_private = (ParquetFdwPlanState *) palloc(sizeof(ParquetFdwPlanState));
+    memcpy(agg_private, fdw_private, sizeof(ParquetFdwPlanState));
+    agg_private->type = RT_AGGREGATE;
+    agg_private->attrs_sorted = NIL;
+    agg_private->agg_exprs = target->exprs;
+    agg_private->agg_values = agg_values;
+    output_rel->fdw_private = agg_private;
+
+    /*
+     * The aggregates are computed right here and end up in the plan as
+     * constants; the executor merely returns them and doesn't look at the
+     * files at all. Hence a cached plan keeps returning the values seen at
+     * planning time even if the files have been changed since.
+     */
+    path = (Path *) create_foreign_upper_path(root, output_rel,
+                                              target,
+                                              1,
+                                              0,
+                                              cpu_tuple_cost,
+                                              NIL,  /* no pathkeys */
+                                              NULL, /* no extra plan */
+                                              (List *) agg_private);
+    add_path(output_rel, path);
+}
+
 extern "C" ForeignScan *
-parquetGetForeignPlan(PlannerInfo * /* root */,
+parquetGetForeignPlan(PlannerInfo *root,
                       RelOptInfo *baserel,
                       Oid /* foreigntableid */,
                       ForeignPath *best_path,
@@ -1427,10 +2398,13 @@ parquetGetForeignPlan(PlannerInfo * /* root */,
 {
     ParquetFdwPlanState *fdw_private = (ParquetFdwPlanState *) best_path->fdw_private;
     Index		scan_relid = baserel->relid;
+    List       *fdw_scan_tlist = NIL;
     List       *attrs_used = NIL;
     List       *attrs_sorted = NIL;
     AttrNumber  attr;
     List       *params = NIL;
+    List       *runtime_filters = NIL;
+    List       *fdw_exprs = NIL;
     ListCell   *lc;
 
 	/*
@@ -1442,12 +2416,52 @@ parquetGetForeignPlan(PlannerInfo * /* root */,
 	 */
     scan_clauses = extract_actual_clauses(scan_clauses, false);
 
+    /*
+     * Pushed down aggregates are returned as a single tuple built from
+     * statistics. All the clauses are already accounted for.
+     */
+    if (fdw_private->type == RT_AGGREGATE)
+    {
+        int     resno = 1;
+
+        scan_relid = 0;
+        scan_clauses = NIL;
+        foreach (lc, fdw_private->agg_exprs)
+            fdw_scan_tlist = lappend(fdw_scan_tlist,
+                                     makeTargetEntry((Expr *) lfirst(lc),
+                                                     resno++, NULL, false));
+    }
+
     /*
      * We can't just pass arbitrary structure into make_foreignscan() because
      * in some cases (i.e. plan caching) postgres may want to make a copy of
      * the plan and it can only make copy of something it knows of, namely
      * Nodes. So we need to convert everything in nodes and store it in a List.
      */
+    /*
+     * Clauses with values computed at execution time become runtime filters.
+     * Their value expressions go to fdw_exprs so that references to the outer
+     * relation of parameterized path get replaced with Params.
+     */
+    if (fdw_private->type != RT_AGGREGATE && fdw_private->type != RT_TRIVIAL)
+    {
+        foreach (lc, scan_clauses)
+        {
+            Var    *var;
+            Expr   *value;
+            Oid     opno;
+
+            if (!is_runtime_filter_clause(root, scan_relid, (Expr *) lfirst(lc),
+                                          &var, &value, &opno))
+                continue;
+
+            runtime_filters = lappend(runtime_filters,
+                                      list_make3_oid((Oid) var->varattno, opno,
+                                                     ((OpExpr *) lfirst(lc))->inputcollid));
+            fdw_exprs = lappend(fdw_exprs, value);
+        }
+    }
+
     attr = -1;
     while ((attr = bms_next_member(fdw_private->attrs_used, attr)) >= 0)
         attrs_used = lappend_int(attrs_used, attr);
@@ -1464,14 +2478,17 @@ parquetGetForeignPlan(PlannerInfo * /* root */,
     params = lappend(params, makeInteger(fdw_private->type));
     params = lappend(params, makeInteger(fdw_private->max_open_files));
     params = lappend(params, fdw_private->rowgroups);
+    params = lappend(params, fdw_private->agg_values);
+    params = lappend(params, makeInteger(fdw_private->pre_buffer));
+    params = lappend(params, runtime_filters);
 
 	/* Create the ForeignScan node */
 	return make_foreignscan(tlist,
 							scan_clauses,
 							scan_relid,
-							NIL,	/* no expressions to evaluate */
+							fdw_exprs,
 							params,
-							NIL,	/* no custom tlist */
+							fdw_scan_tlist,
 							NIL,	/* no remote quals */
 							outer_plan);
 }
@@ -1487,12 +2504,16 @@ parquetBeginForeignScan(ForeignScanState *node, int /* eflags */)
     List           *fdw_private = plan->fdw_private;
     List           *attrs_list;
     List           *rowgroups_list = NIL;
+    List           *agg_values = NIL;
+    List           *runtime_filters = NIL;
+    List           *runtime_exprs;
     ListCell       *lc, *lc2;
     List           *filenames = NIL;
     std::set<int>   attrs_used;
     List           *attrs_sorted = NIL;
     bool            use_mmap = false;
     bool            use_threads = false;
+    bool            pre_buffer = false;
     int             i = 0;
     ReaderType      reader_type = RT_SINGLE;
     int             max_open_files = 0;
@@ -1529,6 +2550,15 @@ parquetBeginForeignScan(ForeignScanState *node, int /* eflags */)
             case 7:
                 rowgroups_list = (List *) lfirst(lc);
                 break;
+            case 8:
+                agg_values = (List *) lfirst(lc);
+                break;
+            case 9:
+                pre_buffer = (bool) intVal(lfirst(lc));
+                break;
+            case 10:
+                runtime_filters = (List *) lfirst(lc);
+                break;
         }
         ++i;
     }
@@ -1541,7 +2571,7 @@ parquetBeginForeignScan(ForeignScanState *node, int /* eflags */)
                                        "parquet_fdw tuple data",
                                        ALLOCSET_DEFAULT_SIZES);
 
-    std::list<SortSupportData> sort_keys;
+    std::vector<SortSupportData> sort_keys;
     foreach (lc, attrs_sorted)
     {
         SortSupportData sort_key;
@@ -1560,7 +2590,12 @@ parquetBeginForeignScan(ForeignScanState *node, int /* eflags */)
         sort_key.ssup_collation = collid;
         sort_key.ssup_nulls_first = true;
         sort_key.ssup_attno = attr;
-        sort_key.abbreviate = false;
+
+        /*
+         * Only the leading key is worth abbreviating as merge caches it for
+         * every input (see MultifileMergeExecutionStateBase::cache_key()).
+         */
+        sort_key.abbreviate = sort_keys.empty();
 
         get_sort_group_operators(typid,
                                  true, false, false,
@@ -1580,17 +2615,51 @@ parquetBeginForeignScan(ForeignScanState *node, int /* eflags */)
 
     try
     {
-        festate = create_parquet_execution_state(reader_type, reader_cxt, tupleDesc,
-                                                 attrs_used, sort_keys,
-                                                 use_threads, use_mmap,
-                                                 max_open_files);
-
-        forboth (lc, filenames, lc2, rowgroups_list)
+        if (reader_type == RT_AGGREGATE)
+        {
+            /* Aggregates are already computed by planner */
+            festate = create_aggregate_execution_state(agg_values);
+        }
+        else
         {
-            char *filename = strVal(lfirst(lc));
-            List *rowgroups = (List *) lfirst(lc2);
+            festate = create_parquet_execution_state(reader_type, reader_cxt, tupleDesc,
+                                                     attrs_used, sort_keys,
+                                                     use_threads, use_mmap,
+                                                     pre_buffer, max_open_files);
+
+            /* Readers bind to runtime filters when files are added */
+            runtime_exprs = ExecInitExprList(plan->fdw_exprs, (PlanState *) node);
+            forboth (lc, runtime_filters, lc2, runtime_exprs)
+            {
+                List           *filter = (List *) lfirst(lc);
+                RuntimeFilter   f;
+
+                f.attnum = linitial_oid(filter) - 1;
+                f.strategy = get_strategy(TupleDescAttr(tupleDesc, f.attnum)->atttypid,
+                                          lsecond_oid(filter), BTREE_AM_OID);
+                f.collid = lthird_oid(filter);
+                fmgr_info(get_opcode(lsecond_oid(filter)), &f.opfunc);
+                f.expr = (ExprState *) lfirst(lc2);
+                f.valtype = exprType((Node *) f.expr->expr);
+                get_typlenbyval(f.valtype, &f.vallen, &f.valbyval);
+                f.value = (Datum) 0;
+                f.isnull = true;
+
+                festate->runtime_filters.push_back(f);
+            }
+            if (runtime_filters)
+                festate->runtime_filters_cxt =
+                    AllocSetContextCreate(reader_cxt,
+                                          "parquet_fdw runtime filters",
+                                          ALLOCSET_SMALL_SIZES);
+
+            forboth (lc, filenames, lc2, rowgroups_list)
+            {
+                char *filename = strVal(lfirst(lc));
+                List *rowgroups = (List *) lfirst(lc2);
 
-            festate->add_file(filename, rowgroups);
+                festate->add_file(filename, rowgroups);
+            }
         }
     }
     catch(std::exception &e)
@@ -1632,6 +2701,32 @@ find_cmp_func(FmgrInfo *finfo, Oid type1, Oid type2)
     fmgr_info(cmp_proc_oid, finfo);
 }
 
+/*
+ * evaluate_runtime_filters
+ *      Compute values of runtime filters for the upcoming scan.
+ */
+static void
+evaluate_runtime_filters(ForeignScanState *node,
+                         ParquetFdwExecutionState *festate)
+{
+    ExprContext    *econtext = node->ss.ps.ps_ExprContext;
+    MemoryContext   oldcxt;
+
+    MemoryContextReset(festate->runtime_filters_cxt);
+    for (auto &filter : festate->runtime_filters)
+    {
+        Datum   value;
+
+        value = ExecEvalExprSwitchContext(filter.expr, econtext, &filter.isnull);
+
+        oldcxt = MemoryContextSwitchTo(festate->runtime_filters_cxt);
+        filter.value = filter.isnull ? (Datum) 0 :
+            datumCopy(value, filter.valbyval, filter.vallen);
+        MemoryContextSwitchTo(oldcxt);
+    }
+    festate->runtime_filters_valid = true;
+}
+
 extern "C" TupleTableSlot *
 parquetIterateForeignScan(ForeignScanState *node)
 {
@@ -1640,6 +2735,10 @@ parquetIterateForeignScan(ForeignScanState *node)
     std::string                 error;
 
 	ExecClearTuple(slot);
+
+    if (!festate->runtime_filters_valid && !festate->runtime_filters.empty())
+        evaluate_runtime_filters(node, festate);
+
     try
     {
         festate->next(slot);
@@ -1668,23 +2767,53 @@ parquetReScanForeignScan(ForeignScanState *node)
 {
     ParquetFdwExecutionState   *festate = (ParquetFdwExecutionState *) node->fdw_state;
 
+    /* Parameters might have changed */
+    festate->runtime_filters_valid = false;
     festate->rescan();
 }
 
+/*
+ * Row group that may be picked for ANALYZE sample
+ */
+struct SampleRowgroup
+{
+    int     file;       /* index in the list of files */
+    int     rowgroup;
+};
+
+/*
+ * parquetAcquireSampleRowsFunc
+ *      Collect a random sample of rows. Instead of scanning the whole table
+ *      a random subset of row groups is chosen (the total number of rows is
+ *      known from the metadata anyway) and only a leading part of each of
+ *      them is read, so that most of the pages are never decoded. Tables
+ *      with too few row groups for that are read entirely. Rows read are
+ *      then sampled with the reservoir algorithm as in acquire_sample_rows().
+ */
 static int
-parquetAcquireSampleRowsFunc(Relation relation, int /* elevel */,
+parquetAcquireSampleRowsFunc(Relation relation, int elevel,
                              HeapTuple *rows, int targrows,
                              double *totalrows,
                              double *totaldeadrows)
 {
-    ParquetFdwExecutionState   *festate;
     ParquetFdwPlanState         fdw_private;
+    ParquetReader      *volatile reader = nullptr;
     MemoryContext               reader_cxt;
     TupleDesc       tupleDesc = RelationGetDescr(relation);
     TupleTableSlot *slot;
     std::set<int>   attrs_used;
-    int             cnt = 0;
-    uint64          num_rows = 0;
+    std::vector<std::string>    filenames;
+    std::vector<SampleRowgroup> candidates;
+    std::vector<SampleRowgroup> sample;
+    BlockSamplerData    bs;
+    ReservoirStateData  rstate;
+    int64           rows_per_rowgroup;
+    int             nrowgroups;
+    int             nsample;
+    int             numrows = 0;
+    double          num_rows = 0;
+    double          rows_read = 0;
+    double          rowstoskip = -1;
     ListCell       *lc;
     std::string     error;
 
@@ -1693,38 +2822,23 @@ parquetAcquireSampleRowsFunc(Relation relation, int /* elevel */,
     for (int i = 0; i < tupleDesc->natts; ++i)
         attrs_used.insert(i + 1 - FirstLowInvalidHeapAttributeNumber);
 
-    reader_cxt = AllocSetContextCreate(CurrentMemoryContext,
-                                       "parquet_fdw tuple data",
-                                       ALLOCSET_DEFAULT_SIZES);
-    festate = create_parquet_execution_state(RT_MULTI, reader_cxt, tupleDesc,
-                                             attrs_used, std::list<SortSupportData>(),
-                                             fdw_private.use_threads,
-                                             false, 0);
-
+    /* Gather non-empty row groups of all the files */
     foreach (lc, fdw_private.filenames)
     {
         char *filename = strVal(lfirst(lc));
 
         try
         {
-            std::unique_ptr<parquet::arrow::FileReader> reader;
-            arrow::Status   status;
-            List           *rowgroups = NIL;
-
-            status = parquet::arrow::FileReader::Make(
-                        arrow::default_memory_pool(),
-                        parquet::ParquetFileReader::OpenFile(filename, false),
-                        &reader);
-            if (!status.ok())
-                throw Error("failed to open Parquet file: %s",
-                                     status.message().c_str());
-            auto meta = reader->parquet_reader()->metadata();
-            num_rows += meta->num_rows();
+            auto summary = get_file_summary(filename);
+            auto &meta = summary->meta;
 
-            /* We need to scan all rowgroups */
             for (int i = 0; i < meta->num_row_groups(); ++i)
-                rowgroups = lappend_int(rowgroups, i);
-            festate->add_file(filename, rowgroups);
+            {
+                if (meta->RowGroup(i)->num_rows() > 0)
+                    candidates.push_back({(int) filenames.size(), i});
+            }
+            num_rows += meta->num_rows();
+            filenames.push_back(filename);
         }
         catch(const std::exception &e)
         {
@@ -1734,72 +2848,184 @@ parquetAcquireSampleRowsFunc(Relation relation, int /* elevel */,
             elog(ERROR, "parquet_fdw: %s", error.c_str());
     }
 
-    PG_TRY();
+    /*
+     * Read ANALYZE_MIN_ROWGROUP_ROWS rows from every row group we touch and
+     * pick as many row groups as needed to get targrows rows. Those are the
+     * leading rows of each row group, so there have to be enough row groups
+     * for the sample to cover the whole table. If there are fewer, read all
+     * of them entirely and leave it to the reservoir to pick rows from their
+     * whole range.
+     */
+    nrowgroups = candidates.size();
+    if ((int64) nrowgroups * ANALYZE_MIN_ROWGROUP_ROWS >= targrows)
+    {
+        rows_per_rowgroup = ANALYZE_MIN_ROWGROUP_ROWS;
+        nsample = (targrows + rows_per_rowgroup - 1) / rows_per_rowgroup;
+    }
+    else
     {
-        uint64  row = 0;
-        int     ratio = num_rows / targrows;
+        rows_per_rowgroup = 0;      /* no limit */
+        nsample = nrowgroups;
+    }
 
-        /* Set ratio to at least 1 to avoid devision by zero issue */
-        ratio = ratio < 1 ? 1 : ratio;
+#if PG_VERSION_NUM < 150000
+    BlockSampler_Init(&bs, nrowgroups, nsample, random());
+#else
+    BlockSampler_Init(&bs, nrowgroups, nsample,
+                      pg_prng_uint32(&pg_global_prng_state));
+#endif
+    /* Row groups come out ordered, hence grouped by file */
+    while (BlockSampler_HasMore(&bs))
+        sample.push_back(candidates[BlockSampler_Next(&bs)]);
 
+    reservoir_init_selection_state(&rstate, targrows);
 
+    reader_cxt = AllocSetContextCreate(CurrentMemoryContext,
+                                       "parquet_fdw tuple data",
+                                       ALLOCSET_DEFAULT_SIZES);
 #if PG_VERSION_NUM < 120000
-        slot = MakeSingleTupleTableSlot(tupleDesc);
+    slot = MakeSingleTupleTableSlot(tupleDesc);
 #else
-        slot = MakeSingleTupleTableSlot(tupleDesc, &TTSOpsHeapTuple);
+    slot = MakeSingleTupleTableSlot(tupleDesc, &TTSOpsHeapTuple);
 #endif
 
-        while (true)
+    PG_TRY();
+    {
+        size_t  i = 0;
+
+        while (i < sample.size())
         {
-            CHECK_FOR_INTERRUPTS();
+            int                 file = sample[i].file;
+            std::vector<int>    rowgroups;
 
-            if (cnt >= targrows)
-                break;
+            for (; i < sample.size() && sample[i].file == file; ++i)
+                rowgroups.push_back(sample[i].rowgroup);
+
+            try
+            {
+                reader = create_parquet_reader(filenames[file].c_str(), reader_cxt);
+                reader->set_rowgroups_list(rowgroups);
+                reader->set_options(fdw_private.use_threads, fdw_private.use_mmap);
+                reader->set_rowgroup_rows_limit(rows_per_rowgroup);
+                reader->open();
+                reader->create_column_mapping(tupleDesc, attrs_used);
+            }
+            catch(std::exception &e)
+            {
+                error = e.what();
+            }
+            if (!error.empty())
+                elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+            while (true)
+            {
+                ReadStatus  res = RS_EOF;
+
+                CHECK_FOR_INTERRUPTS();
+
+                ExecClearTuple(slot);
+                try
+                {
+                    res = reader->next(slot);
+                }
+                catch(std::exception &e)
+                {
+                    error = e.what();
+                }
+                if (!error.empty())
+                    elog(ERROR, "parquet_fdw: %s", error.c_str());
 
-            bool fake = (row % ratio) != 0;
-            ExecClearTuple(slot);
-            try {
-                if (!festate->next(slot, fake))
+                if (res != RS_SUCCESS)
                     break;
-            } catch(std::exception &e) {
-                error = e.what();
-            }
-            if (!error.empty())
-                elog(ERROR, "parquet_fdw: %s", error.c_str());
 
-            if (!fake)
-            {
-                rows[cnt++] = heap_form_tuple(tupleDesc,
-                                              slot->tts_values,
-                                              slot->tts_isnull);
+                if (numrows < targrows)
+                    rows[numrows++] = heap_form_tuple(tupleDesc,
+                                                      slot->tts_values,
+                                                      slot->tts_isnull);
+                else
+                {
+                    /*
+                     * Replace a random tuple of the reservoir, skipping as
+                     * many rows as the algorithm tells.
+                     */
+                    if (rowstoskip < 0)
+                        rowstoskip = reservoir_get_next_S(&rstate, rows_read,
+                                                          targrows);
+
+                    if (rowstoskip <= 0)
+                    {
+                        int k = (int) (targrows * sampler_random_fract(&rstate.randstate));
+
+                        Assert(k >= 0 && k < targrows);
+                        heap_freetuple(rows[k]);
+                        rows[k] = heap_form_tuple(tupleDesc,
+                                                  slot->tts_values,
+                                                  slot->tts_isnull);
+                    }
+                    rowstoskip -= 1;
+                }
+                rows_read += 1;
             }
 
-            row++;
+            delete reader;
+            reader = nullptr;
         }
-
-        *totalrows = num_rows;
-        *totaldeadrows = 0;
-
-        ExecDropSingleTupleTableSlot(slot);
     }
     PG_CATCH();
     {
-        elog(LOG, "Cancelled");
-        delete festate;
+        delete reader;
         PG_RE_THROW();
     }
     PG_END_TRY();
 
-    delete festate;
+    ExecDropSingleTupleTableSlot(slot);
+    MemoryContextDelete(reader_cxt);
 
-    return cnt - 1;
+    ereport(elevel,
+            (errmsg("\"%s\": read %d of %d row groups, %.0f rows read, "
+                    "%d rows in sample, %.0f total rows",
+                    RelationGetRelationName(relation), nsample, nrowgroups,
+                    rows_read, numrows, num_rows)));
+
+    *totalrows = num_rows;
+    *totaldeadrows = 0;
+
+    return numrows;
 }
 
+/*
+ * parquetAnalyzeForeignTable
+ *      Report total size of the files as the number of pages.
+ */
 extern "C" bool
-parquetAnalyzeForeignTable(Relation /* relation */,
+parquetAnalyzeForeignTable(Relation relation,
                            AcquireSampleRowsFunc *func,
-                           BlockNumber * /* totalpages */)
+                           BlockNumber *totalpages)
 {
+    ParquetFdwPlanState fdw_private;
+    double          size = 0;
+    ListCell       *lc;
+    std::string     error;
+
+    get_table_options(RelationGetRelid(relation), &fdw_private);
+
+    foreach (lc, fdw_private.filenames)
+    {
+        char *filename = strVal(lfirst(lc));
+
+        try
+        {
+            size += get_file_summary(filename)->size;
+        }
+        catch(const std::exception &e)
+        {
+            error = e.what();
+        }
+        if (!error.empty())
+            elog(ERROR, "parquet_fdw: %s", error.c_str());
+    }
+
+    *totalpages = Max(1, ceil(size / BLCKSZ));
     *func = parquetAcquireSampleRowsFunc;
     return true;
 }
@@ -1823,7 +3049,7 @@ parquetExplainForeignScan(ForeignScanState *node, ExplainState *es)
 	fdw_private = ((ForeignScan *) node->ss.ps.plan)->fdw_private;
     filenames = (List *) linitial(fdw_private);
     reader_type = (ReaderType) intVal(list_nth(fdw_private, 5));
-    rowgroups_list = (List *) llast(fdw_private);
+    rowgroups_list = (List *) list_nth(fdw_private, 7);
 
     switch (reader_type)
     {
@@ -1842,6 +3068,9 @@ parquetExplainForeignScan(ForeignScanState *node, ExplainState *es)
         case RT_CACHING_MULTI_MERGE:
             ExplainPropertyText("Reader", "Caching Multifile Merge", es);
             break;
+        case RT_AGGREGATE:
+            ExplainPropertyText("Reader", "Aggregate Pushdown", es);
+            break;
     }
 
     forboth(lc, filenames, lc2, rowgroups_list)
@@ -1882,15 +3111,50 @@ parquetExplainForeignScan(ForeignScanState *node, ExplainState *es)
     }
 
     ExplainPropertyText("Row groups", str.data, es);
+
+    /* Columns checked by runtime filters */
+    if (list_length(fdw_private) > 10 && list_nth(fdw_private, 10) != NIL)
+    {
+        Oid     relid = RelationGetRelid(node->ss.ss_currentRelation);
+
+        resetStringInfo(&str);
+        foreach (lc, (List *) list_nth(fdw_private, 10))
+        {
+            List   *filter = (List *) lfirst(lc);
+
+            if (str.len > 0)
+                appendStringInfoString(&str, ", ");
+            appendStringInfoString(&str,
+                                   get_attname(relid, linitial_oid(filter), false));
+        }
+        ExplainPropertyText("Runtime Filters", str.data, es);
+    }
 }
 
 /* Parallel query execution */
 
+/*
+ * parquetIsForeignScanParallelSafe
+ *      Pre-buffering relies on knowing which row group comes next, so such
+ *      tables are scanned by a single process (possibly asynchronously under
+ *      Append) rather than in parallel.
+ */
 extern "C" bool
 parquetIsForeignScanParallelSafe(PlannerInfo * /* root */,
-                                 RelOptInfo *rel,
-                                 RangeTblEntry * /* rte */)
+                                 RelOptInfo * /* rel */,
+                                 RangeTblEntry *rte)
 {
+    ForeignTable   *table = GetForeignTable(rte->relid);
+    ListCell       *lc;
+
+    foreach (lc, table->options)
+    {
+        DefElem    *def = (DefElem *) lfirst(lc);
+
+        if (strcmp(def->defname, "pre_buffer") == 0 && defGetBoolean(def))
+            return false;
+    }
+
     return true;
 }
 
@@ -1951,12 +3215,122 @@ parquetShutdownForeignScan(ForeignScanState * /* node */)
 {
 }
 
+/* Asynchronous execution */
+
+/*
+ * parquetIsForeignPathAsyncCapable
+ *      Scans with pre-buffering enabled may run asynchronously under Append
+ *      so that reading of several foreign tables (e.g. partitions) overlaps.
+ */
+extern "C" bool
+parquetIsForeignPathAsyncCapable(ForeignPath *path)
+{
+    auto fdw_private = (ParquetFdwPlanState *) path->fdw_private;
+
+    return fdw_private->pre_buffer &&
+        (fdw_private->type == RT_SINGLE || fdw_private->type == RT_MULTI);
+}
+
+/*
+ * produce_tuple_asynchronously
+ *      Return the next tuple to requestor if it's available without waiting
+ *      for I/O. Otherwise mark the request as pending.
+ */
+static void
+produce_tuple_asynchronously(AsyncRequest *areq)
+{
+    ForeignScanState           *node = (ForeignScanState *) areq->requestee;
+    ParquetFdwExecutionState   *festate = (ParquetFdwExecutionState *) node->fdw_state;
+    bool                        ready = true;
+    std::string                 error;
+
+    try
+    {
+        ready = festate->ready();
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    if (ready)
+        ExecAsyncRequestDone(areq, ExecProcNode((PlanState *) node));
+    else
+        ExecAsyncRequestPending(areq);
+}
+
+extern "C" void
+parquetForeignAsyncRequest(AsyncRequest *areq)
+{
+    produce_tuple_asynchronously(areq);
+}
+
+/*
+ * parquetForeignAsyncConfigureWait
+ *      Wait for pre-buffering of the next row group to complete.
+ */
+extern "C" void
+parquetForeignAsyncConfigureWait(AsyncRequest *areq)
+{
+    ForeignScanState           *node = (ForeignScanState *) areq->requestee;
+    ParquetFdwExecutionState   *festate = (ParquetFdwExecutionState *) node->fdw_state;
+    AppendState                *requestor = (AppendState *) areq->requestor;
+    int                         fd = -1;
+    std::string                 error;
+
+    /* This should not be called unless callback_pending */
+    Assert(areq->callback_pending);
+
+    try
+    {
+        fd = festate->wait_event_fd();
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    AddWaitEventToSet(requestor->as_eventset, WL_SOCKET_READABLE, fd,
+                      NULL, areq);
+}
+
+extern "C" void
+parquetForeignAsyncNotify(AsyncRequest *areq)
+{
+    ForeignScanState           *node = (ForeignScanState *) areq->requestee;
+    ParquetFdwExecutionState   *festate = (ParquetFdwExecutionState *) node->fdw_state;
+
+    festate->clear_wait_event();
+    produce_tuple_asynchronously(areq);
+}
+
+/*
+ * parquetImportForeignSchema
+ *      Create foreign table for every parquet file of the directory. The
+ *      fields of files that haven't changed since an earlier import are taken
+ *      from the persistent schema cache. Footers of the other files are read
+ *      concurrently by parquet_fdw.import_threads threads and are kept in the
+ *      metadata cache of the backend (see cache.cpp).
+ */
 extern "C" List *
 parquetImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid /* serverOid */)
 {
     struct dirent  *f;
     DIR            *d;
     List           *cmds = NIL;
+    List           *tablenames = NIL;
+    std::vector<std::string> paths;
+    std::vector<List *> fields;
+    std::vector<std::string> missing;
+    std::vector<std::shared_ptr<FileSummary>> summaries;
+    ListCell       *lc;
+    size_t          i;
+    size_t          j;
+    std::string     error;
 
     d = AllocateDir(stmt->remote_schema);
     if (!d)
@@ -1974,19 +3348,13 @@ parquetImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid /* serverOid */)
         /* TODO: use lstat if d_type == DT_UNKNOWN */
         if (f->d_type == DT_REG)
         {
-            ListCell   *lc;
-            bool        skip = false;
-            List       *fields;
+            bool        listed = false;
             char       *filename = pstrdup(f->d_name);
-            char       *path;
-            char       *query;
-
-            path = psprintf("%s/%s", stmt->remote_schema, filename);
 
             /* check that file extension is "parquet" */
             char *ext = strrchr(filename, '.');
 
-            if (ext && strcmp(ext + 1, "parquet") != 0)
+            if (!ext || strcmp(ext + 1, "parquet") != 0)
                 continue;
 
             /*
@@ -1999,39 +3367,67 @@ parquetImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid /* serverOid */)
             {
                 RangeVar *rv = (RangeVar *) lfirst(lc);
 
-                switch (stmt->list_type)
+                if (strcmp(filename, rv->relname) == 0)
                 {
-                    case FDW_IMPORT_SCHEMA_LIMIT_TO:
-                        if (strcmp(filename, rv->relname) != 0)
-                        {
-                            skip = true;
-                            break;
-                        }
-                        break;
-                    case FDW_IMPORT_SCHEMA_EXCEPT:
-                        if (strcmp(filename, rv->relname) == 0)
-                        {
-                            skip = true;
-                            break;
-                        }
-                        break;
-                    default:
-                        ;
+                    listed = true;
+                    break;
                 }
             }
-            if (skip)
+
+            if ((stmt->list_type == FDW_IMPORT_SCHEMA_LIMIT_TO && !listed) ||
+                (stmt->list_type == FDW_IMPORT_SCHEMA_EXCEPT && listed))
                 continue;
 
-            fields = extract_parquet_fields(path);
-            query = create_foreign_table_query(filename, stmt->local_schema,
-                                               stmt->server_name, &path, 1,
-                                               fields, stmt->options);
-            cmds = lappend(cmds, query);
+            tablenames = lappend(tablenames, filename);
+            paths.push_back(psprintf("%s/%s", stmt->remote_schema, f->d_name));
         }
 
     }
     FreeDir(d);
 
+    for (i = 0; i < paths.size(); i++)
+    {
+        fields.push_back(load_cached_fields(paths[i].c_str()));
+        if (fields[i] == NIL)
+            missing.push_back(paths[i]);
+    }
+
+    try
+    {
+        summaries = get_file_summaries(missing, parquet_fdw_import_threads);
+
+        for (i = 0, j = 0; i < paths.size(); i++)
+        {
+            if (fields[i] != NIL)
+                continue;
+            fields[i] = schema_to_fields(summaries[j]->manifest,
+                                         paths[i].c_str());
+            store_cached_fields(paths[i].c_str(), summaries[j].get(),
+                                fields[i]);
+            j++;
+        }
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    i = 0;
+    foreach (lc, tablenames)
+    {
+        char       *path = pstrdup(paths[i].c_str());
+        char       *query;
+
+        query = create_foreign_table_query((char *) lfirst(lc),
+                                           stmt->local_schema,
+                                           stmt->server_name, &path, 1,
+                                           fields[i], stmt->options);
+        cmds = lappend(cmds, query);
+        i++;
+    }
+
     return cmds;
 }
 
@@ -2105,6 +3501,13 @@ parquet_fdw_validator_impl(PG_FUNCTION_ARGS)
              */
             DirectFunctionCall1(jsonb_in, CStringGetDatum(defGetString(def)));
         }
+        else if (strcmp(def->defname, "files_func_ttl") == 0)
+        {
+            if (string_to_int32(defGetString(def)) < 0)
+                ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("parquet_fdw: files_func_ttl must not be negative")));
+        }
         else if (strcmp(def->defname, "sorted") == 0)
             ;  /* do nothing */
         else if (strcmp(def->defname, "use_mmap") == 0)
@@ -2117,6 +3520,11 @@ parquet_fdw_validator_impl(PG_FUNCTION_ARGS)
             /* Check that bool value is valid */
             (void) defGetBoolean(def);
         }
+        else if (strcmp(def->defname, "pre_buffer") == 0)
+        {
+            /* Check that bool value is valid */
+            (void) defGetBoolean(def);
+        }
         else if (strcmp(def->defname, "max_open_files") == 0)
         {
             /* check that int value is valid */
@@ -2330,6 +3738,206 @@ import_parquet_internal(const char *tablename, const char *schemaname,
     }
 }
 
+/*
+ * parse_export_options
+ *      Parse parquet_export() options. Returns space separated list of
+ *      columns to sort by (or NULL).
+ */
+static char *
+parse_export_options(Jsonb *options, ParquetWriterOptions *opts)
+{
+    List       *optlist = jsonb_to_options_list(options);
+    char       *sorted = NULL;
+    const char *compression = "snappy";
+    std::string error;
+    ListCell   *lc;
+
+    opts->row_group_size = DEFAULT_EXPORT_ROW_GROUP_SIZE;
+    opts->compression_level = arrow::util::kUseDefaultCompressionLevel;
+    opts->dictionary = true;
+    opts->statistics = true;
+
+    foreach (lc, optlist)
+    {
+        DefElem    *def = (DefElem *) lfirst(lc);
+
+        if (strcmp(def->defname, "row_group_size") == 0)
+        {
+            opts->row_group_size = string_to_int32(defGetString(def));
+            if (opts->row_group_size <= 0)
+                elog(ERROR, "row_group_size must be positive");
+        }
+        else if (strcmp(def->defname, "compression") == 0)
+            compression = defGetString(def);
+        else if (strcmp(def->defname, "compression_level") == 0)
+            opts->compression_level = string_to_int32(defGetString(def));
+        else if (strcmp(def->defname, "dictionary") == 0)
+            opts->dictionary = defGetBoolean(def);
+        else if (strcmp(def->defname, "statistics") == 0)
+            opts->statistics = defGetBoolean(def);
+        else if (strcmp(def->defname, "sorted") == 0)
+            sorted = defGetString(def);
+        else
+            elog(ERROR, "unknown option '%s'", def->defname);
+    }
+
+    {
+        auto res = arrow::util::Codec::GetCompressionType(
+            strcmp(compression, "none") == 0 ? "uncompressed" : compression);
+
+        if (!res.ok())
+            error = res.status().message();
+        else if (!arrow::util::Codec::IsAvailable(*res))
+            error = "not supported by Arrow library";
+        else
+            opts->compression = *res;
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: invalid compression '%s': %s",
+             compression, error.c_str());
+
+    return sorted;
+}
+
+static void
+destroy_parquet_writer(void *arg)
+{
+    ParquetWriter **writer = (ParquetWriter **) arg;
+
+    if (*writer)
+        delete *writer;
+}
+
+/*
+ * parquet_export_internal
+ *      Write result of the query into a Parquet file. Rows are fetched from
+ *      the cursor in batches and converted into Arrow arrays which are
+ *      written out once a row group is collected.
+ */
+static int64
+parquet_export_internal(const char *query, const char *path,
+                        Jsonb *options) noexcept
+{
+    ParquetWriterOptions    opts;
+    ParquetWriter         **writer;
+    MemoryContextCallback  *callback;
+    SPIPlanPtr              plan;
+    Portal                  portal;
+    TupleDesc               tupdesc;
+    char                   *sorted;
+    int64                   written = 0;
+    std::string             error;
+
+    if (!query || !path)
+        elog(ERROR, "query and path are mandatory");
+
+#if PG_VERSION_NUM < 110000
+    if (!superuser())
+#else
+    if (!has_privs_of_role(GetUserId(), ROLE_PG_WRITE_SERVER_FILES))
+#endif
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("must be superuser or a member of the pg_write_server_files role to export to a file")));
+
+    if (!is_absolute_path(path))
+        elog(ERROR, "relative path not allowed for parquet_export");
+
+    sorted = parse_export_options(options, &opts);
+
+    /* Let executor take care of the order */
+    if (sorted)
+    {
+        StringInfoData  str;
+        char           *tok = strtok(pstrdup(sorted), " ");
+        bool            is_first = true;
+
+        initStringInfo(&str);
+        appendStringInfo(&str, "SELECT * FROM (%s) AS q ORDER BY ", query);
+        while (tok)
+        {
+            if (!is_first)
+                appendStringInfoString(&str, ", ");
+            appendStringInfoString(&str, quote_identifier(tok));
+            is_first = false;
+            tok = strtok(NULL, " ");
+        }
+        query = str.data;
+    }
+
+    /*
+     * Remove incomplete file in case of error by destroying the writer along
+     * with the memory context.
+     */
+    writer = (ParquetWriter **) palloc0(sizeof(ParquetWriter *));
+    callback = (MemoryContextCallback *) palloc(sizeof(MemoryContextCallback));
+    callback->func = destroy_parquet_writer;
+    callback->arg = (void *) writer;
+    MemoryContextRegisterResetCallback(CurrentMemoryContext, callback);
+
+    if (SPI_connect() < 0)
+        elog(ERROR, "parquet_fdw: SPI_connect failed");
+
+    if ((plan = SPI_prepare(query, 0, NULL)) == NULL)
+        elog(ERROR, "parquet_fdw: failed to prepare query: %s",
+             SPI_result_code_string(SPI_result));
+
+    portal = SPI_cursor_open(NULL, plan, NULL, NULL, true);
+    tupdesc = CreateTupleDescCopy(portal->tupDesc);
+
+    try
+    {
+        *writer = new ParquetWriter(path, tupdesc, opts);
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    while (true)
+    {
+        SPI_cursor_fetch(portal, true, EXPORT_FETCH_ROWS);
+        if (SPI_processed == 0)
+            break;
+
+        try
+        {
+            for (uint64 i = 0; i < SPI_processed; ++i)
+                (*writer)->write(SPI_tuptable->vals[i]);
+        }
+        catch (std::exception &e)
+        {
+            error = e.what();
+        }
+        if (!error.empty())
+            elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+        SPI_freetuptable(SPI_tuptable);
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    try
+    {
+        (*writer)->close();
+        written = (*writer)->written();
+        delete *writer;
+        *writer = NULL;
+    }
+    catch (std::exception &e)
+    {
+        error = e.what();
+    }
+    if (!error.empty())
+        elog(ERROR, "parquet_fdw: %s", error.c_str());
+
+    SPI_cursor_close(portal);
+    SPI_finish();
+
+    return written;
+}
+
 extern "C"
 {
 
@@ -2387,4 +3995,28 @@ import_parquet_with_attrs(PG_FUNCTION_ARGS)
     PG_RETURN_VOID();
 }
 
+PG_FUNCTION_INFO_V1(parquet_export);
+Datum
+parquet_export(PG_FUNCTION_ARGS)
+{
+    char       *query;
+    char       *path;
+    Jsonb      *options;
+
+    query = PG_ARGISNULL(0) ? NULL : text_to_cstring(PG_GETARG_TEXT_P(0));
+    path = PG_ARGISNULL(1) ? NULL : text_to_cstring(PG_GETARG_TEXT_P(1));
+    options = PG_ARGISNULL(2) ? NULL : PG_GETARG_JSONB_P(2);
+
+    PG_RETURN_INT64(parquet_export_internal(query, path, options));
+}
+
+PG_FUNCTION_INFO_V1(parquet_fdw_reset_cache);
+Datum
+parquet_fdw_reset_cache(PG_FUNCTION_ARGS)
+{
+    reset_caches();
+
+    PG_RETURN_VOID();
+}
+
 }
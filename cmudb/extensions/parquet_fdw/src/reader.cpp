@@ -1,5 +1,8 @@
 #include <list>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "arrow/api.h"
 #include "arrow/io/api.h"
 #include "arrow/array.h"
@@ -10,19 +13,25 @@
 #include "parquet/statistics.h"
 
 #include "common.hpp"
+#include "cache.hpp"
 #include "reader.hpp"
 
 extern "C"
 {
 #include "postgres.h"
+#include "access/htup_details.h"
+#include "access/nbtree.h"
 #include "access/sysattr.h"
 #include "parser/parse_coerce.h"
+#include "storage/fd.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/pg_locale.h"
 #include "utils/timestamp.h"
+#include "utils/typcache.h"
 
 #if PG_VERSION_NUM < 110000
 #include "catalog/pg_type.h"
@@ -33,6 +42,9 @@ extern "C"
 
 #define SEGMENT_SIZE (1024 * 1024)
 
+/* Lower bound of the batch size of CachingParquetReader */
+#define MIN_BATCH_ROWS 1024
+
 
 bool parquet_fdw_use_threads = true;
 
@@ -49,10 +61,13 @@ private:
     char               *segment_last_ptr;
     std::list<char *>   garbage_segments;
 
+    /* Bytes handed out since the last recycle() */
+    size_t              allocated;
+
 public:
     FastAllocator(MemoryContext cxt)
         : segments_cxt(cxt), segment_start_ptr(nullptr), segment_cur_ptr(nullptr),
-          segment_last_ptr(nullptr), garbage_segments()
+          segment_last_ptr(nullptr), garbage_segments(), allocated(0)
     {}
 
     ~FastAllocator()
@@ -73,6 +88,8 @@ public:
 
         Assert(size >= 0);
 
+        this->allocated += size;
+
         /* If allocation is bigger than segment then just palloc */
         if (size > SEGMENT_SIZE)
         {
@@ -115,6 +132,8 @@ public:
 
     void recycle(void)
     {
+        this->allocated = 0;
+
         /* recycle old segments if any */
         if (!this->garbage_segments.empty())
         {
@@ -142,11 +161,19 @@ public:
     {
         return segments_cxt;
     }
+
+    size_t allocated_bytes()
+    {
+        return allocated;
+    }
 };
 
 
 ParquetReader::ParquetReader(MemoryContext cxt)
-    : allocator(new FastAllocator(cxt))
+    : allocator(new FastAllocator(cxt)), dictionary_cxt(nullptr),
+      use_threads(false), use_mmap(false), pre_buffer(false),
+      rowgroup_rows_limit(0), prefetched_idx(-1), notify_pipe(nullptr), notify_armed(false),
+      runtime_filters(nullptr)
 {}
 
 int32_t ParquetReader::id()
@@ -154,6 +181,147 @@ int32_t ParquetReader::id()
     return reader_id;
 }
 
+/*
+ * open_file
+ *      Open Parquet file and create Arrow reader for it.
+ *
+ * String and binary columns which are dictionary-encoded in every row group
+ * we are going to read are requested as arrow::DictionaryArray. That way each
+ * distinct value is converted into a Datum only once per row group (see
+ * read_dictionary()) instead of allocating and copying it for every row.
+ */
+void ParquetReader::open_file()
+{
+    parquet::ArrowReaderProperties  props;
+    std::unique_ptr<parquet::ParquetFileReader> file_reader;
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    arrow::Status   status;
+
+    parquet::ReaderProperties       file_props = parquet::default_reader_properties();
+
+    /* Reuse the footer parsed during planning if it's still valid */
+    auto summary = get_file_summary(filename.c_str());
+    auto &meta = summary->meta;
+
+    /* Don't read entire column chunks if only a part of them is needed */
+    if (this->rowgroup_rows_limit > 0)
+        file_props.enable_buffered_stream();
+
+    file_reader = parquet::ParquetFileReader::OpenFile(filename, use_mmap,
+                                                       file_props, meta);
+
+    for (auto &schema_field : summary->manifest.schema_fields)
+    {
+        auto    type_id = schema_field.field->type()->id();
+        bool    dict_encoded = !this->rowgroups.empty();
+
+        /* Only top level string and binary columns */
+        if (schema_field.column_index < 0 ||
+            (type_id != arrow::Type::STRING && type_id != arrow::Type::BINARY))
+            continue;
+
+        for (int rowgroup : this->rowgroups)
+        {
+            auto column = meta->RowGroup(rowgroup)->ColumnChunk(schema_field.column_index);
+
+            if (!column->has_dictionary_page())
+            {
+                dict_encoded = false;
+                break;
+            }
+        }
+
+        if (dict_encoded)
+            props.set_read_dictionary(schema_field.column_index, true);
+    }
+
+    status = parquet::arrow::FileReader::Make(arrow::default_memory_pool(),
+                                              std::move(file_reader),
+                                              props,
+                                              &reader);
+    if (!status.ok())
+        throw Error("failed to open Parquet file %s ('%s')",
+                    status.message().c_str(), filename.c_str());
+    this->reader = std::move(reader);
+
+    /* Enable parallel columns decoding/decompression if needed */
+    this->reader->set_use_threads(this->use_threads && parquet_fdw_use_threads);
+}
+
+/*
+ * read_dictionary
+ *      Convert every value of the chunk's dictionary into a Datum (applying
+ *      cast if needed). Values of the chunk are then just indexes into the
+ *      returned array. Resulting Datums are valid until the next
+ *      reset_dictionaries() call.
+ */
+Datum *ParquetReader::read_dictionary(arrow::DictionaryArray *array,
+                                      const TypeInfo &typinfo)
+{
+    MemoryContext   oldcxt;
+    arrow::BinaryArray *dict;
+    Datum          *values;
+    bool            error = false;
+
+    if (array->indices()->type_id() != arrow::Type::INT32)
+        throw Error("parquet_fdw: unexpected dictionary index type: %s",
+                    array->indices()->type()->name().c_str());
+
+    if (!this->dictionary_cxt)
+    {
+        PG_TRY();
+        {
+            this->dictionary_cxt = AllocSetContextCreate(allocator->context(),
+                                                         "parquet_fdw dictionary data",
+                                                         ALLOCSET_DEFAULT_SIZES);
+        }
+        PG_CATCH();
+        {
+            error = true;
+        }
+        PG_END_TRY();
+        if (error)
+            throw std::runtime_error("failed to create memory context");
+    }
+
+    dict = (arrow::BinaryArray *) array->dictionary().get();
+
+    oldcxt = MemoryContextSwitchTo(this->dictionary_cxt);
+    values = (Datum *) exc_palloc(sizeof(Datum) * dict->length());
+
+    for (int64_t i = 0; i < dict->length(); ++i)
+    {
+        int32_t     vallen = 0;
+        const char *value;
+        bytea      *b;
+
+        if (dict->IsNull(i))
+        {
+            /* never referenced by non-null indices */
+            values[i] = (Datum) 0;
+            continue;
+        }
+
+        value = reinterpret_cast<const char*>(dict->GetValue(i, &vallen));
+        b = (bytea *) exc_palloc(vallen + VARHDRSZ);
+        SET_VARSIZE(b, vallen + VARHDRSZ);
+        memcpy(VARDATA(b), value, vallen);
+
+        values[i] = PointerGetDatum(b);
+        if (typinfo.need_cast)
+            values[i] = do_cast(values[i], typinfo);
+    }
+    MemoryContextSwitchTo(oldcxt);
+
+    return values;
+}
+
+void ParquetReader::reset_dictionaries()
+{
+    if (this->dictionary_cxt)
+        MemoryContextReset(this->dictionary_cxt);
+}
+
 /*
  * create_column_mapping
  *      Create mapping between tuple descriptor and parquet columns.
@@ -214,48 +382,10 @@ void ParquetReader::create_column_mapping(TupleDesc tupleDesc, const std::set<in
                 switch (arrow_type->id())
                 {
                     case arrow::Type::LIST:
-                    {
-                        Assert(schema_field.children.size() == 1);
-
-                        Oid     elem_type;
-                        int16   elem_len;
-                        bool    elem_byval;
-                        char    elem_align;
-
-                        PG_TRY();
-                        {
-                            elem_type = get_element_type(typinfo.pg.oid);
-                            if (OidIsValid(elem_type)) {
-                                get_typlenbyvalalign(elem_type, &elem_len,
-                                                     &elem_byval, &elem_align);
-                            }
-                        }
-                        PG_CATCH();
-                        {
-                            error = true;
-                        }
-                        PG_END_TRY();
-                        if (error)
-                            throw Error("failed to get type length (column '%s')",
-                                        pg_colname);
-
-                        if (!OidIsValid(elem_type))
-                            throw Error("cannot convert parquet column of type "
-                                        "LIST to scalar type of postgres column '%s'",
-                                        pg_colname);
-
-                        auto     &child = schema_field.children[0];
-                        typinfo.children.emplace_back(child.field->type(),
-                                                      elem_type);
-                        TypeInfo &elem = typinfo.children[0];
-                        elem.pg.len = elem_len;
-                        elem.pg.byval = elem_byval;
-                        elem.pg.align = elem_align;
-                        initialize_cast(elem, attname);
-
-                        this->indices.push_back(child.column_index);
+                    case arrow::Type::STRUCT:
+                        initialize_nested_type(typinfo, schema_field, attname,
+                                               false);
                         break;
-                    }
                     case arrow::Type::MAP:
                     {
                         /* 
@@ -445,25 +575,34 @@ Datum ParquetReader::read_primitive_type(arrow::Array *array,
         case arrow::Type::TIMESTAMP:
         {
             /* TODO: deal with timezones */
-            TimestampTz ts;
             arrow::TimestampArray *tsarray = (arrow::TimestampArray *) array;
             auto tstype = (arrow::TimestampType *) array->type().get();
 
-            to_postgres_timestamp(tstype, tsarray->Value(i), ts);
-            res = TimestampGetDatum(ts);
+            res = TimestampGetDatum(to_postgres_timestamp(tstype->unit(),
+                                                          tsarray->Value(i)));
             break;
         }
         case arrow::Type::DATE32:
         {
             arrow::Date32Array *tsarray = (arrow::Date32Array *) array;
-            int32 d = tsarray->Value(i);
 
-            /*
-             * Postgres date starts with 2000-01-01 while unix date (which
-             * Parquet is using) starts with 1970-01-01. So we need to do
-             * simple calculations here.
-             */
-            res = DateADTGetDatum(d + (UNIX_EPOCH_JDATE - POSTGRES_EPOCH_JDATE));
+            res = DateADTGetDatum(tsarray->Value(i) + PARQUET_EPOCH_DAYS_OFFSET);
+            break;
+        }
+        case arrow::Type::DECIMAL128:
+        {
+            arrow::Decimal128Array *decarray = (arrow::Decimal128Array *) array;
+            auto dectype = (arrow::Decimal128Type *) array->type().get();
+            arrow::Decimal128 value(decarray->GetValue(i));
+            Pointer numeric = DatumGetPointer(decimal_to_numeric(value,
+                                                                 dectype->scale()));
+
+            /* Move it into the allocator memory along with other values */
+            void   *copy = this->allocator->fast_alloc(VARSIZE(numeric));
+            memcpy(copy, numeric, VARSIZE(numeric));
+            pfree(numeric);
+
+            res = PointerGetDatum(copy);
             break;
         }
         /* TODO: add other types */
@@ -479,10 +618,218 @@ Datum ParquetReader::read_primitive_type(arrow::Array *array,
     return res;
 }
 
+/*
+ * collect_leaf_columns
+ *      Add indices of all the leaf columns of the field to `indices`.
+ */
+static void
+collect_leaf_columns(const parquet::arrow::SchemaField &field,
+                     std::vector<int> &indices)
+{
+    if (field.column_index >= 0)
+        indices.push_back(field.column_index);
+
+    for (auto &child : field.children)
+        collect_leaf_columns(child, indices);
+}
+
+/*
+ * initialize_nested_type
+ *      Prepare type info of a list or struct column (or of a child of such
+ *      column) and add its leaf columns to the list of columns to read.
+ *      Lists nested into lists become extra dimensions of the postgres array
+ *      rather than arrays of their own (`list_dimension` is true for them),
+ *      structs are converted into composite types.
+ */
+void ParquetReader::initialize_nested_type(TypeInfo &typinfo,
+                                           const parquet::arrow::SchemaField &field,
+                                           const char *attname,
+                                           bool list_dimension)
+{
+    MemoryContext   oldcxt;
+    bool            error = false;
+
+    switch (typinfo.arrow.type_id)
+    {
+        case arrow::Type::LIST:
+        {
+            Oid     elem_type = typinfo.pg.oid;
+
+            Assert(field.children.size() == 1);
+
+            if (!list_dimension)
+            {
+                PG_TRY();
+                {
+                    elem_type = get_element_type(typinfo.pg.oid);
+                }
+                PG_CATCH();
+                {
+                    error = true;
+                }
+                PG_END_TRY();
+                if (error)
+                    throw Error("failed to get element type (column '%s')",
+                                attname);
+
+                if (!OidIsValid(elem_type))
+                    throw Error("cannot convert parquet column of type "
+                                "LIST to scalar type of postgres column '%s'",
+                                attname);
+            }
+
+            auto &child = field.children[0];
+            auto  child_type = child.field->type();
+
+            typinfo.children.emplace_back(child_type, elem_type);
+            initialize_nested_type(typinfo.children[0], child, attname,
+                                   child_type->id() == arrow::Type::LIST);
+            break;
+        }
+        case arrow::Type::STRUCT:
+        {
+            TupleDesc   tupdesc = NULL;
+
+            PG_TRY();
+            {
+                if (get_typtype(typinfo.pg.oid) == TYPTYPE_COMPOSITE)
+                {
+                    oldcxt = MemoryContextSwitchTo(CurTransactionContext);
+                    tupdesc = lookup_rowtype_tupdesc_copy(typinfo.pg.oid, -1);
+                    MemoryContextSwitchTo(oldcxt);
+                }
+            }
+            PG_CATCH();
+            {
+                error = true;
+            }
+            PG_END_TRY();
+            if (error)
+                throw Error("failed to get composite type (column '%s')",
+                            attname);
+
+            if (!tupdesc)
+                throw Error("cannot convert parquet column of type STRUCT "
+                            "to non-composite type of postgres column '%s'",
+                            attname);
+            typinfo.tupdesc = tupdesc;
+
+            /*
+             * Match struct fields to composite type attributes by name the
+             * same way columns are matched to the table attributes.
+             */
+            std::vector<bool>   used(field.children.size(), false);
+
+            for (int i = 0; i < tupdesc->natts; ++i)
+            {
+                Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+                char    attrname[NAMEDATALEN];
+                int     found = -1;
+
+                if (!attr->attisdropped)
+                {
+                    tolowercase(NameStr(attr->attname), attrname);
+
+                    for (size_t j = 0; j < field.children.size(); ++j)
+                    {
+                        auto   &name = field.children[j].field->name();
+                        char    fieldname[NAMEDATALEN];
+
+                        if (name.length() >= NAMEDATALEN)
+                            continue;
+                        tolowercase(name.c_str(), fieldname);
+                        if (strcmp(attrname, fieldname) == 0)
+                        {
+                            found = j;
+                            break;
+                        }
+                    }
+                }
+
+                typinfo.fields.push_back(found);
+                if (found < 0)
+                {
+                    /* Attribute will be NULL */
+                    typinfo.children.emplace_back();
+                    continue;
+                }
+
+                auto &child = field.children[found];
+
+                typinfo.children.emplace_back(child.field->type(),
+                                              attr->atttypid);
+                initialize_nested_type(typinfo.children.back(), child,
+                                       NameStr(attr->attname), false);
+                used[found] = true;
+            }
+
+            /*
+             * Read the rest of the fields as well, so that the struct array
+             * keeps the layout of the file schema and field indices remain
+             * valid.
+             */
+            for (size_t j = 0; j < field.children.size(); ++j)
+                if (!used[j])
+                    collect_leaf_columns(field.children[j], this->indices);
+            break;
+        }
+        case arrow::Type::MAP:
+            throw Error("maps nested into lists or structs are not supported "
+                        "(column '%s')", attname);
+        default:
+        {
+            int16   len;
+            bool    byval;
+            char    align;
+
+            PG_TRY();
+            {
+                get_typlenbyvalalign(typinfo.pg.oid, &len, &byval, &align);
+            }
+            PG_CATCH();
+            {
+                error = true;
+            }
+            PG_END_TRY();
+            if (error)
+                throw Error("failed to get type length (column '%s')",
+                            attname);
+
+            typinfo.pg.len = len;
+            typinfo.pg.byval = byval;
+            typinfo.pg.align = align;
+            initialize_cast(typinfo, attname);
+
+            this->indices.push_back(field.column_index);
+        }
+    }
+}
+
+/*
+ * read_nested_type
+ *      Read a value of any type supported as list element or struct field.
+ */
+Datum ParquetReader::read_nested_type(arrow::Array *array,
+                                      const TypeInfo &typinfo, int64_t i)
+{
+    switch (typinfo.arrow.type_id)
+    {
+        case arrow::Type::LIST:
+            return this->nested_list_to_datum((arrow::ListArray *) array, i,
+                                              typinfo);
+        case arrow::Type::STRUCT:
+            return this->struct_to_datum((arrow::StructArray *) array, i,
+                                         typinfo);
+        default:
+            return this->read_primitive_type(array, typinfo, i);
+    }
+}
+
 /*
  * nested_list_to_datum
- *      Returns postgres array build from elements of array. Only one
- *      dimensional arrays are supported.
+ *      Returns postgres array build from elements of array. Lists nested into
+ *      the list become extra dimensions of the array, therefore lists of the
+ *      same level must have the same length.
  */
 Datum ParquetReader::nested_list_to_datum(arrow::ListArray *larray, int pos,
                                            const TypeInfo &typinfo)
@@ -491,21 +838,78 @@ Datum ParquetReader::nested_list_to_datum(arrow::ListArray *larray, int pos,
     ArrayType  *res;
     Datum      *values;
     bool       *nulls = NULL;
-    int         dims[1];
-    int         lbs[1];
+    int         dims[MAXDIM];
+    int         lbs[MAXDIM];
+    int         ndims = 0;
+    int64_t     start = pos,
+                end = pos + 1;
+    arrow::Array   *array = larray;
+    const TypeInfo *elemtypinfo = &typinfo;
     bool        error = false;
 
-    std::shared_ptr<arrow::Array> array =
-        larray->values()->Slice(larray->value_offset(pos),
-                                larray->value_length(pos));
+    /*
+     * Descend through the nested lists narrowing the range of values at each
+     * level down to the elements of the resulting array.
+     */
+    do
+    {
+        auto    list = (arrow::ListArray *) array;
+
+        if (ndims >= MAXDIM)
+            throw Error("number of array dimensions exceeds the maximum "
+                        "allowed (%d)", MAXDIM);
+
+        dims[ndims] = -1;
+        lbs[ndims] = 1;
+        for (int64_t i = start; i < end; ++i)
+        {
+            if (list->IsNull(i))
+                throw Error("NULL nested list cannot be converted into "
+                            "multidimensional array");
+
+            if (dims[ndims] < 0)
+                dims[ndims] = list->value_length(i);
+            else if (dims[ndims] != list->value_length(i))
+                throw Error("nested lists of different length cannot be "
+                            "converted into multidimensional array");
+        }
+        ndims++;
+
+        start = list->value_offset(start);
+        end = list->value_offset(end);
+        array = list->values().get();
+        elemtypinfo = &elemtypinfo->children[0];
+    }
+    while (elemtypinfo->arrow.type_id == arrow::Type::LIST && end > start);
+
+    if (end == start)
+    {
+        PG_TRY();
+        {
+            oldcxt = MemoryContextSwitchTo(allocator->context());
+            res = construct_empty_array(elemtypinfo->pg.oid);
+            MemoryContextSwitchTo(oldcxt);
+        }
+        PG_CATCH();
+        {
+            error = true;
+        }
+        PG_END_TRY();
+        if (error)
+            throw std::runtime_error("failed to constuct an array");
+
+        return PointerGetDatum(res);
+    }
 
-    const TypeInfo &elemtypinfo = typinfo.children[0];
+    std::shared_ptr<arrow::Array> slice = array->Slice(start, end - start);
 
-    values = (Datum *) this->allocator->fast_alloc(sizeof(Datum) * array->length());
+    values = (Datum *) this->allocator->fast_alloc(sizeof(Datum) * slice->length());
 
 #if SIZEOF_DATUM == 8
     /* Fill values and nulls arrays */
-    if (array->null_count() == 0 && typinfo.arrow.type_id == arrow::Type::INT64)
+    if (slice->null_count() == 0 &&
+        elemtypinfo->arrow.type_id == arrow::Type::INT64 &&
+        !elemtypinfo->need_cast)
     {
         /*
          * Ok, there are no nulls, so probably we could just memcpy the
@@ -515,19 +919,19 @@ Datum ParquetReader::nested_list_to_datum(arrow::ListArray *larray, int pos,
          * 8 bytes long, which is true for most contemporary systems but this
          * will not work on some exotic or really old systems.
          */
-        copy_to_c_array<int64_t>((int64_t *) values, array.get(), elemtypinfo.pg.len);
+        copy_to_c_array<int64_t>((int64_t *) values, slice.get(), elemtypinfo->pg.len);
         goto construct_array;
     }
 #endif
-    for (int64_t i = 0; i < array->length(); ++i)
+    for (int64_t i = 0; i < slice->length(); ++i)
     {
-        if (!array->IsNull(i))
-            values[i] = this->read_primitive_type(array.get(), elemtypinfo, i);
+        if (!slice->IsNull(i))
+            values[i] = this->read_nested_type(slice.get(), *elemtypinfo, i);
         else
         {
             if (!nulls)
             {
-                Size size = sizeof(bool) * array->length();
+                Size size = sizeof(bool) * slice->length();
 
                 nulls = (bool *) this->allocator->fast_alloc(size);
                 memset(nulls, 0, size);
@@ -538,18 +942,15 @@ Datum ParquetReader::nested_list_to_datum(arrow::ListArray *larray, int pos,
 
 construct_array:
     /*
-     * Construct one dimensional array. We have to use PG_TRY / PG_CATCH
-     * to prevent any kind leaks of resources allocated by c++ in case of
-     * errors.
+     * Construct the array. We have to use PG_TRY / PG_CATCH to prevent any
+     * kind leaks of resources allocated by c++ in case of errors.
      */
-    dims[0] = array->length();
-    lbs[0] = 1;
     PG_TRY();
     {
         oldcxt = MemoryContextSwitchTo(allocator->context());
-        res = construct_md_array(values, nulls, 1, dims, lbs,
-                                 elemtypinfo.pg.oid, elemtypinfo.pg.len,
-                                 elemtypinfo.pg.byval, elemtypinfo.pg.align);
+        res = construct_md_array(values, nulls, ndims, dims, lbs,
+                                 elemtypinfo->pg.oid, elemtypinfo->pg.len,
+                                 elemtypinfo->pg.byval, elemtypinfo->pg.align);
         MemoryContextSwitchTo(oldcxt);
     }
     PG_CATCH();
@@ -563,6 +964,61 @@ construct_array:
     return PointerGetDatum(res);
 }
 
+/*
+ * struct_to_datum
+ *      Returns composite value built from the fields of struct.
+ */
+Datum ParquetReader::struct_to_datum(arrow::StructArray *sarray, int64_t pos,
+                                     const TypeInfo &typinfo)
+{
+    MemoryContext oldcxt;
+    TupleDesc   tupdesc = typinfo.tupdesc;
+    HeapTuple   tuple;
+    Datum      *values;
+    bool       *nulls;
+    bool        error = false;
+
+    values = (Datum *) this->allocator->fast_alloc(sizeof(Datum) * tupdesc->natts);
+    nulls = (bool *) this->allocator->fast_alloc(sizeof(bool) * tupdesc->natts);
+
+    for (int i = 0; i < tupdesc->natts; ++i)
+    {
+        int     field = typinfo.fields[i];
+
+        values[i] = (Datum) 0;
+        nulls[i] = true;
+
+        if (field < 0)
+            continue;
+
+        /* Child arrays are already adjusted for the struct array offset */
+        arrow::Array *child = sarray->field(field).get();
+
+        if (child->IsNull(pos))
+            continue;
+
+        values[i] = this->read_nested_type(child, typinfo.children[i], pos);
+        nulls[i] = false;
+    }
+
+    PG_TRY();
+    {
+        oldcxt = MemoryContextSwitchTo(allocator->context());
+        tuple = heap_form_tuple(tupdesc, values, nulls);
+        MemoryContextSwitchTo(oldcxt);
+    }
+    PG_CATCH();
+    {
+        error = true;
+    }
+    PG_END_TRY();
+    if (error)
+        throw std::runtime_error("failed to construct a composite value");
+
+    /* Tuple header already carries the composite type id and length */
+    return PointerGetDatum(tuple->t_data);
+}
+
 Datum
 ParquetReader::map_to_datum(arrow::MapArray *maparray, int pos,
                             const TypeInfo &typinfo)
@@ -776,45 +1232,384 @@ void ParquetReader::set_rowgroups_list(const std::vector<int> &rowgroups)
     this->rowgroups = rowgroups;
 }
 
-void ParquetReader::set_options(bool use_threads, bool use_mmap)
+void ParquetReader::set_options(bool use_threads, bool use_mmap, bool pre_buffer)
 {
     this->use_threads = use_threads;
     this->use_mmap = use_mmap;
+    this->pre_buffer = pre_buffer;
 }
 
-void ParquetReader::set_coordinator(ParallelCoordinator *coord)
+void ParquetReader::set_rowgroup_rows_limit(int64_t limit)
 {
-    this->coordinator = coord;
+    this->rowgroup_rows_limit = limit;
 }
 
-class DefaultParquetReader : public ParquetReader
+/*
+ * prefetch
+ *      Issue asynchronous coalesced reads of the projected column chunks of
+ *      the row group `idx` (index in `rowgroups`) so that they are in memory
+ *      by the time we get to read it.
+ *
+ * The file reader only keeps a single pre-buffered range set, so this is
+ * called right after the current row group has been materialized. In
+ * parallel query row groups are distributed dynamically by coordinator and
+ * we don't know which one is going to be the next.
+ */
+void ParquetReader::prefetch(int idx)
 {
-private:
-    struct ChunkInfo
-    {
-        int     chunk;      /* current chunk number */
-        int64   pos;        /* current pos within chunk */
-        int64   len;        /* current chunk length */
+    if (!this->pre_buffer || this->coordinator)
+        return;
+
+    if (idx < 0 || (size_t) idx >= this->rowgroups.size() ||
+        idx == this->prefetched_idx)
+        return;
+
+    std::vector<int> rg{this->rowgroups[idx]};
+    auto file_reader = this->reader->parquet_reader();
+
+    /* Previously buffered data mustn't be released while still being read */
+    if (this->prefetched.is_valid())
+        this->prefetched.Wait();
+
+    file_reader->PreBuffer(rg, this->indices,
+                           arrow::io::default_io_context(),
+                           arrow::io::CacheOptions::Defaults());
+    this->prefetched = file_reader->WhenBuffered(rg, this->indices);
+    this->prefetched_idx = idx;
+    this->notify_armed = false;
+}
 
-        ChunkInfo (int64 len) : chunk(0), pos(0), len(len) {}
-    };
+/*
+ * prefetch_ready
+ *      Check whether row group `idx` can be read without waiting for I/O.
+ *      Starts pre-buffering it if not done yet.
+ */
+bool ParquetReader::prefetch_ready(int idx)
+{
+    if (!this->pre_buffer || this->coordinator)
+        return true;
 
-    /* Current row group */
-    std::shared_ptr<arrow::Table>   table;
+    if (idx < 0 || (size_t) idx >= this->rowgroups.size())
+        return true;
 
-    /*
-     * Plain pointers to inner the structures of row group. It's needed to
-     * prevent excessive shared_ptr management.
-     */
-    std::vector<arrow::Array *>     chunks;
+    this->prefetch(idx);
 
-    int             row_group;          /* current row group index */
-    uint32_t        row;                /* current row within row group */
-    uint32_t        num_rows;           /* total rows in row group */
-    std::vector<ChunkInfo> chunk_info;  /* current chunk and position per-column */
+    return this->prefetched.is_finished();
+}
 
-public:
-    /* 
+/*
+ * wait_event_fd
+ *      Return file descriptor which becomes readable when pre-buffering
+ *      started by the last prefetch() completes.
+ */
+int ParquetReader::wait_event_fd()
+{
+    if (!this->notify_pipe)
+    {
+        auto    notify = std::make_shared<NotifyPipe>();
+
+        /* Let fd.c know about the descriptors so that it keeps within limits */
+        if (!AcquireExternalFD())
+            throw Error("could not create pipe: too many open files");
+        if (!AcquireExternalFD())
+        {
+            ReleaseExternalFD();
+            throw Error("could not create pipe: too many open files");
+        }
+
+        if (pipe(notify->fd) != 0)
+        {
+            char    errbuf[PG_STRERROR_R_BUFLEN];
+
+            strerror_r(errno, errbuf, sizeof(errbuf));
+            ReleaseExternalFD();
+            ReleaseExternalFD();
+            throw Error("could not create pipe: %s", errbuf);
+        }
+
+        for (int fd : notify->fd)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        this->notify_pipe = notify;
+    }
+
+    if (!this->notify_armed && this->prefetched.is_valid())
+    {
+        std::shared_ptr<NotifyPipe> notify = this->notify_pipe;
+
+        /*
+         * Runs in Arrow's I/O thread; must not touch anything but the pipe,
+         * which it keeps open until it's done with it.
+         */
+        this->prefetched.AddCallback([notify](const arrow::Status &) {
+            char    c = 0;
+
+            if (write(notify->fd[1], &c, 1) < 0)
+            {
+                /* pipe is full so reader is going to be woken up anyway */
+            }
+        });
+        this->notify_armed = true;
+    }
+
+    return this->notify_pipe->fd[0];
+}
+
+/*
+ * clear_wait_event
+ *      Drain the notification pipe.
+ */
+void ParquetReader::clear_wait_event()
+{
+    char    buf[64];
+
+    if (!this->notify_pipe)
+        return;
+
+    while (read(this->notify_pipe->fd[0], buf, sizeof(buf)) > 0)
+        ;
+}
+
+void ParquetReader::set_coordinator(ParallelCoordinator *coord)
+{
+    this->coordinator = coord;
+}
+
+/*
+ * lookup_cmp_func
+ *      Find btree comparison function for two types. Unlike find_cmp_func()
+ *      returns false if types don't belong to the same operator family.
+ */
+static bool
+lookup_cmp_func(FmgrInfo *finfo, Oid type1, Oid type2)
+{
+    TypeCacheEntry *tce_1, *tce_2;
+    Oid             cmp_proc_oid;
+
+    tce_1 = lookup_type_cache(type1, TYPECACHE_BTREE_OPFAMILY);
+    tce_2 = lookup_type_cache(type2, TYPECACHE_BTREE_OPFAMILY);
+
+    if (!OidIsValid(tce_1->btree_opf) || tce_1->btree_opf != tce_2->btree_opf)
+        return false;
+
+    cmp_proc_oid = get_opfamily_proc(tce_1->btree_opf,
+                                     tce_1->btree_opintype,
+                                     tce_2->btree_opintype,
+                                     BTORDER_PROC);
+    if (!OidIsValid(cmp_proc_oid))
+        return false;
+
+    fmgr_info(cmp_proc_oid, finfo);
+    return true;
+}
+
+/*
+ * set_runtime_filters
+ *      Bind runtime filters to the columns of the file. Must be called after
+ *      create_column_mapping(). Filters are referenced, not copied, so that
+ *      their new values are picked up after rescan.
+ */
+void ParquetReader::set_runtime_filters(std::vector<RuntimeFilter> *filters)
+{
+    auto           &manifest = this->reader->manifest();
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    char            errstr[ERROR_STR_LEN];
+
+    this->runtime_filters = filters;
+    this->filter_columns.clear();
+
+    for (auto &filter : *filters)
+    {
+        RuntimeFilterColumn fc;
+        int     col = this->map[filter.attnum];
+
+        fc.col = -1;
+        fc.cmpfunc.fn_oid = InvalidOid;
+
+        /* Only scalar columns can be checked */
+        if (col >= 0 && this->types[col].index >= 0)
+        {
+            TypeInfo   &typinfo = this->types[col];
+            Oid         stats_type = to_postgres_type(typinfo.arrow.type_id);
+
+            fc.col = col;
+            for (auto &schema_field : manifest.schema_fields)
+            {
+                if (schema_field.column_index == typinfo.index)
+                {
+                    fc.arrow_type = schema_field.field->type();
+                    break;
+                }
+            }
+
+            PG_TRY();
+            {
+                /*
+                 * Min/max statistics of strings are collected using bytewise
+                 * comparison which only matches "C" collation.
+                 */
+                if (fc.arrow_type && has_typed_stats(fc.arrow_type.get()) &&
+                    (stats_type != TEXTOID || lc_collate_is_c(filter.collid)))
+                {
+                    if (!lookup_cmp_func(&fc.cmpfunc, filter.valtype, stats_type))
+                        fc.cmpfunc.fn_oid = InvalidOid;
+                }
+            }
+            PG_CATCH();
+            {
+                ErrorData *errdata;
+
+                MemoryContextSwitchTo(ccxt);
+                error = true;
+                errdata = CopyErrorData();
+                FlushErrorState();
+
+                strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+                FreeErrorData(errdata);
+            }
+            PG_END_TRY();
+            if (error)
+                throw Error("failed to initialize runtime filter: %s", errstr);
+        }
+        this->filter_columns.push_back(fc);
+    }
+}
+
+/*
+ * rowgroup_matches_runtime_filters
+ *      Check min/max statistics of the row group against current values of
+ *      runtime filters.
+ */
+bool ParquetReader::rowgroup_matches_runtime_filters(int rowgroup)
+{
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    char            errstr[ERROR_STR_LEN];
+    bool            match = true;
+
+    if (!this->runtime_filters)
+        return true;
+
+    auto meta = this->reader->parquet_reader()->metadata()->RowGroup(rowgroup);
+
+    for (size_t i = 0; i < this->filter_columns.size() && match; ++i)
+    {
+        RuntimeFilter  &filter = (*this->runtime_filters)[i];
+        RuntimeFilterColumn &fc = this->filter_columns[i];
+
+        /* Btree operators are strict, nothing matches NULL */
+        if (filter.isnull)
+            return false;
+
+        if (!OidIsValid(fc.cmpfunc.fn_oid))
+            continue;
+
+        auto stats = meta->ColumnChunk(this->types[fc.col].index)->statistics();
+        if (!stats)
+            continue;
+
+        /* Column chunk only contains NULLs */
+        if (stats->HasNullCount() && stats->null_count() == meta->num_rows())
+            return false;
+
+        if (!stats->HasMinMax())
+            continue;
+
+        std::string min = stats->EncodeMin();
+        std::string max = stats->EncodeMax();
+
+        PG_TRY();
+        {
+            Datum   lower = bytes_to_postgres_type(min.c_str(), min.length(),
+                                                   fc.arrow_type.get());
+            Datum   upper = bytes_to_postgres_type(max.c_str(), max.length(),
+                                                   fc.arrow_type.get());
+            int     l = DatumGetInt32(FunctionCall2Coll(&fc.cmpfunc, filter.collid,
+                                                        filter.value, lower));
+            int     u = DatumGetInt32(FunctionCall2Coll(&fc.cmpfunc, filter.collid,
+                                                        filter.value, upper));
+
+            switch (filter.strategy)
+            {
+                case BTLessStrategyNumber:
+                    match = l > 0;
+                    break;
+                case BTLessEqualStrategyNumber:
+                    match = l >= 0;
+                    break;
+                case BTEqualStrategyNumber:
+                    match = l >= 0 && u <= 0;
+                    break;
+                case BTGreaterEqualStrategyNumber:
+                    match = u <= 0;
+                    break;
+                case BTGreaterStrategyNumber:
+                    match = u < 0;
+                    break;
+            }
+        }
+        PG_CATCH();
+        {
+            ErrorData *errdata;
+
+            MemoryContextSwitchTo(ccxt);
+            error = true;
+            errdata = CopyErrorData();
+            FlushErrorState();
+
+            strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+            FreeErrorData(errdata);
+        }
+        PG_END_TRY();
+        if (error)
+            throw Error("runtime filter match failed: %s", errstr);
+    }
+
+    if (!match)
+        elog(DEBUG1, "parquet_fdw: runtime filter skips rowgroup %d", rowgroup + 1);
+
+    return match;
+}
+
+class DefaultParquetReader : public ParquetReader
+{
+private:
+    struct ChunkInfo
+    {
+        int     chunk;      /* current chunk number */
+        int64   pos;        /* current pos within chunk */
+        int64   len;        /* current chunk length */
+
+        /* For dictionary-encoded chunks */
+        Datum          *dict;       /* converted dictionary values */
+        const int32_t  *dict_idx;   /* dictionary indices */
+        arrow::Array   *dict_src;   /* dictionary 'dict' was built from */
+
+        /* Timestamp and date chunks converted as a whole */
+        std::vector<Timestamp>  timestamps;
+        std::vector<DateADT>    dates;
+
+        ChunkInfo () : chunk(0), pos(0), len(0), dict(nullptr),
+                       dict_idx(nullptr), dict_src(nullptr) {}
+    };
+
+    /* Current row group */
+    std::shared_ptr<arrow::Table>   table;
+
+    /*
+     * Plain pointers to inner the structures of row group. It's needed to
+     * prevent excessive shared_ptr management.
+     */
+    std::vector<arrow::Array *>     chunks;
+
+    int             row_group;          /* current row group index */
+    uint32_t        row;                /* current row within row group */
+    uint32_t        num_rows;           /* total rows in row group */
+    std::vector<ChunkInfo> chunk_info;  /* current chunk and position per-column */
+
+public:
+    /* 
      * Constructor.
      * The reader_id parameter is only used for parallel execution of
      * MultifileExecutionState.
@@ -833,20 +1628,7 @@ public:
 
     void open()
     {
-        arrow::Status   status;
-        std::unique_ptr<parquet::arrow::FileReader> reader;
-
-        status = parquet::arrow::FileReader::Make(
-                        arrow::default_memory_pool(),
-                        parquet::ParquetFileReader::OpenFile(filename, use_mmap),
-                        &reader);
-        if (!status.ok())
-            throw Error("failed to open Parquet file %s ('%s')",
-                        status.message().c_str(), filename.c_str());
-        this->reader = std::move(reader);
-
-        /* Enable parallel columns decoding/decompression if needed */
-        this->reader->set_use_threads(this->use_threads && parquet_fdw_use_threads);
+        open_file();
     }
 
     void close()
@@ -854,43 +1636,172 @@ public:
         throw std::runtime_error("DefaultParquetReader::close() not implemented");
     }
 
+    /*
+     * set_chunk
+     *      Make `array` the current chunk of the column. For
+     *      dictionary-encoded chunks convert the dictionary into Datums unless
+     *      it was already done for the previous chunk. Timestamps and dates
+     *      are converted into postgres representation for the entire chunk at
+     *      once.
+     */
+    void set_chunk(int col, arrow::Array *array)
+    {
+        ChunkInfo  &chunkInfo = this->chunk_info[col];
+
+        this->chunks[col] = array;
+        chunkInfo.pos = 0;
+        chunkInfo.len = array->length();
+
+        if (array->type_id() == arrow::Type::DICTIONARY)
+        {
+            auto dictarray = (arrow::DictionaryArray *) array;
+            auto indices = (arrow::Int32Array *) dictarray->indices().get();
+
+            if (dictarray->dictionary().get() != chunkInfo.dict_src)
+            {
+                chunkInfo.dict = this->read_dictionary(dictarray, this->types[col]);
+                chunkInfo.dict_src = dictarray->dictionary().get();
+            }
+            chunkInfo.dict_idx = indices->raw_values();
+        }
+        else
+        {
+            chunkInfo.dict = nullptr;
+            chunkInfo.dict_idx = nullptr;
+            chunkInfo.dict_src = nullptr;
+        }
+
+        switch (array->type_id())
+        {
+            case arrow::Type::TIMESTAMP:
+            {
+                auto tsarray = (arrow::TimestampArray *) array;
+                auto tstype = (arrow::TimestampType *) array->type().get();
+
+                chunkInfo.timestamps.resize(chunkInfo.len);
+                convert_timestamps(tstype->unit(), tsarray->raw_values(),
+                                   chunkInfo.timestamps.data(), chunkInfo.len);
+                break;
+            }
+            case arrow::Type::DATE32:
+            {
+                auto datearray = (arrow::Date32Array *) array;
+
+                chunkInfo.dates.resize(chunkInfo.len);
+                convert_dates(datearray->raw_values(), chunkInfo.dates.data(),
+                              chunkInfo.len);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    /*
+     * chunk_value
+     *      Return the value of the column at the current position within its
+     *      chunk. The value must not be NULL.
+     */
+    Datum chunk_value(int col)
+    {
+        ChunkInfo  &chunkInfo = this->chunk_info[col];
+        TypeInfo   &typinfo = this->types[col];
+        Datum       res;
+
+        /* Dictionary values are already converted and casted */
+        if (chunkInfo.dict)
+            return chunkInfo.dict[chunkInfo.dict_idx[chunkInfo.pos]];
+
+        switch (typinfo.arrow.type_id)
+        {
+            case arrow::Type::TIMESTAMP:
+                res = TimestampGetDatum(chunkInfo.timestamps[chunkInfo.pos]);
+                break;
+            case arrow::Type::DATE32:
+                res = DateADTGetDatum(chunkInfo.dates[chunkInfo.pos]);
+                break;
+            default:
+                return this->read_primitive_type(this->chunks[col], typinfo,
+                                                 chunkInfo.pos);
+        }
+
+        if (typinfo.need_cast)
+            res = do_cast(res, typinfo);
+
+        return res;
+    }
+
+    /*
+     * read_rowgroup_head
+     *      Read only the first `rowgroup_rows_limit` rows of the row group.
+     *      Record batch reader decodes pages lazily, so the pages past the
+     *      first batch are never touched.
+     */
+    arrow::Status read_rowgroup_head(int rowgroup)
+    {
+        std::unique_ptr<arrow::RecordBatchReader>   batch_reader;
+        std::shared_ptr<arrow::RecordBatch>         batch;
+        arrow::Status   status;
+
+        this->reader->set_batch_size(this->rowgroup_rows_limit);
+        status = this->reader->GetRecordBatchReader({rowgroup}, this->indices,
+                                                    &batch_reader);
+        if (!status.ok())
+            return status;
+
+        status = batch_reader->ReadNext(&batch);
+        if (!status.ok())
+            return status;
+
+        if (!batch)
+            return arrow::Table::MakeEmpty(batch_reader->schema()).Value(&this->table);
+
+        return arrow::Table::FromRecordBatches({batch}).Value(&this->table);
+    }
+
     bool read_next_rowgroup()
     {
         arrow::Status               status;
 
-        /*
-         * In case of parallel query get the row group index from the
-         * coordinator. Otherwise just increment it.
-         */
-        if (coordinator)
+        int                         rowgroup;
+
+        /* Skip row groups that can't contain rows passing runtime filters */
+        do
         {
-            coordinator->lock();
-            if ((this->row_group = coordinator->next_rowgroup(reader_id)) == -1)
+            /*
+             * In case of parallel query get the row group index from the
+             * coordinator. Otherwise just increment it.
+             */
+            if (coordinator)
             {
+                coordinator->lock();
+                if ((this->row_group = coordinator->next_rowgroup(reader_id)) == -1)
+                {
+                    coordinator->unlock();
+                    return false;
+                }
                 coordinator->unlock();
-                return false;
             }
-            coordinator->unlock();
-        }
-        else
-            this->row_group++;
+            else
+                this->row_group++;
 
-        /*
-         * row_group cannot be less than zero at this point so it is safe to cast
-         * it to unsigned int
-         */
-        if ((uint) this->row_group >= this->rowgroups.size())
-            return false;
+            /*
+             * row_group cannot be less than zero at this point so it is safe
+             * to cast it to unsigned int
+             */
+            if ((uint) this->row_group >= this->rowgroups.size())
+                return false;
 
-        int  rowgroup = this->rowgroups[this->row_group];
-        auto rowgroup_meta = this->reader
-                                ->parquet_reader()
-                                ->metadata()
-                                ->RowGroup(rowgroup);
+            rowgroup = this->rowgroups[this->row_group];
+        }
+        while (!this->rowgroup_matches_runtime_filters(rowgroup));
 
-        status = this->reader
-            ->RowGroup(rowgroup)
-            ->ReadTable(this->indices, &this->table);
+        if (this->rowgroup_rows_limit > 0)
+            status = this->read_rowgroup_head(rowgroup);
+        else
+            status = this->reader
+                ->RowGroup(rowgroup)
+                ->ReadTable(this->indices, &this->table);
 
         if (!status.ok())
             throw Error("failed to read rowgroup #%i: %s ('%s')",
@@ -899,41 +1810,151 @@ public:
         if (!this->table)
             throw std::runtime_error("got empty table");
 
-        /* TODO: don't clear each time */
-        this->chunk_info.clear();
-        this->chunks.clear();
+        /* Dictionaries of the previous row group aren't needed anymore */
+        this->reset_dictionaries();
 
-        for (uint64_t i = 0; i < types.size(); ++i)
-        {
-            const auto &column = this->table->column(i);
+        this->chunk_info.assign(types.size(), ChunkInfo());
+        this->chunks.assign(types.size(), nullptr);
 
-            int64 len = column->chunk(0)->length();
-            this->chunk_info.emplace_back(len);
-            this->chunks.push_back(column->chunk(0).get());
-        }
+        for (uint64_t i = 0; i < types.size(); ++i)
+            this->set_chunk(i, this->table->column(i)->chunk(0).get());
 
         this->row = 0;
         this->num_rows = this->table->num_rows();
 
+        /* Overlap reading of the next row group with processing this one */
+        this->prefetch(this->row_group + 1);
+
         return true;
     }
 
-    ReadStatus next(TupleTableSlot *slot, bool fake=false)
+    /*
+     * ready
+     *      Whether the next row can be returned without waiting for I/O.
+     */
+    bool ready()
     {
-        allocator->recycle();
+        if (this->row < this->num_rows)
+            return true;
 
-        if (this->row >= this->num_rows)
+        return this->prefetch_ready(this->row_group + 1);
+    }
+
+    /*
+     * current_chunk
+     *      Return the chunk of the column containing the current row.
+     */
+    arrow::Array *current_chunk(int col)
+    {
+        ChunkInfo  &chunkInfo = this->chunk_info[col];
+
+        if (chunkInfo.pos >= chunkInfo.len)
         {
-            /*
-             * Read next row group. We do it in a loop to skip possibly empty
-             * row groups.
-             */
-            do
+            const auto &column = this->table->column(col);
+
+            if (chunkInfo.chunk + 1 < column->num_chunks())
+                this->set_chunk(col, column->chunk(++chunkInfo.chunk).get());
+        }
+        return this->chunks[col];
+    }
+
+    /*
+     * row_matches_runtime_filters
+     *      Check the current row against runtime filters reading only the
+     *      filtered columns.
+     */
+    bool row_matches_runtime_filters()
+    {
+        MemoryContext   ccxt = CurrentMemoryContext;
+        bool            error = false;
+        char            errstr[ERROR_STR_LEN];
+        bool            match = true;
+
+        if (!this->runtime_filters)
+            return true;
+
+        for (size_t i = 0; i < this->filter_columns.size() && match; ++i)
+        {
+            RuntimeFilter  &filter = (*this->runtime_filters)[i];
+            int             col = this->filter_columns[i].col;
+            arrow::Array   *array;
+            Datum           value;
+
+            if (col < 0)
+                continue;
+
+            array = this->current_chunk(col);
+            ChunkInfo  &chunkInfo = this->chunk_info[col];
+
+            if (filter.isnull || array->IsNull(chunkInfo.pos))
+                return false;
+
+            value = this->chunk_value(col);
+
+            PG_TRY();
             {
-                if (!this->read_next_rowgroup())
-                    return RS_EOF;
+                match = DatumGetBool(FunctionCall2Coll(&filter.opfunc,
+                                                       filter.collid,
+                                                       value, filter.value));
             }
-            while (!this->num_rows);
+            PG_CATCH();
+            {
+                ErrorData *errdata;
+
+                MemoryContextSwitchTo(ccxt);
+                error = true;
+                errdata = CopyErrorData();
+                FlushErrorState();
+
+                strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+                FreeErrorData(errdata);
+            }
+            PG_END_TRY();
+            if (error)
+                throw Error("runtime filter check failed: %s", errstr);
+        }
+
+        return match;
+    }
+
+    /*
+     * skip_row
+     *      Move to the next row without reading it.
+     */
+    void skip_row()
+    {
+        for (size_t col = 0; col < this->chunk_info.size(); ++col)
+        {
+            this->current_chunk(col);
+            this->chunk_info[col].pos++;
+        }
+        this->row++;
+    }
+
+    ReadStatus next(TupleTableSlot *slot, bool fake=false)
+    {
+        while (true)
+        {
+            allocator->recycle();
+
+            if (this->row >= this->num_rows)
+            {
+                /*
+                 * Read next row group. We do it in a loop to skip possibly
+                 * empty row groups.
+                 */
+                do
+                {
+                    if (!this->read_next_rowgroup())
+                        return RS_EOF;
+                }
+                while (!this->num_rows);
+            }
+
+            /* Drop rows not passing runtime filters before filling the slot */
+            if (fake || this->row_matches_runtime_filters())
+                break;
+            this->skip_row();
         }
 
         this->populate_slot(slot, fake);
@@ -975,9 +1996,7 @@ public:
                         break;
 
                     array = column->chunk(chunkInfo.chunk).get();
-                    this->chunks[arrow_col] = array;
-                    chunkInfo.pos = 0;
-                    chunkInfo.len = array->length();
+                    this->set_chunk(arrow_col, array);
                 }
 
                 /* Don't do actual reading data into slot in fake mode */
@@ -1012,9 +2031,16 @@ public:
                             this->map_to_datum(maparray, chunkInfo.pos, typinfo);
                         break;
                     }
+                    case arrow::Type::STRUCT:
+                    {
+                        auto sarray = (arrow::StructArray *) array;
+
+                        slot->tts_values[attr] =
+                            this->struct_to_datum(sarray, chunkInfo.pos, typinfo);
+                        break;
+                    }
                     default:
-                        slot->tts_values[attr] = 
-                            this->read_primitive_type(array, typinfo, chunkInfo.pos);
+                        slot->tts_values[attr] = this->chunk_value(arrow_col);
                 }
 
                 chunkInfo.pos++;
@@ -1028,12 +2054,20 @@ public:
 
     void rescan(void)
     {
-        this->row_group = 0;
+        this->row_group = -1;
         this->row = 0;
         this->num_rows = 0;
     }
 };
 
+/*
+ * CachingParquetReader
+ *      Reader which materializes rows into its own buffers so that they stay
+ *      available after the file is closed (see
+ *      CachingMultifileMergeExecutionState). Rows are read in batches of at
+ *      most `batch_rows` rows. With memory budget set the batch size is chosen
+ *      so that materialized rows of a batch fit into it.
+ */
 class CachingParquetReader : public ParquetReader
 {
 private:
@@ -1043,12 +2077,25 @@ private:
     bool            is_active;          /* weather reader is active */
 
     int             row_group;          /* current row group index */
-    uint32_t        row;                /* current row within row group */
-    uint32_t        num_rows;           /* total rows in row group */
+    uint32_t        row;                /* current row within batch */
+    uint32_t        num_rows;           /* total rows in batch */
+
+    /*
+     * Current row group is read in batches by 'batch_reader'. If the file
+     * gets closed in the middle of the row group, the batch reader is
+     * recreated after reopening and 'rowgroup_pos' rows are skipped.
+     */
+    std::unique_ptr<arrow::RecordBatchReader> batch_reader;
+    int64_t         rowgroup_pos;       /* rows of row group already read */
+    int64_t         batch_rows;         /* batch size for current row group */
+
+    size_t          memory_budget;      /* 0 means read entire row groups */
+    double          row_width;          /* measured bytes per row, 0 if unknown */
 
 public:
     CachingParquetReader(const char* filename, MemoryContext cxt, int reader_id = -1)
-        : ParquetReader(cxt), is_active(false), row_group(-1), row(0), num_rows(0)
+        : ParquetReader(cxt), is_active(false), row_group(-1), row(0), num_rows(0),
+          rowgroup_pos(0), batch_rows(0), memory_budget(0), row_width(0)
     {
         this->filename = filename;
         this->reader_id = reader_id;
@@ -1061,39 +2108,92 @@ public:
 
     void open()
     {
-        arrow::Status   status;
-        std::unique_ptr<parquet::arrow::FileReader> reader;
-
-        status = parquet::arrow::FileReader::Make(
-                        arrow::default_memory_pool(),
-                        parquet::ParquetFileReader::OpenFile(filename, use_mmap),
-                        &reader);
-        if (!status.ok())
-            throw Error("failed to open Parquet file %s ('%s')",
-                        status.message().c_str(), filename.c_str());
-        this->reader = std::move(reader);
-
-        /* Enable parallel columns decoding/decompression if needed */
-        this->reader->set_use_threads(this->use_threads && parquet_fdw_use_threads);
-
+        open_file();
         is_active = true;
     }
 
     void close()
     {
+        if (this->prefetched.is_valid())
+            this->prefetched.Wait();
+        this->prefetched = arrow::Future<>();
+        this->prefetched_idx = -1;
+
+        this->batch_reader = nullptr;
         this->reader = nullptr;  /* destroy the reader */
         is_active = false;
     }
 
-    bool read_next_rowgroup()
+    bool ready()
     {
-        arrow::Status                   status;
-        std::shared_ptr<arrow::Table>   table;
+        if (this->row < this->num_rows || !is_active || this->batch_reader)
+            return true;
 
-        /* TODO: release previously stored data */
-        this->column_data.resize(this->types.size(), nullptr);
-        this->column_nulls.resize(this->types.size());
+        return this->prefetch_ready(this->row_group + 1);
+    }
+
+    void set_memory_budget(size_t budget)
+    {
+        this->memory_budget = budget;
+    }
+
+    /*
+     * choose_batch_rows
+     *      Pick the number of rows to read at once so that they fit into
+     *      memory budget. Until we have measured actual memory consumption
+     *      per row, estimate it by uncompressed size of column chunks.
+     */
+    int64_t choose_batch_rows(parquet::RowGroupMetaData *meta)
+    {
+        int64_t     rows = meta->num_rows();
+        double      width = this->row_width;
+
+        if (this->memory_budget == 0 || rows <= MIN_BATCH_ROWS)
+            return Max(rows, 1);
+
+        if (width <= 0)
+        {
+            for (int idx : this->indices)
+                width += (double) meta->ColumnChunk(idx)->total_uncompressed_size() / rows;
+            width += this->types.size() * (sizeof(Datum) + sizeof(bool));
+        }
+
+        return Min(rows, Max((int64_t) (this->memory_budget / width),
+                             (int64_t) MIN_BATCH_ROWS));
+    }
+
+    /*
+     * open_batch_reader
+     *      Start reading the current row group skipping rows that have
+     *      already been returned.
+     */
+    void open_batch_reader()
+    {
+        arrow::Status   status;
+        int             rowgroup = this->rowgroups[this->row_group];
+        int64_t         skipped = 0;
+
+        this->reader->set_batch_size(this->batch_rows);
+        status = this->reader->GetRecordBatchReader({rowgroup}, this->indices,
+                                                    &this->batch_reader);
+        if (!status.ok())
+            throw Error("failed to read rowgroup #%i: %s ('%s')",
+                        rowgroup, status.message().c_str(), this->filename.c_str());
+
+        while (skipped < this->rowgroup_pos)
+        {
+            std::shared_ptr<arrow::RecordBatch> batch;
+
+            status = this->batch_reader->ReadNext(&batch);
+            if (!status.ok() || !batch)
+                throw Error("failed to skip rows of rowgroup #%i ('%s')",
+                            rowgroup, this->filename.c_str());
+            skipped += batch->num_rows();
+        }
+    }
 
+    bool read_next_rowgroup()
+    {
         /*
          * In case of parallel query get the row group index from the
          * coordinator. Otherwise just increment it.
@@ -1118,21 +2218,67 @@ public:
         if ((uint) this->row_group >= this->rowgroups.size())
             return false;
 
-        int  rowgroup = this->rowgroups[this->row_group];
         auto rowgroup_meta = this->reader
                                 ->parquet_reader()
                                 ->metadata()
-                                ->RowGroup(rowgroup);
+                                ->RowGroup(this->rowgroups[this->row_group]);
+
+        this->rowgroup_pos = 0;
+        this->batch_rows = this->choose_batch_rows(rowgroup_meta.get());
+        this->open_batch_reader();
+
+        return true;
+    }
+
+    /*
+     * read_next_batch
+     *      Materialize the next batch of the current row group. Returns false
+     *      if the row group is exhausted.
+     */
+    bool read_next_batch()
+    {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        arrow::Status   status;
+        int             rowgroup;
+
+        if (this->row_group < 0 || (uint) this->row_group >= this->rowgroups.size())
+            return false;
+        rowgroup = this->rowgroups[this->row_group];
 
-        status = this->reader
-            ->RowGroup(rowgroup)
-            ->ReadTable(this->indices, &table);
+        /* The file was closed in the middle of the row group */
+        if (!this->batch_reader)
+            this->open_batch_reader();
+
+        status = this->batch_reader->ReadNext(&batch);
         if (!status.ok())
             throw Error("failed to read rowgroup #%i: %s ('%s')",
                         rowgroup, status.message().c_str(), this->filename.c_str());
 
+        if (!batch)
+        {
+            this->batch_reader = nullptr;
+            return false;
+        }
+
+        /*
+         * Page readers of the row group have got their data by now, overlap
+         * reading of the next row group with processing this one.
+         */
+        if (this->rowgroup_pos == 0)
+            this->prefetch(this->row_group + 1);
+
         /* Release resources acquired in the previous iteration */
         allocator->recycle();
+        this->reset_dictionaries();
+
+        auto rowgroup_meta = this->reader
+                                ->parquet_reader()
+                                ->metadata()
+                                ->RowGroup(rowgroup);
+
+        this->num_rows = batch->num_rows();
+        this->column_data.resize(this->types.size(), nullptr);
+        this->column_nulls.resize(this->types.size());
 
         /* Read columns data and store it into column_data vector */
         for (std::vector<TypeInfo>::size_type col = 0; col < types.size(); ++col)
@@ -1142,27 +2288,45 @@ public:
 
             if (types[col].index >= 0)
                 stats = rowgroup_meta->ColumnChunk(types[col].index)->statistics();
-            has_nulls = stats ? stats->null_count() > 0 : true;
+            has_nulls = stats && stats->HasNullCount() ?
+                stats->null_count() > 0 : true;
 
-            this->num_rows = table->num_rows();
             this->column_nulls[col].resize(this->num_rows);
 
-            this->read_column(table, col, has_nulls);
+            this->read_column(batch->column(col).get(), col, has_nulls);
         }
 
+        /* Account for the memory actually taken by the batch */
+        if (this->num_rows > 0)
+            this->row_width = (double) allocator->allocated_bytes() / this->num_rows;
+
+        this->rowgroup_pos += this->num_rows;
         this->row = 0;
+
         return true;
     }
 
-    void read_column(std::shared_ptr<arrow::Table> table,
+    void read_nulls(arrow::Array *array, int col, bool has_nulls)
+    {
+        std::vector<bool> &nulls = this->column_nulls[col];
+
+        if (!has_nulls)
+        {
+            std::fill(nulls.begin(), nulls.begin() + array->length(), false);
+            return;
+        }
+
+        for (int64_t j = 0; j < array->length(); ++j)
+            nulls[j] = array->IsNull(j);
+    }
+
+    void read_column(arrow::Array *array,
                      int col,
                      bool has_nulls)
     {
-        std::shared_ptr<arrow::ChunkedArray> column = table->column(col);
         TypeInfo &typinfo = this->types[col];
         void   *data;
         size_t  sz;
-        int     row = 0;
 
         switch(typinfo.arrow.type_id) {
             case arrow::Type::BOOL:
@@ -1181,7 +2345,10 @@ public:
                 sz = sizeof(float);
                 break;
             case arrow::Type::DATE32:
-                sz = sizeof(int);
+                sz = sizeof(DateADT);
+                break;
+            case arrow::Type::TIMESTAMP:
+                sz = sizeof(Timestamp);
                 break;
             default:
                 sz = sizeof(Datum);
@@ -1189,102 +2356,143 @@ public:
 
         data = allocator->fast_alloc(sz * num_rows);
 
-        for (int i = 0; i < column->num_chunks(); ++i) {
-            arrow::Array *array = column->chunk(i).get();
-
-            /*
-             * XXX We could probably optimize here by copying the entire array
-             * by using copy_to_c_array when has_nulls = false.
-             */
-
-            for (int j = 0; j < array->length(); ++j) {
-                if (has_nulls && array->IsNull(j)) {
-                    this->column_nulls[col][row++] = true;
-                    continue;
+        /*
+         * Timestamps and dates are converted into postgres representation for
+         * the whole array at once.
+         */
+        switch (typinfo.arrow.type_id)
+        {
+            case arrow::Type::TIMESTAMP:
+                {
+                    auto tsarray = (arrow::TimestampArray *) array;
+                    auto tstype = (arrow::TimestampType *) array->type().get();
+
+                    convert_timestamps(tstype->unit(), tsarray->raw_values(),
+                                       (Timestamp *) data, array->length());
+                    this->read_nulls(array, col, has_nulls);
+                    this->column_data[col] = data;
+                    return;
                 }
-                switch (typinfo.arrow.type_id)
+            case arrow::Type::DATE32:
                 {
-                    /*
-                     * For types smaller than Datum (assuming 8 bytes) we
-                     * copy raw values to save memory and only convert them
-                     * into Datum on the slot population stage.
-                     */
-                    case arrow::Type::BOOL:
-                        {
-                            arrow::BooleanArray *boolarray = (arrow::BooleanArray *) array;
-                            ((bool *) data)[row] = boolarray->Value(row);
-                            break;
-                        }
-                    case arrow::Type::INT8:
-                        {
-                            arrow::Int8Array *intarray = (arrow::Int8Array *) array;
-                            ((int8 *) data)[row] = intarray->Value(row);
-                            break;
-                        }
-                    case arrow::Type::INT16:
-                        {
-                            arrow::Int16Array *intarray = (arrow::Int16Array *) array;
-                            ((int16 *) data)[row] = intarray->Value(row);
-                            break;
-                        }
-                    case arrow::Type::INT32:
-                        {
-                            arrow::Int32Array *intarray = (arrow::Int32Array *) array;
-                            ((int32 *) data)[row] = intarray->Value(row);
-                            break;
-                        }
-                    case arrow::Type::FLOAT:
-                        {
-                            arrow::FloatArray *farray = (arrow::FloatArray *) array;
-                            ((float *) data)[row] = farray->Value(row);
-                            break;
-                        }
-                    case arrow::Type::DATE32:
-                        {
-                            arrow::Date32Array *tsarray = (arrow::Date32Array *) array;
-                            ((int *) data)[row] = tsarray->Value(row);
-                            break;
-                        }
+                    auto datearray = (arrow::Date32Array *) array;
 
-                    case arrow::Type::LIST:
-                        {
-                            auto larray = (arrow::ListArray *) array;
+                    convert_dates(datearray->raw_values(), (DateADT *) data,
+                                  array->length());
+                    this->read_nulls(array, col, has_nulls);
+                    this->column_data[col] = data;
+                    return;
+                }
+            default:
+                break;
+        }
+
+        Datum          *dict = nullptr;
+        const int32_t  *dict_idx = nullptr;
+
+        /* Convert dictionary values into Datums only once */
+        if (array->type_id() == arrow::Type::DICTIONARY)
+        {
+            auto dictarray = (arrow::DictionaryArray *) array;
+
+            dict = this->read_dictionary(dictarray, typinfo);
+            dict_idx = ((arrow::Int32Array *) dictarray->indices().get())->raw_values();
+        }
+
+        /*
+         * XXX We could probably optimize here by copying the entire array
+         * by using copy_to_c_array when has_nulls = false.
+         */
+
+        for (int64_t j = 0; j < array->length(); ++j) {
+            if (has_nulls && array->IsNull(j)) {
+                this->column_nulls[col][j] = true;
+                continue;
+            }
+            switch (typinfo.arrow.type_id)
+            {
+                /*
+                 * For types smaller than Datum (assuming 8 bytes) we
+                 * copy raw values to save memory and only convert them
+                 * into Datum on the slot population stage.
+                 */
+                case arrow::Type::BOOL:
+                    {
+                        arrow::BooleanArray *boolarray = (arrow::BooleanArray *) array;
+                        ((bool *) data)[j] = boolarray->Value(j);
+                        break;
+                    }
+                case arrow::Type::INT8:
+                    {
+                        arrow::Int8Array *intarray = (arrow::Int8Array *) array;
+                        ((int8 *) data)[j] = intarray->Value(j);
+                        break;
+                    }
+                case arrow::Type::INT16:
+                    {
+                        arrow::Int16Array *intarray = (arrow::Int16Array *) array;
+                        ((int16 *) data)[j] = intarray->Value(j);
+                        break;
+                    }
+                case arrow::Type::INT32:
+                    {
+                        arrow::Int32Array *intarray = (arrow::Int32Array *) array;
+                        ((int32 *) data)[j] = intarray->Value(j);
+                        break;
+                    }
+                case arrow::Type::FLOAT:
+                    {
+                        arrow::FloatArray *farray = (arrow::FloatArray *) array;
+                        ((float *) data)[j] = farray->Value(j);
+                        break;
+                    }
+                case arrow::Type::LIST:
+                    {
+                        auto larray = (arrow::ListArray *) array;
+
+                        ((Datum *) data)[j] =
+                            this->nested_list_to_datum(larray, j, typinfo);
+                        break;
+                    }
+                case arrow::Type::STRUCT:
+                    {
+                        auto sarray = (arrow::StructArray *) array;
+
+                        ((Datum *) data)[j] =
+                            this->struct_to_datum(sarray, j, typinfo);
+                        break;
+                    }
+                case arrow::Type::MAP:
+                    {
+                        arrow::MapArray* maparray = (arrow::MapArray*) array;
+
+                        Datum jsonb =
+                            this->map_to_datum(maparray, j, typinfo);
 
-                            ((Datum *) data)[row] =
-                                this->nested_list_to_datum(larray, j, typinfo);
-                            break;
-                        }
-                    case arrow::Type::MAP:
-                        {
-                            arrow::MapArray* maparray = (arrow::MapArray*) array;
-
-                            Datum jsonb =
-                                this->map_to_datum(maparray, j, typinfo);
-
-                            /*
-                             * Copy jsonb into memory block allocated by
-                             * FastAllocator to prevent its destruction though
-                             * to be able to recycle it once it fulfilled its
-                             * purpose.
-                             */
-                            void *res = allocator->fast_alloc(VARSIZE_ANY(jsonb));
-                            memcpy(res, (Jsonb *) jsonb, VARSIZE_ANY(jsonb));
-                            ((Datum *) data)[row] = (Datum) res;
-                            pfree((Jsonb *) jsonb);
-                            break;
-                        }
-                    default:
                         /*
-                         * For larger types we copy already converted into
-                         * Datum values.
+                         * Copy jsonb into memory block allocated by
+                         * FastAllocator to prevent its destruction though
+                         * to be able to recycle it once it fulfilled its
+                         * purpose.
                          */
-                        ((Datum *) data)[row] =
+                        void *res = allocator->fast_alloc(VARSIZE_ANY(jsonb));
+                        memcpy(res, (Jsonb *) jsonb, VARSIZE_ANY(jsonb));
+                        ((Datum *) data)[j] = (Datum) res;
+                        pfree((Jsonb *) jsonb);
+                        break;
+                    }
+                default:
+                    /*
+                     * For larger types we copy already converted into
+                     * Datum values.
+                     */
+                    if (dict_idx)
+                        ((Datum *) data)[j] = dict[dict_idx[j]];
+                    else
+                        ((Datum *) data)[j] =
                             this->read_primitive_type(array, typinfo, j);
-                }
-                this->column_nulls[col][row] = false;
-
-                row++;
             }
+            this->column_nulls[col][j] = false;
         }
 
         this->column_data[col] = data;
@@ -1298,13 +2506,17 @@ public:
                 return RS_INACTIVE;
 
             /*
-             * Read next row group. We do it in a loop to skip possibly empty
-             * row groups.
+             * Read next batch, proceeding to the next row group if the
+             * current one is exhausted. We do it in a loop to skip possibly
+             * empty row groups.
              */
             do
             {
-                if (!this->read_next_rowgroup())
-                    return RS_EOF;
+                while (!this->read_next_batch())
+                {
+                    if (!this->read_next_rowgroup())
+                        return RS_EOF;
+                }
             }
             while (!this->num_rows);
         }
@@ -1349,16 +2561,10 @@ public:
                         slot->tts_values[attr] = Float4GetDatum(((float *) data)[this->row]);
                         break;
                     case arrow::Type::DATE32:
-                        {
-                            /*
-                             * Postgres date starts with 2000-01-01 while unix date (which
-                             * Parquet is using) starts with 1970-01-01. So we need to do
-                             * simple calculations here.
-                             */
-                            int dt = ((int *) data)[this->row]
-                                + (UNIX_EPOCH_JDATE - POSTGRES_EPOCH_JDATE);
-                            slot->tts_values[attr] = DateADTGetDatum(dt);
-                        }
+                        slot->tts_values[attr] = DateADTGetDatum(((DateADT *) data)[this->row]);
+                        break;
+                    case arrow::Type::TIMESTAMP:
+                        slot->tts_values[attr] = TimestampGetDatum(((Timestamp *) data)[this->row]);
                         break;
                     default:
                         slot->tts_values[attr] = ((Datum *) data)[this->row];
@@ -1380,9 +2586,11 @@ public:
 
     void rescan(void)
     {
-        this->row_group = 0;
+        this->row_group = -1;
         this->row = 0;
         this->num_rows = 0;
+        this->rowgroup_pos = 0;
+        this->batch_reader = nullptr;
     }
 };
 
@@ -1405,4 +2613,25 @@ ParquetReader *create_parquet_reader(const char *filename,
 
 /* Default destructor is required */
 ParquetReader::~ParquetReader()
-{}
+{
+    /* Outstanding reads may still refer to the file */
+    if (this->prefetched.is_valid())
+        this->prefetched.Wait();
+
+    /*
+     * Completion callbacks may still hold the pipe, in which case the last of
+     * them closes it. Either way it is no longer ours to account for.
+     */
+    if (this->notify_pipe)
+    {
+        ReleaseExternalFD();
+        ReleaseExternalFD();
+    }
+}
+
+ParquetReader::NotifyPipe::~NotifyPipe()
+{
+    for (int fd : this->fd)
+        if (fd >= 0)
+            ::close(fd);
+}
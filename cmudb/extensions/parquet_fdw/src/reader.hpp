@@ -7,7 +7,9 @@
 #include <vector>
 
 #include "arrow/api.h"
+#include "arrow/util/future.h"
 #include "parquet/arrow/reader.h"
+#include "parquet/arrow/schema.h"
 
 extern "C"
 {
@@ -15,11 +17,38 @@ extern "C"
 #include "fmgr.h"
 #include "access/tupdesc.h"
 #include "executor/tuptable.h"
+#include "nodes/execnodes.h"
 #include "nodes/pg_list.h"
 #include "storage/spin.h"
 }
 
 
+/*
+ * RuntimeFilter
+ *      Condition "column OP value" where the value only becomes known at
+ *      execution time, e.g. it refers to the outer relation of a parameterized
+ *      nested loop join or to a query parameter. Readers use it to skip row
+ *      groups by min/max statistics and to drop rows before they are stored
+ *      into the slot. The condition is checked by executor anyway, so filter
+ *      is only an optimization.
+ */
+struct RuntimeFilter
+{
+    AttrNumber  attnum;     /* attribute index in tuple descriptor (0-based) */
+    int         strategy;   /* btree strategy of the operator */
+    Oid         collid;     /* operator input collation */
+    FmgrInfo    opfunc;     /* operator function */
+    ExprState  *expr;       /* expression computing the value */
+    Oid         valtype;
+    int16       vallen;
+    bool        valbyval;
+
+    /* Set by caller before the scan (re)starts */
+    Datum       value;
+    bool        isnull;
+};
+
+
 class ParallelCoordinator
 {
 private:
@@ -145,9 +174,21 @@ protected:
         FmgrInfo       *outfunc; /* For cast via IO and for maps */
         FmgrInfo       *infunc;  /* For cast via IO              */
 
-        /* Underlying types for complex types like list and map */
+        /*
+         * Underlying types for complex types: element type for lists (which
+         * is a list itself for every extra dimension of nested lists), key and
+         * item types for maps and attribute types for structs.
+         */
         std::vector<TypeInfo> children;
 
+        /*
+         * For structs: descriptor of the composite type and index of the
+         * struct field for every attribute (-1 when there is no field with
+         * the attribute's name).
+         */
+        TupleDesc       tupdesc;
+        std::vector<int> fields;
+
         /*
          * Column index in parquet schema. For complex types and children
          * index is equal -1. Currently only used for checking column
@@ -157,13 +198,15 @@ protected:
 
         TypeInfo()
             : arrow{}, pg{}, need_cast(false),
-              castfunc(nullptr), outfunc(nullptr), infunc(nullptr), index(-1)
+              castfunc(nullptr), outfunc(nullptr), infunc(nullptr),
+              tupdesc(nullptr), index(-1)
         {}
 
         TypeInfo(TypeInfo &&ti)
             : arrow(ti.arrow), pg(ti.pg), need_cast(ti.need_cast),
               castfunc(ti.castfunc), outfunc(ti.outfunc), infunc(ti.infunc),
-              children(std::move(ti.children)), index(-1)
+              children(std::move(ti.children)), tupdesc(ti.tupdesc),
+              fields(std::move(ti.fields)), index(ti.index)
         {}
 
         TypeInfo(std::shared_ptr<arrow::DataType> arrow_type, Oid typid=InvalidOid)
@@ -214,26 +257,91 @@ protected:
 
     std::unique_ptr<FastAllocator>  allocator;
 
+    /*
+     * Memory context for Datums built from dictionaries of dictionary-encoded
+     * columns. Reset on every row group.
+     */
+    MemoryContext                   dictionary_cxt;
+
     /*
      * libparquet options
      */
     bool    use_threads;
     bool    use_mmap;
+    bool    pre_buffer;
+
+    /*
+     * If positive, only that many leading rows of every row group are read.
+     * The file is then read through a buffered stream so that only the pages
+     * holding those rows are fetched and decoded (used by ANALYZE sampling).
+     */
+    int64_t rowgroup_rows_limit;
+
+    /*
+     * Pre-buffering state. 'prefetched' completes once column chunks of the
+     * row group 'prefetched_idx' (index in 'rowgroups') are in memory.
+     * 'notify_pipe' is a pipe which gets a byte written on completion, used
+     * to wait for it in an event loop (see wait_event_fd()).
+     *
+     * Arrow wakes up the waiters of a future before running its callbacks,
+     * so a completion callback may still be about to write to the pipe after
+     * prefetched.Wait() has returned. The callbacks therefore share ownership
+     * of the pipe, which is closed by whoever drops the last reference.
+     */
+    struct NotifyPipe
+    {
+        int     fd[2] = {-1, -1};
+
+        ~NotifyPipe();
+    };
+
+    arrow::Future<>                 prefetched;
+    int                             prefetched_idx;
+    std::shared_ptr<NotifyPipe>     notify_pipe;
+    bool                            notify_armed;
+
+    /*
+     * Runtime filters owned by the execution state and the matching columns
+     * of this file. 'cmpfunc' compares filter value with min/max statistics
+     * of the column, its fn_oid is InvalidOid when statistics can't be used.
+     */
+    struct RuntimeFilterColumn
+    {
+        int                                 col;    /* index in 'types' */
+        std::shared_ptr<arrow::DataType>    arrow_type;
+        FmgrInfo                            cmpfunc;
+    };
+
+    std::vector<RuntimeFilter>         *runtime_filters;
+    std::vector<RuntimeFilterColumn>    filter_columns;
 
     /* Wether object is properly initialized */
     bool    initialized;
 
 protected:
+    void open_file();
+    Datum *read_dictionary(arrow::DictionaryArray *array, const TypeInfo &typinfo);
+    void reset_dictionaries();
+    void prefetch(int idx);
+    bool prefetch_ready(int idx);
+    bool rowgroup_matches_runtime_filters(int rowgroup);
     Datum do_cast(Datum val, const TypeInfo &typinfo);
     Datum read_primitive_type(arrow::Array *array, const TypeInfo &typinfo,
                               int64_t i);
+    Datum read_nested_type(arrow::Array *array, const TypeInfo &typinfo,
+                           int64_t i);
     Datum nested_list_to_datum(arrow::ListArray *larray, int pos, const TypeInfo &typinfo);
+    Datum struct_to_datum(arrow::StructArray *sarray, int64_t pos,
+                          const TypeInfo &typinfo);
     Datum map_to_datum(arrow::MapArray *maparray, int pos, const TypeInfo &typinfo);
     FmgrInfo *find_castfunc(arrow::Type::type src_type, Oid dst_type,
                             const char *attname);
     FmgrInfo *find_outfunc(Oid typoid);
     FmgrInfo *find_infunc(Oid typoid);
     void initialize_cast(TypeInfo &typinfo, const char *attname);
+    void initialize_nested_type(TypeInfo &typinfo,
+                                const parquet::arrow::SchemaField &field,
+                                const char *attname, bool list_dimension);
     template<typename T> inline void copy_to_c_array(T *values,
                                                      const arrow::Array *array,
                                                      int elem_size);
@@ -246,12 +354,19 @@ public:
     virtual void rescan() = 0;
     virtual void open() = 0;
     virtual void close() = 0;
+    virtual bool ready() = 0;
+    /* Limit memory used for materialized rows (caching reader only) */
+    virtual void set_memory_budget(size_t /* budget */) {}
 
     int32_t id();
     void create_column_mapping(TupleDesc tupleDesc, const std::set<int> &attrs_used);
     void set_rowgroups_list(const std::vector<int> &rowgroups);
-    void set_options(bool use_threads, bool use_mmap);
+    void set_options(bool use_threads, bool use_mmap, bool pre_buffer = false);
+    void set_rowgroup_rows_limit(int64_t limit);
+    int wait_event_fd();
+    void clear_wait_event();
     void set_coordinator(ParallelCoordinator *coord);
+    void set_runtime_filters(std::vector<RuntimeFilter> *filters);
 };
 
 ParquetReader *create_parquet_reader(const char *filename,
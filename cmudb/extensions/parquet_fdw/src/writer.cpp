@@ -0,0 +1,585 @@
+#include <cstdio>
+
+#include "arrow/api.h"
+#include "arrow/io/api.h"
+#include "arrow/util/compression.h"
+#include "arrow/util/config.h"
+#include "parquet/arrow/writer.h"
+#include "parquet/properties.h"
+
+#include "common.hpp"
+#include "writer.hpp"
+
+extern "C"
+{
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "miscadmin.h"
+#include "utils/array.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+}
+
+
+/*
+ * native_arrow_type
+ *      Arrow type postgres type is written as. Types without a counterpart
+ *      (returning NA) are written as strings using their output function.
+ */
+static arrow::Type::type
+native_arrow_type(Oid typid)
+{
+    switch (typid)
+    {
+        case BOOLOID:
+            return arrow::Type::BOOL;
+        case INT2OID:
+            return arrow::Type::INT16;
+        case INT4OID:
+            return arrow::Type::INT32;
+        case INT8OID:
+            return arrow::Type::INT64;
+        case FLOAT4OID:
+            return arrow::Type::FLOAT;
+        case FLOAT8OID:
+            return arrow::Type::DOUBLE;
+        case DATEOID:
+            return arrow::Type::DATE32;
+        case TIMESTAMPOID:
+        case TIMESTAMPTZOID:
+            return arrow::Type::TIMESTAMP;
+        case TEXTOID:
+        case VARCHAROID:
+        case BPCHAROID:
+            return arrow::Type::STRING;
+        case BYTEAOID:
+            return arrow::Type::BINARY;
+        default:
+            return arrow::Type::NA;
+    }
+}
+
+ParquetWriter::ParquetWriter(const char *path, TupleDesc tupdesc,
+                             const ParquetWriterOptions &options)
+    : path(path), tupdesc(tupdesc), row_group_size(options.row_group_size),
+      max_buffered_bytes((int64_t) work_mem * 1024),
+      values(nullptr), nulls(nullptr), row_cxt(nullptr),
+      rows_buffered(0), bytes_buffered(0), rows_written(0), closed(false)
+{
+    parquet::WriterProperties::Builder  props;
+    arrow::FieldVector  fields;
+    arrow::Status       status;
+    MemoryContext       ccxt = CurrentMemoryContext;
+    bool                error = false;
+    char                errstr[ERROR_STR_LEN];
+
+    this->tmp_path = this->path + ".tmp";
+
+    PG_TRY();
+    {
+        this->row_cxt = AllocSetContextCreate(CurrentMemoryContext,
+                                              "parquet_fdw writer row",
+                                              ALLOCSET_DEFAULT_SIZES);
+        this->values = (Datum *) palloc(sizeof(Datum) * tupdesc->natts);
+        this->nulls = (bool *) palloc(sizeof(bool) * tupdesc->natts);
+    }
+    PG_CATCH();
+    {
+        ErrorData *errdata;
+
+        MemoryContextSwitchTo(ccxt);
+        error = true;
+        errdata = CopyErrorData();
+        FlushErrorState();
+
+        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+        FreeErrorData(errdata);
+    }
+    PG_END_TRY();
+    if (error)
+        throw Error("failed to initialize writer: %s", errstr);
+
+    this->types.resize(tupdesc->natts);
+    this->row.resize(tupdesc->natts);
+    for (int i = 0; i < tupdesc->natts; ++i)
+    {
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+        this->init_type(this->types[i], attr->atttypid, NameStr(attr->attname));
+        fields.push_back(arrow::field(NameStr(attr->attname),
+                                      this->arrow_type(this->types[i])));
+    }
+    this->schema = arrow::schema(fields);
+
+    for (auto &field : this->schema->fields())
+    {
+        std::unique_ptr<arrow::ArrayBuilder> builder;
+
+        status = arrow::MakeBuilder(arrow::default_memory_pool(),
+                                    field->type(), &builder);
+        if (!status.ok())
+            throw Error("failed to create builder for column '%s': %s",
+                        field->name().c_str(), status.message().c_str());
+        this->builders.push_back(std::move(builder));
+    }
+
+    props.compression(options.compression);
+    if (options.compression_level != arrow::util::kUseDefaultCompressionLevel)
+        props.compression_level(options.compression_level);
+    if (options.dictionary)
+        props.enable_dictionary();
+    else
+        props.disable_dictionary();
+    if (options.statistics)
+        props.enable_statistics();
+    else
+        props.disable_statistics();
+    props.max_row_group_length(this->row_group_size);
+
+    auto sink_res = arrow::io::FileOutputStream::Open(this->tmp_path);
+    if (!sink_res.ok())
+        throw Error("failed to create file '%s': %s",
+                    this->tmp_path.c_str(), sink_res.status().message().c_str());
+    this->sink = *sink_res;
+
+#if ARROW_VERSION_MAJOR >= 11
+    auto writer_res = parquet::arrow::FileWriter::Open(*this->schema,
+                                                       arrow::default_memory_pool(),
+                                                       this->sink, props.build(),
+                                                       parquet::default_arrow_writer_properties());
+    status = writer_res.status();
+    if (status.ok())
+        this->writer = std::move(*writer_res);
+#else
+    status = parquet::arrow::FileWriter::Open(*this->schema,
+                                              arrow::default_memory_pool(),
+                                              this->sink, props.build(),
+                                              parquet::default_arrow_writer_properties(),
+                                              &this->writer);
+#endif
+    if (!status.ok())
+        throw Error("failed to create Parquet writer for '%s': %s",
+                    this->path.c_str(), status.message().c_str());
+}
+
+/*
+ * ~ParquetWriter
+ *      Unless close() succeeded remove the incomplete file. Memory contexts are
+ *      not touched as the writer may be destroyed by the reset callback of
+ *      the parent context after its children are already gone.
+ */
+ParquetWriter::~ParquetWriter()
+{
+    if (this->closed)
+        return;
+
+    if (this->writer)
+        (void) this->writer->Close();
+    if (this->sink && !this->sink->closed())
+        (void) this->sink->Close();
+    std::remove(this->tmp_path.c_str());
+}
+
+/*
+ * init_type
+ *      Resolve how values of the postgres type are converted into Arrow.
+ */
+void ParquetWriter::init_type(TypeInfo &typinfo, Oid typid, const char *attname)
+{
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    char            errstr[ERROR_STR_LEN];
+    Oid             elem_type = InvalidOid;
+
+    PG_TRY();
+    {
+        typinfo.typid = getBaseType(typid);
+        get_typlenbyvalalign(typinfo.typid, &typinfo.len, &typinfo.byval,
+                             &typinfo.align);
+        typinfo.arrow_type = native_arrow_type(typinfo.typid);
+        typinfo.use_outfunc = false;
+
+        if (typinfo.arrow_type == arrow::Type::NA)
+        {
+            elem_type = get_element_type(typinfo.typid);
+
+            if (!OidIsValid(elem_type))
+            {
+                Oid     outfunc;
+                bool    isvarlena;
+
+                getTypeOutputInfo(typinfo.typid, &outfunc, &isvarlena);
+                fmgr_info(outfunc, &typinfo.outfunc);
+                typinfo.arrow_type = arrow::Type::STRING;
+                typinfo.use_outfunc = true;
+            }
+        }
+    }
+    PG_CATCH();
+    {
+        ErrorData *errdata;
+
+        MemoryContextSwitchTo(ccxt);
+        error = true;
+        errdata = CopyErrorData();
+        FlushErrorState();
+
+        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+        FreeErrorData(errdata);
+    }
+    PG_END_TRY();
+    if (error)
+        throw Error("failed to initialize type of column '%s': %s",
+                    attname, errstr);
+
+    if (OidIsValid(elem_type))
+    {
+        typinfo.arrow_type = arrow::Type::LIST;
+        typinfo.children.resize(1);
+        this->init_type(typinfo.children[0], elem_type, attname);
+    }
+}
+
+std::shared_ptr<arrow::DataType>
+ParquetWriter::arrow_type(const TypeInfo &typinfo)
+{
+    switch (typinfo.arrow_type)
+    {
+        case arrow::Type::BOOL:
+            return arrow::boolean();
+        case arrow::Type::INT16:
+            return arrow::int16();
+        case arrow::Type::INT32:
+            return arrow::int32();
+        case arrow::Type::INT64:
+            return arrow::int64();
+        case arrow::Type::FLOAT:
+            return arrow::float32();
+        case arrow::Type::DOUBLE:
+            return arrow::float64();
+        case arrow::Type::DATE32:
+            return arrow::date32();
+        case arrow::Type::TIMESTAMP:
+            if (typinfo.typid == TIMESTAMPTZOID)
+                return arrow::timestamp(arrow::TimeUnit::MICRO, "UTC");
+            return arrow::timestamp(arrow::TimeUnit::MICRO);
+        case arrow::Type::STRING:
+            return arrow::utf8();
+        case arrow::Type::BINARY:
+            return arrow::binary();
+        case arrow::Type::LIST:
+            return arrow::list(this->arrow_type(typinfo.children[0]));
+        default:
+            throw Error("unsupported type %d", (int) typinfo.arrow_type);
+    }
+}
+
+/*
+ * check_finite
+ *      Parquet has no infinite dates or timestamps, and converting postgres
+ *      ones would overflow or turn them into ordinary values.
+ */
+static void
+check_finite(Oid typid, Datum value)
+{
+    switch (typid)
+    {
+        case DATEOID:
+            if (DATE_NOT_FINITE(DatumGetDateADT(value)))
+                ereport(ERROR,
+                        (errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+                         errmsg("infinite date cannot be written to Parquet")));
+            break;
+        case TIMESTAMPOID:
+        case TIMESTAMPTZOID:
+            if (TIMESTAMP_NOT_FINITE(DatumGetTimestamp(value)))
+                ereport(ERROR,
+                        (errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+                         errmsg("infinite timestamp cannot be written to Parquet")));
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * prepare_row
+ *      Deform the tuple and bring column values into the form which can be
+ *      passed to Arrow builders: detoast varlenas, deconstruct arrays and
+ *      call output functions. All the postgres calls are done here so that
+ *      appending to builders doesn't need to care about postgres errors.
+ */
+void ParquetWriter::prepare_row(HeapTuple tuple)
+{
+    MemoryContext   ccxt = CurrentMemoryContext;
+    bool            error = false;
+    char            errstr[ERROR_STR_LEN];
+
+    MemoryContextReset(this->row_cxt);
+    MemoryContextSwitchTo(this->row_cxt);
+
+    PG_TRY();
+    {
+        heap_deform_tuple(tuple, this->tupdesc, this->values, this->nulls);
+
+        for (size_t i = 0; i < this->types.size(); ++i)
+        {
+            ColumnValue    &cv = this->row[i];
+            TypeInfo       &typinfo = this->types[i];
+            Datum           value = this->values[i];
+
+            cv.isnull = this->nulls[i];
+            if (cv.isnull)
+                continue;
+
+            switch (typinfo.arrow_type)
+            {
+                case arrow::Type::LIST:
+                {
+                    ArrayType  *arr = DatumGetArrayTypeP(value);
+                    TypeInfo   &elem = typinfo.children[0];
+
+                    if (ARR_NDIM(arr) > 1)
+                        elog(ERROR, "multidimensional arrays are not supported");
+
+                    deconstruct_array(arr, elem.typid, elem.len, elem.byval,
+                                      elem.align, &cv.elems, &cv.elem_nulls,
+                                      &cv.nelems);
+
+                    for (int j = 0; j < cv.nelems; ++j)
+                        if (!cv.elem_nulls[j])
+                            check_finite(elem.typid, cv.elems[j]);
+
+                    if (elem.use_outfunc)
+                    {
+                        for (int j = 0; j < cv.nelems; ++j)
+                            if (!cv.elem_nulls[j])
+                                cv.elems[j] = CStringGetDatum(
+                                    OutputFunctionCall(&elem.outfunc, cv.elems[j]));
+                    }
+                    break;
+                }
+                case arrow::Type::STRING:
+                case arrow::Type::BINARY:
+                    if (typinfo.use_outfunc)
+                        cv.value = CStringGetDatum(
+                            OutputFunctionCall(&typinfo.outfunc, value));
+                    else
+                        cv.value = PointerGetDatum(PG_DETOAST_DATUM_PACKED(value));
+                    break;
+                default:
+                    check_finite(typinfo.typid, value);
+                    cv.value = value;
+            }
+        }
+    }
+    PG_CATCH();
+    {
+        ErrorData *errdata;
+
+        MemoryContextSwitchTo(ccxt);
+        error = true;
+        errdata = CopyErrorData();
+        FlushErrorState();
+
+        strncpy(errstr, errdata->message, ERROR_STR_LEN - 1);
+        FreeErrorData(errdata);
+    }
+    PG_END_TRY();
+    MemoryContextSwitchTo(ccxt);
+    if (error)
+        throw Error("%s", errstr);
+}
+
+arrow::Status ParquetWriter::append_scalar(arrow::ArrayBuilder *builder,
+                                           const TypeInfo &typinfo, Datum value)
+{
+    switch (typinfo.arrow_type)
+    {
+        case arrow::Type::BOOL:
+            return ((arrow::BooleanBuilder *) builder)->Append(DatumGetBool(value));
+        case arrow::Type::INT16:
+            return ((arrow::Int16Builder *) builder)->Append(DatumGetInt16(value));
+        case arrow::Type::INT32:
+            return ((arrow::Int32Builder *) builder)->Append(DatumGetInt32(value));
+        case arrow::Type::INT64:
+            return ((arrow::Int64Builder *) builder)->Append(DatumGetInt64(value));
+        case arrow::Type::FLOAT:
+            return ((arrow::FloatBuilder *) builder)->Append(DatumGetFloat4(value));
+        case arrow::Type::DOUBLE:
+            return ((arrow::DoubleBuilder *) builder)->Append(DatumGetFloat8(value));
+        case arrow::Type::DATE32:
+            return ((arrow::Date32Builder *) builder)->Append(
+                DatumGetDateADT(value) - PARQUET_EPOCH_DAYS_OFFSET);
+        case arrow::Type::TIMESTAMP:
+            /* infinite values are rejected by prepare_row() */
+            return ((arrow::TimestampBuilder *) builder)->Append(
+                DatumGetTimestamp(value) - PARQUET_EPOCH_USECS_OFFSET);
+        case arrow::Type::STRING:
+        case arrow::Type::BINARY:
+        {
+            /* StringBuilder is a BinaryBuilder */
+            auto binbuilder = (arrow::BinaryBuilder *) builder;
+
+            if (typinfo.use_outfunc)
+            {
+                const char *str = DatumGetCString(value);
+
+                return binbuilder->Append(str, strlen(str));
+            }
+            else
+            {
+                struct varlena *v = (struct varlena *) DatumGetPointer(value);
+
+                return binbuilder->Append(VARDATA_ANY(v), VARSIZE_ANY_EXHDR(v));
+            }
+        }
+        default:
+            return arrow::Status::NotImplemented("unsupported type");
+    }
+}
+
+/*
+ * value_size
+ *      Approximate number of bytes the value takes in an Arrow builder.
+ */
+int64_t ParquetWriter::value_size(const TypeInfo &typinfo, Datum value)
+{
+    switch (typinfo.arrow_type)
+    {
+        case arrow::Type::STRING:
+        case arrow::Type::BINARY:
+            if (typinfo.use_outfunc)
+                return strlen(DatumGetCString(value)) + sizeof(int32);
+            return VARSIZE_ANY_EXHDR(DatumGetPointer(value)) + sizeof(int32);
+        default:
+            return typinfo.len > 0 ? typinfo.len : sizeof(Datum);
+    }
+}
+
+arrow::Status ParquetWriter::append_row()
+{
+    for (size_t i = 0; i < this->types.size(); ++i)
+    {
+        ColumnValue            &cv = this->row[i];
+        TypeInfo               &typinfo = this->types[i];
+        arrow::ArrayBuilder    *builder = this->builders[i].get();
+
+        if (cv.isnull)
+        {
+            ARROW_RETURN_NOT_OK(builder->AppendNull());
+            continue;
+        }
+
+        if (typinfo.arrow_type == arrow::Type::LIST)
+        {
+            auto    lbuilder = (arrow::ListBuilder *) builder;
+            auto    vbuilder = lbuilder->value_builder();
+
+            ARROW_RETURN_NOT_OK(lbuilder->Append());
+            this->bytes_buffered += sizeof(int32);
+            for (int j = 0; j < cv.nelems; ++j)
+            {
+                if (cv.elem_nulls[j])
+                    ARROW_RETURN_NOT_OK(vbuilder->AppendNull());
+                else
+                {
+                    ARROW_RETURN_NOT_OK(this->append_scalar(vbuilder,
+                                                            typinfo.children[0],
+                                                            cv.elems[j]));
+                    this->bytes_buffered += this->value_size(typinfo.children[0],
+                                                             cv.elems[j]);
+                }
+            }
+        }
+        else
+        {
+            ARROW_RETURN_NOT_OK(this->append_scalar(builder, typinfo, cv.value));
+            this->bytes_buffered += this->value_size(typinfo, cv.value);
+        }
+    }
+
+    return arrow::Status::OK();
+}
+
+/*
+ * write
+ *      Append tuple to the current row group. The row group is written out
+ *      once it has row_group_size rows or its buffered values exceed
+ *      work_mem, whichever comes first.
+ */
+void ParquetWriter::write(HeapTuple tuple)
+{
+    arrow::Status   status;
+
+    this->prepare_row(tuple);
+
+    status = this->append_row();
+    if (!status.ok())
+        throw Error("failed to append row: %s", status.message().c_str());
+
+    if (++this->rows_buffered >= this->row_group_size ||
+        this->bytes_buffered >= this->max_buffered_bytes)
+        this->flush();
+}
+
+/*
+ * flush
+ *      Write out buffered rows as a row group.
+ */
+void ParquetWriter::flush()
+{
+    std::vector<std::shared_ptr<arrow::Array>> arrays(this->builders.size());
+    arrow::Status   status;
+
+    if (this->rows_buffered == 0)
+        return;
+
+    for (size_t i = 0; i < this->builders.size(); ++i)
+    {
+        status = this->builders[i]->Finish(&arrays[i]);
+        if (!status.ok())
+            throw Error("failed to build column '%s': %s",
+                        this->schema->field(i)->name().c_str(),
+                        status.message().c_str());
+    }
+
+    auto table = arrow::Table::Make(this->schema, arrays, this->rows_buffered);
+
+    status = this->writer->WriteTable(*table, this->row_group_size);
+    if (!status.ok())
+        throw Error("failed to write row group to '%s': %s",
+                    this->path.c_str(), status.message().c_str());
+
+    this->rows_written += this->rows_buffered;
+    this->rows_buffered = 0;
+    this->bytes_buffered = 0;
+}
+
+/*
+ * close
+ *      Write out the remaining rows and the footer and move the file to its
+ *      final location.
+ */
+void ParquetWriter::close()
+{
+    arrow::Status   status;
+
+    this->flush();
+
+    status = this->writer->Close();
+    if (status.ok())
+        status = this->sink->Close();
+    if (!status.ok())
+        throw Error("failed to close '%s': %s",
+                    this->path.c_str(), status.message().c_str());
+
+    if (std::rename(this->tmp_path.c_str(), this->path.c_str()) != 0)
+        throw Error("could not rename file '%s' to '%s': %s",
+                    this->tmp_path.c_str(), this->path.c_str(), strerror(errno));
+
+    this->closed = true;
+}
@@ -0,0 +1,116 @@
+#ifndef PARQUET_FDW_WRITER_HPP
+#define PARQUET_FDW_WRITER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arrow/api.h"
+#include "arrow/io/api.h"
+#include "parquet/arrow/writer.h"
+
+extern "C"
+{
+#include "postgres.h"
+#include "fmgr.h"
+#include "access/htup.h"
+#include "access/tupdesc.h"
+}
+
+
+struct ParquetWriterOptions
+{
+    int64_t                     row_group_size;     /* rows per row group */
+    arrow::Compression::type    compression;
+    int                         compression_level;
+    bool                        dictionary;
+    bool                        statistics;
+};
+
+/*
+ * ParquetWriter
+ *      Writes tuples into a Parquet file. Rows are accumulated in Arrow
+ *      builders and written out as a row group once `row_group_size` rows
+ *      are collected or their values take more than work_mem. The file is written under a temporary name and renamed
+ *      into place by close(), so that a failed export doesn't leave a
+ *      truncated file behind.
+ */
+class ParquetWriter
+{
+private:
+    struct TypeInfo
+    {
+        Oid                 typid;
+        int16               len;
+        bool                byval;
+        char                align;
+        arrow::Type::type   arrow_type;
+
+        /* Types without native Arrow counterpart are written as strings */
+        bool                use_outfunc;
+        FmgrInfo            outfunc;
+
+        /* Element type for arrays */
+        std::vector<TypeInfo> children;
+    };
+
+    /*
+     * Column value converted to the form which can be passed to Arrow
+     * builders without calling any postgres functions.
+     */
+    struct ColumnValue
+    {
+        Datum   value;
+        bool    isnull;
+
+        /* Deconstructed array */
+        Datum  *elems;
+        bool   *elem_nulls;
+        int     nelems;
+    };
+
+    std::string                     path;
+    std::string                     tmp_path;
+    TupleDesc                       tupdesc;
+    int64_t                         row_group_size;
+    int64_t                         max_buffered_bytes;
+
+    std::vector<TypeInfo>           types;
+    std::vector<ColumnValue>        row;
+    Datum                          *values;
+    bool                           *nulls;
+    std::vector<std::unique_ptr<arrow::ArrayBuilder>> builders;
+    std::shared_ptr<arrow::Schema>  schema;
+
+    std::shared_ptr<arrow::io::FileOutputStream>    sink;
+    std::unique_ptr<parquet::arrow::FileWriter>     writer;
+
+    /* Memory for detoasted and deconstructed values of the current row */
+    MemoryContext                   row_cxt;
+
+    int64_t                         rows_buffered;
+    int64_t                         bytes_buffered;     /* approximate */
+    int64_t                         rows_written;
+    bool                            closed;
+
+private:
+    void init_type(TypeInfo &typinfo, Oid typid, const char *attname);
+    std::shared_ptr<arrow::DataType> arrow_type(const TypeInfo &typinfo);
+    void prepare_row(HeapTuple tuple);
+    arrow::Status append_scalar(arrow::ArrayBuilder *builder,
+                                const TypeInfo &typinfo, Datum value);
+    int64_t value_size(const TypeInfo &typinfo, Datum value);
+    arrow::Status append_row();
+    void flush();
+
+public:
+    ParquetWriter(const char *path, TupleDesc tupdesc,
+                  const ParquetWriterOptions &options);
+    ~ParquetWriter();
+
+    void write(HeapTuple tuple);
+    void close();
+    int64_t written() { return rows_written; }
+};
+
+#endif
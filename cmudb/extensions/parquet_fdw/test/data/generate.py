@@ -6,6 +6,7 @@ import pandas as pd
 import pyarrow as pa
 import pyarrow.parquet as pq
 from datetime import datetime, date, timedelta
+from decimal import Decimal
 
 # example1.parquet file
 df1 = pd.DataFrame({'one': [1, 2, 3],
@@ -108,3 +109,37 @@ table_part2 = pa.Table.from_pandas(df_part2)
 
 with pq.ParquetWriter('partition/example_part2.parquet', table_part2.schema) as writer:
     writer.write_table(table_part2)
+
+# example4.parquet file: nanosecond/millisecond timestamps and decimals.
+# Kept out of simple/, which 002_import imports as a whole.
+table5 = pa.table({
+    'one': pa.array([1, 2, 3], pa.int64()),
+    'two': pa.array([1514764800000001500, -500, None], pa.timestamp('ns')),
+    'three': pa.array([1514764800123, -315619199500, 1514764800000],
+                      pa.timestamp('ms')),
+    'four': pa.array([Decimal('123.45'), Decimal('-0.01'), None],
+                     pa.decimal128(10, 2)),
+    'five': pa.array([Decimal('1234567890123456789012.34567'),
+                      Decimal('-1.50000'), Decimal('0.00000')],
+                     pa.decimal128(30, 5))})
+
+with pq.ParquetWriter('types/example4.parquet', table5.schema) as writer:
+    writer.write_table(table5)
+
+# example5.parquet file: structs and nested lists
+struct_type = pa.struct([('a', pa.int32()),
+                         ('b', pa.string()),
+                         ('c', pa.list_(pa.int64()))])
+table6 = pa.table({
+    'one': pa.array([1, 2, 3], pa.int64()),
+    'two': pa.array([{'a': 1, 'b': 'foo', 'c': [1, 2]},
+                     None,
+                     {'a': None, 'b': 'bar', 'c': None}], struct_type),
+    'three': pa.array([[[1, 2], [3, 4]], [[5], [6], [7]], None],
+                      pa.list_(pa.list_(pa.int32()))),
+    'four': pa.array([[{'x': 1, 'y': 'a'}, {'x': 2, 'y': None}], [], None],
+                     pa.list_(pa.struct([('x', pa.int32()),
+                                         ('y', pa.string())])))})
+
+with pq.ParquetWriter('complex/example5.parquet', table6.schema) as writer:
+    writer.write_table(table6)
@@ -56,6 +56,7 @@
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
+#include "storage/aio.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
@@ -72,6 +73,8 @@
 #include "utils/spccache.h"
 
 
+static void heapgetpage_internal(HeapScanDesc scan, BlockNumber page,
+								 ScanDirection dir);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -322,6 +325,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_nreadbuf = 0;
+	scan->rs_nextreadbuf = 0;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -362,6 +367,139 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heap_scan_release_readbufs - unpin the pages read ahead by the scan
+ */
+static void
+heap_scan_release_readbufs(HeapScanDesc scan)
+{
+	while (scan->rs_nextreadbuf < scan->rs_nreadbuf)
+		ReleaseBuffer(scan->rs_readbuf[scan->rs_nextreadbuf++]);
+	scan->rs_nreadbuf = 0;
+	scan->rs_nextreadbuf = 0;
+}
+
+/*
+ * heap_scan_run_length - number of pages a forward scan currently at the
+ * given page will read in a row, starting at start, limited to what one
+ * ReadBuffers() call should read.  The pages from page up to start have
+ * been read already.
+ */
+static int
+heap_scan_run_length(HeapScanDesc scan, BlockNumber page, BlockNumber start)
+{
+	int64		ahead = start - page;
+	int64		nblocks;
+
+	/* Don't run past the end of the relation, where the scan wraps around */
+	nblocks = Min(io_combine_limit, (int64) scan->rs_nblocks - start);
+
+	/*
+	 * Keep the pins we hold in reasonable proportion to shared_buffers, in
+	 * case many scans are open at once.
+	 */
+	nblocks = Min(nblocks, NBuffers / MaxBackends - ahead);
+
+	if (scan->rs_base.rs_parallel != NULL)
+	{
+		ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		ParallelBlockTableScanWorker pbscanwork =
+		scan->rs_parallelworkerdata;
+
+		/* Only the rest of our current chunk is ours to read */
+		nblocks = Min(nblocks, pbscanwork->phsw_chunk_remaining + 1 - ahead);
+		nblocks = Min(nblocks, (int64) pbscan->phs_nblocks -
+					  pbscanwork->phsw_nallocated - ahead);
+	}
+	else
+	{
+		if (start < scan->rs_startblock)
+			nblocks = Min(nblocks, scan->rs_startblock - start);
+		if (scan->rs_numblocks != InvalidBlockNumber)
+			nblocks = Min(nblocks, scan->rs_numblocks - ahead);
+	}
+
+	return (int) Max(nblocks, 0);
+}
+
+/*
+ * heap_scan_read_ahead - start reading the next run of pages after those in
+ * rs_readbuf, if the scan will get to them
+ */
+static void
+heap_scan_read_ahead(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber start;
+	int			nblocks;
+
+	Assert(scan->rs_nreadbuf > 0);
+
+	start = BufferGetBlockNumber(scan->rs_readbuf[scan->rs_nreadbuf - 1]) + 1;
+	nblocks = heap_scan_run_length(scan, page, start);
+	if (nblocks == 0)
+		return;
+
+	/* Make room at the end of rs_readbuf */
+	memmove(scan->rs_readbuf, scan->rs_readbuf + scan->rs_nextreadbuf,
+			(scan->rs_nreadbuf - scan->rs_nextreadbuf) * sizeof(Buffer));
+	scan->rs_nreadbuf -= scan->rs_nextreadbuf;
+	scan->rs_nextreadbuf = 0;
+
+	StartReadBuffers(scan->rs_base.rs_rd, MAIN_FORKNUM, start, nblocks,
+					 scan->rs_strategy, scan->rs_readbuf + scan->rs_nreadbuf);
+	scan->rs_nreadbuf += nblocks;
+}
+
+/*
+ * heap_scan_read_buffer - read and pin a page for heapgetpage()
+ *
+ * A forward scan reads the pages ahead of it in runs of consecutive blocks
+ * with StartReadBuffers(), which fetches all uncached blocks of a run with
+ * one read call.  The buffers of the pages after the requested one stay
+ * pinned in rs_readbuf until the scan gets to them.  Unless io_method is
+ * "sync", those reads are performed by I/O workers, and the next run is
+ * started as soon as the scan enters the current one, so that it is read
+ * while the scan processes the current one.  Other scans read one page at
+ * a time.
+ */
+static Buffer
+heap_scan_read_buffer(HeapScanDesc scan, BlockNumber page, ScanDirection dir)
+{
+	Buffer		buffer;
+	int			nblocks;
+
+	if (scan->rs_nextreadbuf < scan->rs_nreadbuf &&
+		BufferGetBlockNumber(scan->rs_readbuf[scan->rs_nextreadbuf]) == page)
+	{
+		buffer = scan->rs_readbuf[scan->rs_nextreadbuf++];
+	}
+	else
+	{
+		heap_scan_release_readbufs(scan);
+
+		nblocks = ScanDirectionIsForward(dir) ?
+			heap_scan_run_length(scan, page, page) : 1;
+		if (nblocks <= 1)
+			return ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+									  RBM_NORMAL, scan->rs_strategy);
+
+		StartReadBuffers(scan->rs_base.rs_rd, MAIN_FORKNUM, page, nblocks,
+						 scan->rs_strategy, scan->rs_readbuf);
+		scan->rs_nreadbuf = nblocks;
+		scan->rs_nextreadbuf = 1;
+		buffer = scan->rs_readbuf[0];
+	}
+
+	if (io_method != IOMETHOD_SYNC &&
+		scan->rs_nreadbuf - scan->rs_nextreadbuf < io_combine_limit)
+		heap_scan_read_ahead(scan, page);
+
+	WaitReadBuffer(buffer);
+
+	return buffer;
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -372,7 +510,15 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 void
 heapgetpage(TableScanDesc sscan, BlockNumber page)
 {
-	HeapScanDesc scan = (HeapScanDesc) sscan;
+	heapgetpage_internal((HeapScanDesc) sscan, page, NoMovementScanDirection);
+}
+
+/*
+ * heapgetpage_internal - heapgetpage() for a scan moving in direction dir
+ */
+static void
+heapgetpage_internal(HeapScanDesc scan, BlockNumber page, ScanDirection dir)
+{
 	Buffer		buffer;
 	Snapshot	snapshot;
 	Page		dp;
@@ -399,8 +545,7 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	CHECK_FOR_INTERRUPTS();
 
 	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	scan->rs_cbuf = heap_scan_read_buffer(scan, page, dir);
 	scan->rs_cblock = page;
 
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
@@ -560,7 +705,7 @@ heapgettup(HeapScanDesc scan,
 			}
 			else
 				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 			lineoff = FirstOffsetNumber;	/* first offnum */
 			scan->rs_inited = true;
 		}
@@ -616,7 +761,7 @@ heapgettup(HeapScanDesc scan,
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 		}
 		else
 		{
@@ -665,7 +810,7 @@ heapgettup(HeapScanDesc scan,
 
 		page = ItemPointerGetBlockNumber(&(tuple->t_self));
 		if (page != scan->rs_cblock)
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 
 		/* Since the tuple was previously fetched, needn't lock page here */
 		dp = BufferGetPage(scan->rs_cbuf);
@@ -801,6 +946,7 @@ heapgettup(HeapScanDesc scan,
 		{
 			if (BufferIsValid(scan->rs_cbuf))
 				ReleaseBuffer(scan->rs_cbuf);
+			heap_scan_release_readbufs(scan);
 			scan->rs_cbuf = InvalidBuffer;
 			scan->rs_cblock = InvalidBlockNumber;
 			tuple->t_data = NULL;
@@ -808,7 +954,7 @@ heapgettup(HeapScanDesc scan,
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
+		heapgetpage_internal(scan, page, dir);
 
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -898,7 +1044,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 			}
 			else
 				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 			lineindex = 0;
 			scan->rs_inited = true;
 		}
@@ -951,7 +1097,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 		}
 		else
 		{
@@ -990,7 +1136,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 
 		page = ItemPointerGetBlockNumber(&(tuple->t_self));
 		if (page != scan->rs_cblock)
-			heapgetpage((TableScanDesc) scan, page);
+			heapgetpage_internal(scan, page, dir);
 
 		/* Since the tuple was previously fetched, needn't lock page here */
 		dp = BufferGetPage(scan->rs_cbuf);
@@ -1110,6 +1256,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 		{
 			if (BufferIsValid(scan->rs_cbuf))
 				ReleaseBuffer(scan->rs_cbuf);
+			heap_scan_release_readbufs(scan);
 			scan->rs_cbuf = InvalidBuffer;
 			scan->rs_cblock = InvalidBlockNumber;
 			tuple->t_data = NULL;
@@ -1117,7 +1264,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
+		heapgetpage_internal(scan, page, dir);
 
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
@@ -1252,6 +1399,7 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_scan_release_readbufs(scan);
 
 	/*
 	 * reinitialize scan descriptor
@@ -1271,6 +1419,7 @@ heap_endscan(TableScanDesc sscan)
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_scan_release_readbufs(scan);
 
 	/*
 	 * decrement relation reference count and free scan descriptor storage
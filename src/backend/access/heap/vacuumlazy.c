@@ -56,6 +56,7 @@
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
+#include "storage/aio.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
@@ -63,6 +64,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/spccache.h"
 #include "utils/timestamp.h"
 
 
@@ -162,6 +164,10 @@ typedef struct LVRelState
 	BufferAccessStrategy bstrategy;
 	ParallelVacuumState *pvs;
 
+	/* Pinned buffers of pages prefetched by lazy_scan_prefetch, in order */
+	Buffer		prefetch_bufs[MAX_IO_COMBINE_LIMIT];
+	int			nprefetch_bufs;
+
 	/* rel's initial relfrozenxid and relminmxid */
 	TransactionId relfrozenxid;
 	MultiXactId relminmxid;
@@ -251,6 +257,11 @@ static BlockNumber lazy_scan_skip(LVRelState *vacrel, Buffer *vmbuffer,
 								  BlockNumber next_block,
 								  bool *next_unskippable_allvis,
 								  bool *skipping_current_range);
+static void lazy_scan_prefetch(LVRelState *vacrel, BlockNumber blkno,
+							   BlockNumber next_unskippable_block,
+							   bool skipping_current_range,
+							   BlockNumber *prefetch_blkno);
+static Buffer lazy_scan_read_buffer(LVRelState *vacrel, BlockNumber blkno);
 static bool lazy_scan_new_or_empty(LVRelState *vacrel, Buffer buf,
 								   BlockNumber blkno, Page page,
 								   bool sharelock, Buffer vmbuffer);
@@ -848,7 +859,8 @@ lazy_scan_heap(LVRelState *vacrel)
 				blkno,
 				next_unskippable_block,
 				next_failsafe_block = 0,
-				next_fsm_block_to_vacuum = 0;
+				next_fsm_block_to_vacuum = 0,
+				prefetch_blkno = 0;
 	VacDeadItems *dead_items = vacrel->dead_items;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		next_unskippable_allvis,
@@ -972,9 +984,13 @@ lazy_scan_heap(LVRelState *vacrel)
 		 */
 		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
 
+		/* With I/O workers, have the next pages read while we scan this one */
+		if (io_method != IOMETHOD_SYNC)
+			lazy_scan_prefetch(vacrel, blkno, next_unskippable_block,
+							   skipping_current_range, &prefetch_blkno);
+
 		/* Finished preparatory checks.  Actually scan the page. */
-		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vacrel->bstrategy);
+		buf = lazy_scan_read_buffer(vacrel, blkno);
 		page = BufferGetPage(buf);
 
 		/*
@@ -1239,6 +1255,9 @@ lazy_scan_heap(LVRelState *vacrel)
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
+	for (int i = 0; i < vacrel->nprefetch_bufs; i++)
+		ReleaseBuffer(vacrel->prefetch_bufs[i]);
+	vacrel->nprefetch_bufs = 0;
 
 	/* report that everything is now scanned */
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
@@ -1384,6 +1403,97 @@ lazy_scan_skip(LVRelState *vacrel, Buffer *vmbuffer, BlockNumber next_block,
 	return next_unskippable_block;
 }
 
+/*
+ *	lazy_scan_prefetch() -- start reading the pages lazy_scan_heap() will
+ *	scan after blkno.
+ *
+ * The pages after blkno up to next_unskippable_block are scanned, unless the
+ * current range is skipped; beyond that, we don't know yet.  Their reads are
+ * handed to I/O workers with StartReadBuffers(), and we keep the buffers
+ * pinned in vacrel->prefetch_bufs until lazy_scan_read_buffer() gets to them.
+ * That way each page is read, and charged to the vacuum cost balance, just
+ * once.  *prefetch_blkno tracks the first block not prefetched yet.
+ *
+ * We stay at most maintenance_io_concurrency pages ahead, and no more than
+ * one combined read, so that the pages read aren't evicted again from our
+ * buffer access strategy's ring before we get to them.
+ */
+static void
+lazy_scan_prefetch(LVRelState *vacrel, BlockNumber blkno,
+				   BlockNumber next_unskippable_block,
+				   bool skipping_current_range,
+				   BlockNumber *prefetch_blkno)
+{
+	BlockNumber distance,
+				start,
+				end;
+
+	distance = get_tablespace_maintenance_io_concurrency(vacrel->rel->rd_rel->reltablespace);
+	distance = Min(distance, io_combine_limit);
+
+	/* Wait until we've used up half of what we prefetched */
+	if (distance == 0 || *prefetch_blkno > blkno + distance / 2)
+		return;
+
+	start = Max(*prefetch_blkno, blkno + 1);
+	if (skipping_current_range)
+		start = Max(start, next_unskippable_block);
+	end = Min(blkno + distance, next_unskippable_block);
+	end = Min(end, vacrel->rel_pages - 1);
+	/* the page about to be scanned may still take up a slot */
+	end = Min(end, start + (MAX_IO_COMBINE_LIMIT - vacrel->nprefetch_bufs) - 1);
+	if (start > end)
+		return;
+
+	*prefetch_blkno = end + 1;
+
+	while (start <= end)
+	{
+		int			nblocks = Min(end - start + 1, io_combine_limit);
+
+		StartReadBuffers(vacrel->rel, MAIN_FORKNUM, start, nblocks,
+						 vacrel->bstrategy,
+						 vacrel->prefetch_bufs + vacrel->nprefetch_bufs);
+		vacrel->nprefetch_bufs += nblocks;
+
+		start += nblocks;
+	}
+}
+
+/*
+ *	lazy_scan_read_buffer() -- read and pin page blkno for lazy_scan_heap().
+ *
+ * Uses the buffer pinned by lazy_scan_prefetch(), if the page was prefetched.
+ * Prefetched pages before blkno, which turned out not to be scanned after
+ * all, are released.
+ */
+static Buffer
+lazy_scan_read_buffer(LVRelState *vacrel, BlockNumber blkno)
+{
+	while (vacrel->nprefetch_bufs > 0)
+	{
+		Buffer		buf = vacrel->prefetch_bufs[0];
+		BlockNumber prefetched = BufferGetBlockNumber(buf);
+
+		if (prefetched > blkno)
+			break;
+
+		vacrel->nprefetch_bufs--;
+		memmove(vacrel->prefetch_bufs, vacrel->prefetch_bufs + 1,
+				vacrel->nprefetch_bufs * sizeof(Buffer));
+
+		if (prefetched == blkno)
+		{
+			WaitReadBuffer(buf);
+			return buf;
+		}
+		ReleaseBuffer(buf);
+	}
+
+	return ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
+							  RBM_NORMAL, vacrel->bstrategy);
+}
+
 /*
  *	lazy_scan_new_or_empty() -- lazy_scan_heap() new/empty page handling.
  *
@@ -89,6 +89,7 @@
 #include "access/xlogutils.h"
 #include "catalog/pg_type.h"
 #include "catalog/storage.h"
+#include "executor/nodeSubplan.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
@@ -1566,8 +1567,18 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 									   abortstats,
 									   gid);
 
+	/*
+	 * We don't know which tables the prepared transaction changed, so cached
+	 * subplan results must assume all of them did.
+	 */
+	if (isCommit)
+		SubPlanCacheBeginCommit(true);
+
 	ProcArrayRemove(proc, latestXid);
 
+	if (isCommit)
+		SubPlanCacheEndCommit();
+
 	/*
 	 * In case we fail while running the callbacks, mark the gxact invalid so
 	 * no one else will try to commit/rollback, and so it will be recycled if
@@ -39,6 +39,7 @@
 #include "commands/tablecmds.h"
 #include "commands/trigger.h"
 #include "common/pg_prng.h"
+#include "executor/nodeSubplan.h"
 #include "executor/spi.h"
 #include "libpq/be-fsstubs.h"
 #include "libpq/pqsignal.h"
@@ -2272,6 +2273,13 @@ CommitTransaction(void)
 
 	TRACE_POSTGRESQL_TRANSACTION_COMMIT(MyProc->lxid);
 
+	/*
+	 * Tell cached subplan results that the tables we changed are about to
+	 * change for others, while we still hold their locks.
+	 */
+	if (TransactionIdIsValid(latestXid))
+		SubPlanCacheBeginCommit(false);
+
 	/*
 	 * Let others know about no transaction in progress by me. Note that this
 	 * must be done _before_ releasing locks we hold and _after_
@@ -2279,6 +2287,9 @@ CommitTransaction(void)
 	 */
 	ProcArrayEndTransaction(MyProc, latestXid);
 
+	if (TransactionIdIsValid(latestXid))
+		SubPlanCacheEndCommit();
+
 	/*
 	 * This is all post-commit cleanup.  Note that if an error is raised here,
 	 * it's too late to abort the transaction.  This should be just
@@ -128,6 +128,9 @@ ExecReScan(PlanState *node)
 	if (node->ps_ExprContext)
 		ReScanExprContext(node->ps_ExprContext);
 
+	/* Allow fetching batches again */
+	node->ps_BatchDone = false;
+
 	/* And do node-type-specific processing */
 	switch (nodeTag(node))
 	{
@@ -0,0 +1,156 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Support routines for batch-at-a-time execution.
+ *
+ * A node that consumes all of its input anyway (currently plain and hashed
+ * Agg) may pull it through ExecProcNodeBatch() instead of ExecProcNode().
+ * That amortizes the per-tuple dispatch through the plan tree: a scan with
+ * a native batch implementation fetches, qualifies and projects up to
+ * executor_batch_size rows in a tight loop before returning to its parent.
+ * The batch size is fixed when the EState is created, so a node never gets
+ * a bigger batch from its child than its own.
+ *
+ * Every node supports the batch protocol.  Nodes without a native
+ * implementation get ExecProcNodeBatchDefault(), which collects the rows of
+ * ExecProcNode() into a batch, so batching is transparent to them.
+ *
+ * Since rows are fetched ahead of their consumption, batches must only be
+ * requested by nodes that will read their input to the end.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/execBatch.h"
+#include "miscadmin.h"
+
+/* GUC variable */
+int			executor_batch_size = 64;
+
+
+/* ----------------------------------------------------------------
+ *		ExecInitTupleBatch
+ *
+ *		Create a batch of es_batch_size slots of the given type.
+ *		The slots are registered in the estate's tuple table, so that
+ *		any buffer pins they hold are released at executor shutdown.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecInitTupleBatch(EState *estate, TupleDesc desc,
+				   const TupleTableSlotOps *tts_ops)
+{
+	MemoryContext oldcontext;
+	TupleBatch *batch;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	batch = palloc(sizeof(TupleBatch));
+	batch->maxrows = estate->es_batch_size;
+	batch->nrows = 0;
+	batch->slots = palloc(sizeof(TupleTableSlot *) * batch->maxrows);
+
+	for (i = 0; i < batch->maxrows; i++)
+		batch->slots[i] = ExecAllocTableSlot(&estate->es_tupleTable, desc,
+											 tts_ops);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return batch;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecClearTupleBatch
+ *
+ *		Empty all slots of the batch, releasing any buffer pins.
+ * ----------------------------------------------------------------
+ */
+void
+ExecClearTupleBatch(TupleBatch *batch)
+{
+	int			i;
+
+	for (i = 0; i < batch->maxrows; i++)
+		ExecClearTuple(batch->slots[i]);
+	batch->nrows = 0;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecGetResultBatch
+ *
+ *		Return the node's result batch, creating it on first use.  Its
+ *		slots have the node's result type and slot type, so a parent's
+ *		expressions compiled for the latter work on every row of a batch.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecGetResultBatch(PlanState *planstate)
+{
+	if (planstate->ps_ResultBatch == NULL)
+		planstate->ps_ResultBatch =
+			ExecInitTupleBatch(planstate->state,
+							   ExecGetResultType(planstate),
+							   ExecGetResultSlotOps(planstate, NULL));
+
+	return planstate->ps_ResultBatch;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSupportsBatch
+ *
+ *		Does the node have a native batch method?  Consumers use this to
+ *		decide whether batching pays off: ExecProcNodeBatchDefault() only
+ *		adds the cost of copying every tuple.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSupportsBatch(PlanState *node)
+{
+	return node->state->es_batch_size > 1 &&
+		node->ExecProcNodeBatchReal != ExecProcNodeBatchDefault;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatchDefault
+ *
+ *		Batch method of nodes that only produce single tuples.  Each
+ *		tuple is copied into the result batch, as the node is free to
+ *		reuse its result slot for the next one.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecProcNodeBatchDefault(PlanState *node)
+{
+	TupleBatch *batch;
+
+	/* Some nodes restart from the beginning if called after the end */
+	if (node->ps_BatchDone)
+		return NULL;
+
+	batch = ExecGetResultBatch(node);
+	batch->nrows = 0;
+
+	while (batch->nrows < batch->maxrows)
+	{
+		TupleTableSlot *slot = ExecProcNode(node);
+
+		if (TupIsNull(slot))
+		{
+			node->ps_BatchDone = true;
+			break;
+		}
+
+		ExecCopySlot(batch->slots[batch->nrows++], slot);
+	}
+
+	return batch->nrows > 0 ? batch : NULL;
+}
@@ -41,6 +41,7 @@
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/subscripting.h"
+#include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "utils/acl.h"
@@ -282,6 +283,277 @@ ExecInitQual(List *qual, PlanState *parent)
 	return state;
 }
 
+/* workspace of ExecReadyVectorQual() */
+typedef struct ExprVecBuildState
+{
+	ExprVecProgram *prog;
+	int			steps_alloc;
+	int			regs_alloc;
+	Datum	   *regconst;		/* value of constant registers */
+	bool	   *regisconst;
+} ExprVecBuildState;
+
+static int	ExecVecAllocReg(ExprVecBuildState *vb);
+static ExprVecStep *ExecVecPushStep(ExprVecBuildState *vb, ExprVecOp op);
+static int	ExecVecCompileExpr(ExprVecBuildState *vb, Expr *node);
+
+/*
+ * ExecReadyVectorQual: prepare a qual for ExecVectorQual()
+ *
+ * The qual must have been built by ExecInitQual() and is going to be
+ * evaluated for batches of up to maxrows scan tuples.  Conjuncts are
+ * compiled into a vector program from the first one on, until one is found
+ * that cannot be; that one and the following ones are left to a residual
+ * qual, so that conjuncts are still evaluated in their original order.
+ *
+ * If not even the first conjunct can be vectorized, state->vecprog is left
+ * NULL and the qual has to be evaluated with ExecQual() as usual.  The
+ * program is allocated in the current memory context, which should be the
+ * one the qual lives in.
+ */
+void
+ExecReadyVectorQual(ExprState *state, int maxrows)
+{
+	ExprVecBuildState vb;
+	ExprVecProgram *prog;
+	List	   *qual = (List *) state->expr;
+	List	   *residual;
+	ListCell   *lc;
+	int			nconjuncts = 0;
+	int			reg;
+
+	Assert(state->flags & EEO_FLAG_IS_QUAL);
+
+	if (state->flags & EEO_FLAG_VECTOR_INITIALIZED)
+		return;
+	state->flags |= EEO_FLAG_VECTOR_INITIALIZED;
+
+	Assert(IsA(qual, List));
+
+	prog = palloc0(sizeof(ExprVecProgram));
+	prog->maxrows = maxrows;
+
+	vb.prog = prog;
+	vb.steps_alloc = 16;
+	vb.regs_alloc = 16;
+	prog->steps = palloc(sizeof(ExprVecStep) * vb.steps_alloc);
+	vb.regconst = palloc(sizeof(Datum) * vb.regs_alloc);
+	vb.regisconst = palloc(sizeof(bool) * vb.regs_alloc);
+
+	foreach(lc, qual)
+	{
+		int			saved_nsteps = prog->nsteps;
+		int			saved_nregs = prog->nregs;
+		ExprVecStep *step;
+
+		reg = ExecVecCompileExpr(&vb, (Expr *) lfirst(lc));
+		if (reg < 0)
+		{
+			/* forget about the partially compiled conjunct */
+			prog->nsteps = saved_nsteps;
+			prog->nregs = saved_nregs;
+			break;
+		}
+
+		step = ExecVecPushStep(&vb, EEVOP_QUAL);
+		step->argreg[0] = reg;
+		nconjuncts++;
+	}
+
+	residual = list_copy_tail(qual, nconjuncts);
+
+	/*
+	 * Compiling the residual qual must not initialize subplans a second
+	 * time, so such quals are not vectorized at all.
+	 */
+	if (nconjuncts == 0 || contain_subplans((Node *) residual))
+	{
+		pfree(prog->steps);
+		pfree(prog);
+		pfree(vb.regconst);
+		pfree(vb.regisconst);
+		list_free(residual);
+		return;
+	}
+
+	prog->residual = ExecInitQual(residual, state->parent);
+
+	/* allocate the registers, and fill in the constant ones */
+	prog->values = palloc(sizeof(Datum *) * prog->nregs);
+	prog->nulls = palloc(sizeof(bool *) * prog->nregs);
+	for (reg = 0; reg < prog->nregs; reg++)
+	{
+		int			i;
+
+		prog->values[reg] = palloc(sizeof(Datum) * maxrows);
+		prog->nulls[reg] = palloc0(sizeof(bool) * maxrows);
+
+		if (vb.regisconst[reg])
+		{
+			for (i = 0; i < maxrows; i++)
+				prog->values[reg][i] = vb.regconst[reg];
+		}
+	}
+	prog->sel = palloc(sizeof(int) * maxrows);
+
+	pfree(vb.regconst);
+	pfree(vb.regisconst);
+
+	state->vecprog = prog;
+}
+
+/*
+ * Allocate a register of the vector program being built.
+ */
+static int
+ExecVecAllocReg(ExprVecBuildState *vb)
+{
+	ExprVecProgram *prog = vb->prog;
+
+	if (prog->nregs >= vb->regs_alloc)
+	{
+		vb->regs_alloc *= 2;
+		vb->regconst = repalloc(vb->regconst, sizeof(Datum) * vb->regs_alloc);
+		vb->regisconst = repalloc(vb->regisconst,
+								  sizeof(bool) * vb->regs_alloc);
+	}
+
+	vb->regconst[prog->nregs] = (Datum) 0;
+	vb->regisconst[prog->nregs] = false;
+
+	return prog->nregs++;
+}
+
+/*
+ * Append a step to the vector program being built.
+ */
+static ExprVecStep *
+ExecVecPushStep(ExprVecBuildState *vb, ExprVecOp op)
+{
+	ExprVecProgram *prog = vb->prog;
+	ExprVecStep *step;
+
+	if (prog->nsteps >= vb->steps_alloc)
+	{
+		vb->steps_alloc *= 2;
+		prog->steps = repalloc(prog->steps,
+							   sizeof(ExprVecStep) * vb->steps_alloc);
+	}
+
+	step = &prog->steps[prog->nsteps++];
+	memset(step, 0, sizeof(ExprVecStep));
+	step->op = op;
+
+	return step;
+}
+
+/*
+ * Append the steps computing node to the vector program being built, and
+ * return the register holding its value.  Returns -1 if node cannot be
+ * vectorized.
+ */
+static int
+ExecVecCompileExpr(ExprVecBuildState *vb, Expr *node)
+{
+	ExprVecProgram *prog = vb->prog;
+	ExprVecStep *step;
+	ExprVecKernel kernel;
+	List	   *args;
+	Oid			funcid;
+	int			argreg[2];
+	int			i;
+
+	check_stack_depth();
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			{
+				Var		   *var = (Var *) node;
+
+				/* only user attributes of the scan tuple */
+				if (var->varno == INNER_VAR || var->varno == OUTER_VAR ||
+					var->varattno <= 0)
+					return -1;
+
+				/* every attribute is fetched once, at its first use */
+				for (i = 0; i < prog->nsteps; i++)
+				{
+					if (prog->steps[i].op == EEVOP_SCAN_VAR &&
+						prog->steps[i].attnum == var->varattno)
+						return prog->steps[i].resreg;
+				}
+
+				step = ExecVecPushStep(vb, EEVOP_SCAN_VAR);
+				step->attnum = var->varattno;
+				step->resreg = ExecVecAllocReg(vb);
+				return step->resreg;
+			}
+
+		case T_Const:
+			{
+				Const	   *con = (Const *) node;
+				int			reg;
+
+				if (con->constisnull || !con->constbyval)
+					return -1;
+
+				reg = ExecVecAllocReg(vb);
+				vb->regconst[reg] = con->constvalue;
+				vb->regisconst[reg] = true;
+				return reg;
+			}
+
+		case T_RelabelType:
+			/* binary-compatible, so the argument's values will do */
+			return ExecVecCompileExpr(vb, ((RelabelType *) node)->arg);
+
+		case T_OpExpr:
+			{
+				OpExpr	   *op = (OpExpr *) node;
+
+				set_opfuncid(op);
+				funcid = op->opfuncid;
+				args = op->args;
+				break;
+			}
+
+		case T_FuncExpr:
+			{
+				FuncExpr   *func = (FuncExpr *) node;
+
+				if (func->funcretset)
+					return -1;
+				funcid = func->funcid;
+				args = func->args;
+				break;
+			}
+
+		default:
+			return -1;
+	}
+
+	/* all kernels implement strict functions of two arguments */
+	kernel = ExecVectorKernel(funcid);
+	if (kernel == NULL || list_length(args) != 2)
+		return -1;
+
+	for (i = 0; i < 2; i++)
+	{
+		argreg[i] = ExecVecCompileExpr(vb, (Expr *) list_nth(args, i));
+		if (argreg[i] < 0)
+			return -1;
+	}
+
+	step = ExecVecPushStep(vb, EEVOP_FUNC);
+	step->kernel = kernel;
+	step->argreg[0] = argreg[0];
+	step->argreg[1] = argreg[1];
+	step->resreg = ExecVecAllocReg(vb);
+
+	return step->resreg;
+}
+
 /*
  * ExecInitCheck: prepare a check constraint for execution by ExecCheck
  *
@@ -59,6 +59,7 @@
 #include "access/heaptoast.h"
 #include "catalog/pg_type.h"
 #include "commands/sequence.h"
+#include "common/int.h"
 #include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
@@ -71,6 +72,8 @@
 #include "utils/date.h"
 #include "utils/datum.h"
 #include "utils/expandedrecord.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/timestamp.h"
@@ -4400,3 +4403,362 @@ ExecAggPlainTransByRef(AggState *aggstate, AggStatePerTrans pertrans,
 
 	MemoryContextSwitchTo(oldContext);
 }
+
+
+/*
+ * Vectorized qual evaluation
+ *
+ * The kernels below evaluate a strict two-argument function over a batch of
+ * rows.  The dense variant (no selection vector) is a straight loop over
+ * arrays without calls or data-dependent branches, which compilers turn into
+ * SIMD code.  Overflow checks of the integer arithmetic kernels are folded
+ * into a flag that is tested once per batch; rows with a null argument never
+ * raise an error, as the function would not have been called for them.
+ */
+
+#define VEC_LT(x, y) ((x) < (y))
+#define VEC_LE(x, y) ((x) <= (y))
+#define VEC_GT(x, y) ((x) > (y))
+#define VEC_GE(x, y) ((x) >= (y))
+#define VEC_EQ(x, y) ((x) == (y))
+#define VEC_NE(x, y) ((x) != (y))
+
+/* r = a <cmp> b, for types with a C comparison */
+#define VEC_CMP_KERNEL(name, aget, bget, cmp) \
+static void \
+name(int n, const int *sel, \
+	 const Datum *a, const bool *anull, \
+	 const Datum *b, const bool *bnull, \
+	 Datum *r, bool *rnull) \
+{ \
+	int			i, \
+				k; \
+\
+	if (sel == NULL) \
+	{ \
+		for (i = 0; i < n; i++) \
+		{ \
+			r[i] = BoolGetDatum(cmp(aget(a[i]), bget(b[i]))); \
+			rnull[i] = anull[i] | bnull[i]; \
+		} \
+	} \
+	else \
+	{ \
+		for (k = 0; k < n; k++) \
+		{ \
+			i = sel[k]; \
+			r[i] = BoolGetDatum(cmp(aget(a[i]), bget(b[i]))); \
+			rnull[i] = anull[i] | bnull[i]; \
+		} \
+	} \
+}
+
+/* r = a <op> b for integers, erroring out on overflow like the function */
+#define VEC_INT_ARITH_KERNEL(name, ctype, aget, bget, rset, overflowfn, msg) \
+static void \
+name(int n, const int *sel, \
+	 const Datum *a, const bool *anull, \
+	 const Datum *b, const bool *bnull, \
+	 Datum *r, bool *rnull) \
+{ \
+	int			i, \
+				k; \
+	bool		overflow = false; \
+\
+	if (sel == NULL) \
+	{ \
+		for (i = 0; i < n; i++) \
+		{ \
+			ctype		res; \
+\
+			rnull[i] = anull[i] | bnull[i]; \
+			overflow |= overflowfn(aget(a[i]), bget(b[i]), &res) & !rnull[i]; \
+			r[i] = rset(res); \
+		} \
+	} \
+	else \
+	{ \
+		for (k = 0; k < n; k++) \
+		{ \
+			ctype		res; \
+\
+			i = sel[k]; \
+			rnull[i] = anull[i] | bnull[i]; \
+			overflow |= overflowfn(aget(a[i]), bget(b[i]), &res) & !rnull[i]; \
+			r[i] = rset(res); \
+		} \
+	} \
+\
+	if (unlikely(overflow)) \
+		ereport(ERROR, \
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE), \
+				 errmsg(msg))); \
+}
+
+/*
+ * r = a <op> b for float8, using the checked operators of float.h.  These
+ * may raise an error, so rows with a null argument have to be skipped.
+ */
+#define VEC_FLOAT8_ARITH_KERNEL(name, opfn) \
+static void \
+name(int n, const int *sel, \
+	 const Datum *a, const bool *anull, \
+	 const Datum *b, const bool *bnull, \
+	 Datum *r, bool *rnull) \
+{ \
+	int			i, \
+				k; \
+\
+	for (k = 0; k < n; k++) \
+	{ \
+		i = sel ? sel[k] : k; \
+		rnull[i] = anull[i] | bnull[i]; \
+		r[i] = rnull[i] ? (Datum) 0 : \
+			Float8GetDatum(opfn(DatumGetFloat8(a[i]), DatumGetFloat8(b[i]))); \
+	} \
+}
+
+VEC_CMP_KERNEL(vec_int4lt, DatumGetInt32, DatumGetInt32, VEC_LT)
+VEC_CMP_KERNEL(vec_int4le, DatumGetInt32, DatumGetInt32, VEC_LE)
+VEC_CMP_KERNEL(vec_int4gt, DatumGetInt32, DatumGetInt32, VEC_GT)
+VEC_CMP_KERNEL(vec_int4ge, DatumGetInt32, DatumGetInt32, VEC_GE)
+VEC_CMP_KERNEL(vec_int4eq, DatumGetInt32, DatumGetInt32, VEC_EQ)
+VEC_CMP_KERNEL(vec_int4ne, DatumGetInt32, DatumGetInt32, VEC_NE)
+
+VEC_CMP_KERNEL(vec_date_lt, DatumGetDateADT, DatumGetDateADT, VEC_LT)
+VEC_CMP_KERNEL(vec_date_le, DatumGetDateADT, DatumGetDateADT, VEC_LE)
+VEC_CMP_KERNEL(vec_date_gt, DatumGetDateADT, DatumGetDateADT, VEC_GT)
+VEC_CMP_KERNEL(vec_date_ge, DatumGetDateADT, DatumGetDateADT, VEC_GE)
+VEC_CMP_KERNEL(vec_date_eq, DatumGetDateADT, DatumGetDateADT, VEC_EQ)
+VEC_CMP_KERNEL(vec_date_ne, DatumGetDateADT, DatumGetDateADT, VEC_NE)
+
+VEC_INT_ARITH_KERNEL(vec_int4pl, int32, DatumGetInt32, DatumGetInt32,
+					 Int32GetDatum, pg_add_s32_overflow, "integer out of range")
+VEC_INT_ARITH_KERNEL(vec_int4mi, int32, DatumGetInt32, DatumGetInt32,
+					 Int32GetDatum, pg_sub_s32_overflow, "integer out of range")
+VEC_INT_ARITH_KERNEL(vec_int4mul, int32, DatumGetInt32, DatumGetInt32,
+					 Int32GetDatum, pg_mul_s32_overflow, "integer out of range")
+
+/* int8 and float8 Datums are only directly usable if passed by value */
+#ifdef USE_FLOAT8_BYVAL
+VEC_CMP_KERNEL(vec_int8lt, DatumGetInt64, DatumGetInt64, VEC_LT)
+VEC_CMP_KERNEL(vec_int8le, DatumGetInt64, DatumGetInt64, VEC_LE)
+VEC_CMP_KERNEL(vec_int8gt, DatumGetInt64, DatumGetInt64, VEC_GT)
+VEC_CMP_KERNEL(vec_int8ge, DatumGetInt64, DatumGetInt64, VEC_GE)
+VEC_CMP_KERNEL(vec_int8eq, DatumGetInt64, DatumGetInt64, VEC_EQ)
+VEC_CMP_KERNEL(vec_int8ne, DatumGetInt64, DatumGetInt64, VEC_NE)
+
+VEC_CMP_KERNEL(vec_int84lt, DatumGetInt64, DatumGetInt32, VEC_LT)
+VEC_CMP_KERNEL(vec_int84le, DatumGetInt64, DatumGetInt32, VEC_LE)
+VEC_CMP_KERNEL(vec_int84gt, DatumGetInt64, DatumGetInt32, VEC_GT)
+VEC_CMP_KERNEL(vec_int84ge, DatumGetInt64, DatumGetInt32, VEC_GE)
+VEC_CMP_KERNEL(vec_int84eq, DatumGetInt64, DatumGetInt32, VEC_EQ)
+VEC_CMP_KERNEL(vec_int84ne, DatumGetInt64, DatumGetInt32, VEC_NE)
+
+VEC_CMP_KERNEL(vec_int48lt, DatumGetInt32, DatumGetInt64, VEC_LT)
+VEC_CMP_KERNEL(vec_int48le, DatumGetInt32, DatumGetInt64, VEC_LE)
+VEC_CMP_KERNEL(vec_int48gt, DatumGetInt32, DatumGetInt64, VEC_GT)
+VEC_CMP_KERNEL(vec_int48ge, DatumGetInt32, DatumGetInt64, VEC_GE)
+VEC_CMP_KERNEL(vec_int48eq, DatumGetInt32, DatumGetInt64, VEC_EQ)
+VEC_CMP_KERNEL(vec_int48ne, DatumGetInt32, DatumGetInt64, VEC_NE)
+
+/* float8_lt() and friends sort NaNs above all other values */
+VEC_CMP_KERNEL(vec_float8lt, DatumGetFloat8, DatumGetFloat8, float8_lt)
+VEC_CMP_KERNEL(vec_float8le, DatumGetFloat8, DatumGetFloat8, float8_le)
+VEC_CMP_KERNEL(vec_float8gt, DatumGetFloat8, DatumGetFloat8, float8_gt)
+VEC_CMP_KERNEL(vec_float8ge, DatumGetFloat8, DatumGetFloat8, float8_ge)
+VEC_CMP_KERNEL(vec_float8eq, DatumGetFloat8, DatumGetFloat8, float8_eq)
+VEC_CMP_KERNEL(vec_float8ne, DatumGetFloat8, DatumGetFloat8, float8_ne)
+
+VEC_INT_ARITH_KERNEL(vec_int8pl, int64, DatumGetInt64, DatumGetInt64,
+					 Int64GetDatum, pg_add_s64_overflow, "bigint out of range")
+VEC_INT_ARITH_KERNEL(vec_int8mi, int64, DatumGetInt64, DatumGetInt64,
+					 Int64GetDatum, pg_sub_s64_overflow, "bigint out of range")
+VEC_INT_ARITH_KERNEL(vec_int8mul, int64, DatumGetInt64, DatumGetInt64,
+					 Int64GetDatum, pg_mul_s64_overflow, "bigint out of range")
+
+VEC_FLOAT8_ARITH_KERNEL(vec_float8pl, float8_pl)
+VEC_FLOAT8_ARITH_KERNEL(vec_float8mi, float8_mi)
+VEC_FLOAT8_ARITH_KERNEL(vec_float8mul, float8_mul)
+#endif							/* USE_FLOAT8_BYVAL */
+
+static const struct
+{
+	Oid			funcid;
+	ExprVecKernel kernel;
+}			vec_kernels[] =
+{
+	{F_INT4LT, vec_int4lt},
+	{F_INT4LE, vec_int4le},
+	{F_INT4GT, vec_int4gt},
+	{F_INT4GE, vec_int4ge},
+	{F_INT4EQ, vec_int4eq},
+	{F_INT4NE, vec_int4ne},
+	{F_DATE_LT, vec_date_lt},
+	{F_DATE_LE, vec_date_le},
+	{F_DATE_GT, vec_date_gt},
+	{F_DATE_GE, vec_date_ge},
+	{F_DATE_EQ, vec_date_eq},
+	{F_DATE_NE, vec_date_ne},
+	{F_INT4PL, vec_int4pl},
+	{F_INT4MI, vec_int4mi},
+	{F_INT4MUL, vec_int4mul},
+#ifdef USE_FLOAT8_BYVAL
+	{F_INT8LT, vec_int8lt},
+	{F_INT8LE, vec_int8le},
+	{F_INT8GT, vec_int8gt},
+	{F_INT8GE, vec_int8ge},
+	{F_INT8EQ, vec_int8eq},
+	{F_INT8NE, vec_int8ne},
+	{F_INT84LT, vec_int84lt},
+	{F_INT84LE, vec_int84le},
+	{F_INT84GT, vec_int84gt},
+	{F_INT84GE, vec_int84ge},
+	{F_INT84EQ, vec_int84eq},
+	{F_INT84NE, vec_int84ne},
+	{F_INT48LT, vec_int48lt},
+	{F_INT48LE, vec_int48le},
+	{F_INT48GT, vec_int48gt},
+	{F_INT48GE, vec_int48ge},
+	{F_INT48EQ, vec_int48eq},
+	{F_INT48NE, vec_int48ne},
+	{F_FLOAT8LT, vec_float8lt},
+	{F_FLOAT8LE, vec_float8le},
+	{F_FLOAT8GT, vec_float8gt},
+	{F_FLOAT8GE, vec_float8ge},
+	{F_FLOAT8EQ, vec_float8eq},
+	{F_FLOAT8NE, vec_float8ne},
+	{F_INT8PL, vec_int8pl},
+	{F_INT8MI, vec_int8mi},
+	{F_INT8MUL, vec_int8mul},
+	{F_FLOAT8PL, vec_float8pl},
+	{F_FLOAT8MI, vec_float8mi},
+	{F_FLOAT8MUL, vec_float8mul},
+#endif
+};
+
+/*
+ * Return the vector kernel implementing the function with OID funcid, or
+ * NULL if there is none.
+ */
+ExprVecKernel
+ExecVectorKernel(Oid funcid)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(vec_kernels); i++)
+	{
+		if (vec_kernels[i].funcid == funcid)
+			return vec_kernels[i].kernel;
+	}
+
+	return NULL;
+}
+
+/*
+ * ExecVectorQual - evaluate a qual for a batch of scan tuples
+ *
+ * The qual must have been prepared by ExecReadyVectorQual() and have a
+ * vector program.  Returns the number of rows of slots[0 .. nrows-1] that
+ * satisfy the qual and sets *sel to their indexes in ascending order, or to
+ * NULL if all rows do.  The selection vector is valid until the next call.
+ *
+ * Like ExecQual(), this may leave data in the per-tuple memory context; all
+ * rows of a batch share it.
+ */
+int
+ExecVectorQual(ExprState *state, ExprContext *econtext,
+			   TupleTableSlot **slots, int nrows, const int **sel)
+{
+	ExprVecProgram *prog = state->vecprog;
+	int		   *cursel = NULL;	/* NULL means rows 0 .. nrows-1 */
+	int			nsel = nrows;
+	int			stepno;
+	int			i,
+				k;
+
+	Assert(prog != NULL);
+	Assert(nrows <= prog->maxrows);
+
+	for (stepno = 0; stepno < prog->nsteps && nsel > 0; stepno++)
+	{
+		ExprVecStep *step = &prog->steps[stepno];
+
+		switch (step->op)
+		{
+			case EEVOP_SCAN_VAR:
+				{
+					Datum	   *values = prog->values[step->resreg];
+					bool	   *nulls = prog->nulls[step->resreg];
+					int			attnum = step->attnum;
+
+					for (k = 0; k < nsel; k++)
+					{
+						TupleTableSlot *slot;
+
+						i = cursel ? cursel[k] : k;
+						slot = slots[i];
+
+						slot_getsomeattrs(slot, attnum);
+						values[i] = slot->tts_values[attnum - 1];
+						nulls[i] = slot->tts_isnull[attnum - 1];
+					}
+					break;
+				}
+
+			case EEVOP_FUNC:
+				step->kernel(nsel, cursel,
+							 prog->values[step->argreg[0]],
+							 prog->nulls[step->argreg[0]],
+							 prog->values[step->argreg[1]],
+							 prog->nulls[step->argreg[1]],
+							 prog->values[step->resreg],
+							 prog->nulls[step->resreg]);
+				break;
+
+			case EEVOP_QUAL:
+				{
+					Datum	   *values = prog->values[step->argreg[0]];
+					bool	   *nulls = prog->nulls[step->argreg[0]];
+					int			nqual = 0;
+
+					/*
+					 * Compact the selection in place, without branching on
+					 * the result: a rejected row is overwritten by the next
+					 * one.
+					 */
+					for (k = 0; k < nsel; k++)
+					{
+						i = cursel ? cursel[k] : k;
+						prog->sel[nqual] = i;
+						nqual += !nulls[i] & DatumGetBool(values[i]);
+					}
+
+					cursel = prog->sel;
+					nsel = nqual;
+					break;
+				}
+		}
+	}
+
+	/* the remaining conjuncts are evaluated one row at a time */
+	if (prog->residual != NULL && nsel > 0)
+	{
+		int			nqual = 0;
+
+		for (k = 0; k < nsel; k++)
+		{
+			i = cursel ? cursel[k] : k;
+			econtext->ecxt_scantuple = slots[i];
+			prog->sel[nqual] = i;
+			nqual += ExecQual(prog->residual, econtext);
+		}
+
+		cursel = prog->sel;
+		nsel = nqual;
+	}
+
+	*sel = nsel == nrows ? NULL : cursel;
+
+	return nsel;
+}
@@ -18,8 +18,63 @@
 #include "common/hashfn.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/uuid.h"
+
+/*
+ * If every key column has one of the fixed-width types below, whose
+ * equality is the same as binary equality, the key columns of each entry
+ * are also stored packed in front of its firstTuple.  Probes then pack the
+ * key of the input tuple once, compute its hash value without calling the
+ * hash functions through fmgr, and compare keys with memcmp() instead of
+ * running the equality expression on the deformed entry tuple.
+ *
+ * The hash values are the same as those of the datatype's hash functions,
+ * so tables with packed keys can still be probed with cross-type hash
+ * functions by FindTupleHashEntry().
+ */
+typedef enum TupleHashKeyKind
+{
+	TUPLEHASH_KEY_CHAR,			/* hashchar(): bool, "char" */
+	TUPLEHASH_KEY_INT16,		/* hashint2() */
+	TUPLEHASH_KEY_INT32,		/* hashint4(), hashoid(): int4, date, oid */
+	TUPLEHASH_KEY_INT64,		/* hashint8(): int8, time, timestamp(tz) */
+	TUPLEHASH_KEY_UUID			/* uuid_hash() */
+} TupleHashKeyKind;
+
+typedef struct TupleHashKeyCol
+{
+	TupleHashKeyKind kind;
+	int			len;			/* length of the packed column */
+	int			offset;			/* offset of the column in the packed key */
+} TupleHashKeyCol;
+
+static const struct
+{
+	Oid			hashfn;
+	Oid			eqfn;
+	TupleHashKeyKind kind;
+	int			len;
+}			fixed_width_keys[] =
+{
+	{F_HASHCHAR, F_BOOLEQ, TUPLEHASH_KEY_CHAR, 1},
+	{F_HASHCHAR, F_CHAREQ, TUPLEHASH_KEY_CHAR, 1},
+	{F_HASHINT2, F_INT2EQ, TUPLEHASH_KEY_INT16, 2},
+	{F_HASHINT4, F_INT4EQ, TUPLEHASH_KEY_INT32, 4},
+	{F_HASHINT4, F_DATE_EQ, TUPLEHASH_KEY_INT32, 4},
+	{F_HASHOID, F_OIDEQ, TUPLEHASH_KEY_INT32, 4},
+	{F_HASHINT8, F_INT8EQ, TUPLEHASH_KEY_INT64, 8},
+	{F_TIME_HASH, F_TIME_EQ, TUPLEHASH_KEY_INT64, 8},
+	{F_TIMESTAMP_HASH, F_TIMESTAMP_EQ, TUPLEHASH_KEY_INT64, 8},
+	{F_TIMESTAMP_HASH, F_TIMESTAMPTZ_EQ, TUPLEHASH_KEY_INT64, 8},
+	{F_UUID_HASH, F_UUID_EQ, TUPLEHASH_KEY_UUID, UUID_LEN}
+};
+
+/* the packed key of a table entry, stored in front of its firstTuple */
+#define TupleHashEntryKey(hashtable, tuple) \
+	((char *) (tuple) - MAXALIGN((hashtable)->keylen))
 
 static int	TupleHashTableMatch(struct tuplehash_hash *tb, const MinimalTuple tuple1, const MinimalTuple tuple2);
 static inline uint32 TupleHashTableHash_internal(struct tuplehash_hash *tb,
@@ -27,6 +82,13 @@ static inline uint32 TupleHashTableHash_internal(struct tuplehash_hash *tb,
 static inline TupleHashEntry LookupTupleHashEntry_internal(TupleHashTable hashtable,
 														   TupleTableSlot *slot,
 														   bool *isnew, uint32 hash);
+static void TupleHashSetupPackedKey(TupleHashTable hashtable,
+									TupleDesc inputDesc,
+									const Oid *eqfuncoids);
+static uint32 TupleHashPackInputKey(TupleHashTable hashtable,
+									TupleTableSlot *slot);
+static MinimalTuple TupleHashCopyEntryTuple(TupleHashTable hashtable,
+											TupleTableSlot *slot);
 
 /*
  * Define parameters for tuple hash table code generation. The interface is
@@ -207,6 +269,8 @@ BuildTupleHashTableExt(PlanState *parent,
 
 	hashtable->hashtab = tuplehash_create(metacxt, nbuckets, hashtable);
 
+	TupleHashSetupPackedKey(hashtable, inputDesc, eqfuncoids);
+
 	/*
 	 * We copy the input tuple descriptor just for safety --- we assume all
 	 * input tuples will have equivalent descriptors.
@@ -372,6 +436,10 @@ LookupTupleHashEntryHash(TupleHashTable hashtable, TupleTableSlot *slot,
 	hashtable->in_hash_funcs = hashtable->tab_hash_funcs;
 	hashtable->cur_eq_func = hashtable->tab_eq_func;
 
+	/* the match function needs the packed key, even without hashing */
+	if (hashtable->keylen > 0)
+		(void) TupleHashPackInputKey(hashtable, slot);
+
 	entry = LookupTupleHashEntry_internal(hashtable, slot, isnew, hash);
 	Assert(entry == NULL || entry->hash == hash);
 
@@ -434,6 +502,11 @@ TupleHashTableHash_internal(struct tuplehash_hash *tb,
 	FmgrInfo   *hashfunctions;
 	int			i;
 
+	/* Use the packed key if the table's own hash functions are in use */
+	if (tuple == NULL && hashtable->keylen > 0 &&
+		hashtable->in_hash_funcs == hashtable->tab_hash_funcs)
+		return TupleHashPackInputKey(hashtable, hashtable->inputslot);
+
 	if (tuple == NULL)
 	{
 		/* Process the current input tuple for the table */
@@ -519,7 +592,10 @@ LookupTupleHashEntry_internal(TupleHashTable hashtable, TupleTableSlot *slot,
 			entry->additional = NULL;
 			MemoryContextSwitchTo(hashtable->tablecxt);
 			/* Copy the first tuple into the table context */
-			entry->firstTuple = ExecCopySlotMinimalTuple(slot);
+			if (hashtable->keylen > 0)
+				entry->firstTuple = TupleHashCopyEntryTuple(hashtable, slot);
+			else
+				entry->firstTuple = ExecCopySlotMinimalTuple(slot);
 		}
 	}
 	else
@@ -548,9 +624,17 @@ TupleHashTableMatch(struct tuplehash_hash *tb, const MinimalTuple tuple1, const
 	 * could be supported too, but is not currently required.
 	 */
 	Assert(tuple1 != NULL);
+	Assert(tuple2 == NULL);
+
+	/* The input key was packed while computing its hash value */
+	if (hashtable->keylen > 0 &&
+		hashtable->cur_eq_func == hashtable->tab_eq_func &&
+		hashtable->in_hash_funcs == hashtable->tab_hash_funcs)
+		return memcmp(TupleHashEntryKey(hashtable, tuple1),
+					  hashtable->inputkey, hashtable->keylen);
+
 	slot1 = hashtable->tableslot;
 	ExecStoreMinimalTuple(tuple1, slot1, false);
-	Assert(tuple2 == NULL);
 	slot2 = hashtable->inputslot;
 
 	/* For crosstype comparisons, the inputslot must be first */
@@ -558,3 +642,179 @@ TupleHashTableMatch(struct tuplehash_hash *tb, const MinimalTuple tuple1, const
 	econtext->ecxt_outertuple = slot1;
 	return !ExecQualAndReset(hashtable->cur_eq_func, econtext);
 }
+
+/*
+ * Decide whether the table can use packed keys (see top of file), and set
+ * up the packing of each key column if so.  The null flags of all columns
+ * follow the packed values.
+ */
+static void
+TupleHashSetupPackedKey(TupleHashTable hashtable, TupleDesc inputDesc,
+						const Oid *eqfuncoids)
+{
+	TupleHashKeyCol *keycols;
+	int			offset = 0;
+	int			i;
+
+	hashtable->keylen = 0;
+	hashtable->keycols = NULL;
+	hashtable->inputkey = NULL;
+
+	if (hashtable->numCols == 0)
+		return;
+
+	keycols = palloc(sizeof(TupleHashKeyCol) * hashtable->numCols);
+
+	for (i = 0; i < hashtable->numCols; i++)
+	{
+		AttrNumber	att = hashtable->keyColIdx[i];
+		int			j;
+
+		for (j = 0; j < lengthof(fixed_width_keys); j++)
+		{
+			if (fixed_width_keys[j].hashfn == hashtable->tab_hash_funcs[i].fn_oid &&
+				fixed_width_keys[j].eqfn == eqfuncoids[i])
+				break;
+		}
+
+		if (j == lengthof(fixed_width_keys) ||
+			att <= 0 || att > inputDesc->natts ||
+			TupleDescAttr(inputDesc, att - 1)->attlen != fixed_width_keys[j].len)
+		{
+			pfree(keycols);
+			return;
+		}
+
+		keycols[i].kind = fixed_width_keys[j].kind;
+		keycols[i].len = fixed_width_keys[j].len;
+		keycols[i].offset = offset;
+		offset += keycols[i].len;
+	}
+
+	hashtable->keylen = offset + hashtable->numCols;
+	hashtable->keycols = keycols;
+	hashtable->inputkey = palloc(hashtable->keylen);
+}
+
+/*
+ * Pack the key columns of the given input tuple into hashtable->inputkey,
+ * and return its hash value.  The hash value is the same that
+ * TupleHashTableHash_internal() computes with the table's hash functions.
+ */
+static uint32
+TupleHashPackInputKey(TupleHashTable hashtable, TupleTableSlot *slot)
+{
+	char	   *key = hashtable->inputkey;
+	char	   *nulls = key + hashtable->keylen - hashtable->numCols;
+	uint32		hashkey = hashtable->hash_iv;
+	int			i;
+
+	for (i = 0; i < hashtable->numCols; i++)
+	{
+		TupleHashKeyCol *col = &hashtable->keycols[i];
+		char	   *dst = key + col->offset;
+		Datum		attr;
+		bool		isNull;
+		uint32		hkey;
+
+		/* combine successive hashkeys by rotating */
+		hashkey = pg_rotate_left32(hashkey, 1);
+
+		attr = slot_getattr(slot, hashtable->keyColIdx[i], &isNull);
+		nulls[i] = isNull;
+
+		if (isNull)
+		{
+			/* treat nulls as having hash key 0, and all-zero contents */
+			memset(dst, 0, col->len);
+			continue;
+		}
+
+		switch (col->kind)
+		{
+			case TUPLEHASH_KEY_CHAR:
+				{
+					char		val = DatumGetChar(attr);
+
+					*dst = val;
+					hkey = hash_bytes_uint32((int32) val);
+					break;
+				}
+			case TUPLEHASH_KEY_INT16:
+				{
+					int16		val = DatumGetInt16(attr);
+
+					memcpy(dst, &val, sizeof(val));
+					hkey = hash_bytes_uint32((int32) val);
+					break;
+				}
+			case TUPLEHASH_KEY_INT32:
+				{
+					int32		val = DatumGetInt32(attr);
+
+					memcpy(dst, &val, sizeof(val));
+					hkey = hash_bytes_uint32(val);
+					break;
+				}
+			case TUPLEHASH_KEY_INT64:
+				{
+					/* same folding as hashint8() */
+					int64		val = DatumGetInt64(attr);
+					uint32		lohalf = (uint32) val;
+					uint32		hihalf = (uint32) (val >> 32);
+
+					memcpy(dst, &val, sizeof(val));
+					lohalf ^= (val >= 0) ? hihalf : ~hihalf;
+					hkey = hash_bytes_uint32(lohalf);
+					break;
+				}
+			case TUPLEHASH_KEY_UUID:
+				{
+					pg_uuid_t  *val = DatumGetUUIDP(attr);
+
+					memcpy(dst, val->data, UUID_LEN);
+					hkey = hash_bytes(val->data, UUID_LEN);
+					break;
+				}
+			default:
+				elog(ERROR, "unrecognized packed key kind: %d", (int) col->kind);
+				hkey = 0;		/* keep compiler quiet */
+				break;
+		}
+
+		hashkey ^= hkey;
+	}
+
+	/* see TupleHashTableHash_internal() */
+	return murmurhash32(hashkey);
+}
+
+/*
+ * Copy the input tuple for a new table entry, with the packed key of the
+ * input tuple in front of it.  The caller must have switched to tablecxt.
+ */
+static MinimalTuple
+TupleHashCopyEntryTuple(TupleHashTable hashtable, TupleTableSlot *slot)
+{
+	Size		keyspace = MAXALIGN(hashtable->keylen);
+	MemoryContext oldcontext;
+	MinimalTuple tuple;
+	MinimalTuple copy;
+	bool		shouldFree;
+	char	   *mem;
+
+	/* a temporary copy of the tuple is made in the short-lived context */
+	oldcontext = MemoryContextSwitchTo(hashtable->tempcxt);
+	tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+	MemoryContextSwitchTo(oldcontext);
+
+	mem = palloc(keyspace + tuple->t_len);
+	memcpy(mem, hashtable->inputkey, hashtable->keylen);
+	copy = (MinimalTuple) (mem + keyspace);
+	memcpy(copy, tuple, tuple->t_len);
+
+	if (shouldFree)
+		pfree(tuple);
+
+	return copy;
+}
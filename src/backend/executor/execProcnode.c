@@ -72,6 +72,7 @@
  */
 #include "postgres.h"
 
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
@@ -121,6 +122,8 @@
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
 static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
+static TupleBatch *ExecProcNodeBatchFirst(PlanState *node);
+static TupleBatch *ExecProcNodeBatchInstr(PlanState *node);
 static bool ExecShutdownNode_walker(PlanState *node, void *context);
 
 
@@ -390,6 +393,14 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 
 	ExecSetExecProcNode(result, result->ExecProcNode);
 
+	/*
+	 * Likewise for the batch method.  Nodes that don't provide one return
+	 * the tuples of ExecProcNode() in batches.
+	 */
+	result->ExecProcNodeBatchReal = result->ExecProcNodeBatch ?
+		result->ExecProcNodeBatch : ExecProcNodeBatchDefault;
+	result->ExecProcNodeBatch = ExecProcNodeBatchFirst;
+
 	/*
 	 * Initialize any initPlans present in this node.  The planner put them in
 	 * a separate list for us.
@@ -485,6 +496,47 @@ ExecProcNodeInstr(PlanState *node)
 }
 
 
+/*
+ * ExecProcNodeBatch wrapper that performs the same one-time checks as
+ * ExecProcNodeFirst().
+ */
+static TupleBatch *
+ExecProcNodeBatchFirst(PlanState *node)
+{
+	check_stack_depth();
+
+	/*
+	 * The default batch method goes through ExecProcNode(), which already
+	 * does the instrumentation.
+	 */
+	if (node->instrument &&
+		node->ExecProcNodeBatchReal != ExecProcNodeBatchDefault)
+		node->ExecProcNodeBatch = ExecProcNodeBatchInstr;
+	else
+		node->ExecProcNodeBatch = node->ExecProcNodeBatchReal;
+
+	return node->ExecProcNodeBatch(node);
+}
+
+
+/*
+ * ExecProcNodeBatch wrapper that performs instrumentation calls.
+ */
+static TupleBatch *
+ExecProcNodeBatchInstr(PlanState *node)
+{
+	TupleBatch *result;
+
+	InstrStartNode(node->instrument);
+
+	result = node->ExecProcNodeBatchReal(node);
+
+	InstrStopNode(node->instrument, result ? result->nrows : 0.0);
+
+	return result;
+}
+
+
 /* ----------------------------------------------------------------
  *		MultiExecProcNode
  *
@@ -818,6 +870,12 @@ ExecShutdownNode_walker(PlanState *node, void *context)
 		case T_HashJoinState:
 			ExecShutdownHashJoin((HashJoinState *) node);
 			break;
+		case T_AggState:
+			ExecShutdownAgg((AggState *) node);
+			break;
+		case T_SortState:
+			ExecShutdownSort((SortState *) node);
+			break;
 		default:
 			break;
 	}
@@ -986,3 +1044,37 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 	 * it's unclear that any other cases are worth checking here.
 	 */
 }
+
+/*
+ * ExecSetReadToCompletion
+ *
+ * Tell a planstate node that its parent is going to read all of its output,
+ * because it consumes its whole input before returning anything itself.  A
+ * node may then read its own input ahead of what it has been asked for,
+ * which is otherwise not allowed as it would evaluate expressions for rows
+ * that are never needed (see "Batch Execution" in the executor README).
+ *
+ * This must be called right after the child node has been initialized.
+ */
+void
+ExecSetReadToCompletion(PlanState *child_node)
+{
+	if (IsA(child_node, HashJoinState))
+		ExecHashJoinSetReadToCompletion((HashJoinState *) child_node);
+	else if (IsA(child_node, ResultState))
+	{
+		/*
+		 * A projecting Result reads its child to completion as well, unless
+		 * its resconstantqual fails, in which case it reads nothing at all.
+		 */
+		if (outerPlanState(child_node))
+			ExecSetReadToCompletion(outerPlanState(child_node));
+	}
+	else if (IsA(child_node, SubqueryScanState))
+	{
+		/* Its qual, if any, only discards rows once they've been read */
+		SubqueryScanState *subqueryState = (SubqueryScanState *) child_node;
+
+		ExecSetReadToCompletion(subqueryState->subplan);
+	}
+}
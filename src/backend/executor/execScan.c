@@ -18,11 +18,17 @@
  */
 #include "postgres.h"
 
+#include "executor/execBatch.h"
 #include "executor/executor.h"
+#include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
 
+static int	ExecScanBatchVectorQual(ScanState *node,
+									ExecScanSlotAccessMtd accessMtd,
+									TupleBatch *scanbatch, TupleBatch *batch);
+
 
 /*
  * ExecScanFetch -- check interrupts & fetch next potential tuple
@@ -176,7 +182,7 @@ ExecScan(ScanState *node,
 	 * If we have neither a qual to check nor a projection to do, just skip
 	 * all the overhead and return the raw scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !node->ss_RuntimeFilter)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -226,6 +232,17 @@ ExecScan(ScanState *node,
 		 */
 		if (qual == NULL || ExecQual(qual, econtext))
 		{
+			/*
+			 * Drop the tuple if the hash join above us can't use it.
+			 */
+			if (node->ss_RuntimeFilter &&
+				!ExecHashRuntimeFilterPass(node->ss_RuntimeFilter, econtext))
+			{
+				InstrCountFiltered1(node, 1);
+				ResetExprContext(econtext);
+				continue;
+			}
+
 			/*
 			 * Found a satisfactory scan tuple.
 			 */
@@ -255,6 +272,185 @@ ExecScan(ScanState *node,
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecScanBatch
+ *
+ *		Batch variant of ExecScan().  Instead of returning the first
+ *		qualifying tuple it fills a batch with up to es_batch_size of
+ *		them.  The access method stores the next tuple of the relation
+ *		into the given slot and returns false at the end of the scan.
+ *
+ *		Each fetched tuple gets its own scan slot, so that projected
+ *		values referencing it remain valid until the batch is consumed.
+ *		All rows of a batch share one per-tuple memory cycle; to keep
+ *		that bounded with a selective qual, a batch ends after a batch's
+ *		worth of tuples has been fetched, even if fewer of them qualified.
+ *
+ *		If the qual has a vector program (see ExecReadyVectorQual()),
+ *		all tuples are fetched before the qual is evaluated for them at
+ *		once.
+ *
+ *		Tuples passing the qual are also checked against the runtime
+ *		filter of a hash join above, if there is one.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecScanBatch(ScanState *node, ExecScanSlotAccessMtd accessMtd)
+{
+	EState	   *estate = node->ps.state;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	ExprState  *qual = node->ps.qual;
+	ProjectionInfo *projInfo = node->ps.ps_ProjInfo;
+	TupleBatch *scanbatch;
+	TupleBatch *batch;
+	int			maxrows;
+	int			nrows = 0;
+
+	/*
+	 * EvalPlanQual rechecks substitute test tuples for the relation, which
+	 * ExecScan() knows how to do.
+	 */
+	if (estate->es_epq_active != NULL)
+		return ExecProcNodeBatchDefault(&node->ps);
+
+	/* The access method would restart the scan */
+	if (node->ps.ps_BatchDone)
+		return NULL;
+
+	if (node->ss_ScanBatch == NULL)
+		node->ss_ScanBatch =
+			ExecInitTupleBatch(estate,
+							   node->ss_ScanTupleSlot->tts_tupleDescriptor,
+							   node->ss_ScanTupleSlot->tts_ops);
+	scanbatch = node->ss_ScanBatch;
+
+	/* Without projection the scan tuples are returned as they are */
+	batch = projInfo ? ExecGetResultBatch(&node->ps) : scanbatch;
+	maxrows = batch->maxrows;
+
+	/* See whether the qual can be evaluated for all rows at once */
+	if (qual != NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+		ExecReadyVectorQual(qual, maxrows);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	while (nrows == 0 && !node->ps.ps_BatchDone)
+	{
+		int			nfetched;
+
+		ResetExprContext(econtext);
+
+		if (qual != NULL && qual->vecprog != NULL)
+		{
+			nrows = ExecScanBatchVectorQual(node, accessMtd, scanbatch, batch);
+			continue;
+		}
+
+		for (nfetched = 0; nfetched < maxrows; nfetched++)
+		{
+			/* a tuple failing the qual leaves its slot to the next one */
+			TupleTableSlot *slot = scanbatch->slots[nrows];
+
+			CHECK_FOR_INTERRUPTS();
+
+			if (!(*accessMtd) (node, slot))
+			{
+				node->ps.ps_BatchDone = true;
+				break;
+			}
+
+			econtext->ecxt_scantuple = slot;
+
+			if ((qual != NULL && !ExecQual(qual, econtext)) ||
+				(node->ss_RuntimeFilter != NULL &&
+				 !ExecHashRuntimeFilterPass(node->ss_RuntimeFilter, econtext)))
+			{
+				InstrCountFiltered1(node, 1);
+				continue;
+			}
+
+			if (projInfo)
+				ExecProjectBatchRow(projInfo, batch->slots[nrows]);
+
+			nrows++;
+		}
+	}
+
+	batch->nrows = nrows;
+
+	return nrows > 0 ? batch : NULL;
+}
+
+/*
+ * ExecScanBatchVectorQual
+ *
+ * Helper of ExecScanBatch() for quals with a vector program: fetch a full
+ * batch of tuples first, then evaluate the qual for all of them with
+ * ExecVectorQual().  Returns the number of qualifying rows put into batch.
+ */
+static int
+ExecScanBatchVectorQual(ScanState *node, ExecScanSlotAccessMtd accessMtd,
+						TupleBatch *scanbatch, TupleBatch *batch)
+{
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	ProjectionInfo *projInfo = node->ps.ps_ProjInfo;
+	HashJoinRuntimeFilter *filter = node->ss_RuntimeFilter;
+	const int  *sel;
+	int			nfetched;
+	int			nqual;
+	int			nrows = 0;
+	int			i;
+
+	for (nfetched = 0; nfetched < scanbatch->maxrows; nfetched++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (!(*accessMtd) (node, scanbatch->slots[nfetched]))
+		{
+			node->ps.ps_BatchDone = true;
+			break;
+		}
+	}
+
+	if (nfetched == 0)
+		return 0;
+
+	nqual = ExecVectorQual(node->ps.qual, econtext,
+						   scanbatch->slots, nfetched, &sel);
+
+	for (i = 0; i < nqual; i++)
+	{
+		int			row = sel ? sel[i] : i;
+
+		econtext->ecxt_scantuple = scanbatch->slots[row];
+
+		if (filter != NULL && !ExecHashRuntimeFilterPass(filter, econtext))
+			continue;
+
+		if (projInfo)
+			ExecProjectBatchRow(projInfo, batch->slots[nrows]);
+		else if (row != nrows)
+		{
+			/*
+			 * Move the row to the front.  The selection is ascending, so the
+			 * slot at row has not been touched yet.
+			 */
+			TupleTableSlot *slot = scanbatch->slots[nrows];
+
+			scanbatch->slots[nrows] = scanbatch->slots[row];
+			scanbatch->slots[row] = slot;
+		}
+		nrows++;
+	}
+
+	InstrCountFiltered1(node, nfetched - nrows);
+
+	return nrows;
+}
+
 /*
  * ExecAssignScanProjectionInfo
  *		Set up projection info for a scan node, if necessary.
@@ -306,6 +502,10 @@ ExecScanReScan(ScanState *node)
 	 */
 	ExecClearTuple(node->ss_ScanTupleSlot);
 
+	/* Likewise for the tuples of the scan batch */
+	if (node->ss_ScanBatch != NULL)
+		ExecClearTupleBatch(node->ss_ScanBatch);
+
 	/* Rescan EvalPlanQual tuple if we're inside an EvalPlanQual recheck */
 	if (estate->es_epq_active != NULL)
 	{
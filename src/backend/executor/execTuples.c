@@ -802,17 +802,13 @@ tts_buffer_heap_copyslot(TupleTableSlot *dstslot, TupleTableSlot *srcslot)
 	{
 		Assert(BufferIsValid(bsrcslot->buffer));
 
-		tts_buffer_heap_store_tuple(dstslot, bsrcslot->base.tuple,
-									bsrcslot->buffer, false);
-
 		/*
 		 * The HeapTupleData portion of the source tuple might be shorter
-		 * lived than the destination slot. Therefore copy the HeapTuple into
-		 * our slot's tupdata, which is guaranteed to live long enough (but
-		 * will still point into the buffer).
+		 * lived than the destination slot, but storing it copies it into our
+		 * slot's tupdata.
 		 */
-		memcpy(&bdstslot->base.tupdata, bdstslot->base.tuple, sizeof(HeapTupleData));
-		bdstslot->base.tuple = &bdstslot->base.tupdata;
+		tts_buffer_heap_store_tuple(dstslot, bsrcslot->base.tuple,
+									bsrcslot->buffer, false);
 	}
 }
 
@@ -870,6 +866,18 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 		slot->tts_flags &= ~TTS_FLAG_SHOULDFREE;
 	}
 
+	/*
+	 * Copy the HeapTupleData into our slot's tupdata (it will still point
+	 * into the buffer).  The caller's copy may be reused for the next tuple
+	 * while this slot is still in use, as happens with a heap scan's rs_ctup
+	 * when a batch of scan tuples is kept in several slots.
+	 */
+	if (tuple != &bslot->base.tupdata)
+	{
+		memcpy(&bslot->base.tupdata, tuple, sizeof(HeapTupleData));
+		tuple = &bslot->base.tupdata;
+	}
+
 	slot->tts_flags &= ~TTS_FLAG_EMPTY;
 	slot->tts_nvalid = 0;
 	bslot->base.tuple = tuple;
@@ -50,6 +50,7 @@
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/transam.h"
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/execPartition.h"
 #include "jit/jit.h"
@@ -156,6 +157,9 @@ CreateExecutorState(void)
 
 	estate->es_use_parallel_mode = false;
 
+	/* All batches of a query have the same size */
+	estate->es_batch_size = Max(executor_batch_size, 1);
+
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
 
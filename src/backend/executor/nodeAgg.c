@@ -226,6 +226,21 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Parallel HashAggregate
+ *
+ *	  A parallel-aware AGG_HASHED node below a Gather aggregates all of its
+ *	  input without a Finalize Aggregate above it.  Each participant first
+ *	  routes the tuples of its partial outer plan to one of a fixed number of
+ *	  shared tuplestores, chosen by the hash value of the grouping columns, so
+ *	  that all tuples of a group end up in the same partition.  After all
+ *	  participants have finished partitioning, they claim whole partitions one
+ *	  at a time and aggregate each of them like ordinary input into their
+ *	  private hash table, which may still spill to disk as described above.
+ *	  No group is ever seen by two participants, so the groups can be emitted
+ *	  directly.  Unlike Partial/Finalize aggregation, this also works for
+ *	  aggregates without a combine function, and avoids merging the partial
+ *	  states of a high number of groups in the leader.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -255,6 +270,7 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "executor/execBatch.h"
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -265,6 +281,9 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/sharedfileset.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -273,8 +292,10 @@
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
+#include "utils/wait_event.h"
 
 /*
  * Control how many partitions are created when spilling HashAgg to
@@ -357,6 +378,44 @@ typedef struct HashAggBatch
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
 
+/*
+ * Shared state of a Parallel HashAggregate, followed in memory by
+ * npartitions SharedTuplestores (see ParallelHashAggPartition()).
+ *
+ * The barrier has two phases: while in PHA_PHASE_PARTITIONING, every
+ * participant routes its share of the input to the partitions.  Once all
+ * of them have arrived, partitions are handed out in PHA_PHASE_AGGREGATING
+ * by incrementing next_partition.
+ */
+typedef struct ParallelHashAggState
+{
+	Barrier		barrier;		/* synchronizes the end of partitioning */
+	pg_atomic_uint32 next_partition;	/* next partition to aggregate */
+	int			nparticipants;	/* leader and planned workers */
+	int			npartitions;	/* number of partitions */
+	SharedFileSet fileset;		/* space for partition files */
+} ParallelHashAggState;
+
+#define PHA_PHASE_PARTITIONING		0
+#define PHA_PHASE_AGGREGATING		1
+
+/* partitions per participant, to even out skewed partition sizes */
+#define PHA_PARTITIONS_PER_PARTICIPANT	4
+
+/* shm_toc key of the shared state; plan_node_id is used by SharedAggInfo */
+#define PHA_TOC_KEY(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (plan_node_id))
+
+static inline SharedTuplestore *
+ParallelHashAggPartition(ParallelHashAggState *pstate, int partno)
+{
+	Size		stssize = MAXALIGN(sts_estimate(pstate->nparticipants));
+
+	return (SharedTuplestore *) ((char *) pstate +
+								 MAXALIGN(sizeof(ParallelHashAggState)) +
+								 partno * stssize);
+}
+
 /* used to find referenced colnos */
 typedef struct FindColsContext
 {
@@ -439,6 +498,12 @@ static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *slot, uint32 hash);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
 								 int setno);
+static TupleTableSlot *hashagg_spill_slot(AggState *aggstate,
+										  TupleTableSlot *inputslot);
+static bool agg_fill_shared_hash_table(AggState *aggstate);
+static void agg_partition_shared_input(AggState *aggstate);
+static bool agg_next_shared_partition(AggState *aggstate);
+static void agg_end_shared_scan(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 									  AggState *aggstate, EState *estate,
@@ -542,6 +607,12 @@ initialize_phase(AggState *aggstate, int newphase)
  * populated by the previous phase.  Copy it to the sorter for the next phase
  * if any.
  *
+ * If batch_input is set, tuples of the outer plan are fetched in batches and
+ * returned one by one from the current batch.
+ *
+ * Once a Parallel HashAggregate has partitioned its input, tuples come from
+ * the shared partition currently being aggregated instead.
+ *
  * Callers cannot rely on memory for tuple in returned slot remaining valid
  * past any subsequently fetched tuple.
  */
@@ -559,6 +630,30 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->hash_ppartitioned)
+	{
+		MinimalTuple tuple;
+
+		CHECK_FOR_INTERRUPTS();
+		tuple = sts_parallel_scan_next(aggstate->hash_pparts[aggstate->hash_pcurpart],
+									   NULL);
+		if (tuple == NULL)
+			return NULL;
+		slot = ExecStoreMinimalTuple(tuple, aggstate->hash_spill_rslot, false);
+	}
+	else if (aggstate->batch_input)
+	{
+		TupleBatch *batch = aggstate->input_batch;
+
+		if (batch == NULL || aggstate->input_batch_pos >= batch->nrows)
+		{
+			batch = ExecProcNodeBatch(outerPlanState(aggstate));
+			aggstate->input_batch = batch;
+			aggstate->input_batch_pos = 0;
+		}
+
+		slot = batch ? batch->slots[aggstate->input_batch_pos++] : NULL;
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1797,8 +1892,9 @@ hash_agg_set_limits(double hashentrysize, double input_groups, int used_bits,
 
 	/*
 	 * Calculate expected memory requirements for spilling, which is the size
-	 * of the buffers needed for all the tapes that need to be open at once.
-	 * Then, subtract that from the memory available for holding hash tables.
+	 * of the buffers needed for all the tapes that need to be open at once,
+	 * plus the tape set's write-behind buffer.  Then, subtract that from the
+	 * memory available for holding hash tables.
 	 */
 	npartitions = hash_choose_num_partitions(input_groups,
 											 hashentrysize,
@@ -1809,7 +1905,8 @@ hash_agg_set_limits(double hashentrysize, double input_groups, int used_bits,
 
 	partition_mem =
 		HASHAGG_READ_BUFFER_SIZE +
-		HASHAGG_WRITE_BUFFER_SIZE * npartitions;
+		HASHAGG_WRITE_BUFFER_SIZE * npartitions +
+		LogicalTapeWriteBehindSize(hash_mem_limit);
 
 	/*
 	 * Don't set the limit below 3/4 of hash_mem. In that case, we are at the
@@ -1863,18 +1960,30 @@ hash_agg_check_limits(AggState *aggstate)
 static void
 hash_agg_enter_spill_mode(AggState *aggstate)
 {
+	/* partitions of a Parallel HashAggregate are read as MinimalTuples */
+	bool		minslot = aggstate->table_filled || aggstate->hash_ppartitioned;
+
 	aggstate->hash_spill_mode = true;
-	hashagg_recompile_expressions(aggstate, aggstate->table_filled, true);
+	hashagg_recompile_expressions(aggstate, minslot, true);
 
 	if (!aggstate->hash_ever_spilled)
 	{
 		Assert(aggstate->hash_tapeset == NULL);
-		Assert(aggstate->hash_spills == NULL);
 
 		aggstate->hash_ever_spilled = true;
 
 		aggstate->hash_tapeset = LogicalTapeSetCreate(true, NULL, -1);
+		LogicalTapeSetWriteBehind(aggstate->hash_tapeset,
+								  LogicalTapeWriteBehindSize(get_hash_memory_limit()));
+	}
 
+	/*
+	 * Spilling while reading the input needs the initial spill structures.
+	 * A Parallel HashAggregate reads each of its partitions as input, so it
+	 * may need them more than once.
+	 */
+	if (!aggstate->table_filled && aggstate->hash_spills == NULL)
+	{
 		aggstate->hash_spills = palloc(sizeof(HashAggSpill) * aggstate->num_hashes);
 
 		for (int setno = 0; setno < aggstate->num_hashes; setno++)
@@ -1917,6 +2026,8 @@ hash_agg_update_metrics(AggState *aggstate, bool from_tape, int npartitions)
 	buffer_mem = npartitions * HASHAGG_WRITE_BUFFER_SIZE;
 	if (from_tape)
 		buffer_mem += HASHAGG_READ_BUFFER_SIZE;
+	if (aggstate->hash_tapeset != NULL)
+		buffer_mem += LogicalTapeWriteBehindSize(get_hash_memory_limit());
 
 	/* update peak mem */
 	total_mem = meta_mem + hashkey_mem + buffer_mem;
@@ -2151,7 +2262,15 @@ ExecAgg(PlanState *pstate)
 		{
 			case AGG_HASHED:
 				if (!node->table_filled)
-					agg_fill_hash_table(node);
+				{
+					if (node->hash_pstate == NULL)
+						agg_fill_hash_table(node);
+					else if (!agg_fill_shared_hash_table(node))
+					{
+						node->agg_done = true;
+						return NULL;
+					}
+				}
 				/* FALLTHROUGH */
 			case AGG_MIXED:
 				result = agg_retrieve_hash_table(node);
@@ -2560,6 +2679,152 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * ExecAgg for Parallel HashAggregate: fill the hash table with the groups of
+ * the next shared partition, partitioning our share of the input first if
+ * that has not been done yet.
+ *
+ * Returns false if there are no more partitions for us to aggregate.
+ */
+static bool
+agg_fill_shared_hash_table(AggState *aggstate)
+{
+	if (!aggstate->hash_ppartitioned)
+		agg_partition_shared_input(aggstate);
+
+	return agg_next_shared_partition(aggstate);
+}
+
+/*
+ * Route all tuples of our outer plan to the shared partitions by the hash
+ * value of their grouping columns, then wait for the other participants to
+ * do the same.  Every group ends up in exactly one partition, so the groups
+ * of each partition can be aggregated and emitted by a single participant.
+ *
+ * The outer plan is partial (each participant sees a disjoint subset of the
+ * input) and every participant computes the same hash values, as the hash
+ * table's initial value only differs between workers for partial
+ * aggregation.
+ */
+static void
+agg_partition_shared_input(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->hash_pstate;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	int			partno;
+
+	Assert(aggstate->num_hashes == 1);
+
+	/*
+	 * A participant that starts late will find partitioning finished; it
+	 * must not write anything, but can still help to aggregate.
+	 */
+	if (BarrierAttach(&pstate->barrier) == PHA_PHASE_PARTITIONING)
+	{
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			MinimalTuple tuple;
+			bool		shouldFree;
+			uint32		hash;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+
+			/*
+			 * The hash table of the partition uses the low bits of the hash
+			 * value, so hash the hash to choose the partition.
+			 */
+			partno = murmurhash32(hash) % pstate->npartitions;
+
+			tuple = ExecFetchSlotMinimalTuple(hashagg_spill_slot(aggstate,
+																 outerslot),
+											  &shouldFree);
+			sts_puttuple(aggstate->hash_pparts[partno], NULL, tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(tmpcontext);
+		}
+
+		for (partno = 0; partno < pstate->npartitions; partno++)
+			sts_end_write(aggstate->hash_pparts[partno]);
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+
+	Assert(BarrierPhase(&pstate->barrier) == PHA_PHASE_AGGREGATING);
+	aggstate->hash_pattached = true;
+	aggstate->hash_ppartitioned = true;
+}
+
+/*
+ * Claim the next shared partition that no participant has aggregated yet,
+ * and fill the hash table with its groups.
+ *
+ * Returns false, after detaching from the shared state, if all partitions
+ * have been claimed.
+ */
+static bool
+agg_next_shared_partition(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->hash_pstate;
+	uint32		partno;
+
+	agg_end_shared_scan(aggstate);
+
+	if (!aggstate->hash_pattached)
+		return false;
+
+	partno = pg_atomic_fetch_add_u32(&pstate->next_partition, 1);
+	if (partno >= (uint32) pstate->npartitions)
+	{
+		BarrierDetach(&pstate->barrier);
+		aggstate->hash_pattached = false;
+		return false;
+	}
+
+	aggstate->hash_pcurpart = partno;
+	sts_begin_parallel_scan(aggstate->hash_pparts[partno]);
+
+	/* free memory and reset the hash table, as in agg_refill_hash_table */
+	ReScanExprContext(aggstate->hashcontext);
+	ResetTupleHashTable(aggstate->perhash[0].hashtable);
+	MemSet(aggstate->hash_pergroup, 0,
+		   sizeof(AggStatePerGroup) * aggstate->num_hashes);
+	aggstate->hash_ngroups_current = 0;
+	hash_agg_set_limits(aggstate->hashentrysize,
+						aggstate->perhash[0].aggnode->numGroups, 0,
+						&aggstate->hash_mem_limit,
+						&aggstate->hash_ngroups_limit, NULL);
+
+	/* tuples of the partition are read back as MinimalTuples */
+	hashagg_recompile_expressions(aggstate, true, false);
+
+	aggstate->table_filled = false;
+	agg_fill_hash_table(aggstate);
+
+	return true;
+}
+
+/*
+ * Stop reading the shared partition we are aggregating, if any.
+ */
+static void
+agg_end_shared_scan(AggState *aggstate)
+{
+	if (aggstate->hash_pcurpart >= 0)
+	{
+		sts_end_parallel_scan(aggstate->hash_pparts[aggstate->hash_pcurpart]);
+		aggstate->hash_pcurpart = -1;
+	}
+}
+
 /*
  * If any data was spilled during hash aggregation, reset the hash table and
  * reprocess one batch of spilled data. After reprocessing a batch, the hash
@@ -2734,11 +2999,16 @@ agg_retrieve_hash_table(AggState *aggstate)
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
-			if (!agg_refill_hash_table(aggstate))
-			{
-				aggstate->agg_done = true;
-				break;
-			}
+			if (agg_refill_hash_table(aggstate))
+				continue;
+
+			/* move on to the next shared partition, if any */
+			if (aggstate->hash_pstate != NULL &&
+				agg_next_shared_partition(aggstate))
+				continue;
+
+			aggstate->agg_done = true;
+			break;
 		}
 	}
 
@@ -2897,6 +3167,38 @@ hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *tapeset, int used_bits,
 		initHyperLogLog(&spill->hll_card[i], HASHAGG_HLL_BIT_WIDTH);
 }
 
+/*
+ * hashagg_spill_slot
+ *
+ * Return a slot with the input tuple to write out, containing only the
+ * attributes that we actually need.
+ */
+static TupleTableSlot *
+hashagg_spill_slot(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	TupleTableSlot *spillslot;
+
+	if (aggstate->all_cols_needed)
+		return inputslot;
+
+	spillslot = aggstate->hash_spill_wslot;
+	slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
+	ExecClearTuple(spillslot);
+	for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
+	{
+		if (bms_is_member(i + 1, aggstate->colnos_needed))
+		{
+			spillslot->tts_values[i] = inputslot->tts_values[i];
+			spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
+		}
+		else
+			spillslot->tts_isnull[i] = true;
+	}
+	ExecStoreVirtualTuple(spillslot);
+
+	return spillslot;
+}
+
 /*
  * hashagg_spill_tuple
  *
@@ -2916,27 +3218,7 @@ hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 
 	Assert(spill->partitions != NULL);
 
-	/* spill only attributes that we actually need */
-	if (!aggstate->all_cols_needed)
-	{
-		spillslot = aggstate->hash_spill_wslot;
-		slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
-		ExecClearTuple(spillslot);
-		for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
-		{
-			if (bms_is_member(i + 1, aggstate->colnos_needed))
-			{
-				spillslot->tts_values[i] = inputslot->tts_values[i];
-				spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
-			}
-			else
-				spillslot->tts_isnull[i] = true;
-		}
-		ExecStoreVirtualTuple(spillslot);
-	}
-	else
-		spillslot = inputslot;
-
+	spillslot = hashagg_spill_slot(aggstate, inputslot);
 	tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
 
 	partition = (hash & spill->mask) >> spill->shift;
@@ -3286,6 +3568,26 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * Plain and hashed aggregation consume all of their input before
+	 * returning anything, so unless there are additional sorted phases the
+	 * outer plan can be read in batches, and may itself read ahead.
+	 */
+	if ((node->aggstrategy == AGG_PLAIN ||
+		 node->aggstrategy == AGG_HASHED) &&
+		numPhases == (use_hashing ? 1 : 2))
+	{
+		ExecSetReadToCompletion(outerPlanState(aggstate));
+		aggstate->batch_input = ExecSupportsBatch(outerPlanState(aggstate));
+	}
+	else
+		aggstate->batch_input = false;
+	aggstate->input_batch = NULL;
+	aggstate->input_batch_pos = 0;
+
+	/* Parallel HashAggregate state is set up with the DSM, if at all */
+	aggstate->hash_pcurpart = -1;
+
 	/*
 	 * initialize source tuple type.
 	 */
@@ -4347,9 +4649,21 @@ ExecReScanAgg(AggState *node)
 	int			setno;
 
 	node->agg_done = false;
+	node->input_batch = NULL;
 
 	if (node->aggstrategy == AGG_HASHED)
 	{
+		/*
+		 * A Parallel HashAggregate only holds the groups of its last shared
+		 * partition, so it always starts over.  The shared state is reset by
+		 * ExecAggReInitializeDSM(); here we only forget our part in it.
+		 */
+		if (node->hash_pstate != NULL)
+		{
+			ExecShutdownAgg(node);
+			node->hash_ppartitioned = false;
+		}
+
 		/*
 		 * In the hashed case, if we haven't yet built the hash table then we
 		 * can just return; nothing done yet, so nothing to undo. If subnode's
@@ -4366,7 +4680,8 @@ ExecReScanAgg(AggState *node)
 		 * we can just rescan the existing hash table; no need to build it
 		 * again.
 		 */
-		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+		if (node->hash_pstate == NULL &&
+			outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4649,10 +4964,66 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
  * ----------------------------------------------------------------
  */
 
+/*
+ * Does this node run as a Parallel HashAggregate?  Without workers the
+ * leader aggregates all the input on its own.  This must give the same
+ * answer at estimate time, before the DSM segment exists, as when the
+ * segment is initialized; nworkers can only drop to zero in between (if
+ * no segment could be created), which merely leaves the estimate unused.
+ */
+static bool
+ExecAggIsSharedHash(AggState *node, ParallelContext *pcxt)
+{
+	return node->ss.ps.plan->parallel_aware &&
+		node->aggstrategy == AGG_HASHED &&
+		pcxt->nworkers > 0;
+}
+
+/*
+ * Size of the shared state of a Parallel HashAggregate, including its
+ * partitions.
+ */
+static Size
+ExecAggSharedHashSize(int nparticipants)
+{
+	Size		size;
+
+	size = mul_size(MAXALIGN(sts_estimate(nparticipants)),
+					nparticipants * PHA_PARTITIONS_PER_PARTICIPANT);
+	return add_size(size, MAXALIGN(sizeof(ParallelHashAggState)));
+}
+
+/*
+ * Set up the barrier and the empty partitions of a Parallel HashAggregate,
+ * as the leader.
+ */
+static void
+ExecAggInitializeSharedHash(AggState *node)
+{
+	ParallelHashAggState *pstate = node->hash_pstate;
+	int			partno;
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_init_u32(&pstate->next_partition, 0);
+
+	for (partno = 0; partno < pstate->npartitions; partno++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "hashagg.%d", partno);
+		node->hash_pparts[partno] =
+			sts_initialize(ParallelHashAggPartition(pstate, partno),
+						   pstate->nparticipants, 0, 0,
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset, name);
+	}
+}
+
  /* ----------------------------------------------------------------
   *		ExecAggEstimate
   *
-  *		Estimate space required to propagate aggregate statistics.
+  *		Estimate space required to propagate aggregate statistics, and
+  *		for the shared state of a Parallel HashAggregate.
   * ----------------------------------------------------------------
   */
 void
@@ -4660,6 +5031,13 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (ExecAggIsSharedHash(node, pcxt))
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   ExecAggSharedHashSize(pcxt->nworkers + 1));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4673,7 +5051,8 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for aggregate statistics, and the shared
+ *		state of a Parallel HashAggregate.
  * ----------------------------------------------------------------
  */
 void
@@ -4681,6 +5060,25 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (ExecAggIsSharedHash(node, pcxt))
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+		ParallelHashAggState *pstate;
+
+		pstate = shm_toc_allocate(pcxt->toc,
+								  ExecAggSharedHashSize(nparticipants));
+		pstate->nparticipants = nparticipants;
+		pstate->npartitions = nparticipants * PHA_PARTITIONS_PER_PARTICIPANT;
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		shm_toc_insert(pcxt->toc, PHA_TOC_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->hash_pstate = pstate;
+		node->hash_pparts = palloc(sizeof(SharedTuplestoreAccessor *) *
+								   pstate->npartitions);
+		ExecAggInitializeSharedHash(node);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4695,17 +5093,85 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset the shared state of a Parallel HashAggregate before
+ *		beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelHashAggState *pstate = node->hash_pstate;
+
+	if (pstate == NULL)
+		return;
+
+	/* Detach, if we didn't get to the end of the last scan. */
+	ExecShutdownAgg(node);
+
+	/* Clear the partition files, and start partitioning again. */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	ExecAggInitializeSharedHash(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggInitializeWorker
  *
- *		Attach worker to DSM space for aggregate statistics.
+ *		Attach worker to DSM space for aggregate statistics, and to the
+ *		shared state of a Parallel HashAggregate.
  * ----------------------------------------------------------------
  */
 void
 ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
+	ParallelHashAggState *pstate;
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+
+	if (!node->ss.ps.plan->parallel_aware)
+		return;
+
+	pstate = shm_toc_lookup(pwcxt->toc,
+							PHA_TOC_KEY(node->ss.ps.plan->plan_node_id), true);
+	if (pstate != NULL)
+	{
+		int			participant = ParallelWorkerNumber + 1;
+		int			partno;
+
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->hash_pstate = pstate;
+		node->hash_pparts = palloc(sizeof(SharedTuplestoreAccessor *) *
+								   pstate->npartitions);
+		for (partno = 0; partno < pstate->npartitions; partno++)
+			node->hash_pparts[partno] =
+				sts_attach(ParallelHashAggPartition(pstate, partno),
+						   participant, &pstate->fileset);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownAgg
+ *
+ *		Stop reading shared partitions and detach from the shared state
+ *		of a Parallel HashAggregate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownAgg(AggState *node)
+{
+	if (node->hash_pstate == NULL)
+		return;
+
+	agg_end_shared_scan(node);
+	if (node->hash_pattached)
+	{
+		BarrierDetach(&node->hash_pstate->barrier);
+		node->hash_pattached = false;
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -57,10 +58,18 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
+static inline void ExecHashPushTuple(HashJoinTable hashtable, int bucketno,
+									 HashJoinTuple tuple);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												size_t size,
 												dsa_pointer *shared);
 static void MultiExecPrivateHash(HashState *node);
+static bool ExecHashComputeHashValue(HashJoinTable hashtable,
+									 ExprContext *econtext,
+									 List *hashkeys,
+									 bool outer_tuple,
+									 bool keep_nulls,
+									 uint32 *hashvalue);
 static void MultiExecParallelHash(HashState *node);
 static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable table,
 													   int bucketno);
@@ -174,6 +183,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloom)
+				bloom_add_element(hashtable->bloom, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -196,7 +209,8 @@ MultiExecPrivateHash(HashState *node)
 		ExecHashIncreaseNumBuckets(hashtable);
 
 	/* Account for the buckets in spaceUsed (reported in EXPLAIN ANALYZE) */
-	hashtable->spaceUsed += hashtable->nbuckets * sizeof(HashJoinTuple);
+	hashtable->spaceUsed += hashtable->nbuckets *
+		(sizeof(HashJoinTuple) + sizeof(uint16));
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
@@ -380,6 +394,9 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	 */
 	outerPlanState(hashstate) = ExecInitNode(outerPlan(node), estate, eflags);
 
+	/* The hash table is built from all of the input */
+	ExecSetReadToCompletion(outerPlanState(hashstate));
+
 	/*
 	 * initialize our result slot and type. No need to build projection
 	 * because this node doesn't do projections.
@@ -486,6 +503,8 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->log2_nbuckets = log2_nbuckets;
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
 	hashtable->buckets.unshared = NULL;
+	hashtable->bucketTags = NULL;
+	hashtable->bloom = NULL;
 	hashtable->keepNulls = keepNulls;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
@@ -638,6 +657,8 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 
 		hashtable->buckets.unshared = (HashJoinTuple *)
 			palloc0(nbuckets * sizeof(HashJoinTuple));
+		hashtable->bucketTags = (uint16 *)
+			palloc0(nbuckets * sizeof(uint16));
 
 		/*
 		 * Set up for skew optimization, if possible and there's a need for
@@ -979,6 +1000,9 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 		hashtable->buckets.unshared =
 			repalloc(hashtable->buckets.unshared,
 					 sizeof(HashJoinTuple) * hashtable->nbuckets);
+		hashtable->bucketTags =
+			repalloc(hashtable->bucketTags,
+					 sizeof(uint16) * hashtable->nbuckets);
 	}
 
 	/*
@@ -988,6 +1012,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	 */
 	memset(hashtable->buckets.unshared, 0,
 		   sizeof(HashJoinTuple) * hashtable->nbuckets);
+	memset(hashtable->bucketTags, 0, sizeof(uint16) * hashtable->nbuckets);
 	oldchunks = hashtable->chunks;
 	hashtable->chunks = NULL;
 
@@ -1021,8 +1046,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-				hashtable->buckets.unshared[bucketno] = copyTuple;
+				ExecHashPushTuple(hashtable, bucketno, copyTuple);
 			}
 			else
 			{
@@ -1484,6 +1508,11 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	memset(hashtable->buckets.unshared, 0,
 		   hashtable->nbuckets * sizeof(HashJoinTuple));
 
+	hashtable->bucketTags =
+		(uint16 *) repalloc(hashtable->bucketTags,
+							hashtable->nbuckets * sizeof(uint16));
+	memset(hashtable->bucketTags, 0, hashtable->nbuckets * sizeof(uint16));
+
 	/* scan through all tuples in all chunks to rebuild the hash table */
 	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
 	{
@@ -1500,8 +1529,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-			hashtable->buckets.unshared[bucketno] = hashTuple;
+			ExecHashPushTuple(hashtable, bucketno, hashTuple);
 
 			/* advance index past the tuple */
 			idx += MAXALIGN(HJTUPLE_OVERHEAD +
@@ -1653,8 +1681,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-		hashtable->buckets.unshared[bucketno] = hashTuple;
+		ExecHashPushTuple(hashtable, bucketno, hashTuple);
 
 		/*
 		 * Increase the (optimal) number of buckets if we just exceeded the
@@ -1678,7 +1705,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
 		if (hashtable->spaceUsed +
-			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
+			hashtable->nbuckets_optimal * (sizeof(HashJoinTuple) + sizeof(uint16))
 			> hashtable->spaceAllowed)
 			ExecHashIncreaseNumBatches(hashtable);
 	}
@@ -1818,18 +1845,34 @@ ExecHashGetHashValue(HashJoinTable hashtable,
 					 bool keep_nulls,
 					 uint32 *hashvalue)
 {
-	uint32		hashkey = 0;
-	FmgrInfo   *hashfunctions;
-	ListCell   *hk;
-	int			i = 0;
-	MemoryContext oldContext;
-
 	/*
 	 * We reset the eval context each time to reclaim any memory leaked in the
 	 * hashkey expressions.
 	 */
 	ResetExprContext(econtext);
 
+	return ExecHashComputeHashValue(hashtable, econtext, hashkeys,
+									outer_tuple, keep_nulls, hashvalue);
+}
+
+/*
+ * ExecHashComputeHashValue
+ *		Workhorse of ExecHashGetHashValue, without resetting econtext
+ */
+static bool
+ExecHashComputeHashValue(HashJoinTable hashtable,
+						 ExprContext *econtext,
+						 List *hashkeys,
+						 bool outer_tuple,
+						 bool keep_nulls,
+						 uint32 *hashvalue)
+{
+	uint32		hashkey = 0;
+	FmgrInfo   *hashfunctions;
+	ListCell   *hk;
+	int			i = 0;
+	MemoryContext oldContext;
+
 	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 
 	if (outer_tuple)
@@ -1891,6 +1934,112 @@ ExecHashGetHashValue(HashJoinTable hashtable,
 	return true;
 }
 
+/*
+ * ExecHashTableAddBloomFilter
+ *		Make the hash table collect the hash values of all inner tuples,
+ *		including those of later batches, in a bloom filter
+ *
+ * This must be called before the table is built.  ntuples is the expected
+ * number of inner tuples, which the filter is sized for.
+ *
+ * The filter takes its memory from the hash table's, and is left out if even
+ * the smallest one (1MB) would take more than RUNTIME_FILTER_HASH_MEM_PERCENT
+ * of that.  It is also left out if the inner side is expected to be so large
+ * that the filter would get fewer than RUNTIME_FILTER_MIN_BITS_PER_TUPLE bits
+ * per tuple, as it would then let through most of the outer tuples anyway.
+ * Whether the join is expected to drop enough outer tuples for a filter to be
+ * worthwhile was decided when the filter was set up.
+ */
+void
+ExecHashTableAddBloomFilter(HashJoinTable hashtable, double ntuples)
+{
+	MemoryContext oldcxt;
+	Size		bloom_mem;
+
+	bloom_mem = hashtable->spaceAllowed * RUNTIME_FILTER_HASH_MEM_PERCENT / 100;
+	if (bloom_mem < 1024 * 1024 ||
+		ntuples * RUNTIME_FILTER_MIN_BITS_PER_TUPLE >
+		(double) Min(bloom_mem, (Size) MAX_KILOBYTES * 1024) * BITS_PER_BYTE)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+	hashtable->bloom = bloom_create((int64) Max(ntuples, 1.0),
+									(int) Min(bloom_mem / 1024, MAX_KILOBYTES),
+									0);
+	MemoryContextSwitchTo(oldcxt);
+
+	hashtable->spaceUsed += GetMemoryChunkSpace(hashtable->bloom);
+	if (hashtable->spaceUsed > hashtable->spacePeak)
+		hashtable->spacePeak = hashtable->spaceUsed;
+}
+
+/*
+ * ExecHashRuntimeFilterStart
+ *		Activate a runtime filter with the bloom filter of a newly built
+ *		hash table
+ *
+ * A bloom filter with too many bits set would remove hardly any tuples, so
+ * the filter stays inactive then.
+ */
+void
+ExecHashRuntimeFilterStart(HashJoinRuntimeFilter *filter,
+						   HashJoinTable hashtable)
+{
+	filter->hashtable = NULL;
+	filter->nprobed = 0;
+	filter->nremoved = 0;
+
+	if (hashtable->bloom == NULL ||
+		bloom_prop_bits_set(hashtable->bloom) > RUNTIME_FILTER_MAX_BITS_SET)
+		return;
+
+	filter->hashtable = hashtable;
+}
+
+/*
+ * ExecHashRuntimeFilterPass
+ *		Check whether the scan tuple in econtext->ecxt_scantuple can have a
+ *		join partner in the hash table
+ *
+ * This is evaluated by the outer scan of a hash join for every tuple that
+ * passed its quals, so that tuples without a partner are discarded before
+ * they are projected and handed up to the join.  The hash value is computed
+ * from the join's outer hash keys, remapped to the scan tuple, and looked up
+ * in the bloom filter built along with the hash table.  A false result means
+ * the tuple certainly has no match; the join only requests filtering for
+ * join types that discard such tuples anyway.
+ *
+ * econtext is not reset here, as the scan may have projected earlier rows
+ * of a batch into its per-tuple memory.  If the filter turns out to remove
+ * too few tuples to pay for itself, it disables itself.
+ */
+bool
+ExecHashRuntimeFilterPass(HashJoinRuntimeFilter *filter,
+						  ExprContext *econtext)
+{
+	HashJoinTable hashtable = filter->hashtable;
+	uint32		hashvalue;
+	bool		pass;
+
+	if (hashtable == NULL)
+		return true;
+
+	pass = ExecHashComputeHashValue(hashtable, econtext, filter->hashkeys,
+									true, false, &hashvalue) &&
+		!bloom_lacks_element(hashtable->bloom, (unsigned char *) &hashvalue,
+							 sizeof(hashvalue));
+
+	filter->nprobed += 1;
+	if (!pass)
+		filter->nremoved += 1;
+
+	if (filter->nprobed == RUNTIME_FILTER_MIN_PROBED &&
+		filter->nremoved < filter->nprobed * RUNTIME_FILTER_MIN_REMOVED)
+		filter->hashtable = NULL;
+
+	return pass;
+}
+
 /*
  * ExecHashGetBucketAndBatch
  *		Determine the bucket number and batch number for a hash value
@@ -1971,7 +2120,14 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
 	else
+	{
+		/* don't touch the tuples if the bucket's tag rules out a match */
+		if (!(hashtable->bucketTags[hjstate->hj_CurBucketNo] &
+			  HJ_BUCKET_TAG(hashvalue)))
+			return false;
+
 		hashTuple = hashtable->buckets.unshared[hjstate->hj_CurBucketNo];
+	}
 
 	while (hashTuple != NULL)
 	{
@@ -2173,8 +2329,13 @@ ExecHashTableReset(HashJoinTable hashtable)
 	/* Reallocate and reinitialize the hash bucket headers. */
 	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
+	hashtable->bucketTags = (uint16 *)
+		palloc0(nbuckets * sizeof(uint16));
 
+	/* The bloom filter stays, it covers all batches */
 	hashtable->spaceUsed = 0;
+	if (hashtable->bloom)
+		hashtable->spaceUsed += GetMemoryChunkSpace(hashtable->bloom);
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -2530,8 +2691,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			memcpy(copyTuple, hashTuple, tupleSize);
 			pfree(hashTuple);
 
-			copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-			hashtable->buckets.unshared[bucketno] = copyTuple;
+			ExecHashPushTuple(hashtable, bucketno, copyTuple);
 
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
@@ -3226,6 +3386,18 @@ ExecHashTableDetach(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * Insert a tuple at the front of an unshared bucket, and add its hash value
+ * to the bucket's tag.
+ */
+static inline void
+ExecHashPushTuple(HashJoinTable hashtable, int bucketno, HashJoinTuple tuple)
+{
+	tuple->next.unshared = hashtable->buckets.unshared[bucketno];
+	hashtable->buckets.unshared[bucketno] = tuple;
+	hashtable->bucketTags[bucketno] |= HJ_BUCKET_TAG(tuple->hashvalue);
+}
+
 /*
  * Get the first tuple in a given bucket identified by number.
  */
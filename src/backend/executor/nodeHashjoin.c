@@ -101,6 +101,16 @@
  * tuples while in PHJ_BATCH_PROBING phase, but that's OK because we use
  * BarrierArriveAndDetach() to advance it to PHJ_BATCH_DONE without waiting.
  *
+ * RUNTIME FILTERS
+ *
+ * Once the hash table is built, an outer tuple whose hash value matches no
+ * inner tuple is known to be useless for inner, semi and right joins.  If the
+ * outer plan is a plain relation scan, the join hands it a bloom filter over
+ * the inner hash values (a HashJoinRuntimeFilter), so that such tuples are
+ * discarded right after the scan's quals, before they are projected and
+ * passed up.  This is only done for parallel-oblivious joins, whose hash
+ * table is private; it still filters a partial scan below Gather.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -108,11 +118,16 @@
 
 #include "access/htup_details.h"
 #include "access/parallel.h"
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/optimizer.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "utils/memutils.h"
 #include "utils/sharedtuplestore.h"
@@ -136,6 +151,9 @@
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+														HashJoinState *hjstate,
+														uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
@@ -146,6 +164,9 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *node);
+static void ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate,
+										  HashJoin *node);
+static Node *runtime_filter_key_mutator(Node *node, List *tlist);
 
 
 /* ----------------------------------------------------------------
@@ -282,6 +303,11 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/* Collect the inner hash values for the outer scan's filter */
+				if (!parallel && node->hj_RuntimeFilter != NULL)
+					ExecHashTableAddBloomFilter(hashtable,
+												hashNode->ps.plan->plan_rows);
+
 				/*
 				 * Execute the Hash node, to build the hash table.  If using
 				 * Parallel Hash, then we'll try to help hashing unless we
@@ -298,6 +324,10 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (hashtable->totalTuples == 0 && !HJ_FILL_OUTER(node))
 					return NULL;
 
+				if (!parallel && node->hj_RuntimeFilter != NULL)
+					ExecHashRuntimeFilterStart(node->hj_RuntimeFilter,
+											   hashtable);
+
 				/*
 				 * need to remember whether nbatch has increased since we
 				 * began scanning the outer relation
@@ -676,6 +706,12 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_OuterTupleSlot = ExecInitExtraTupleSlot(estate, outerDesc,
 														ops);
 
+	/*
+	 * Outer tuples are fetched one at a time unless our parent tells us that
+	 * it reads all of our output; see ExecHashJoinSetReadToCompletion().
+	 */
+	hjstate->hj_BatchProbe = false;
+
 	/*
 	 * detect whether we need only consider the first matching inner tuple
 	 */
@@ -752,9 +788,136 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	ExecHashJoinInitRuntimeFilter(hjstate, node);
+
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinSetReadToCompletion
+ *
+ *		Our parent reads all of our output (see ExecSetReadToCompletion()),
+ *		so we read all of the outer plan's in any case.  It can then be
+ *		fetched in batches to probe the hash table with, see
+ *		ExecHashJoinOuterGetBatchedTuple(), if the outer plan produces
+ *		batches natively.
+ *
+ *		That still changes the order in which outer rows and join rows are
+ *		computed, which is only unobservable if neither the outer plan nor
+ *		our outer hash keys contain volatile functions.  Natively batching
+ *		plans are projecting Results on top of a SeqScan, so there are few
+ *		expressions to check.
+ */
+void
+ExecHashJoinSetReadToCompletion(HashJoinState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	HashJoin   *hjplan = (HashJoin *) node->js.ps.plan;
+	EState	   *estate = node->js.ps.state;
+	Plan	   *plan;
+
+	if (node->hj_BatchProbe || !ExecSupportsBatch(outerNode))
+		return;
+
+	if (contain_volatile_functions((Node *) hjplan->hashkeys))
+		return;
+
+	for (plan = outerNode->plan; plan != NULL; plan = outerPlan(plan))
+	{
+		if (contain_volatile_functions((Node *) plan->targetlist) ||
+			contain_volatile_functions((Node *) plan->qual))
+			return;
+		if (IsA(plan, Result) &&
+			contain_volatile_functions(((Result *) plan)->resconstantqual))
+			return;
+	}
+
+	node->hj_BatchProbe = true;
+	node->hj_ProbeSlots = (TupleTableSlot **)
+		palloc(sizeof(TupleTableSlot *) * estate->es_batch_size);
+	node->hj_ProbeHashValues = (uint32 *)
+		palloc(sizeof(uint32) * estate->es_batch_size);
+}
+
+/*
+ * ExecHashJoinInitRuntimeFilter
+ *
+ *		Set up a runtime filter on the outer scan, if it's worthwhile and
+ *		safe.  The filter evaluates our outer hash keys on the scan tuple,
+ *		so references to the outer plan's output are replaced by the
+ *		expressions of its targetlist.  Keys that are volatile or contain
+ *		subplans must not be evaluated a second time.
+ *
+ *		The filter is only worthwhile if the planner expects a good part of
+ *		the outer tuples to find no partner.  The join's row estimate bounds
+ *		the number of outer tuples that do (from above, as inner duplicates
+ *		only add to it), which is good enough for that.
+ */
+static void
+ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate, HashJoin *node)
+{
+	PlanState  *outerState = outerPlanState(hjstate);
+	ScanState  *scanState;
+	HashJoinRuntimeFilter *filter;
+	List	   *hashkeys;
+
+	/* Only these join types drop outer tuples without a partner */
+	if (node->join.jointype != JOIN_INNER &&
+		node->join.jointype != JOIN_SEMI &&
+		node->join.jointype != JOIN_RIGHT)
+		return;
+
+	/* A shared hash table has no bloom filter */
+	if (node->join.plan.parallel_aware)
+		return;
+
+	if (!IsA(outerState, SeqScanState) &&
+		!IsA(outerState, IndexScanState) &&
+		!IsA(outerState, IndexOnlyScanState) &&
+		!IsA(outerState, BitmapHeapScanState))
+		return;
+	scanState = (ScanState *) outerState;
+
+	if (node->join.plan.plan_rows >
+		outerState->plan->plan_rows * (1.0 - RUNTIME_FILTER_MIN_REMOVED))
+		return;
+
+	hashkeys = (List *)
+		runtime_filter_key_mutator((Node *) node->hashkeys,
+								   outerState->plan->targetlist);
+	if (contain_volatile_functions((Node *) hashkeys) ||
+		contain_subplans((Node *) hashkeys))
+		return;
+
+	filter = (HashJoinRuntimeFilter *) palloc0(sizeof(HashJoinRuntimeFilter));
+	filter->hashkeys = ExecInitExprList(hashkeys, outerState);
+
+	hjstate->hj_RuntimeFilter = filter;
+	scanState->ss_RuntimeFilter = filter;
+}
+
+/*
+ * Replace the outer Vars of a hash key by the outer plan's tlist entries
+ */
+static Node *
+runtime_filter_key_mutator(Node *node, List *tlist)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var) && ((Var *) node)->varno == OUTER_VAR)
+	{
+		Var		   *var = (Var *) node;
+		TargetEntry *tle = get_tle_by_resno(tlist, var->varattno);
+
+		if (tle == NULL)
+			elog(ERROR, "hash key references nonexistent outer column %d",
+				 var->varattno);
+		return (Node *) copyObject(tle->expr);
+	}
+	return expression_tree_mutator(node, runtime_filter_key_mutator,
+								   (void *) tlist);
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -769,6 +932,8 @@ ExecEndHashJoin(HashJoinState *node)
 	 */
 	if (node->hj_HashTable)
 	{
+		if (node->hj_RuntimeFilter)
+			node->hj_RuntimeFilter->hashtable = NULL;
 		ExecHashTableDestroy(node->hj_HashTable);
 		node->hj_HashTable = NULL;
 	}
@@ -822,6 +987,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 		slot = hjstate->hj_FirstOuterTupleSlot;
 		if (!TupIsNull(slot))
 			hjstate->hj_FirstOuterTupleSlot = NULL;
+		else if (hjstate->hj_BatchProbe)
+			return ExecHashJoinOuterGetBatchedTuple(outerNode, hjstate,
+													hashvalue);
 		else
 			slot = ExecProcNode(outerNode);
 
@@ -849,6 +1017,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			 * That tuple couldn't match because of a NULL, so discard it and
 			 * continue with the next one.
 			 */
+			if (hjstate->hj_BatchProbe)
+				return ExecHashJoinOuterGetBatchedTuple(outerNode, hjstate,
+														hashvalue);
 			slot = ExecProcNode(outerNode);
 		}
 	}
@@ -875,6 +1046,88 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinOuterGetBatchedTuple
+ *
+ *		ExecHashJoinOuterGetTuple() for the first pass, when the outer plan
+ *		produces batches of tuples.
+ *
+ *		Probing the hash table one outer tuple at a time, nearly every probe
+ *		of a large table waits for a cache miss on the bucket and then on
+ *		the first tuple in it.  Instead, all tuples of an outer batch are
+ *		hashed first while prefetching the bucket headers and tags they
+ *		need, then the first tuple of each bucket that may contain a match
+ *		is prefetched.  By the time the tuples are returned one by one to be
+ *		matched, the memory they touch is likely to be in cache.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+								 HashJoinState *hjstate,
+								 uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+	int			pos;
+
+	while (hjstate->hj_ProbePos >= hjstate->hj_ProbeCount)
+	{
+		TupleBatch *batch = ExecProcNodeBatch(outerNode);
+		int			bucketno;
+		int			batchno;
+		int			nprobe = 0;
+		int			i;
+
+		if (batch == NULL)
+			return NULL;
+
+		for (i = 0; i < batch->nrows; i++)
+		{
+			TupleTableSlot *slot = batch->slots[i];
+			uint32		hash;
+
+			econtext->ecxt_outertuple = slot;
+			if (!ExecHashGetHashValue(hashtable, econtext,
+									  hjstate->hj_OuterHashKeys,
+									  true, /* outer tuple */
+									  HJ_FILL_OUTER(hjstate),
+									  &hash))
+				continue;		/* can't match because of a NULL */
+
+			ExecHashGetBucketAndBatch(hashtable, hash, &bucketno, &batchno);
+			if (batchno == hashtable->curbatch)
+			{
+				pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+				pg_prefetch_mem(&hashtable->bucketTags[bucketno]);
+			}
+
+			hjstate->hj_ProbeSlots[nprobe] = slot;
+			hjstate->hj_ProbeHashValues[nprobe] = hash;
+			nprobe++;
+		}
+
+		for (i = 0; i < nprobe; i++)
+		{
+			uint32		hash = hjstate->hj_ProbeHashValues[i];
+
+			ExecHashGetBucketAndBatch(hashtable, hash, &bucketno, &batchno);
+			if (batchno == hashtable->curbatch &&
+				(hashtable->bucketTags[bucketno] & HJ_BUCKET_TAG(hash)))
+				pg_prefetch_mem(hashtable->buckets.unshared[bucketno]);
+		}
+
+		hjstate->hj_ProbeCount = nprobe;
+		hjstate->hj_ProbePos = 0;
+	}
+
+	/* remember outer relation is not empty for possible rescan */
+	hjstate->hj_OuterNotEmpty = true;
+
+	pos = hjstate->hj_ProbePos++;
+	*hashvalue = hjstate->hj_ProbeHashValues[pos];
+
+	return hjstate->hj_ProbeSlots[pos];
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -1341,6 +1594,8 @@ ExecReScanHashJoin(HashJoinState *node)
 											 hashNode->hashtable);
 			/* for safety, be sure to clear child plan node's pointer too */
 			hashNode->hashtable = NULL;
+			if (node->hj_RuntimeFilter)
+				node->hj_RuntimeFilter->hashtable = NULL;
 
 			ExecHashTableDestroy(node->hj_HashTable);
 			node->hj_HashTable = NULL;
@@ -1363,6 +1618,8 @@ ExecReScanHashJoin(HashJoinState *node)
 
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
+	node->hj_ProbeCount = 0;
+	node->hj_ProbePos = 0;
 
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
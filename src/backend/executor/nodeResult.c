@@ -45,6 +45,7 @@
 
 #include "postgres.h"
 
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeResult.h"
 #include "miscadmin.h"
@@ -139,6 +140,71 @@ ExecResult(PlanState *pstate)
 	return NULL;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecResultBatch(node)
+ *
+ *		Batch variant of ExecResult: projects a whole batch of tuples
+ *		from the outer plan at a time.  Only used if there is an outer
+ *		plan with native batch support.
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+ExecResultBatch(PlanState *pstate)
+{
+	ResultState *node = castNode(ResultState, pstate);
+	PlanState  *outerPlan = outerPlanState(node);
+	ExprContext *econtext;
+	TupleBatch *outerBatch;
+	TupleBatch *batch;
+	int			i;
+
+	Assert(outerPlan != NULL);
+
+	CHECK_FOR_INTERRUPTS();
+
+	econtext = node->ps.ps_ExprContext;
+
+	/*
+	 * check constant qualifications like (2 > 1), if not already done
+	 */
+	if (node->rs_checkqual)
+	{
+		bool		qualResult = ExecQual(node->resconstantqual, econtext);
+
+		node->rs_checkqual = false;
+		if (!qualResult)
+		{
+			node->rs_done = true;
+			return NULL;
+		}
+	}
+
+	if (node->rs_done)
+		return NULL;
+
+	/*
+	 * Reset per-tuple memory context to free any expression evaluation
+	 * storage allocated for the previous batch.
+	 */
+	ResetExprContext(econtext);
+
+	outerBatch = ExecProcNodeBatch(outerPlan);
+	if (outerBatch == NULL)
+		return NULL;
+
+	batch = ExecGetResultBatch(pstate);
+	Assert(outerBatch->nrows <= batch->maxrows);
+
+	for (i = 0; i < outerBatch->nrows; i++)
+	{
+		econtext->ecxt_outertuple = outerBatch->slots[i];
+		ExecProjectBatchRow(node->ps.ps_ProjInfo, batch->slots[i]);
+	}
+	batch->nrows = outerBatch->nrows;
+
+	return batch;
+}
+
 /* ----------------------------------------------------------------
  *		ExecResultMarkPos
  * ----------------------------------------------------------------
@@ -209,6 +275,14 @@ ExecInitResult(Result *node, EState *estate, int eflags)
 	 */
 	outerPlanState(resstate) = ExecInitNode(outerPlan(node), estate, eflags);
 
+	/*
+	 * Projecting batches is only worthwhile if the outer plan produces them
+	 * natively.  A constant target list yields just one tuple anyway.
+	 */
+	if (outerPlanState(resstate) != NULL &&
+		ExecSupportsBatch(outerPlanState(resstate)))
+		resstate->ps.ExecProcNodeBatch = ExecResultBatch;
+
 	/*
 	 * we don't use inner plan
 	 */
@@ -15,6 +15,7 @@
 /*
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
+ *		ExecSeqScanBatch		sequentially scans a relation in batches.
  *		ExecSeqNext				retrieve next tuple in sequential order.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
@@ -29,10 +30,12 @@
 
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
 #include "utils/rel.h"
 
+static bool SeqNextSlot(SeqScanState *node, TupleTableSlot *slot);
 static TupleTableSlot *SeqNext(SeqScanState *node);
 
 /* ----------------------------------------------------------------
@@ -41,18 +44,19 @@ static TupleTableSlot *SeqNext(SeqScanState *node);
  */
 
 /* ----------------------------------------------------------------
- *		SeqNext
+ *		SeqNextSlot
  *
- *		This is a workhorse for ExecSeqScan
+ *		Store the next tuple of the relation into the given slot.
+ *		Returns false at the end of the scan.  This is a workhorse
+ *		for ExecSeqScan and ExecSeqScanBatch.
  * ----------------------------------------------------------------
  */
-static TupleTableSlot *
-SeqNext(SeqScanState *node)
+static bool
+SeqNextSlot(SeqScanState *node, TupleTableSlot *slot)
 {
 	TableScanDesc scandesc;
 	EState	   *estate;
 	ScanDirection direction;
-	TupleTableSlot *slot;
 
 	/*
 	 * get information from the estate and scan state
@@ -60,7 +64,6 @@ SeqNext(SeqScanState *node)
 	scandesc = node->ss.ss_currentScanDesc;
 	estate = node->ss.ps.state;
 	direction = estate->es_direction;
-	slot = node->ss.ss_ScanTupleSlot;
 
 	if (scandesc == NULL)
 	{
@@ -77,7 +80,21 @@ SeqNext(SeqScanState *node)
 	/*
 	 * get the next tuple from the table
 	 */
-	if (table_scan_getnextslot(scandesc, direction, slot))
+	return table_scan_getnextslot(scandesc, direction, slot);
+}
+
+/* ----------------------------------------------------------------
+ *		SeqNext
+ *
+ *		Fetch the next tuple into the scan slot
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+SeqNext(SeqScanState *node)
+{
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	if (SeqNextSlot(node, slot))
 		return slot;
 	return NULL;
 }
@@ -114,6 +131,22 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Scans the relation sequentially and returns the next batch of
+ *		qualifying tuples, see ExecScanBatch().
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+ExecSeqScanBatch(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	return ExecScanBatch(&node->ss,
+						 (ExecScanSlotAccessMtd) SeqNextSlot);
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -138,6 +171,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
 	scanstate->ss.ps.ExecProcNode = ExecSeqScan;
+	scanstate->ss.ps.ExecProcNodeBatch = ExecSeqScanBatch;
 
 	/*
 	 * Miscellaneous initialization
@@ -201,6 +235,8 @@ ExecEndSeqScan(SeqScanState *node)
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (node->ss.ss_ScanBatch)
+		ExecClearTupleBatch(node->ss.ss_ScanBatch);
 
 	/*
 	 * close heap scan
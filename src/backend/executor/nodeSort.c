@@ -10,16 +10,99 @@
  * IDENTIFICATION
  *	  src/backend/executor/nodeSort.c
  *
+ * NOTES
+ *	  Parallel Sort
+ *
+ *	  A parallel-aware Sort, used for the inner side of a Parallel Merge
+ *	  Join, sorts its partial outer plan together with the other participants
+ *	  and returns the complete sorted result to each of them.  This is a
+ *	  sample sort: every participant spools its share of the input and
+ *	  contributes a random sample of it.  One participant sorts the samples
+ *	  and picks splitters that divide the key space into ranges of about the
+ *	  same number of tuples.  Every participant then routes its spooled
+ *	  tuples to shared partitions by key range, and the participants claim
+ *	  whole partitions, sort them and write them to shared files.  Finally,
+ *	  each one reads the sorted partitions in key order.  No participant
+ *	  sorts more than a share of the input, and no merge step is needed.
+ *
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
 #include "access/parallel.h"
+#include "common/pg_prng.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/buffile.h"
+#include "storage/sharedfileset.h"
+#include "utils/sharedtuplestore.h"
+#include "utils/sortsupport.h"
 #include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
+#include "utils/wait_event.h"
+
+/*
+ * Shared state of a Parallel Sort, followed in memory by npartitions + 1
+ * SharedTuplestores: the partitions and the sample (see ParallelSortStore()).
+ *
+ * The barrier's phases are the steps of the sort.  While in PS_PHASE_READING,
+ * every participant spools its share of the input and writes its sample.  In
+ * PS_PHASE_SPLITTING, the participant elected at the end of the previous
+ * phase writes the splitters to a shared file.  In PS_PHASE_PARTITIONING,
+ * every participant routes its spooled tuples to the partitions, and in
+ * PS_PHASE_SORTING, partitions are handed out by incrementing next_partition
+ * and written back sorted.  In PS_PHASE_DONE, the result can be read.
+ */
+typedef struct ParallelSortState
+{
+	Barrier		barrier;		/* synchronizes the steps of the sort */
+	pg_atomic_uint32 next_partition;	/* next partition to sort */
+	int			nparticipants;	/* leader and planned workers */
+	int			npartitions;	/* number of partitions */
+	SharedFileSet fileset;		/* space for all files */
+} ParallelSortState;
+
+#define PS_PHASE_READING			0
+#define PS_PHASE_SPLITTING			1
+#define PS_PHASE_PARTITIONING		2
+#define PS_PHASE_SORTING			3
+#define PS_PHASE_DONE				4
+
+/* partitions per participant, to even out differences in sorting speed */
+#define PS_PARTITIONS_PER_PARTICIPANT	4
+
+/* sampled tuples per participant, about 32 per partition */
+#define PS_SAMPLE_SIZE	128
+
+/* shm_toc key of the shared state; plan_node_id is used by SharedSortInfo */
+#define PS_TOC_KEY(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (plan_node_id))
+
+static inline SharedTuplestore *
+ParallelSortStore(ParallelSortState *pstate, int storeno)
+{
+	Size		stssize = MAXALIGN(sts_estimate(pstate->nparticipants));
+
+	return (SharedTuplestore *) ((char *) pstate +
+								 MAXALIGN(sizeof(ParallelSortState)) +
+								 storeno * stssize);
+}
+
+static TupleTableSlot *ExecParallelSort(PlanState *pstate);
+static void ExecSortShared(SortState *node);
+static Tuplesortstate *sort_begin_shared(SortState *node);
+static Tuplestorestate *sort_spool_shared_input(SortState *node);
+static void sort_choose_splitters(SortState *node);
+static void sort_partition_shared_input(SortState *node,
+										Tuplestorestate *spool);
+static void sort_shared_partitions(SortState *node);
+static MinimalTuple sort_read_tuple(SortState *node, BufFile *file);
+static BufFile *sort_open_file(SortState *node, const char *name);
+static void sort_open_partition(SortState *node, int partno);
 
 
 /* ----------------------------------------------------------------
@@ -209,6 +292,497 @@ ExecSort(PlanState *pstate)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecParallelSort
+ *
+ *		ExecSort for a Parallel Sort: sort the input together with the
+ *		other participants, then return the tuples of the sorted
+ *		partitions in order.  Only forward scans are supported.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecParallelSort(PlanState *pstate)
+{
+	SortState  *node = castNode(SortState, pstate);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	MinimalTuple tuple;
+
+	CHECK_FOR_INTERRUPTS();
+
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	if (!node->sort_Done)
+	{
+		ExecSortShared(node);
+		node->sort_Done = true;
+	}
+
+	for (;;)
+	{
+		if (node->pfile == NULL)
+		{
+			if (node->pcurpart + 1 >= node->pstate->npartitions)
+				return ExecClearTuple(slot);
+			sort_open_partition(node, node->pcurpart + 1);
+		}
+
+		tuple = sort_read_tuple(node, node->pfile);
+		if (tuple != NULL)
+			return ExecStoreMinimalTuple(tuple, slot, false);
+
+		/* end of this partition, the next one may follow */
+		BufFileClose(node->pfile);
+		node->pfile = NULL;
+	}
+}
+
+/*
+ * Take part in all steps of a Parallel Sort that have not been completed
+ * yet, and wait until the sorted partitions are complete.
+ *
+ * A participant that starts late will find reading the input finished; its
+ * share of the partial outer plan is then empty, as the others have read it
+ * all.  It can still help with the remaining steps.
+ */
+static void
+ExecSortShared(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	Tuplestorestate *spool = NULL;
+
+	node->pattached = true;
+	switch (BarrierAttach(&pstate->barrier))
+	{
+		case PS_PHASE_READING:
+			spool = sort_spool_shared_input(node);
+			if (BarrierArriveAndWait(&pstate->barrier,
+									 WAIT_EVENT_SORT_EXCHANGE))
+				sort_choose_splitters(node);
+			/* FALLTHROUGH */
+
+		case PS_PHASE_SPLITTING:
+			BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_SORT_EXCHANGE);
+			/* FALLTHROUGH */
+
+		case PS_PHASE_PARTITIONING:
+			sort_partition_shared_input(node, spool);
+			BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_SORT_EXCHANGE);
+			/* FALLTHROUGH */
+
+		case PS_PHASE_SORTING:
+			sort_shared_partitions(node);
+			BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_SORT_EXCHANGE);
+			/* FALLTHROUGH */
+
+		default:
+			break;
+	}
+
+	Assert(BarrierPhase(&pstate->barrier) == PS_PHASE_DONE);
+	BarrierDetach(&pstate->barrier);
+	node->pattached = false;
+}
+
+/*
+ * Begin a sort of the outer plan's tuples by the node's sort keys.
+ */
+static Tuplesortstate *
+sort_begin_shared(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+
+	return tuplesort_begin_heap(ExecGetResultType(outerPlanState(node)),
+								plannode->numCols,
+								plannode->sortColIdx,
+								plannode->sortOperators,
+								plannode->collations,
+								plannode->nullsFirst,
+								work_mem,
+								NULL,
+								TUPLESORT_NONE);
+}
+
+/*
+ * Read all tuples of our share of the input into a private spool, and write
+ * a random sample of them to the shared sample.
+ */
+static Tuplestorestate *
+sort_spool_shared_input(SortState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	Tuplestorestate *spool;
+	MinimalTuple sample[PS_SAMPLE_SIZE];
+	int			nsample = 0;
+	uint64		nseen = 0;
+	int			i;
+
+	spool = tuplestore_begin_heap(false, false, work_mem);
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+		uint64		k;
+
+		if (TupIsNull(slot))
+			break;
+		tuplestore_puttupleslot(spool, slot);
+
+		/*
+		 * Keep a uniform sample of the tuples seen so far: the n-th tuple
+		 * replaces a random member of a full sample with probability
+		 * PS_SAMPLE_SIZE / n.
+		 */
+		if (nsample < PS_SAMPLE_SIZE)
+			sample[nsample++] = ExecCopySlotMinimalTuple(slot);
+		else if ((k = pg_prng_uint64_range(&pg_global_prng_state,
+										   0, nseen)) < PS_SAMPLE_SIZE)
+		{
+			pfree(sample[k]);
+			sample[k] = ExecCopySlotMinimalTuple(slot);
+		}
+		nseen++;
+	}
+
+	for (i = 0; i < nsample; i++)
+	{
+		sts_puttuple(node->psample, NULL, sample[i]);
+		pfree(sample[i]);
+	}
+	sts_end_write(node->psample);
+
+	return spool;
+}
+
+/*
+ * Sort the samples of all participants, and write every
+ * (nsamples / npartitions)-th of them to the shared splitters file.  The
+ * partitions' key ranges are bounded by these splitters.
+ */
+static void
+sort_choose_splitters(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	Tuplesortstate *sortstate;
+	MinimalTuple tuple;
+	BufFile    *file;
+	int64		nsamples = 0;
+	int64		pos;
+	int			nsplitters = 0;
+
+	sortstate = sort_begin_shared(node);
+
+	sts_begin_parallel_scan(node->psample);
+	while ((tuple = sts_parallel_scan_next(node->psample, NULL)) != NULL)
+	{
+		ExecStoreMinimalTuple(tuple, slot, false);
+		tuplesort_puttupleslot(sortstate, slot);
+		nsamples++;
+	}
+	sts_end_parallel_scan(node->psample);
+
+	tuplesort_performsort(sortstate);
+
+	file = BufFileCreateFileSet(&pstate->fileset.fs, "splitters");
+	for (pos = 0;
+		 nsplitters < pstate->npartitions - 1 &&
+		 tuplesort_gettupleslot(sortstate, true, false, slot, NULL);
+		 pos++)
+	{
+		/* with few samples, the same one may bound several partitions */
+		while (nsplitters < pstate->npartitions - 1 &&
+			   pos == (nsplitters + 1) * nsamples / pstate->npartitions)
+		{
+			bool		shouldFree;
+
+			tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+			BufFileWrite(file, (void *) tuple, tuple->t_len);
+			if (shouldFree)
+				pfree(tuple);
+			nsplitters++;
+		}
+	}
+	BufFileClose(file);
+
+	ExecClearTuple(slot);
+	tuplesort_end(sortstate);
+}
+
+/*
+ * Compare the sort keys of a tuple to those of a splitter.
+ */
+static int
+sort_compare_splitter(SortSupport sortkeys, int nkeys,
+					  TupleTableSlot *splitter, TupleTableSlot *slot)
+{
+	int			nkey;
+
+	for (nkey = 0; nkey < nkeys; nkey++)
+	{
+		SortSupport sortKey = sortkeys + nkey;
+		AttrNumber	attno = sortKey->ssup_attno;
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+		int			compare;
+
+		datum1 = slot_getattr(splitter, attno, &isNull1);
+		datum2 = slot_getattr(slot, attno, &isNull2);
+
+		compare = ApplySortComparator(datum1, isNull1,
+									  datum2, isNull2,
+									  sortKey);
+		if (compare != 0)
+			return compare;
+	}
+	return 0;
+}
+
+/*
+ * Route the spooled tuples to the shared partitions, by comparing them to
+ * the splitters.  Partition i receives tuples between splitters i - 1 and i,
+ * inclusive, so a tuple equal to one or more splitters may go to any of
+ * several partitions.  Such tuples are spread over them in turn, so that
+ * even a heavily duplicated key doesn't end up in a single partition.
+ */
+static void
+sort_partition_shared_input(SortState *node, Tuplestorestate *spool)
+{
+	ParallelSortState *pstate = node->pstate;
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleDesc	tupDesc = ExecGetResultType(outerPlanState(node));
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot **splitters;
+	SortSupport sortkeys;
+	BufFile    *file;
+	MinimalTuple tuple;
+	int			nsplitters = 0;
+	uint32		nequal = 0;
+	int			partno;
+	int			i;
+
+	/* Load the splitters */
+	splitters = palloc(sizeof(TupleTableSlot *) * (pstate->npartitions - 1));
+	file = sort_open_file(node, "splitters");
+	while ((tuple = sort_read_tuple(node, file)) != NULL)
+	{
+		Assert(nsplitters < pstate->npartitions - 1);
+		splitters[nsplitters] = MakeSingleTupleTableSlot(tupDesc,
+														 &TTSOpsMinimalTuple);
+		ExecStoreMinimalTuple(heap_copy_minimal_tuple(tuple),
+							  splitters[nsplitters], true);
+		nsplitters++;
+	}
+	BufFileClose(file);
+
+	sortkeys = palloc0(sizeof(SortSupportData) * plannode->numCols);
+	for (i = 0; i < plannode->numCols; i++)
+	{
+		SortSupport sortKey = sortkeys + i;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = plannode->collations[i];
+		sortKey->ssup_nulls_first = plannode->nullsFirst[i];
+		sortKey->ssup_attno = plannode->sortColIdx[i];
+		sortKey->abbreviate = false;
+
+		PrepareSortSupportFromOrderingOp(plannode->sortOperators[i], sortKey);
+	}
+
+	while (spool != NULL && tuplestore_gettupleslot(spool, true, false, slot))
+	{
+		int			lo;
+		int			hi;
+		int			first;
+		bool		shouldFree;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* find the first splitter that is >= the tuple */
+		lo = 0;
+		hi = nsplitters;
+		while (lo < hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (sort_compare_splitter(sortkeys, plannode->numCols,
+									  splitters[mid], slot) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		first = lo;
+
+		/* ... and the first one that is > the tuple */
+		hi = nsplitters;
+		while (lo < hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (sort_compare_splitter(sortkeys, plannode->numCols,
+									  splitters[mid], slot) <= 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if (first == lo)
+			partno = first;
+		else
+			partno = first + nequal++ % (lo - first + 1);
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->pparts[partno], NULL, tuple);
+		if (shouldFree)
+			pfree(tuple);
+	}
+	ExecClearTuple(slot);
+
+	for (partno = 0; partno < pstate->npartitions; partno++)
+		sts_end_write(node->pparts[partno]);
+
+	if (spool != NULL)
+		tuplestore_end(spool);
+	for (i = 0; i < nsplitters; i++)
+		ExecDropSingleTupleTableSlot(splitters[i]);
+	pfree(splitters);
+	pfree(sortkeys);
+}
+
+/*
+ * Claim partitions that no participant has sorted yet, sort them and write
+ * them to shared files, until there are none left.
+ */
+static void
+sort_shared_partitions(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	uint32		partno;
+
+	while ((partno = pg_atomic_fetch_add_u32(&pstate->next_partition, 1)) <
+		   (uint32) pstate->npartitions)
+	{
+		Tuplesortstate *sortstate;
+		MinimalTuple tuple;
+		BufFile    *file;
+		char		name[MAXPGPATH];
+
+		sortstate = sort_begin_shared(node);
+
+		sts_begin_parallel_scan(node->pparts[partno]);
+		while ((tuple = sts_parallel_scan_next(node->pparts[partno],
+											   NULL)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+			ExecStoreMinimalTuple(tuple, slot, false);
+			tuplesort_puttupleslot(sortstate, slot);
+		}
+		sts_end_parallel_scan(node->pparts[partno]);
+
+		tuplesort_performsort(sortstate);
+
+		snprintf(name, sizeof(name), "sorted.%u", partno);
+		file = BufFileCreateFileSet(&pstate->fileset.fs, name);
+		while (tuplesort_gettupleslot(sortstate, true, false, slot, NULL))
+		{
+			bool		shouldFree;
+
+			tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+			BufFileWrite(file, (void *) tuple, tuple->t_len);
+			if (shouldFree)
+				pfree(tuple);
+		}
+		BufFileClose(file);
+		ExecClearTuple(slot);
+
+		/* report the partition that took the most space */
+		if (node->shared_info && node->am_worker)
+		{
+			TuplesortInstrumentation stats;
+			TuplesortInstrumentation *si;
+
+			Assert(IsParallelWorker());
+			Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+			si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+			tuplesort_get_stats(sortstate, &stats);
+			if (stats.spaceUsed >= si->spaceUsed)
+				*si = stats;
+		}
+
+		tuplesort_end(sortstate);
+	}
+}
+
+/*
+ * Read the next tuple from a file written by a Parallel Sort, or return NULL
+ * at its end.  The tuple is valid until the next call.
+ */
+static MinimalTuple
+sort_read_tuple(SortState *node, BufFile *file)
+{
+	uint32		t_len;
+	size_t		nread;
+	MinimalTuple tuple;
+
+	nread = BufFileRead(file, (void *) &t_len, sizeof(t_len));
+	if (nread == 0)				/* end of file */
+		return NULL;
+	if (nread != sizeof(t_len))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from parallel sort temporary file: read only %zu of %zu bytes",
+						nread, sizeof(t_len))));
+
+	if (t_len > node->preadbuflen)
+	{
+		if (node->preadbuf != NULL)
+			pfree(node->preadbuf);
+		node->preadbuflen = Max(t_len, node->preadbuflen * 2);
+		node->preadbuf = MemoryContextAlloc(node->ss.ps.state->es_query_cxt,
+											node->preadbuflen);
+	}
+
+	tuple = (MinimalTuple) node->preadbuf;
+	tuple->t_len = t_len;
+	nread = BufFileRead(file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						t_len - sizeof(uint32));
+	if (nread != t_len - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from parallel sort temporary file: read only %zu of %zu bytes",
+						nread, t_len - sizeof(uint32))));
+
+	return tuple;
+}
+
+/*
+ * Open a file of the Parallel Sort that another participant may have
+ * written, for reading.
+ */
+static BufFile *
+sort_open_file(SortState *node, const char *name)
+{
+	return BufFileOpenFileSet(&node->pstate->fileset.fs, name, O_RDONLY,
+							  false);
+}
+
+/*
+ * Start reading the given sorted partition.
+ */
+static void
+sort_open_partition(SortState *node, int partno)
+{
+	char		name[MAXPGPATH];
+
+	Assert(node->pfile == NULL);
+	snprintf(name, sizeof(name), "sorted.%d", partno);
+	node->pfile = sort_open_file(node, name);
+	node->pcurpart = partno;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -246,6 +820,9 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
 
+	/* Parallel Sort state is set up with the DSM, if at all */
+	sortstate->pcurpart = -1;
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -263,6 +840,9 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 
 	outerPlanState(sortstate) = ExecInitNode(outerPlan(node), estate, eflags);
 
+	/* Even a bounded sort reads all of its input */
+	ExecSetReadToCompletion(outerPlanState(sortstate));
+
 	/*
 	 * Initialize scan slot and type.
 	 */
@@ -279,9 +859,11 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 
 	/*
 	 * We perform a Datum sort when we're sorting just a single byval column,
-	 * otherwise we perform a tuple sort.
+	 * otherwise we perform a tuple sort.  A Parallel Sort always passes
+	 * tuples between participants.
 	 */
-	if (outerTupDesc->natts == 1 && TupleDescAttr(outerTupDesc, 0)->attbyval)
+	if (!node->plan.parallel_aware &&
+		outerTupDesc->natts == 1 && TupleDescAttr(outerTupDesc, 0)->attbyval)
 		sortstate->datumSort = true;
 	else
 		sortstate->datumSort = false;
@@ -340,6 +922,23 @@ ExecSortMarkPos(SortState *node)
 	if (!node->sort_Done)
 		return;
 
+	if (node->pstate != NULL)
+	{
+		/* remember the start of the next partition if at end of one */
+		if (node->pfile == NULL)
+		{
+			node->pmarkpart = node->pcurpart + 1;
+			node->pmarkfileno = 0;
+			node->pmarkoffset = 0;
+		}
+		else
+		{
+			node->pmarkpart = node->pcurpart;
+			BufFileTell(node->pfile, &node->pmarkfileno, &node->pmarkoffset);
+		}
+		return;
+	}
+
 	tuplesort_markpos((Tuplesortstate *) node->tuplesortstate);
 }
 
@@ -361,6 +960,30 @@ ExecSortRestrPos(SortState *node)
 	/*
 	 * restore the scan to the previously marked position
 	 */
+	if (node->pstate != NULL)
+	{
+		if (node->pfile == NULL || node->pcurpart != node->pmarkpart)
+		{
+			if (node->pfile != NULL)
+			{
+				BufFileClose(node->pfile);
+				node->pfile = NULL;
+			}
+			if (node->pmarkpart >= node->pstate->npartitions)
+			{
+				node->pcurpart = node->pstate->npartitions - 1;
+				return;
+			}
+			sort_open_partition(node, node->pmarkpart);
+		}
+		if (BufFileSeek(node->pfile, node->pmarkfileno, node->pmarkoffset,
+						SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in parallel sort temporary file")));
+		return;
+	}
+
 	tuplesort_restorepos((Tuplesortstate *) node->tuplesortstate);
 }
 
@@ -380,6 +1003,21 @@ ExecReScanSort(SortState *node)
 	/* must drop pointer to sort result tuple */
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
+	/*
+	 * A Parallel Sort is only rescanned along with its Gather, which resets
+	 * the shared state in ExecSortReInitializeDSM(), so it always starts
+	 * over.  Here we only forget our part in it.
+	 */
+	if (node->pstate != NULL)
+	{
+		ExecShutdownSort(node);
+		node->pcurpart = -1;
+		node->sort_Done = false;
+		if (outerPlan->chgParam == NULL)
+			ExecReScan(outerPlan);
+		return;
+	}
+
 	/*
 	 * If subnode is to be rescanned then we forget previous sort results; we
 	 * have to re-read the subplan and re-sort.  Also must re-sort if the
@@ -412,10 +1050,75 @@ ExecReScanSort(SortState *node)
  * ----------------------------------------------------------------
  */
 
+/*
+ * Does this node run as a Parallel Sort?  Without workers the leader sorts
+ * all the input on its own.  This must give the same answer at estimate
+ * time, before the DSM segment exists, as when the segment is initialized;
+ * nworkers can only drop to zero in between (if no segment could be
+ * created), which merely leaves the estimate unused.
+ */
+static bool
+ExecSortIsShared(SortState *node, ParallelContext *pcxt)
+{
+	return node->ss.ps.plan->parallel_aware && pcxt->nworkers > 0;
+}
+
+/*
+ * Size of the shared state of a Parallel Sort, including its partitions and
+ * its sample.
+ */
+static Size
+ExecSortSharedSize(int nparticipants)
+{
+	Size		size;
+
+	size = mul_size(MAXALIGN(sts_estimate(nparticipants)),
+					nparticipants * PS_PARTITIONS_PER_PARTICIPANT + 1);
+	return add_size(size, MAXALIGN(sizeof(ParallelSortState)));
+}
+
+/*
+ * Set up the barrier, the empty partitions and the empty sample of a
+ * Parallel Sort, as the leader.  The accessors are created in their own
+ * context, so that a rescan can free the previous ones at once.
+ */
+static void
+ExecSortInitializeShared(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	MemoryContext oldcxt;
+	int			partno;
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_init_u32(&pstate->next_partition, 0);
+
+	oldcxt = MemoryContextSwitchTo(node->paccessorcxt);
+	node->pparts = palloc(sizeof(SharedTuplestoreAccessor *) *
+						  pstate->npartitions);
+	for (partno = 0; partno < pstate->npartitions; partno++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "partition.%d", partno);
+		node->pparts[partno] =
+			sts_initialize(ParallelSortStore(pstate, partno),
+						   pstate->nparticipants, 0, 0,
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset, name);
+	}
+	node->psample =
+		sts_initialize(ParallelSortStore(pstate, pstate->npartitions),
+					   pstate->nparticipants, 0, 0,
+					   SHARED_TUPLESTORE_SINGLE_PASS,
+					   &pstate->fileset, "sample");
+	MemoryContextSwitchTo(oldcxt);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics, and for
+ *		the shared state of a Parallel Sort.
  * ----------------------------------------------------------------
  */
 void
@@ -423,6 +1126,13 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (ExecSortIsShared(node, pcxt))
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   ExecSortSharedSize(pcxt->nworkers + 1));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -436,7 +1146,8 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics, and the shared state
+ *		of a Parallel Sort.
  * ----------------------------------------------------------------
  */
 void
@@ -444,6 +1155,27 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (ExecSortIsShared(node, pcxt))
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+		ParallelSortState *pstate;
+
+		pstate = shm_toc_allocate(pcxt->toc,
+								  ExecSortSharedSize(nparticipants));
+		pstate->nparticipants = nparticipants;
+		pstate->npartitions = nparticipants * PS_PARTITIONS_PER_PARTICIPANT;
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		shm_toc_insert(pcxt->toc, PS_TOC_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->pstate = pstate;
+		node->paccessorcxt = AllocSetContextCreate(CurrentMemoryContext,
+												   "Parallel Sort accessors",
+												   ALLOCSET_SMALL_SIZES);
+		ExecSortInitializeShared(node);
+		ExecSetExecProcNode(&node->ss.ps, ExecParallelSort);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -458,18 +1190,84 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset the shared state of a Parallel Sort before beginning a
+ *		fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	ParallelSortState *pstate = node->pstate;
+
+	if (pstate == NULL)
+		return;
+
+	/* Detach, if we didn't get to the end of the last scan. */
+	ExecShutdownSort(node);
+	node->pcurpart = -1;
+	node->sort_Done = false;
+
+	/*
+	 * Release the previous scan's local sort state and accessors before
+	 * creating new ones over the same shared memory.
+	 */
+	if (node->tuplesortstate != NULL)
+	{
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+	}
+	MemoryContextReset(node->paccessorcxt);
+	node->pparts = NULL;
+	node->psample = NULL;
+
+	/* Clear all files, and start reading the input again. */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	ExecSortInitializeShared(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for sort statistics, and to the
+ *		shared state of a Parallel Sort.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
+	ParallelSortState *pstate;
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 	node->am_worker = true;
+
+	if (!node->ss.ps.plan->parallel_aware)
+		return;
+
+	pstate = shm_toc_lookup(pwcxt->toc,
+							PS_TOC_KEY(node->ss.ps.plan->plan_node_id), true);
+	if (pstate != NULL)
+	{
+		int			participant = ParallelWorkerNumber + 1;
+		int			partno;
+
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->pstate = pstate;
+		node->pparts = palloc(sizeof(SharedTuplestoreAccessor *) *
+							  pstate->npartitions);
+		for (partno = 0; partno < pstate->npartitions; partno++)
+			node->pparts[partno] =
+				sts_attach(ParallelSortStore(pstate, partno),
+						   participant, &pstate->fileset);
+		node->psample = sts_attach(ParallelSortStore(pstate,
+													 pstate->npartitions),
+								   participant, &pstate->fileset);
+		ExecSetExecProcNode(&node->ss.ps, ExecParallelSort);
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -493,3 +1291,28 @@ ExecSortRetrieveInstrumentation(SortState *node)
 	memcpy(si, node->shared_info, size);
 	node->shared_info = si;
 }
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownSort
+ *
+ *		Stop reading the sorted partitions and detach from the shared
+ *		state of a Parallel Sort.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownSort(SortState *node)
+{
+	if (node->pstate == NULL)
+		return;
+
+	if (node->pfile != NULL)
+	{
+		BufFileClose(node->pfile);
+		node->pfile = NULL;
+	}
+	if (node->pattached)
+	{
+		BarrierDetach(&node->pstate->barrier);
+		node->pattached = false;
+	}
+}
@@ -10,6 +10,14 @@
  * direct correlation variables from the parent plan level), and "regular"
  * subplans, which are re-evaluated every time their result is required.
  *
+ * The hash tables of hashed subplans can outlive a single execution: when
+ * the planner found that the subselect's result only depends on the contents
+ * of ordinary tables, a copy of the tables is kept in a backend-local cache
+ * attached to the plan tree, and used directly by later executions of the
+ * same plan (e.g. of a prepared statement) as long as no transaction that
+ * could have changed one of the tables read has committed in between.  See
+ * subplan_cache_lookup.
+ *
  *
  * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -29,15 +37,95 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/transam.h"
+#include "access/xact.h"
 #include "executor/executor.h"
 #include "executor/nodeSubplan.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "storage/lock.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "utils/array.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+/*
+ * Key of a cached hashed subplan result.  A SubPlan is identified by the plan
+ * tree it belongs to and its plan_id; unknownEqFalse is part of the key
+ * because it decides whether rows containing nulls are kept.
+ */
+typedef struct SubPlanCacheKey
+{
+	const PlannedStmt *stmt;
+	int			plan_id;
+	bool		unknownEqFalse;
+} SubPlanCacheKey;
+
+/*
+ * Cached hash tables of a hashed subplan.  They are built without a parent
+ * plan node and with private copies of the hash function data, so nothing in
+ * them points into the executor state of the execution that made them.
+ * Executions using the tables hold a reference; tables that were replaced,
+ * or whose plan tree is gone, are freed when the last of them is done.
+ */
+typedef struct SubPlanCacheTables
+{
+	MemoryContext cxt;			/* holds everything, including this struct */
+	TupleHashTable hashtable;	/* rows without nulls */
+	TupleHashTable hashnulls;	/* rows with null(s), if we keep them */
+	bool		havehashrows;
+	bool		havenullrows;
+	bool		takenDuringRecovery;	/* were the rows read in recovery? */
+	uint64		xactCompletionCount;	/* snapshot the rows were read with */
+	int			nrelids;		/* tables the sub-select read */
+	Oid		   *relids;
+	int			refcount;		/* executions using the tables */
+	bool		orphaned;		/* no longer reachable from the cache */
+} SubPlanCacheTables;
+
+typedef struct SubPlanCacheEntry
+{
+	SubPlanCacheKey key;		/* hash key (must be first) */
+	bool		toobig;			/* result found to exceed subplan_cache_size */
+	SubPlanCacheTables *tables; /* the result, or NULL */
+} SubPlanCacheEntry;
+
+/*
+ * Shared memory telling when tables last changed.  Each table maps to one of
+ * SUBPLAN_CACHE_SLOTS slots by its OID; the extra last slot stands for all
+ * tables.  A committing transaction raises 'pending' of the slots of the
+ * tables it changed before its commit becomes visible, then advances
+ * 'lastchange' to the completed-transaction count (see
+ * snapXactCompletionCount) and lowers 'pending' again.  So a snapshot whose
+ * count is at least a slot's 'lastchange', taken while 'pending' is zero,
+ * sees all committed changes of the slot's tables.
+ */
+#define SUBPLAN_CACHE_SLOTS		4096
+#define SUBPLAN_CACHE_ALL_SLOT	SUBPLAN_CACHE_SLOTS
+
+typedef struct SubPlanCacheSlot
+{
+	pg_atomic_uint64 lastchange;
+	pg_atomic_uint32 pending;
+} SubPlanCacheSlot;
+
+/* GUC variable */
+int			subplan_cache_size = 1024;
+
+static HTAB *SubPlanCache = NULL;
+static SubPlanCacheSlot *SubPlanCacheSlots = NULL;
+
+/* slots marked pending by SubPlanCacheBeginCommit */
+static uint64 CommitSlots[SUBPLAN_CACHE_SLOTS / 64 + 1];
+static bool HaveCommitSlots = false;
 
 static Datum ExecHashSubPlan(SubPlanState *node,
 							 ExprContext *econtext,
@@ -50,6 +138,22 @@ static bool findPartialMatch(TupleHashTable hashtable, TupleTableSlot *slot,
 							 FmgrInfo *eqfunctions);
 static bool slotAllNulls(TupleTableSlot *slot);
 static bool slotNoNulls(TupleTableSlot *slot);
+static SubPlanCacheEntry *subplan_cache_lookup(SubPlanState *node);
+static bool subplan_cache_valid(SubPlanCacheTables *tables, Snapshot snapshot);
+static void subplan_cache_release(void *arg);
+static void subplan_cache_drop(SubPlanCacheEntry *entry);
+static void subplan_cache_use(SubPlanState *node, SubPlanCacheTables *tables);
+static void subplan_cache_unuse(void *arg);
+static void subplan_cache_store(SubPlanState *node, SubPlanCacheEntry *entry);
+static TupleHashTable subplan_cache_copy_table(SubPlanState *node,
+											   TupleHashTable src,
+											   AttrNumber *keyColIdx,
+											   FmgrInfo *hashfunctions,
+											   Oid *collations,
+											   MemoryContext cxt);
+static bool subplan_cache_relids_walker(PlanState *planstate, List **relids);
+static void subplan_cache_mark_relation(Oid relid);
+static void subplan_cache_mark_slot(int slotno);
 
 
 /* ----------------------------------------------------------------
@@ -117,6 +221,17 @@ ExecHashSubPlan(SubPlanState *node,
 	if (node->hashtable == NULL || planstate->chgParam != NULL)
 		buildSubPlanHash(node, econtext);
 
+	/*
+	 * Tables from the subplan cache must do their temporary allocations in
+	 * our context; that of the execution that built them may be gone.
+	 */
+	if (node->cachetables != NULL)
+	{
+		node->hashtable->tempcxt = node->hashtempcxt;
+		if (node->hashnulls)
+			node->hashnulls->tempcxt = node->hashtempcxt;
+	}
+
 	/*
 	 * The result for an empty subplan is always FALSE; no need to evaluate
 	 * lefthand side.
@@ -476,9 +591,29 @@ buildSubPlanHash(SubPlanState *node, ExprContext *econtext)
 	MemoryContext oldcontext;
 	long		nbuckets;
 	TupleTableSlot *slot;
+	SubPlanCacheEntry *entry;
 
 	Assert(subplan->subLinkType == ANY_SUBLINK);
 
+	/* We are rebuilding; stop using the cached tables if we were */
+	if (node->cachetables != NULL)
+	{
+		subplan_cache_unuse(node);
+		node->hashtable = NULL;
+		node->hashnulls = NULL;
+	}
+
+	/*
+	 * If an earlier execution of this plan left us the tables, we needn't
+	 * run the subplan at all.
+	 */
+	entry = subplan_cache_lookup(node);
+	if (entry != NULL && entry->tables != NULL)
+	{
+		subplan_cache_use(node, entry->tables);
+		return;
+	}
+
 	/*
 	 * If we already had any hash tables, reset 'em; otherwise create empty
 	 * hash table(s).
@@ -621,6 +756,500 @@ buildSubPlanHash(SubPlanState *node, ExprContext *econtext)
 	ExecClearTuple(node->projRight->pi_state.resultslot);
 
 	MemoryContextSwitchTo(oldcontext);
+
+	if (entry != NULL)
+		subplan_cache_store(node, entry);
+}
+
+/*
+ * subplan_cache_lookup: find the cache entry of a hashed subplan
+ *
+ * Returns NULL if the subplan's result must not be cached or reused in the
+ * current state.  That's decided by:
+ *
+ * - the planner, which sets subplan->cacheable only if the subselect reads
+ *   nothing but ordinary tables, and views on them, and calls only immutable
+ *   functions, so that its result depends on nothing but the contents of
+ *   those tables;
+ *
+ * - the subplan's external parameters: there must be none;
+ *
+ * - the snapshot: we neither use nor fill the cache once our transaction
+ *   has an XID, since we can't tell what our own changes touched.  Cached
+ *   tables are only used if no transaction that changed one of the tables
+ *   the subplan read has committed between the snapshot they were read
+ *   with and ours; see subplan_cache_valid.
+ *
+ * Replanning, e.g. after a relcache invalidation of one of the tables,
+ * creates a new plan tree and so a new entry.  Entries are removed when
+ * their plan tree's memory context is reset or deleted.
+ *
+ * A new entry is only marked as seen; its tables are stored by the second
+ * execution, to avoid copying the result of every one-shot query.
+ */
+static SubPlanCacheEntry *
+subplan_cache_lookup(SubPlanState *node)
+{
+	SubPlan    *subplan = node->subplan;
+	EState	   *estate = node->planstate->state;
+	Snapshot	snapshot = estate->es_snapshot;
+	SubPlanCacheKey key;
+	SubPlanCacheEntry *entry;
+	bool		found;
+
+	if (subplan_cache_size <= 0 ||
+		!subplan->cacheable ||
+		!bms_is_empty(node->planstate->plan->extParam) ||
+		IsParallelWorker() ||
+		!IsMVCCSnapshot(snapshot) ||
+		snapshot->snapXactCompletionCount == 0 ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return NULL;
+
+	if (SubPlanCache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(SubPlanCacheKey);
+		ctl.entrysize = sizeof(SubPlanCacheEntry);
+		SubPlanCache = hash_create("SubPlan cache", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS);
+	}
+
+	MemSet(&key, 0, sizeof(key));
+	key.stmt = estate->es_plannedstmt;
+	key.plan_id = subplan->plan_id;
+	key.unknownEqFalse = subplan->unknownEqFalse;
+
+	entry = (SubPlanCacheEntry *) hash_search(SubPlanCache, &key,
+											  HASH_ENTER, &found);
+	if (!found)
+	{
+		MemoryContext stmtcxt = GetMemoryChunkContext((void *) key.stmt);
+		MemoryContextCallback *cb;
+
+		entry->toobig = false;
+		entry->tables = NULL;
+
+		/* Forget the entry along with the plan tree */
+		cb = MemoryContextAlloc(stmtcxt, sizeof(MemoryContextCallback));
+		cb->func = subplan_cache_release;
+		cb->arg = entry;
+		MemoryContextRegisterResetCallback(stmtcxt, cb);
+
+		return NULL;
+	}
+
+	if (entry->toobig)
+		return NULL;
+
+	/* Tables that may be out of date are useless; replace them */
+	if (entry->tables != NULL && !subplan_cache_valid(entry->tables, snapshot))
+		subplan_cache_drop(entry);
+
+	return entry;
+}
+
+/*
+ * subplan_cache_valid: do cached tables show what the snapshot would see?
+ *
+ * They do if no change to the tables the subplan read was committed between
+ * the snapshot they were read with and the given one, in whichever order the
+ * two were taken.  We know that if none of the tables' slots changed since
+ * the older of the two.
+ *
+ * During recovery, changes are replayed from WAL and not tracked in the
+ * slots, so there we fall back to requiring that no transaction at all has
+ * completed in between.
+ */
+static bool
+subplan_cache_valid(SubPlanCacheTables *tables, Snapshot snapshot)
+{
+	uint64		horizon;
+
+	if (tables->takenDuringRecovery || snapshot->takenDuringRecovery)
+		return (tables->takenDuringRecovery &&
+				snapshot->takenDuringRecovery &&
+				tables->xactCompletionCount ==
+				snapshot->snapXactCompletionCount);
+
+	horizon = Min(tables->xactCompletionCount,
+				  snapshot->snapXactCompletionCount);
+
+	for (int i = -1; i < tables->nrelids; i++)
+	{
+		SubPlanCacheSlot *slot;
+
+		if (i < 0)
+			slot = &SubPlanCacheSlots[SUBPLAN_CACHE_ALL_SLOT];
+		else
+			slot = &SubPlanCacheSlots[tables->relids[i] % SUBPLAN_CACHE_SLOTS];
+
+		if (pg_atomic_read_u32(&slot->pending) != 0)
+			return false;
+		pg_read_barrier();
+		if (pg_atomic_read_u64(&slot->lastchange) > horizon)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * subplan_cache_release: reset callback of a plan tree's memory context
+ */
+static void
+subplan_cache_release(void *arg)
+{
+	SubPlanCacheEntry *entry = (SubPlanCacheEntry *) arg;
+
+	subplan_cache_drop(entry);
+	(void) hash_search(SubPlanCache, &entry->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * subplan_cache_drop: detach the tables from a cache entry, freeing them
+ * unless an execution still uses them
+ */
+static void
+subplan_cache_drop(SubPlanCacheEntry *entry)
+{
+	SubPlanCacheTables *tables = entry->tables;
+
+	if (tables == NULL)
+		return;
+
+	entry->tables = NULL;
+	tables->orphaned = true;
+	if (tables->refcount == 0)
+		MemoryContextDelete(tables->cxt);
+}
+
+/*
+ * subplan_cache_use: make a subplan use cached tables
+ *
+ * The reference is dropped when the query's memory goes away, or when the
+ * subplan is rebuilt.
+ */
+static void
+subplan_cache_use(SubPlanState *node, SubPlanCacheTables *tables)
+{
+	MemoryContext querycxt = node->planstate->state->es_query_cxt;
+	MemoryContextCallback *cb;
+
+	cb = MemoryContextAlloc(querycxt, sizeof(MemoryContextCallback));
+	cb->func = subplan_cache_unuse;
+	cb->arg = node;
+	MemoryContextRegisterResetCallback(querycxt, cb);
+
+	tables->refcount++;
+	node->cachetables = tables;
+	node->hashtable = tables->hashtable;
+	node->hashnulls = tables->hashnulls;
+	node->havehashrows = tables->havehashrows;
+	node->havenullrows = tables->havenullrows;
+}
+
+/*
+ * subplan_cache_unuse: drop a subplan's reference to cached tables
+ */
+static void
+subplan_cache_unuse(void *arg)
+{
+	SubPlanState *node = (SubPlanState *) arg;
+	SubPlanCacheTables *tables = node->cachetables;
+
+	if (tables == NULL)
+		return;
+
+	node->cachetables = NULL;
+	Assert(tables->refcount > 0);
+	if (--tables->refcount == 0 && tables->orphaned)
+		MemoryContextDelete(tables->cxt);
+}
+
+/*
+ * subplan_cache_store: keep a copy of the hash tables just built
+ *
+ * The copy lives in its own memory context, so that it can outlive the plan
+ * tree while an execution still uses it.  If the tables take more than
+ * subplan_cache_size, the entry is disabled for good.
+ */
+static void
+subplan_cache_store(SubPlanState *node, SubPlanCacheEntry *entry)
+{
+	Snapshot	snapshot = node->planstate->state->es_snapshot;
+	Size		limit = (Size) subplan_cache_size * 1024L;
+	int			ncols = node->numCols;
+	MemoryContext cxt;
+	MemoryContext oldcontext;
+	SubPlanCacheTables *tables;
+	AttrNumber *keyColIdx;
+	FmgrInfo   *hashfunctions;
+	Oid		   *collations;
+	List	   *relids = NIL;
+	ListCell   *lc;
+	int			i;
+
+	/* A recursive execution of the same plan might have beaten us to it */
+	if (entry->tables != NULL || entry->toobig)
+		return;
+
+	/* Don't bother copying tables that can't fit */
+	if (MemoryContextMemAllocated(node->hashtablecxt, true) > limit)
+	{
+		entry->toobig = true;
+		return;
+	}
+
+	/* Moved to TopMemoryContext once complete, so an error can't leak it */
+	cxt = AllocSetContextCreate(node->planstate->state->es_query_cxt,
+								"SubPlan cache",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(cxt);
+
+	tables = palloc0(sizeof(SubPlanCacheTables));
+	tables->cxt = cxt;
+
+	/* The tables keep pointers to these, so they need copies of their own */
+	keyColIdx = palloc(ncols * sizeof(AttrNumber));
+	memcpy(keyColIdx, node->keyColIdx, ncols * sizeof(AttrNumber));
+	collations = palloc(ncols * sizeof(Oid));
+	memcpy(collations, node->tab_collations, ncols * sizeof(Oid));
+	hashfunctions = palloc(ncols * sizeof(FmgrInfo));
+	for (i = 0; i < ncols; i++)
+		fmgr_info_copy(&hashfunctions[i], &node->tab_hash_funcs[i], cxt);
+
+	tables->hashtable = subplan_cache_copy_table(node, node->hashtable,
+												 keyColIdx, hashfunctions,
+												 collations, cxt);
+	if (node->hashnulls)
+		tables->hashnulls = subplan_cache_copy_table(node, node->hashnulls,
+													 keyColIdx, hashfunctions,
+													 collations, cxt);
+	tables->havehashrows = node->havehashrows;
+	tables->havenullrows = node->havenullrows;
+	tables->takenDuringRecovery = snapshot->takenDuringRecovery;
+	tables->xactCompletionCount = snapshot->snapXactCompletionCount;
+
+	/* Remember the tables read, which decide when the copy is out of date */
+	(void) subplan_cache_relids_walker(node->planstate, &relids);
+	tables->nrelids = list_length(relids);
+	tables->relids = palloc(Max(tables->nrelids, 1) * sizeof(Oid));
+	i = 0;
+	foreach(lc, relids)
+		tables->relids[i++] = lfirst_oid(lc);
+	list_free(relids);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (MemoryContextMemAllocated(cxt, true) > limit)
+	{
+		MemoryContextDelete(cxt);
+		entry->toobig = true;
+		return;
+	}
+
+	MemoryContextSetParent(cxt, TopMemoryContext);
+	entry->tables = tables;
+}
+
+/*
+ * subplan_cache_copy_table: copy one of a subplan's hash tables into cxt
+ */
+static TupleHashTable
+subplan_cache_copy_table(SubPlanState *node, TupleHashTable src,
+						 AttrNumber *keyColIdx, FmgrInfo *hashfunctions,
+						 Oid *collations, MemoryContext cxt)
+{
+	TupleTableSlot *slot = node->cacheslot;
+	TupleHashTable dst;
+	TupleHashIterator hashiter;
+	TupleHashEntry tupentry;
+
+	dst = BuildTupleHashTableExt(NULL,
+								 node->descRight,
+								 node->numCols,
+								 keyColIdx,
+								 node->tab_eq_funcoids,
+								 hashfunctions,
+								 collations,
+								 Max(src->hashtab->members, 1),
+								 0,
+								 cxt,
+								 cxt,
+								 node->hashtempcxt,
+								 false);
+
+	InitTupleHashIterator(src, &hashiter);
+	while ((tupentry = ScanTupleHashTable(src, &hashiter)) != NULL)
+	{
+		bool		isnew;
+
+		ExecStoreMinimalTuple(tupentry->firstTuple, slot, false);
+		(void) LookupTupleHashEntry(dst, slot, &isnew, NULL);
+	}
+	TermTupleHashIterator(&hashiter);
+	ExecClearTuple(slot);
+
+	return dst;
+}
+
+/*
+ * subplan_cache_relids_walker: collect the OIDs of the tables a subplan's
+ * plan tree scans
+ *
+ * Partitions and inheritance children are scanned by nodes of their own, so
+ * they are found as well.
+ */
+static bool
+subplan_cache_relids_walker(PlanState *planstate, List **relids)
+{
+	switch (nodeTag(planstate))
+	{
+		case T_SeqScanState:
+		case T_IndexScanState:
+		case T_IndexOnlyScanState:
+		case T_BitmapHeapScanState:
+		case T_TidScanState:
+		case T_TidRangeScanState:
+			{
+				Index		scanrelid = ((Scan *) planstate->plan)->scanrelid;
+				RangeTblEntry *rte = exec_rt_fetch(scanrelid, planstate->state);
+
+				*relids = list_append_unique_oid(*relids, rte->relid);
+			}
+			break;
+		case T_CteScanState:
+			/* The CTE's plan is not below us in the tree */
+			(void) subplan_cache_relids_walker(((CteScanState *) planstate)->cteplanstate,
+											   relids);
+			break;
+		default:
+			break;
+	}
+
+	return planstate_tree_walker(planstate, subplan_cache_relids_walker,
+								 (void *) relids);
+}
+
+/*
+ * SubPlanCacheShmemSize: report shared-memory space needed by
+ * SubPlanCacheShmemInit
+ */
+Size
+SubPlanCacheShmemSize(void)
+{
+	return mul_size(SUBPLAN_CACHE_SLOTS + 1, sizeof(SubPlanCacheSlot));
+}
+
+/*
+ * SubPlanCacheShmemInit: allocate and initialize the table change slots
+ */
+void
+SubPlanCacheShmemInit(void)
+{
+	bool		found;
+
+	SubPlanCacheSlots = (SubPlanCacheSlot *)
+		ShmemInitStruct("SubPlan Cache Slots", SubPlanCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		for (int i = 0; i <= SUBPLAN_CACHE_SLOTS; i++)
+		{
+			pg_atomic_init_u64(&SubPlanCacheSlots[i].lastchange, 0);
+			pg_atomic_init_u32(&SubPlanCacheSlots[i].pending, 0);
+		}
+	}
+}
+
+/*
+ * SubPlanCacheBeginCommit: mark the tables a committing transaction may
+ * have changed as pending
+ *
+ * Must be called right before the commit becomes visible to others, i.e.
+ * before the transaction is removed from the proc array, while we still
+ * hold our locks; SubPlanCacheEndCommit must follow right after.  If
+ * prepared is true, we are finishing a prepared transaction whose tables we
+ * don't know, so all tables are marked.
+ */
+void
+SubPlanCacheBeginCommit(bool prepared)
+{
+	Assert(!HaveCommitSlots);
+
+	if (SubPlanCacheSlots == NULL)
+		return;
+
+	if (prepared)
+		subplan_cache_mark_slot(SUBPLAN_CACHE_ALL_SLOT);
+	else
+		VisitRelationsLockedForWrite(subplan_cache_mark_relation);
+}
+
+/*
+ * SubPlanCacheEndCommit: publish the changes of the transaction that just
+ * became visible
+ */
+void
+SubPlanCacheEndCommit(void)
+{
+	uint64		count;
+
+	if (!HaveCommitSlots)
+		return;
+
+	/* Snapshots taken from now on include our commit */
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+	count = ShmemVariableCache->xactCompletionCount;
+	LWLockRelease(ProcArrayLock);
+
+	for (int i = 0; i < lengthof(CommitSlots); i++)
+	{
+		while (CommitSlots[i] != 0)
+		{
+			int			slotno = i * 64 + pg_rightmost_one_pos64(CommitSlots[i]);
+			SubPlanCacheSlot *slot = &SubPlanCacheSlots[slotno];
+			uint64		old = pg_atomic_read_u64(&slot->lastchange);
+
+			while (old < count &&
+				   !pg_atomic_compare_exchange_u64(&slot->lastchange, &old,
+												   count))
+				;
+			pg_atomic_fetch_sub_u32(&slot->pending, 1);
+
+			CommitSlots[i] &= CommitSlots[i] - 1;
+		}
+	}
+
+	HaveCommitSlots = false;
+}
+
+/*
+ * subplan_cache_mark_relation: mark the slot of a relation pending
+ */
+static void
+subplan_cache_mark_relation(Oid relid)
+{
+	subplan_cache_mark_slot(relid % SUBPLAN_CACHE_SLOTS);
+}
+
+/*
+ * subplan_cache_mark_slot: mark a slot pending, once per transaction
+ */
+static void
+subplan_cache_mark_slot(int slotno)
+{
+	uint64		bit = UINT64CONST(1) << (slotno % 64);
+
+	if (CommitSlots[slotno / 64] & bit)
+		return;
+
+	CommitSlots[slotno / 64] |= bit;
+	HaveCommitSlots = true;
+	pg_atomic_fetch_add_u32(&SubPlanCacheSlots[slotno].pending, 1);
 }
 
 /*
@@ -831,6 +1460,8 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 	sstate->tab_collations = NULL;
 	sstate->lhs_hash_funcs = NULL;
 	sstate->cur_eq_funcs = NULL;
+	sstate->cacheslot = NULL;
+	sstate->cachetables = NULL;
 
 	/*
 	 * If this is an initplan or MULTIEXPR subplan, it has output parameters
@@ -1014,6 +1645,11 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 													sstate->planstate,
 													NULL);
 
+		/* Slot for copying rows into the subplan cache, if we may need it */
+		if (subplan->cacheable)
+			sstate->cacheslot = ExecInitExtraTupleSlot(estate, tupDescRight,
+													   &TTSOpsMinimalTuple);
+
 		/*
 		 * Create comparator for lookups of rows in the table (potentially
 		 * cross-type comparisons).
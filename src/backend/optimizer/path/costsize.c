@@ -150,6 +150,8 @@ bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = true;
+bool		enable_parallel_sort = true;
 bool		enable_partition_pruning = true;
 bool		enable_async_append = true;
 
@@ -2789,6 +2791,30 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_parallel_hashagg
+ *		Adds the cost of exchanging the input of a Parallel HashAggregate to
+ *		a hashed Agg path costed for one participant's share of the input and
+ *		of the groups.
+ *
+ * Every participant writes its input tuples to shared temporary files, one
+ * per partition of the groups, and later reads back the partitions it
+ * aggregates; on average, as many tuples as it wrote.  All of this happens
+ * before the first group is returned.
+ */
+void
+cost_parallel_hashagg(Path *path, double input_tuples, double input_width)
+{
+	double		pages = page_size(input_tuples, input_width);
+	Cost		exchange_cost;
+
+	exchange_cost = pages * 2.0 * seq_page_cost;
+	exchange_cost += input_tuples * 2.0 * cpu_tuple_cost;
+
+	path->startup_cost += exchange_cost;
+	path->total_cost += exchange_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -3217,6 +3243,8 @@ final_cost_nestloop(PlannerInfo *root, NestPath *path,
  * 'outersortkeys' is the list of sort keys for the outer path
  * 'innersortkeys' is the list of sort keys for the inner path
  * 'extra' contains miscellaneous information about the join
+ * 'parallel_sort' indicates that inner_path is partial and that its sorted
+ *		result will be shared by all participants
  *
  * Note: outersortkeys and innersortkeys should be NIL if no explicit
  * sort is needed because the respective source path is already ordered.
@@ -3227,7 +3255,8 @@ initial_cost_mergejoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 					   List *mergeclauses,
 					   Path *outer_path, Path *inner_path,
 					   List *outersortkeys, List *innersortkeys,
-					   JoinPathExtraData *extra)
+					   JoinPathExtraData *extra,
+					   bool parallel_sort)
 {
 	Cost		startup_cost = 0;
 	Cost		run_cost = 0;
@@ -3244,6 +3273,13 @@ initial_cost_mergejoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 				innerendsel;
 	Path		sort_path;		/* dummy for result of cost_sort */
 
+	/*
+	 * With a Parallel Sort, every participant merges against the whole inner
+	 * relation, not just the rows of its own share.
+	 */
+	if (parallel_sort)
+		inner_path_rows *= get_parallel_divisor(inner_path);
+
 	/* Protect some assumptions below that rowcounts aren't zero */
 	if (outer_path_rows <= 0)
 		outer_path_rows = 1;
@@ -3376,7 +3412,40 @@ initial_cost_mergejoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 			* (outerendsel - outerstartsel);
 	}
 
-	if (innersortkeys)			/* do we need to sort inner? */
+	if (parallel_sort)
+	{
+		Cost		read_cost;
+
+		/*
+		 * Each participant sorts about its share of the inner rows, after
+		 * exchanging them by key range through temporary files: its share is
+		 * written to and read back from the partition files, and then
+		 * written out sorted.  Reading the whole sorted result back is the
+		 * run cost.
+		 */
+		Assert(innersortkeys != NIL);
+		cost_sort(&sort_path,
+				  root,
+				  innersortkeys,
+				  inner_path->total_cost,
+				  inner_path->rows,
+				  inner_path->pathtarget->width,
+				  0.0,
+				  work_mem,
+				  -1.0);
+		startup_cost += sort_path.startup_cost;
+		startup_cost += page_size(inner_path->rows,
+								  inner_path->pathtarget->width) *
+			3.0 * seq_page_cost;
+		startup_cost += inner_path->rows * 2.0 * cpu_tuple_cost;
+
+		read_cost = page_size(inner_path_rows, inner_path->pathtarget->width) *
+			seq_page_cost;
+		read_cost += inner_path_rows * cpu_operator_cost;
+		startup_cost += read_cost * innerstartsel;
+		inner_run_cost = read_cost * (innerendsel - innerstartsel);
+	}
+	else if (innersortkeys)		/* do we need to sort inner? */
 	{
 		cost_sort(&sort_path,
 				  root,
@@ -3477,6 +3546,10 @@ final_cost_mergejoin(PlannerInfo *root, MergePath *path,
 				rescannedtuples;
 	double		rescanratio;
 
+	/* A Parallel Sort returns the whole inner relation to everyone */
+	if (path->jpath.path.parallel_aware)
+		inner_path_rows *= get_parallel_divisor(inner_path);
+
 	/* Protect some assumptions below that rowcounts aren't zero */
 	if (inner_path_rows <= 0)
 		inner_path_rows = 1;
@@ -3642,13 +3715,15 @@ final_cost_mergejoin(PlannerInfo *root, MergePath *path,
 	 * sort is expected to spill to disk.  This is because the final merge
 	 * pass can be done on-the-fly if it doesn't have to support mark/restore.
 	 * We don't try to adjust the cost estimates for this consideration,
-	 * though.
+	 * though.  A Parallel Sort always reads its result back from files, so
+	 * it gains nothing from this.
 	 *
 	 * Since materialization is a performance optimization in this case,
 	 * rather than necessary for correctness, we skip it if enable_material is
 	 * off.
 	 */
 	else if (enable_material && innersortkeys != NIL &&
+			 !path->jpath.path.parallel_aware &&
 			 relation_byte_size(inner_path_rows,
 								inner_path->pathtarget->width) >
 			 (work_mem * 1024L))
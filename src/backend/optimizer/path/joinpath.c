@@ -51,7 +51,8 @@ static void try_partial_mergejoin_path(PlannerInfo *root,
 									   List *outersortkeys,
 									   List *innersortkeys,
 									   JoinType jointype,
-									   JoinPathExtraData *extra);
+									   JoinPathExtraData *extra,
+									   bool parallel_sort);
 static void sort_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 								 RelOptInfo *outerrel, RelOptInfo *innerrel,
 								 JoinType jointype, JoinPathExtraData *extra);
@@ -842,7 +843,8 @@ try_mergejoin_path(PlannerInfo *root,
 								   outersortkeys,
 								   innersortkeys,
 								   jointype,
-								   extra);
+								   extra,
+								   false /* parallel_sort */ );
 		return;
 	}
 
@@ -877,7 +879,7 @@ try_mergejoin_path(PlannerInfo *root,
 	initial_cost_mergejoin(root, &workspace, jointype, mergeclauses,
 						   outer_path, inner_path,
 						   outersortkeys, innersortkeys,
-						   extra);
+						   extra, false);
 
 	if (add_path_precheck(joinrel,
 						  workspace.startup_cost, workspace.total_cost,
@@ -891,6 +893,7 @@ try_mergejoin_path(PlannerInfo *root,
 									   extra,
 									   outer_path,
 									   inner_path,
+									   false,	/* parallel_sort */
 									   extra->restrictlist,
 									   pathkeys,
 									   required_outer,
@@ -909,6 +912,10 @@ try_mergejoin_path(PlannerInfo *root,
  * try_partial_mergejoin_path
  *	  Consider a partial merge join path; if it appears useful, push it into
  *	  the joinrel's pathlist via add_partial_path().
+ *	  The outer side is partial.  If parallel_sort is true, then the inner path
+ *	  must be partial and will be sorted by all participants together, each
+ *	  of them reading the complete sorted result.  Otherwise the inner path
+ *	  must be non-partial and each participant sorts all of it if needed.
  */
 static void
 try_partial_mergejoin_path(PlannerInfo *root,
@@ -920,7 +927,8 @@ try_partial_mergejoin_path(PlannerInfo *root,
 						   List *outersortkeys,
 						   List *innersortkeys,
 						   JoinType jointype,
-						   JoinPathExtraData *extra)
+						   JoinPathExtraData *extra,
+						   bool parallel_sort)
 {
 	JoinCostWorkspace workspace;
 
@@ -938,14 +946,16 @@ try_partial_mergejoin_path(PlannerInfo *root,
 
 	/*
 	 * If the given paths are already well enough ordered, we can skip doing
-	 * an explicit sort.
+	 * an explicit sort.  The order of a partial inner path only holds within
+	 * each participant's share, though, so a Parallel Sort is always needed.
 	 */
 	if (outersortkeys &&
 		pathkeys_contained_in(outersortkeys, outer_path->pathkeys))
 		outersortkeys = NIL;
-	if (innersortkeys &&
+	if (innersortkeys && !parallel_sort &&
 		pathkeys_contained_in(innersortkeys, inner_path->pathkeys))
 		innersortkeys = NIL;
+	Assert(innersortkeys != NIL || !parallel_sort);
 
 	/*
 	 * See comments in try_partial_nestloop_path().
@@ -953,7 +963,7 @@ try_partial_mergejoin_path(PlannerInfo *root,
 	initial_cost_mergejoin(root, &workspace, jointype, mergeclauses,
 						   outer_path, inner_path,
 						   outersortkeys, innersortkeys,
-						   extra);
+						   extra, parallel_sort);
 
 	if (!add_partial_path_precheck(joinrel, workspace.total_cost, pathkeys))
 		return;
@@ -967,6 +977,7 @@ try_partial_mergejoin_path(PlannerInfo *root,
 										   extra,
 										   outer_path,
 										   inner_path,
+										   parallel_sort,
 										   extra->restrictlist,
 										   pathkeys,
 										   NULL,
@@ -1151,6 +1162,7 @@ sort_inner_and_outer(PlannerInfo *root,
 	Path	   *outer_path;
 	Path	   *inner_path;
 	Path	   *cheapest_partial_outer = NULL;
+	Path	   *cheapest_partial_inner = NULL;
 	Path	   *cheapest_safe_inner = NULL;
 	List	   *all_pathkeys;
 	ListCell   *l;
@@ -1222,6 +1234,17 @@ sort_inner_and_outer(PlannerInfo *root,
 		else if (save_jointype != JOIN_UNIQUE_INNER)
 			cheapest_safe_inner =
 				get_cheapest_parallel_safe_total_inner(innerrel->pathlist);
+
+		/*
+		 * Can we use a partial inner plan too, so that the participants sort
+		 * the inner relation together instead of each sorting all of it?  As
+		 * for Parallel Hash, we can't handle JOIN_UNIQUE_INNER.
+		 */
+		if (innerrel->partial_pathlist != NIL &&
+			save_jointype != JOIN_UNIQUE_INNER &&
+			enable_parallel_sort)
+			cheapest_partial_inner =
+				(Path *) linitial(innerrel->partial_pathlist);
 	}
 
 	/*
@@ -1323,7 +1346,22 @@ sort_inner_and_outer(PlannerInfo *root,
 									   outerkeys,
 									   innerkeys,
 									   jointype,
-									   extra);
+									   extra,
+									   false /* parallel_sort */ );
+
+		/* Also try sorting a partial inner path in parallel */
+		if (cheapest_partial_outer && cheapest_partial_inner)
+			try_partial_mergejoin_path(root,
+									   joinrel,
+									   cheapest_partial_outer,
+									   cheapest_partial_inner,
+									   merge_pathkeys,
+									   cur_mergeclauses,
+									   outerkeys,
+									   innerkeys,
+									   jointype,
+									   extra,
+									   true /* parallel_sort */ );
 	}
 }
 
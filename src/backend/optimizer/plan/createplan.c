@@ -4498,6 +4498,11 @@ create_mergejoin_plan(PlannerInfo *root,
 												   inner_relids);
 
 		label_sort_with_costsize(root, sort, -1.0);
+
+		/* Parallel Merge Join sorts its partial inner input in common */
+		if (best_path->jpath.path.parallel_aware)
+			sort->plan.parallel_aware = true;
+
 		inner_plan = (Plan *) sort;
 		innerpathkeys = best_path->innersortkeys;
 	}
@@ -224,6 +224,10 @@ static void add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									  grouping_sets_data *gd,
 									  double dNumGroups,
 									  GroupPathExtraData *extra);
+static void add_parallel_hashagg_path(PlannerInfo *root, RelOptInfo *input_rel,
+									  RelOptInfo *grouped_rel,
+									  const AggClauseCosts *agg_costs,
+									  List *havingQual, double dNumGroups);
 static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 RelOptInfo *grouped_rel,
 												 RelOptInfo *input_rel,
@@ -6503,6 +6507,15 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 havingQual,
 									 agg_costs,
 									 dNumGroups));
+
+			/*
+			 * Also try to let the workers of a parallel plan divide the
+			 * groups among them.
+			 */
+			if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+				input_rel->partial_pathlist != NIL)
+				add_parallel_hashagg_path(root, input_rel, grouped_rel,
+										  agg_costs, havingQual, dNumGroups);
 		}
 
 		/*
@@ -6537,6 +6550,58 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		gather_grouping_paths(root, grouped_rel);
 }
 
+/*
+ * add_parallel_hashagg_path
+ *
+ * Add a Gather over a Parallel HashAggregate of the cheapest partial input
+ * path to the grouping relation.  The participants exchange their input by
+ * grouping key, so that each one aggregates a disjoint set of groups
+ * completely.  Unlike partial aggregation, this needs no combine functions
+ * and no Finalize Aggregate in the leader.
+ *
+ * Exchanging the input costs more than partial aggregation, which is only
+ * useless when each participant would see mostly distinct groups, so we
+ * don't bother with this otherwise.
+ */
+static void
+add_parallel_hashagg_path(PlannerInfo *root, RelOptInfo *input_rel,
+						  RelOptInfo *grouped_rel,
+						  const AggClauseCosts *agg_costs,
+						  List *havingQual, double dNumGroups)
+{
+	Path	   *partial_path = (Path *) linitial(input_rel->partial_pathlist);
+	AggPath    *aggpath;
+	Path	   *path;
+	double		fraction;
+	double		total_groups;
+
+	if (dNumGroups < partial_path->rows || input_rel->rows <= 0)
+		return;
+
+	/* Each participant aggregates its share of the groups */
+	fraction = Min(partial_path->rows / input_rel->rows, 1.0);
+
+	aggpath = create_agg_path(root,
+							  grouped_rel,
+							  partial_path,
+							  grouped_rel->reltarget,
+							  AGG_HASHED,
+							  AGGSPLIT_SIMPLE,
+							  root->parse->groupClause,
+							  havingQual,
+							  agg_costs,
+							  clamp_row_est(dNumGroups * fraction));
+	aggpath->path.parallel_aware = true;
+	cost_parallel_hashagg(&aggpath->path, partial_path->rows,
+						  partial_path->pathtarget->width);
+
+	total_groups = clamp_row_est(aggpath->path.rows / fraction);
+	path = (Path *) create_gather_path(root, grouped_rel, &aggpath->path,
+									   grouped_rel->reltarget, NULL,
+									   &total_groups);
+	add_path(grouped_rel, path);
+}
+
 /*
  * create_partial_grouping_paths
  *
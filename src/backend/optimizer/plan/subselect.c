@@ -17,6 +17,8 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "catalog/catalog.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
@@ -86,6 +88,8 @@ static bool test_opexpr_is_hashable(OpExpr *testexpr, List *param_ids);
 static bool hash_ok_operator(OpExpr *expr);
 static bool contain_dml(Node *node);
 static bool contain_dml_walker(Node *node, void *context);
+static bool subquery_is_cacheable(Query *subquery);
+static bool subquery_is_cacheable_walker(Node *node, void *context);
 static bool contain_outer_selfref(Node *node);
 static bool contain_outer_selfref_walker(Node *node, Index *depth);
 static void inline_cte(PlannerInfo *root, CommonTableExpr *cte);
@@ -240,6 +244,10 @@ make_subplan(PlannerInfo *root, Query *orig_subquery,
 						   subLinkType, subLinkId,
 						   testexpr, NIL, isTopQual);
 
+	/* See whether the executor may keep a hashed subplan's result */
+	if (IsA(result, SubPlan) && ((SubPlan *) result)->useHashTable)
+		((SubPlan *) result)->cacheable = subquery_is_cacheable(orig_subquery);
+
 	/*
 	 * If it's a correlated EXISTS with an unimportant targetlist, we might be
 	 * able to transform it to the equivalent of an IN and then implement it
@@ -297,6 +305,7 @@ make_subplan(PlannerInfo *root, Query *orig_subquery,
 				/* Check we got what we expected */
 				Assert(hashplan->parParam == NIL);
 				Assert(hashplan->useHashTable);
+				hashplan->cacheable = subquery_is_cacheable(orig_subquery);
 
 				/* Leave it to setrefs.c to decide which plan to use */
 				asplan = makeNode(AlternativeSubPlan);
@@ -341,6 +350,7 @@ build_subplan(PlannerInfo *root, Plan *plan, PlannerInfo *subroot,
 	splan->useHashTable = false;
 	splan->unknownEqFalse = unknownEqFalse;
 	splan->parallel_safe = plan->parallel_safe;
+	splan->cacheable = false;
 	splan->setParam = NIL;
 	splan->parParam = NIL;
 	splan->args = NIL;
@@ -1020,6 +1030,7 @@ SS_process_ctes(PlannerInfo *root)
 		 * parallel-safe.
 		 */
 		splan->parallel_safe = false;
+		splan->cacheable = false;
 		splan->setParam = NIL;
 		splan->parParam = NIL;
 		splan->args = NIL;
@@ -1090,6 +1101,62 @@ contain_dml_walker(Node *node, void *context)
 	return expression_tree_walker(node, contain_dml_walker, context);
 }
 
+/*
+ * subquery_is_cacheable: may the result of a hashed subplan made from the
+ * given sub-select be reused by later executions of the plan?
+ *
+ * The executor reuses it as long as no transaction that changed one of the
+ * tables read has committed (see nodeSubplan.c), so the result must depend
+ * on nothing but the contents of those tables.  That rules out mutable
+ * functions, external Params, TABLESAMPLE, and relations that can change
+ * without a transaction getting an XID, such as foreign tables and
+ * sequences.  System catalogs are out too, since their changes are not
+ * always tracked.  Views are fine: by now they have been expanded into
+ * subqueries over the tables they read, and only their placeholder entries
+ * for permission checks remain.  We also reject SELECT FOR UPDATE/SHARE,
+ * since not running the subplan would not lock the rows.
+ */
+static bool
+subquery_is_cacheable(Query *subquery)
+{
+	return !contain_mutable_functions((Node *) subquery) &&
+		!subquery_is_cacheable_walker((Node *) subquery, NULL);
+}
+
+/* Returns true if the result must not be cached */
+static bool
+subquery_is_cacheable_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+		return ((Param *) node)->paramkind == PARAM_EXTERN;
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+
+		if (rte->rtekind != RTE_RELATION)
+			return false;
+		return (rte->tablesample != NULL ||
+				IsCatalogRelationOid(rte->relid) ||
+				(rte->relkind != RELKIND_RELATION &&
+				 rte->relkind != RELKIND_PARTITIONED_TABLE &&
+				 rte->relkind != RELKIND_MATVIEW &&
+				 rte->relkind != RELKIND_VIEW));
+	}
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+
+		if (query->rowMarks != NIL)
+			return true;
+
+		return query_tree_walker(query, subquery_is_cacheable_walker, context,
+								 QTW_EXAMINE_RTES_BEFORE);
+	}
+	return expression_tree_walker(node, subquery_is_cacheable_walker, context);
+}
+
 /*
  * contain_outer_selfref: is there an external recursive self-reference?
  */
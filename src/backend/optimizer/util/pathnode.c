@@ -2483,6 +2483,7 @@ create_nestloop_path(PlannerInfo *root,
  * 'extra' contains various information about the join
  * 'outer_path' is the outer path
  * 'inner_path' is the inner path
+ * 'parallel_sort' to select Parallel Sort of inner path (shared sort result)
  * 'restrict_clauses' are the RestrictInfo nodes to apply at the join
  * 'pathkeys' are the path keys of the new join path
  * 'required_outer' is the set of required outer rels
@@ -2499,6 +2500,7 @@ create_mergejoin_path(PlannerInfo *root,
 					  JoinPathExtraData *extra,
 					  Path *outer_path,
 					  Path *inner_path,
+					  bool parallel_sort,
 					  List *restrict_clauses,
 					  List *pathkeys,
 					  Relids required_outer,
@@ -2519,7 +2521,8 @@ create_mergejoin_path(PlannerInfo *root,
 								  extra->sjinfo,
 								  required_outer,
 								  &restrict_clauses);
-	pathnode->jpath.path.parallel_aware = false;
+	pathnode->jpath.path.parallel_aware =
+		joinrel->consider_parallel && parallel_sort;
 	pathnode->jpath.path.parallel_safe = joinrel->consider_parallel &&
 		outer_path->parallel_safe && inner_path->parallel_safe;
 	/* This is a foolish way to estimate parallel_workers, but for now... */
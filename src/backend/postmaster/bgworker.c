@@ -22,6 +22,7 @@
 #include "postmaster/postmaster.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
+#include "storage/aio.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/latch.h"
@@ -128,6 +129,9 @@ static const struct
 	},
 	{
 		"ApplyWorkerMain", ApplyWorkerMain
+	},
+	{
+		"IoWorkerMain", IoWorkerMain
 	}
 };
 
@@ -135,6 +139,16 @@ static const struct
 static bgworker_main_type LookupBackgroundWorkerFunction(const char *libraryname, const char *funcname);
 
 
+/*
+ * Number of background worker slots: max_worker_processes for ordinary
+ * workers, plus the ones reserved for the I/O workers.
+ */
+int
+BackgroundWorkerSlots(void)
+{
+	return max_worker_processes + AioWorkerSlots();
+}
+
 /*
  * Calculate shared memory needed.
  */
@@ -145,7 +159,7 @@ BackgroundWorkerShmemSize(void)
 
 	/* Array of workers is variably sized. */
 	size = offsetof(BackgroundWorkerArray, slot);
-	size = add_size(size, mul_size(max_worker_processes,
+	size = add_size(size, mul_size(BackgroundWorkerSlots(),
 								   sizeof(BackgroundWorkerSlot)));
 
 	return size;
@@ -167,7 +181,7 @@ BackgroundWorkerShmemInit(void)
 		slist_iter	siter;
 		int			slotno = 0;
 
-		BackgroundWorkerData->total_slots = max_worker_processes;
+		BackgroundWorkerData->total_slots = BackgroundWorkerSlots();
 		BackgroundWorkerData->parallel_register_count = 0;
 		BackgroundWorkerData->parallel_terminate_count = 0;
 
@@ -183,7 +197,7 @@ BackgroundWorkerShmemInit(void)
 			RegisteredBgWorker *rw;
 
 			rw = slist_container(RegisteredBgWorker, rw_lnode, siter.cur);
-			Assert(slotno < max_worker_processes);
+			Assert(slotno < BackgroundWorkerData->total_slots);
 			slot->in_use = true;
 			slot->terminate = false;
 			slot->pid = InvalidPid;
@@ -197,7 +211,7 @@ BackgroundWorkerShmemInit(void)
 		/*
 		 * Mark any remaining slots as not in use.
 		 */
-		while (slotno < max_worker_processes)
+		while (slotno < BackgroundWorkerData->total_slots)
 		{
 			BackgroundWorkerSlot *slot = &BackgroundWorkerData->slot[slotno];
 
@@ -242,19 +256,19 @@ void
 BackgroundWorkerStateChange(bool allow_new_workers)
 {
 	int			slotno;
+	int			total_slots = BackgroundWorkerSlots();
 
 	/*
 	 * The total number of slots stored in shared memory should match our
-	 * notion of max_worker_processes.  If it does not, something is very
-	 * wrong.  Further down, we always refer to this value as
-	 * max_worker_processes, in case shared memory gets corrupted while we're
-	 * looping.
+	 * notion of it.  If it does not, something is very wrong.  Further down,
+	 * we always refer to our local copy, in case shared memory gets corrupted
+	 * while we're looping.
 	 */
-	if (max_worker_processes != BackgroundWorkerData->total_slots)
+	if (total_slots != BackgroundWorkerData->total_slots)
 	{
 		ereport(LOG,
-				(errmsg("inconsistent background worker state (max_worker_processes=%d, total_slots=%d)",
-						max_worker_processes,
+				(errmsg("inconsistent background worker state (expected slots=%d, total_slots=%d)",
+						total_slots,
 						BackgroundWorkerData->total_slots)));
 		return;
 	}
@@ -263,7 +277,7 @@ BackgroundWorkerStateChange(bool allow_new_workers)
 	 * Iterate through slots, looking for newly-registered workers or workers
 	 * who must die.
 	 */
-	for (slotno = 0; slotno < max_worker_processes; ++slotno)
+	for (slotno = 0; slotno < total_slots; ++slotno)
 	{
 		BackgroundWorkerSlot *slot = &BackgroundWorkerData->slot[slotno];
 		RegisteredBgWorker *rw;
@@ -430,7 +444,7 @@ ForgetBackgroundWorker(slist_mutable_iter *cur)
 
 	rw = slist_container(RegisteredBgWorker, rw_lnode, cur->cur);
 
-	Assert(rw->rw_shmem_slot < max_worker_processes);
+	Assert(rw->rw_shmem_slot < BackgroundWorkerSlots());
 	slot = &BackgroundWorkerData->slot[rw->rw_shmem_slot];
 	Assert(slot->in_use);
 
@@ -462,7 +476,7 @@ ReportBackgroundWorkerPID(RegisteredBgWorker *rw)
 {
 	BackgroundWorkerSlot *slot;
 
-	Assert(rw->rw_shmem_slot < max_worker_processes);
+	Assert(rw->rw_shmem_slot < BackgroundWorkerSlots());
 	slot = &BackgroundWorkerData->slot[rw->rw_shmem_slot];
 	slot->pid = rw->rw_pid;
 
@@ -485,7 +499,7 @@ ReportBackgroundWorkerExit(slist_mutable_iter *cur)
 
 	rw = slist_container(RegisteredBgWorker, rw_lnode, cur->cur);
 
-	Assert(rw->rw_shmem_slot < max_worker_processes);
+	Assert(rw->rw_shmem_slot < BackgroundWorkerSlots());
 	slot = &BackgroundWorkerData->slot[rw->rw_shmem_slot];
 	slot->pid = rw->rw_pid;
 	notify_pid = rw->rw_worker.bgw_notify_pid;
@@ -548,7 +562,7 @@ ForgetUnstartedBackgroundWorkers(void)
 		BackgroundWorkerSlot *slot;
 
 		rw = slist_container(RegisteredBgWorker, rw_lnode, iter.cur);
-		Assert(rw->rw_shmem_slot < max_worker_processes);
+		Assert(rw->rw_shmem_slot < BackgroundWorkerSlots());
 		slot = &BackgroundWorkerData->slot[rw->rw_shmem_slot];
 
 		/* If it's not yet started, and there's someone waiting ... */
@@ -905,9 +919,11 @@ RegisterBackgroundWorker(BackgroundWorker *worker)
 	 * Enforce maximum number of workers.  Note this is overly restrictive: we
 	 * could allow more non-shmem-connected workers, because these don't count
 	 * towards the MAX_BACKENDS limit elsewhere.  For now, it doesn't seem
-	 * important to relax this restriction.
+	 * important to relax this restriction.  The I/O workers have slots of
+	 * their own and are registered before anything else, so the others still
+	 * get max_worker_processes.
 	 */
-	if (++numworkers > max_worker_processes)
+	if (++numworkers > BackgroundWorkerSlots())
 	{
 		ereport(LOG,
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
@@ -1070,7 +1086,7 @@ GetBackgroundWorkerPid(BackgroundWorkerHandle *handle, pid_t *pidp)
 	BackgroundWorkerSlot *slot;
 	pid_t		pid;
 
-	Assert(handle->slot < max_worker_processes);
+	Assert(handle->slot < BackgroundWorkerSlots());
 	slot = &BackgroundWorkerData->slot[handle->slot];
 
 	/*
@@ -1209,7 +1225,7 @@ TerminateBackgroundWorker(BackgroundWorkerHandle *handle)
 	BackgroundWorkerSlot *slot;
 	bool		signal_postmaster = false;
 
-	Assert(handle->slot < max_worker_processes);
+	Assert(handle->slot < BackgroundWorkerSlots());
 	slot = &BackgroundWorkerData->slot[handle->slot];
 
 	/* Set terminate flag in shared memory, unless slot has been reused. */
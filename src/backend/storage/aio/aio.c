@@ -0,0 +1,325 @@
+/*-------------------------------------------------------------------------
+ *
+ * aio.c
+ *	  Asynchronous I/O on shared buffers.
+ *
+ * With io_method set to anything but "sync", the postmaster starts
+ * io_workers I/O worker processes (see aio_worker.c), and backends can hand
+ * reads into and writes from shared buffers to them instead of performing
+ * the system calls themselves.  The buffer manager uses that to read ahead
+ * of sequential scans and of VACUUM, to turn PrefetchBuffer() into a real
+ * read, and to let the checkpointer keep writing while earlier writes are
+ * still in flight.
+ *
+ * Requests live in a fixed-size array in shared memory.  A backend takes a
+ * free one with pgaio_acquire(), fills it in and puts it on the submission
+ * queue with pgaio_submit(), which wakes up an idle worker.  The worker
+ * performs the I/O and calls pgaio_complete(), which ends the I/O on the
+ * buffers and puts the request back on the free list.  When no request is
+ * free, or no worker is running (e.g. in a standalone backend, or during
+ * shutdown), pgaio_acquire() returns NULL and the caller performs the I/O
+ * synchronously as before.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/aio/aio.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "port/pg_bitutils.h"
+#include "postmaster/bgworker.h"
+#include "storage/aio.h"
+#include "storage/buf_internals.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+
+/* number of requests that can be queued or in flight at once */
+#define AIO_NUM_REQUESTS	128
+
+typedef struct PgAioCtlData
+{
+	slock_t		mutex;			/* protects all fields below */
+	int			nworkers;		/* number of workers accepting requests */
+	uint32		idle_workers;	/* bitmap of workers waiting for requests */
+	Latch	   *worker_latches[MAX_IO_WORKERS];
+	int			nfree;			/* number of entries in freelist */
+	int			queue_head;		/* position in queue of the next request */
+	int			nqueued;		/* number of requests in queue */
+	int			freelist[AIO_NUM_REQUESTS];
+	int			queue[AIO_NUM_REQUESTS];	/* circular submission queue */
+	PgAioRequest requests[AIO_NUM_REQUESTS];
+} PgAioCtlData;
+
+/* GUC variables */
+int			io_method = IOMETHOD_SYNC;
+int			io_workers = 3;
+
+/* NULL if io_method is "sync" */
+static PgAioCtlData *AioCtl = NULL;
+static char *AioBounceBuffers = NULL;
+
+
+/*
+ * Report shared-memory space needed by AioShmemInit
+ */
+Size
+AioShmemSize(void)
+{
+	if (io_method == IOMETHOD_SYNC)
+		return 0;
+
+	return add_size(sizeof(PgAioCtlData),
+					mul_size(AIO_NUM_REQUESTS, BLCKSZ));
+}
+
+/*
+ * Allocate and initialize shared memory for asynchronous I/O
+ */
+void
+AioShmemInit(void)
+{
+	bool		found;
+
+	if (io_method == IOMETHOD_SYNC)
+		return;
+
+	AioCtl = (PgAioCtlData *)
+		ShmemInitStruct("AIO Control", sizeof(PgAioCtlData), &found);
+	AioBounceBuffers = (char *)
+		ShmemInitStruct("AIO Bounce Buffers",
+						mul_size(AIO_NUM_REQUESTS, BLCKSZ), &found);
+
+	if (!found)
+	{
+		SpinLockInit(&AioCtl->mutex);
+		AioCtl->nworkers = 0;
+		AioCtl->idle_workers = 0;
+		for (int i = 0; i < MAX_IO_WORKERS; i++)
+			AioCtl->worker_latches[i] = NULL;
+		AioCtl->queue_head = 0;
+		AioCtl->nqueued = 0;
+		AioCtl->nfree = AIO_NUM_REQUESTS;
+		for (int i = 0; i < AIO_NUM_REQUESTS; i++)
+			AioCtl->freelist[i] = i;
+	}
+}
+
+/*
+ * Number of background worker slots reserved for the I/O workers, on top of
+ * max_worker_processes
+ */
+int
+AioWorkerSlots(void)
+{
+	if (io_method == IOMETHOD_SYNC)
+		return 0;
+
+	return io_workers;
+}
+
+/*
+ * Register the I/O workers with the postmaster
+ *
+ * This must happen before shared_preload_libraries are loaded, so that the
+ * workers get the slots reserved for them by AioWorkerSlots().
+ */
+void
+AioWorkersRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (io_method == IOMETHOD_SYNC)
+		return;
+
+	for (int i = 0; i < io_workers; i++)
+	{
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+		snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "IoWorkerMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "io worker %d", i);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "io worker");
+		bgw.bgw_restart_time = 1;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(i);
+
+		RegisterBackgroundWorker(&bgw);
+	}
+}
+
+/*
+ * pgaio_acquire - get a free request
+ *
+ * Returns NULL if asynchronous I/O is not available right now, in which case
+ * the caller should perform the I/O itself.  A request must be passed to
+ * pgaio_submit() or pgaio_release() without anything that could throw an
+ * error in between.
+ */
+PgAioRequest *
+pgaio_acquire(void)
+{
+	PgAioRequest *req = NULL;
+
+	if (AioCtl == NULL)
+		return NULL;
+
+	SpinLockAcquire(&AioCtl->mutex);
+	if (AioCtl->nworkers > 0 && AioCtl->nfree > 0)
+		req = &AioCtl->requests[AioCtl->freelist[--AioCtl->nfree]];
+	SpinLockRelease(&AioCtl->mutex);
+
+	return req;
+}
+
+/*
+ * pgaio_bounce_buffer - the BLCKSZ bytes of shared memory for a write
+ */
+char *
+pgaio_bounce_buffer(PgAioRequest *req)
+{
+	return AioBounceBuffers + (Size) (req - AioCtl->requests) * BLCKSZ;
+}
+
+/*
+ * pgaio_release - put back a request that is not needed after all
+ */
+void
+pgaio_release(PgAioRequest *req)
+{
+	SpinLockAcquire(&AioCtl->mutex);
+	Assert(AioCtl->nfree < AIO_NUM_REQUESTS);
+	AioCtl->freelist[AioCtl->nfree++] = req - AioCtl->requests;
+	SpinLockRelease(&AioCtl->mutex);
+}
+
+/*
+ * pgaio_submit - queue a filled-in request and wake up a worker
+ */
+void
+pgaio_submit(PgAioRequest *req)
+{
+	Latch	   *latch = NULL;
+
+	Assert(req->nblocks > 0 && req->nblocks <= MAX_IO_COMBINE_LIMIT);
+	Assert(req->op == PGAIO_OP_READ || req->nblocks == 1);
+
+	SpinLockAcquire(&AioCtl->mutex);
+
+	if (AioCtl->nworkers == 0)
+	{
+		/*
+		 * The last worker has exited since pgaio_acquire() checked.  Fail
+		 * the request; the buffer manager then does the I/O synchronously.
+		 */
+		SpinLockRelease(&AioCtl->mutex);
+		pgaio_complete(req, false);
+		return;
+	}
+
+	AioCtl->queue[(AioCtl->queue_head + AioCtl->nqueued) % AIO_NUM_REQUESTS] =
+		req - AioCtl->requests;
+	AioCtl->nqueued++;
+
+	if (AioCtl->idle_workers != 0)
+	{
+		int			worker = pg_rightmost_one_pos32(AioCtl->idle_workers);
+
+		AioCtl->idle_workers &= ~((uint32) 1 << worker);
+		latch = AioCtl->worker_latches[worker];
+	}
+
+	SpinLockRelease(&AioCtl->mutex);
+
+	if (latch)
+		SetLatch(latch);
+}
+
+/*
+ * pgaio_complete - end the I/O of a performed request and free it
+ *
+ * On success, the blocks of a read are verified here, so that the buffers of
+ * pages that fail verification are left invalid with BM_IO_ERROR set.
+ * Whoever needs such a buffer reads it again synchronously, which reports
+ * the problem (or zeroes the page) according to its own settings.  Likewise
+ * a buffer whose write failed stays dirty, and is written synchronously
+ * later.
+ */
+void
+pgaio_complete(PgAioRequest *req, bool success)
+{
+	for (int i = 0; i < req->nblocks; i++)
+	{
+		bool		ok = success;
+
+		if (ok && req->op == PGAIO_OP_READ)
+			ok = PageIsVerifiedExtended((Page) BufferGetBlock(req->buffers[i]),
+										req->blocknum + i, 0);
+
+		AioCompleteBufferIO(req->buffers[i], req->op == PGAIO_OP_READ, ok);
+	}
+
+	pgaio_release(req);
+}
+
+/*
+ * pgaio_worker_attach - start accepting requests in I/O worker id
+ */
+void
+pgaio_worker_attach(int id)
+{
+	Assert(id >= 0 && id < MAX_IO_WORKERS);
+
+	SpinLockAcquire(&AioCtl->mutex);
+	AioCtl->worker_latches[id] = MyLatch;
+	AioCtl->nworkers++;
+	SpinLockRelease(&AioCtl->mutex);
+}
+
+/*
+ * pgaio_worker_dequeue - take up to maxreqs requests off the queue
+ *
+ * If the queue is empty, worker id is marked idle, so that the next
+ * submission sets its latch.  With detach, it instead stops accepting
+ * requests, unless there are some left to perform.  The last worker only
+ * detaches from an empty queue, and pgaio_submit() doesn't queue anything
+ * once no worker is attached, so no request can be left behind.
+ */
+int
+pgaio_worker_dequeue(int id, PgAioRequest **reqs, int maxreqs, bool detach)
+{
+	int			n = 0;
+
+	SpinLockAcquire(&AioCtl->mutex);
+
+	AioCtl->idle_workers &= ~((uint32) 1 << id);
+
+	while (n < maxreqs && AioCtl->nqueued > 0)
+	{
+		reqs[n++] = &AioCtl->requests[AioCtl->queue[AioCtl->queue_head]];
+		AioCtl->queue_head = (AioCtl->queue_head + 1) % AIO_NUM_REQUESTS;
+		AioCtl->nqueued--;
+	}
+
+	if (n == 0)
+	{
+		if (detach)
+		{
+			AioCtl->worker_latches[id] = NULL;
+			AioCtl->nworkers--;
+		}
+		else
+			AioCtl->idle_workers |= (uint32) 1 << id;
+	}
+
+	SpinLockRelease(&AioCtl->mutex);
+
+	return n;
+}
@@ -0,0 +1,412 @@
+/*-------------------------------------------------------------------------
+ *
+ * aio_worker.c
+ *	  I/O worker processes, which perform the requests submitted through
+ *	  aio.c.
+ *
+ * Each worker takes a batch of requests off the submission queue, performs
+ * them and completes them.  With io_method = worker, it reads and writes
+ * with plain system calls through smgr, so several requests are in flight
+ * only as long as several workers are busy.  With io_method = io_uring, a
+ * worker submits all reads of a batch to its own io_uring before waiting for
+ * any of them, which keeps many reads in flight per worker.  Writes are
+ * always performed through smgrwrite(), which also takes care of registering
+ * the segment for the next checkpoint's fsync.
+ *
+ * A worker must not exit while it has requests in hand: nobody else would
+ * end the I/O on their buffers.  So errors while performing a request are
+ * caught and fail only that request, and a shutdown request is honored only
+ * once the queue is empty.
+ *
+ * Workers don't process shared invalidations, nor the barrier that asks
+ * processes to release their files.  Instead they close all their files
+ * whenever they are idle, and whenever a checkpoint has started since the
+ * last time.  The files of a dropped relation are unlinked by the next
+ * checkpoint, and only then can its relfilenode be used again, so a worker
+ * never reads a new relation through a descriptor of an old one.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/aio/aio_worker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "access/xlog.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_iovec.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/aio.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/smgr.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+
+/* maximum number of requests a worker takes off the queue at once */
+#define IO_WORKER_BATCH_SIZE	16
+
+#ifdef USE_LIBURING
+/*
+ * A read spans at most two segment files, so it needs at most two
+ * submission queue entries.
+ */
+#define IO_WORKER_URING_ENTRIES (2 * IO_WORKER_BATCH_SIZE)
+
+typedef struct IoWorkerUringRead IoWorkerUringRead;
+
+/* the part of a read in one segment file, one submission queue entry */
+typedef struct IoWorkerUringPart
+{
+	IoWorkerUringRead *read;
+	int			expected;		/* number of bytes to read */
+} IoWorkerUringPart;
+
+struct IoWorkerUringRead
+{
+	PgAioRequest *req;
+	struct iovec iov[MAX_IO_COMBINE_LIMIT];
+	IoWorkerUringPart parts[2];
+	int			nparts;			/* number of parts submitted */
+	int			npending;		/* number of those not completed yet */
+	bool		ok;
+};
+
+static struct io_uring io_worker_uring;
+static bool io_worker_uring_ready = false;
+#endif
+
+static MemoryContext IoWorkerContext = NULL;
+
+
+/*
+ * Perform a request with plain system calls, and complete it
+ */
+static void
+IoWorkerPerform(PgAioRequest *req)
+{
+	volatile bool ok = false;
+
+	PG_TRY();
+	{
+		SMgrRelation reln = smgropen(req->rnode, InvalidBackendId);
+
+		if (req->op == PGAIO_OP_READ)
+		{
+			char	   *pages[MAX_IO_COMBINE_LIMIT];
+
+			for (int i = 0; i < req->nblocks; i++)
+				pages[i] = (char *) BufferGetBlock(req->buffers[i]);
+			smgrreadv(reln, req->forknum, req->blocknum, pages, req->nblocks);
+		}
+		else
+			smgrwrite(reln, req->forknum, req->blocknum,
+					  pgaio_bounce_buffer(req), false);
+		ok = true;
+	}
+	PG_CATCH();
+	{
+		/* Report the error, but stay alive for the requests of others */
+		MemoryContextSwitchTo(IoWorkerContext);
+		EmitErrorReport();
+		FlushErrorState();
+	}
+	PG_END_TRY();
+
+	pgaio_complete(req, ok);
+}
+
+#ifdef USE_LIBURING
+/*
+ * Submit the reads queued in our io_uring.  If that fails for anything but
+ * a transient reason, stop using io_uring and return false.
+ */
+static bool
+IoWorkerUringSubmit(void)
+{
+	for (;;)
+	{
+		int			rc = io_uring_submit(&io_worker_uring);
+
+		if (rc >= 0)
+			return true;
+		if (rc == -EINTR)
+			continue;
+		if (rc == -EAGAIN)
+		{
+			/* The kernel is short of resources, try again shortly */
+			pg_usleep(1000L);
+			continue;
+		}
+
+		ereport(LOG,
+				(errmsg("could not submit reads to io_uring, performing I/O synchronously: %s",
+						strerror(-rc))));
+		io_worker_uring_ready = false;
+		return false;
+	}
+}
+
+/*
+ * Perform a batch of requests, queueing all of its reads in our io_uring
+ * and completing them once they are all done.
+ *
+ * Each part of a read is submitted as soon as it is prepared.  The kernel
+ * looks up the file descriptor when the read is submitted, and the next
+ * smgrfd() call may close that descriptor to make room for another file,
+ * which could then be opened under the same number.
+ */
+static void
+IoWorkerPerformUring(PgAioRequest **reqs, int nreqs)
+{
+	/* static, so that it survives a longjmp out of smgrfd() unharmed */
+	static IoWorkerUringRead reads[IO_WORKER_BATCH_SIZE];
+	int			nreads = 0;
+	int			ninflight = 0;
+
+	for (int i = 0; i < nreqs; i++)
+	{
+		PgAioRequest *req = reqs[i];
+		IoWorkerUringRead *read = &reads[nreads];
+
+		if (req->op != PGAIO_OP_READ || !io_worker_uring_ready)
+		{
+			IoWorkerPerform(req);
+			continue;
+		}
+
+		read->req = req;
+		read->nparts = 0;
+		read->npending = 0;
+		read->ok = true;
+		for (int j = 0; j < req->nblocks; j++)
+		{
+			read->iov[j].iov_base = BufferGetBlock(req->buffers[j]);
+			read->iov[j].iov_len = BLCKSZ;
+		}
+
+		PG_TRY();
+		{
+			SMgrRelation reln = smgropen(req->rnode, InvalidBackendId);
+			BlockNumber done = 0;
+
+			while (done < req->nblocks)
+			{
+				IoWorkerUringPart *part = &read->parts[read->nparts];
+				struct io_uring_sqe *sqe;
+				BlockNumber nblocks = req->nblocks - done;
+				off_t		offset;
+				int			fd;
+
+				fd = smgrfd(reln, req->forknum, req->blocknum + done,
+							&offset, &nblocks);
+
+				sqe = io_uring_get_sqe(&io_worker_uring);
+				Assert(sqe != NULL);
+				part->read = read;
+				part->expected = nblocks * BLCKSZ;
+				io_uring_prep_readv(sqe, fd, &read->iov[done], nblocks, offset);
+				io_uring_sqe_set_data(sqe, part);
+
+				if (!IoWorkerUringSubmit())
+				{
+					read->ok = false;
+					break;
+				}
+				read->nparts++;
+				read->npending++;
+				done += nblocks;
+			}
+		}
+		PG_CATCH();
+		{
+			MemoryContextSwitchTo(IoWorkerContext);
+			EmitErrorReport();
+			FlushErrorState();
+			read->ok = false;
+		}
+		PG_END_TRY();
+
+		/* Wait for the parts already submitted even if a later one failed */
+		if (read->nparts == 0)
+			pgaio_complete(req, false);
+		else
+		{
+			ninflight += read->nparts;
+			nreads++;
+		}
+	}
+
+	if (nreads == 0)
+		return;
+
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_READ);
+
+	while (ninflight > 0)
+	{
+		struct io_uring_cqe *cqe;
+		IoWorkerUringPart *part;
+		int			rc;
+
+		rc = io_uring_wait_cqe(&io_worker_uring, &cqe);
+		if (rc == -EINTR || rc == -EAGAIN)
+			continue;
+		if (rc < 0)
+		{
+			/*
+			 * Not expected to happen.  We can't tell which of the reads are
+			 * still running, so fail all that haven't completed, and leave
+			 * it to the buffer manager to read their blocks again.
+			 */
+			ereport(LOG,
+					(errmsg("could not wait for io_uring completion, performing I/O synchronously: %s",
+							strerror(-rc))));
+			io_worker_uring_ready = false;
+			for (int i = 0; i < nreads; i++)
+			{
+				if (reads[i].npending > 0)
+					reads[i].ok = false;
+			}
+			break;
+		}
+
+		/*
+		 * Anything but reading the whole part, including a short read at
+		 * EOF, fails the request.  The buffer manager then reads the blocks
+		 * again itself, and reports the problem.
+		 */
+		part = (IoWorkerUringPart *) io_uring_cqe_get_data(cqe);
+		if (cqe->res != part->expected)
+			part->read->ok = false;
+		part->read->npending--;
+		io_uring_cqe_seen(&io_worker_uring, cqe);
+
+		ninflight--;
+	}
+
+	pgstat_report_wait_end();
+
+	for (int i = 0; i < nreads; i++)
+		pgaio_complete(reads[i].req, reads[i].ok);
+}
+#endif							/* USE_LIBURING */
+
+/*
+ * Main entry point for I/O worker processes
+ */
+void
+IoWorkerMain(Datum main_arg)
+{
+	int			id = DatumGetInt32(main_arg);
+	XLogRecPtr	last_redo = InvalidXLogRecPtr;
+
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Blocks that fail verification are left for the backend that needs
+	 * them, whose session settings decide whether they are zeroed.
+	 */
+	SetConfigOption("zero_damaged_pages", "off", PGC_SUSET, PGC_S_OVERRIDE);
+
+	IoWorkerContext = AllocSetContextCreate(TopMemoryContext,
+											"I/O worker",
+											ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(IoWorkerContext);
+
+#ifdef USE_LIBURING
+	if (io_method == IOMETHOD_IO_URING)
+	{
+		int			rc = io_uring_queue_init(IO_WORKER_URING_ENTRIES,
+											 &io_worker_uring, 0);
+
+		if (rc < 0)
+			ereport(LOG,
+					(errmsg("could not set up io_uring, performing I/O synchronously: %s",
+							strerror(-rc))));
+		else
+			io_worker_uring_ready = true;
+	}
+#endif
+
+	pgaio_worker_attach(id);
+
+#ifdef USE_LIBURING
+	if (io_worker_uring_ready)
+		ereport(DEBUG1,
+				(errmsg_internal("I/O worker %d started, using io_uring", id)));
+	else
+#endif
+		ereport(DEBUG1,
+				(errmsg_internal("I/O worker %d started", id)));
+
+	for (;;)
+	{
+		PgAioRequest *reqs[IO_WORKER_BATCH_SIZE];
+		int			maxreqs = 1;
+		int			nreqs;
+		XLogRecPtr	redo;
+
+		ResetLatch(MyLatch);
+
+#ifdef USE_LIBURING
+		/* Without io_uring, leave requests to the other idle workers */
+		if (io_worker_uring_ready)
+			maxreqs = IO_WORKER_BATCH_SIZE;
+#endif
+
+		nreqs = pgaio_worker_dequeue(id, reqs, maxreqs,
+									 ShutdownRequestPending);
+		if (nreqs == 0)
+		{
+			if (ShutdownRequestPending)
+				break;
+
+			/*
+			 * Nothing to do.  Close our files, so that those of dropped
+			 * relations don't linger.
+			 */
+			smgrcloseall();
+
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+							 WAIT_EVENT_IO_WORKER_MAIN);
+			continue;
+		}
+
+		/*
+		 * A relfilenode can only be reused after a checkpoint unlinked the
+		 * dropped relation's files, so a request for the new relation reaches
+		 * us only after that checkpoint moved the redo pointer.  Close our
+		 * files if it moved since we last closed them.
+		 */
+		redo = GetRedoRecPtr();
+		if (redo != last_redo)
+		{
+			smgrcloseall();
+			last_redo = redo;
+		}
+
+#ifdef USE_LIBURING
+		if (io_worker_uring_ready)
+			IoWorkerPerformUring(reqs, nreqs);
+		else
+#endif
+			for (int i = 0; i < nreqs; i++)
+				IoWorkerPerform(reqs[i]);
+
+		MemoryContextReset(IoWorkerContext);
+	}
+
+	proc_exit(0);
+}
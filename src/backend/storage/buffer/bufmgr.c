@@ -45,6 +45,7 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "postmaster/bgwriter.h"
+#include "storage/aio.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
@@ -151,6 +152,12 @@ int			effective_io_concurrency = 0;
  */
 int			maintenance_io_concurrency = 0;
 
+/*
+ * Maximum number of consecutive blocks ReadBuffers() callers should ask for
+ * at once, which is the largest read issued to the kernel.
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
 /*
  * GUC variables about triggering kernel writeback for buffers written; OS
  * dependent defaults are set via the GUC mechanism.
@@ -159,9 +166,14 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions: the buffers we are
+ * doing I/O on.  ReadBuffers() may start input on a whole run of buffers,
+ * and evicting a victim for the next one may add an output.
+ */
+static BufferDesc *InProgressBufs[MAX_IO_COMBINE_LIMIT + 1];
+static bool InProgressForInput[MAX_IO_COMBINE_LIMIT + 1];
+static int	NInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -463,17 +475,31 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 								ForkNumber forkNum, BlockNumber blockNum,
 								ReadBufferMode mode, BufferAccessStrategy strategy,
 								bool *hit);
+static PrefetchBufferResult PrefetchSharedBufferAsync(Relation reln,
+													  ForkNumber forkNum,
+													  BlockNumber blockNum);
+static void ReadBuffersInternal(Relation reln, ForkNumber forkNum,
+								BlockNumber blockNum, int nblocks,
+								BufferAccessStrategy strategy,
+								Buffer *buffers, bool async);
+static void StartReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum,
+								BlockNumber blockNum, BufferDesc **run,
+								int nrun, bool async);
+static void ReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum,
+						   BlockNumber blockNum, BufferDesc **run, int nrun);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
-						  WritebackContext *wb_context);
+						  WritebackContext *wb_context, bool async);
 static void WaitIO(BufferDesc *buf);
-static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
+static void ForgetBufferIO(BufferDesc *buf);
+static void HandOffBufferIO(BufferDesc *buf);
 static void shared_buffer_write_error_callback(void *arg);
 static void local_buffer_write_error_callback(void *arg);
 static BufferDesc *BufferAlloc(SMgrRelation smgr,
@@ -481,8 +507,9 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   ForkNumber forkNum,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
+							   bool nowait,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln, bool async);
 static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
 										  ForkNumber forkNum,
 										  BlockNumber nForkBlock,
@@ -587,6 +614,10 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
  * lack of a kernel facility), or the underlying relation file wasn't found and
  * we are in recovery.  (If the relation file wasn't found and we are not in
  * recovery, an error is raised).
+ *
+ * Unless io_method is "sync", a block of a shared buffer relation is instead
+ * read into shared buffers by an I/O worker, and initiated_io means that the
+ * read has been queued.  The block must exist in that case.
  */
 PrefetchBufferResult
 PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
@@ -605,6 +636,11 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 		/* pass it off to localbuf.c */
 		return PrefetchLocalBuffer(RelationGetSmgr(reln), forkNum, blockNum);
 	}
+	else if (io_method != IOMETHOD_SYNC)
+	{
+		/* read it into shared buffers through an I/O worker */
+		return PrefetchSharedBufferAsync(reln, forkNum, blockNum);
+	}
 	else
 	{
 		/* pass it to the shared buffer version */
@@ -612,6 +648,65 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 }
 
+/*
+ * PrefetchSharedBufferAsync -- subroutine for PrefetchBuffer.  Queues a read
+ *		of the block into a shared buffer, if it's not in one already.
+ *
+ * If no I/O worker can take the read right now, this falls back to the
+ * kernel prefetch of PrefetchSharedBuffer, and leaves the allocated buffer
+ * invalid for whoever reads the block next.  A block that someone else is
+ * already reading in is skipped rather than waited for.
+ */
+static PrefetchBufferResult
+PrefetchSharedBufferAsync(Relation reln, ForkNumber forkNum,
+						  BlockNumber blockNum)
+{
+	PrefetchBufferResult result = {InvalidBuffer, false};
+	SMgrRelation smgr = RelationGetSmgr(reln);
+	BufferDesc *bufHdr;
+	PgAioRequest *req;
+	bool		found;
+
+	/* Make sure we will have room to remember the buffer pin */
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+	bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+						 blockNum, NULL, true, &found);
+	result.recent_buffer = BufferDescriptorGetBuffer(bufHdr);
+
+	if (!found)
+	{
+		req = pgaio_acquire();
+		if (req != NULL)
+		{
+			req->op = PGAIO_OP_READ;
+			req->rnode = smgr->smgr_rnode.node;
+			req->forknum = forkNum;
+			req->blocknum = blockNum;
+			req->nblocks = 1;
+			req->buffers[0] = result.recent_buffer;
+
+			HandOffBufferIO(bufHdr);
+			pgaio_submit(req);
+
+			pgBufferUsage.shared_blks_read++;
+			result.initiated_io = true;
+		}
+		else
+		{
+			TerminateBufferIO(bufHdr, false, 0);
+#ifdef USE_PREFETCH
+			if (smgrprefetch(smgr, forkNum, blockNum))
+				result.initiated_io = true;
+#endif							/* USE_PREFETCH */
+		}
+	}
+
+	UnpinBuffer(bufHdr, true);
+
+	return result;
+}
+
 /*
  * ReadRecentBuffer -- try to pin a block in a recently observed buffer
  *
@@ -785,6 +880,286 @@ ReadBufferExtended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 }
 
 
+/*
+ * ReadBuffers -- read nblocks consecutive blocks of a relation
+ *
+ * Returns the blocks starting at blockNum, pinned, in buffers[], exactly as
+ * calling ReadBufferExtended() in RBM_NORMAL mode for each of them would.
+ * The difference is that each run of blocks that are not in shared buffers
+ * yet is read with a single smgrreadv() call.  nblocks must not exceed
+ * MAX_IO_COMBINE_LIMIT, and all blocks must exist.
+ *
+ * The buffers of a run stay I/O-in-progress until the whole run has been
+ * read, so anyone else wanting one of them waits for us.  That can't
+ * deadlock because every caller acquires its buffers in ascending block
+ * order and waits only for blocks after the ones it holds.
+ */
+void
+ReadBuffers(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+			int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	ReadBuffersInternal(reln, forkNum, blockNum, nblocks, strategy, buffers,
+						false);
+}
+
+/*
+ * StartReadBuffers -- start reading nblocks consecutive blocks of a relation
+ *
+ * Like ReadBuffers, but unless io_method is "sync", the runs of blocks that
+ * are not in shared buffers yet are handed to I/O workers rather than read
+ * here.  The returned buffers are pinned, but WaitReadBuffer() must be called
+ * on each of them before its contents may be looked at.
+ */
+void
+StartReadBuffers(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				 int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	ReadBuffersInternal(reln, forkNum, blockNum, nblocks, strategy, buffers,
+						io_method != IOMETHOD_SYNC);
+}
+
+/*
+ * WaitReadBuffer -- wait for a buffer returned by StartReadBuffers to
+ *		become valid
+ *
+ * If its read failed, or the page didn't pass verification, the block is
+ * read again here, which reports the problem or zeroes the page just as
+ * ReadBuffer would.
+ */
+void
+WaitReadBuffer(Buffer buffer)
+{
+	BufferDesc *bufHdr;
+	uint32		buf_state;
+	instr_time	io_start,
+				io_time;
+	bool		needs_read;
+
+	Assert(BufferIsPinned(buffer));
+
+	if (BufferIsLocal(buffer))
+		return;
+
+	bufHdr = GetBufferDescriptor(buffer - 1);
+
+	buf_state = LockBufHdr(bufHdr);
+	UnlockBufHdr(bufHdr, buf_state);
+	if (buf_state & BM_VALID)
+		return;
+
+	/* Count the time spent waiting for the worker as read time */
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	needs_read = StartBufferIO(bufHdr, true, false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+
+	if (needs_read)
+		ReadBuffersRun(smgropen(bufHdr->tag.rnode, InvalidBackendId),
+					   bufHdr->tag.forkNum, bufHdr->tag.blockNum,
+					   &bufHdr, 1);
+}
+
+/*
+ * ReadBuffersInternal -- common logic for ReadBuffers and StartReadBuffers
+ */
+static void
+ReadBuffersInternal(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+					int nblocks, BufferAccessStrategy strategy,
+					Buffer *buffers, bool async)
+{
+	SMgrRelation smgr;
+	BufferDesc *run[MAX_IO_COMBINE_LIMIT];
+	BlockNumber runStart = InvalidBlockNumber;
+	int			nrun = 0;
+
+	Assert(nblocks > 0 && nblocks <= MAX_IO_COMBINE_LIMIT);
+
+	/* See ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(reln))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	/* Local buffers are not worth the trouble, read them one at a time */
+	if (RelationUsesLocalBuffers(reln))
+	{
+		for (int i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(reln, forkNum, blockNum + i,
+											RBM_NORMAL, strategy);
+		return;
+	}
+
+	smgr = RelationGetSmgr(reln);
+
+	for (int i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blockNum + i,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+							 blockNum + i, strategy, false, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (!found)
+		{
+			/* IO_IN_PROGRESS is set, add the buffer to the run */
+			pgBufferUsage.shared_blks_read++;
+			if (nrun == 0)
+				runStart = blockNum + i;
+			run[nrun++] = bufHdr;
+			continue;
+		}
+
+		pgstat_count_buffer_hit(reln);
+		pgBufferUsage.shared_blks_hit++;
+		VacuumPageHit++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageHit;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  found);
+
+		/* A cached block ends the current run */
+		if (nrun > 0)
+		{
+			StartReadBuffersRun(smgr, forkNum, runStart, run, nrun, async);
+			nrun = 0;
+		}
+	}
+
+	if (nrun > 0)
+		StartReadBuffersRun(smgr, forkNum, runStart, run, nrun, async);
+}
+
+/*
+ * StartReadBuffersRun -- subroutine for ReadBuffersInternal.  Hands the read
+ *		of a run to an I/O worker if async is true and one can take it, else
+ *		reads it right away with ReadBuffersRun.
+ */
+static void
+StartReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum,
+					BlockNumber blockNum, BufferDesc **run, int nrun,
+					bool async)
+{
+	PgAioRequest *req = async ? pgaio_acquire() : NULL;
+
+	if (req == NULL)
+	{
+		ReadBuffersRun(smgr, forkNum, blockNum, run, nrun);
+		return;
+	}
+
+	req->op = PGAIO_OP_READ;
+	req->rnode = smgr->smgr_rnode.node;
+	req->forknum = forkNum;
+	req->blocknum = blockNum;
+	req->nblocks = nrun;
+	for (int i = 0; i < nrun; i++)
+	{
+		req->buffers[i] = BufferDescriptorGetBuffer(run[i]);
+		HandOffBufferIO(run[i]);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+	}
+
+	pgaio_submit(req);
+}
+
+/*
+ * ReadBuffersRun -- subroutine for ReadBuffers.  Reads the consecutive
+ *		blocks starting at blockNum into the I/O-in-progress buffers run[],
+ *		verifies them and marks them valid.
+ */
+static void
+ReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
+			   BufferDesc **run, int nrun)
+{
+	char	   *pages[MAX_IO_COMBINE_LIMIT];
+	instr_time	io_start,
+				io_time;
+
+	for (int i = 0; i < nrun; i++)
+		pages[i] = (char *) BufHdrGetBlock(run[i]);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrreadv(smgr, forkNum, blockNum, pages, nrun);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+
+	for (int i = 0; i < nrun; i++)
+	{
+		/* check for garbage data, as ReadBuffer_common does */
+		if (!PageIsVerifiedExtended((Page) pages[i], blockNum + i,
+									PIV_LOG_WARNING | PIV_REPORT_STAT))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(pages[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(run[i], false, BM_VALID);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  false);
+	}
+}
+
 /*
  * ReadBufferWithoutRelcache -- like ReadBufferExtended, but doesn't require
  *		a relcache entry for the relation.
@@ -871,7 +1246,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * not currently in memory.
 		 */
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
-							 strategy, &found);
+							 strategy, false, &found);
 		if (found)
 			pgBufferUsage.shared_blks_hit++;
 		else if (isExtend)
@@ -968,7 +1343,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				Assert(buf_state & BM_VALID);
 				buf_state &= ~BM_VALID;
 				UnlockBufHdr(bufHdr, buf_state);
-			} while (!StartBufferIO(bufHdr, true));
+			} while (!StartBufferIO(bufHdr, true, false));
 		}
 	}
 
@@ -1113,12 +1488,18 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
  * we keep it for simplicity in ReadBuffer.
  *
+ * If nowait is true, a page that someone else is reading in is reported as
+ * found instead of waiting for the read to finish.  The buffer may then
+ * still be invalid; that is only good enough for callers that merely want
+ * the page on its way, like PrefetchSharedBufferAsync.
+ *
  * No locks are held either at entry or exit.
  */
 static BufferDesc *
 BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
+			bool nowait,
 			bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
@@ -1168,7 +1549,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			 * own read attempt if the page is still not BM_VALID.
 			 * StartBufferIO does it all.
 			 */
-			if (StartBufferIO(buf, true))
+			if (StartBufferIO(buf, true, nowait))
 			{
 				/*
 				 * If we get here, previous attempts to read the buffer must
@@ -1269,7 +1650,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, false);
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
@@ -1380,7 +1761,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 * then set up our own read attempt if the page is still not
 				 * BM_VALID.  StartBufferIO does it all.
 				 */
-				if (StartBufferIO(buf, true))
+				if (StartBufferIO(buf, true, nowait))
 				{
 					/*
 					 * If we get here, previous attempts to read the buffer
@@ -1456,7 +1837,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * to read it before we did, so there's nothing left for BufferAlloc() to
 	 * do.
 	 */
-	if (StartBufferIO(buf, true))
+	if (StartBufferIO(buf, true, nowait))
 		*foundPtr = false;
 	else
 		*foundPtr = true;
@@ -1946,6 +2327,9 @@ UnpinBuffer(BufferDesc *buf, bool fixOwner)
  * CHECKPOINT_END_OF_RECOVERY or CHECKPOINT_FLUSH_ALL is set, we write even
  * unlogged buffers, which are otherwise skipped.  The remaining flags
  * currently have no effect here.
+ *
+ * Unless io_method is "sync", the writes are handed to I/O workers, so that
+ * the checkpointer can keep issuing writes while earlier ones are in flight.
  */
 static void
 BufferSync(int flags)
@@ -1962,6 +2346,7 @@ BufferSync(int flags)
 	int			i;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
+	bool		async = (io_method != IOMETHOD_SYNC);
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -2161,7 +2546,7 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			if (SyncOneBuffer(buf_id, false, &wb_context, async) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				PendingCheckpointerStats.buf_written_checkpoints++;
@@ -2196,6 +2581,26 @@ BufferSync(int flags)
 		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
+	/*
+	 * Wait for the writes handed to I/O workers to finish, so that the files
+	 * are not fsync'd before the writes reach them.  Buffers whose write
+	 * failed are still marked BM_CHECKPOINT_NEEDED; write those ourselves.
+	 */
+	if (async)
+	{
+		for (i = 0; i < num_to_scan; i++)
+		{
+			BufferDesc *bufHdr;
+
+			buf_id = CkptBufferIds[i].buf_id;
+			bufHdr = GetBufferDescriptor(buf_id);
+
+			WaitIO(bufHdr);
+			if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
+				SyncOneBuffer(buf_id, false, &wb_context, false);
+		}
+	}
+
 	/* issue all pending flushes */
 	IssuePendingWritebacks(&wb_context);
 
@@ -2450,7 +2855,7 @@ BgBufferSync(WritebackContext *wb_context)
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
 		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+											   wb_context, false);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -2516,6 +2921,9 @@ BgBufferSync(WritebackContext *wb_context)
  * If skip_recently_used is true, we don't write currently-pinned buffers, nor
  * buffers marked recently used, as these are not replacement candidates.
  *
+ * If async is true, the write may be handed to an I/O worker, see
+ * FlushBuffer.
+ *
  * Returns a bitmask containing the following flag bits:
  *	BUF_WRITTEN: we wrote the buffer.
  *	BUF_REUSABLE: buffer is available for replacement, ie, it has
@@ -2527,7 +2935,8 @@ BgBufferSync(WritebackContext *wb_context)
  * Note: caller must have done ResourceOwnerEnlargeBuffers.
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
+SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context,
+			  bool async)
 {
 	BufferDesc *bufHdr = GetBufferDescriptor(buf_id);
 	int			result = 0;
@@ -2573,7 +2982,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, async);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2820,9 +3229,13 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
  * as the second parameter.  If not, pass NULL.
+ *
+ * If async is true and an I/O worker is available, the write is only
+ * started here: the buffer stays BM_IO_IN_PROGRESS until the worker has
+ * written it, and stays dirty if that fails.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, bool async)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcallback;
@@ -2831,13 +3244,14 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	Block		bufBlock;
 	char	   *bufToWrite;
 	uint32		buf_state;
+	PgAioRequest *req;
 
 	/*
 	 * Try to start an I/O operation.  If StartBufferIO returns false, then
 	 * someone else flushed the buffer before we could, so we need not do
 	 * anything.
 	 */
-	if (!StartBufferIO(buf, false))
+	if (!StartBufferIO(buf, false, false))
 		return;
 
 	/* Setup error traceback support for ereport() */
@@ -2895,6 +3309,35 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 */
 	bufBlock = BufHdrGetBlock(buf);
 
+	/*
+	 * Hand the write to an I/O worker if asked to.  The page goes to the
+	 * request's bounce buffer, and the checksum is set there, for the same
+	 * reason PageSetChecksumCopy copies it.
+	 */
+	if (async && (req = pgaio_acquire()) != NULL)
+	{
+		char	   *bounce = pgaio_bounce_buffer(req);
+
+		memcpy(bounce, bufBlock, BLCKSZ);
+		PageSetChecksumInplace((Page) bounce, buf->tag.blockNum);
+
+		req->op = PGAIO_OP_WRITE;
+		req->rnode = buf->tag.rnode;
+		req->forknum = buf->tag.forkNum;
+		req->blocknum = buf->tag.blockNum;
+		req->nblocks = 1;
+		req->buffers[0] = BufferDescriptorGetBuffer(buf);
+
+		HandOffBufferIO(buf);
+		pgaio_submit(req);
+
+		pgBufferUsage.shared_blks_written++;
+
+		/* Pop the error context stack */
+		error_context_stack = errcallback.previous;
+		return;
+	}
+
 	/*
 	 * Update page checksum if desired.  Since we have only shared lock on the
 	 * buffer, other processes might be updating hint bits in it, so we must
@@ -3585,7 +4028,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, RelationGetSmgr(rel));
+			FlushBuffer(bufHdr, RelationGetSmgr(rel), false);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3680,7 +4123,7 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, false);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3890,7 +4333,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, false);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3917,7 +4360,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, false);
 }
 
 /*
@@ -4536,27 +4979,29 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is not executing IO for this buffer
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
  * could attempt the same I/O operation concurrently.  If someone else
  * has already started I/O on this buffer then we will block on the
- * I/O condition variable until he's done.
+ * I/O condition variable until he's done, unless nowait is true, in which
+ * case we return false right away.
  *
  * Input operations are only attempted on buffers that are not BM_VALID,
  * and output operations only on buffers that are BM_VALID and BM_DIRTY,
  * so we can always tell if the work is already done.
  *
  * Returns true if we successfully marked the buffer as I/O busy,
- * false if someone else already did the work.
+ * false if someone else already did the work (or, with nowait, is still
+ * doing it).
  */
 static bool
-StartBufferIO(BufferDesc *buf, bool forInput)
+StartBufferIO(BufferDesc *buf, bool forInput, bool nowait)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NInProgressBufs < lengthof(InProgressBufs));
 
 	for (;;)
 	{
@@ -4565,6 +5010,8 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 		if (!(buf_state & BM_IO_IN_PROGRESS))
 			break;
 		UnlockBufHdr(buf, buf_state);
+		if (nowait)
+			return false;
 		WaitIO(buf);
 	}
 
@@ -4580,8 +5027,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NInProgressBufs] = buf;
+	InProgressForInput[NInProgressBufs] = forInput;
+	NInProgressBufs++;
 
 	return true;
 }
@@ -4607,8 +5055,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
 
-	Assert(buf == InProgressBuf);
-
 	buf_state = LockBufHdr(buf);
 
 	Assert(buf_state & BM_IO_IN_PROGRESS);
@@ -4620,13 +5066,103 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	ForgetBufferIO(buf);
 
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
 
 /*
- * AbortBufferIO: Clean up any active buffer I/O after an error.
+ * ForgetBufferIO: remove a buffer from the ones we are doing I/O on
+ */
+static void
+ForgetBufferIO(BufferDesc *buf)
+{
+	int			i;
+
+	for (i = NInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
+
+	/* Move the last entry into its place */
+	NInProgressBufs--;
+	InProgressBufs[i] = InProgressBufs[NInProgressBufs];
+	InProgressForInput[i] = InProgressForInput[NInProgressBufs];
+}
+
+/*
+ * HandOffBufferIO: pass the I/O we started on a buffer to an AIO request
+ *
+ * The request gets a pin of its own, so that the buffer stays put until the
+ * request is completed, whether or not we still hold ours by then.  From now
+ * on the I/O is ended by AioCompleteBufferIO(), and not by us nor by
+ * AbortBufferIO().
+ */
+static void
+HandOffBufferIO(BufferDesc *buf)
+{
+	uint32		buf_state;
+
+	buf_state = LockBufHdr(buf);
+	Assert(buf_state & BM_IO_IN_PROGRESS);
+	Assert(BUF_STATE_GET_REFCOUNT(buf_state) > 0);
+	buf_state += BUF_REFCOUNT_ONE;
+	UnlockBufHdr(buf, buf_state);
+
+	ForgetBufferIO(buf);
+}
+
+/*
+ * AioCompleteBufferIO: end the I/O of an AIO request on a buffer
+ *
+ * This is TerminateBufferIO() for a buffer whose I/O was handed off with
+ * HandOffBufferIO(), and may be called by any process.  It also drops the
+ * request's pin.  On success, a read marks the buffer valid, and a write
+ * marks it clean unless it has been dirtied again meanwhile.  On failure,
+ * BM_IO_ERROR is set, and the next one to need the buffer does the I/O
+ * again.
+ */
+void
+AioCompleteBufferIO(Buffer buffer, bool forInput, bool success)
+{
+	BufferDesc *buf = GetBufferDescriptor(buffer - 1);
+	uint32		buf_state;
+	int			wait_backend_pgprocno = -1;
+
+	buf_state = LockBufHdr(buf);
+
+	Assert(buf_state & BM_IO_IN_PROGRESS);
+	Assert(BUF_STATE_GET_REFCOUNT(buf_state) > 0);
+
+	buf_state &= ~(BM_IO_IN_PROGRESS | BM_IO_ERROR);
+	if (!success)
+		buf_state |= BM_IO_ERROR;
+	else if (forInput)
+		buf_state |= BM_VALID;
+	else if (!(buf_state & BM_JUST_DIRTIED))
+		buf_state &= ~(BM_DIRTY | BM_CHECKPOINT_NEEDED);
+
+	/* Drop the request's pin, see UnpinBuffer */
+	buf_state -= BUF_REFCOUNT_ONE;
+	if ((buf_state & BM_PIN_COUNT_WAITER) &&
+		BUF_STATE_GET_REFCOUNT(buf_state) == 1)
+	{
+		wait_backend_pgprocno = buf->wait_backend_pgprocno;
+		buf_state &= ~BM_PIN_COUNT_WAITER;
+	}
+
+	UnlockBufHdr(buf, buf_state);
+
+	if (wait_backend_pgprocno >= 0)
+		ProcSendSignal(wait_backend_pgprocno);
+
+	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
+}
+
+/*
+ * AbortBufferIO: Clean up all active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
  *	but we haven't yet released buffer pins, so the buffer is still pinned.
@@ -4637,15 +5173,14 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NInProgressBufs - 1];
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (InProgressForInput[NInProgressBufs - 1])
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -805,6 +805,114 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFileWriteBlocks --- write whole blocks, bypassing the buffer
+ *
+ * Writes nblocks BLCKSZ-sized blocks starting at block blknum with as few
+ * write calls as possible, i.e. one per segment file touched, rather than one
+ * per block.  The target must not start past the end of the file.  The
+ * logical position is left after the last block written.
+ */
+void
+BufFileWriteBlocks(BufFile *file, long blknum, void *ptr, int nblocks)
+{
+	size_t		size = (size_t) nblocks * BLCKSZ;
+
+	Assert(!file->readOnly);
+
+	if (BufFileSeekBlock(file, blknum) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek to block %ld of temporary file",
+						blknum)));
+
+	/*
+	 * Write out anything still in the buffer, then forget it: the blocks
+	 * written below may overlap it.
+	 */
+	BufFileFlush(file);
+	file->curOffset += file->pos;
+	file->pos = 0;
+	file->nbytes = 0;
+
+	while (size > 0)
+	{
+		File		thisfile;
+		size_t		nthistime;
+		int			nwritten;
+		instr_time	io_start;
+		instr_time	io_time;
+
+		/*
+		 * Advance to next component file if necessary, as in
+		 * BufFileDumpBuffer.
+		 */
+		if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+		{
+			while (file->curFile + 1 >= file->numFiles)
+				extendBufFile(file);
+			file->curFile++;
+			file->curOffset = 0L;
+		}
+
+		nthistime = Min(size, (size_t) (MAX_PHYSICAL_FILESIZE - file->curOffset));
+		thisfile = file->files[file->curFile];
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+
+		nwritten = FileWrite(thisfile, (char *) ptr, (int) nthistime,
+							 file->curOffset, WAIT_EVENT_BUFFILE_WRITE);
+		if (nwritten <= 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							FilePathName(thisfile))));
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			INSTR_TIME_ADD(pgBufferUsage.temp_blk_write_time, io_time);
+		}
+
+		file->curOffset += nwritten;
+		ptr = (void *) ((char *) ptr + nwritten);
+		size -= nwritten;
+
+		pgBufferUsage.temp_blks_written += (nwritten + BLCKSZ - 1) / BLCKSZ;
+	}
+}
+
+/*
+ * BufFilePrefetchBlocks --- hint that blocks will be read soon
+ *
+ * Asks the kernel to start reading nblocks BLCKSZ-sized blocks starting at
+ * block blknum in the background, so that a later BufFileRead() of them
+ * does not have to wait for the device.  This is only a hint: blocks past
+ * the end of the file are ignored, and nothing is done on platforms
+ * without posix_fadvise().  The logical position is not moved.
+ */
+void
+BufFilePrefetchBlocks(BufFile *file, long blknum, int nblocks)
+{
+	int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+	off_t		offset = (off_t) (blknum % BUFFILE_SEG_SIZE) * BLCKSZ;
+	off_t		amount = (off_t) nblocks * BLCKSZ;
+
+	while (amount > 0 && fileno < file->numFiles)
+	{
+		off_t		nthistime = Min(amount, MAX_PHYSICAL_FILESIZE - offset);
+
+		(void) FilePrefetch(file->files[fileno], offset, (int) nthistime,
+							WAIT_EVENT_BUFFILE_READ);
+
+		amount -= nthistime;
+		fileno++;
+		offset = 0;
+	}
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
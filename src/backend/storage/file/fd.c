@@ -2164,6 +2164,61 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileReadV - like FileRead(), but scatters the data read from offset into
+ * several buffers with a single system call.  Returns the total number of
+ * bytes read, which is less than the buffers' combined size at end of file.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		  uint32 wait_event_info)
+{
+	int			returnCode;
+	Vfd		   *vfdP;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = pg_preadv(vfdP->fd, iov, iovcnt, offset);
+	pgstat_report_wait_end();
+
+	if (returnCode < 0)
+	{
+		/* See FileRead() about these */
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+	}
+
+	return returnCode;
+}
+
 int
 FileWrite(File file, char *buffer, int amount, off_t offset,
 		  uint32 wait_event_info)
@@ -2358,6 +2413,25 @@ FileGetRawDesc(File file)
 	return VfdCache[file].fd;
 }
 
+/*
+ * FileAccessRawDesc - like FileGetRawDesc, but reopens the file first if it
+ * has been closed to make room for others.  Returns -1 with errno set if
+ * that fails.  The same caveats apply.
+ */
+int
+FileAccessRawDesc(File file)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return VfdCache[file].fd;
+}
+
 /*
  * FileGetRawFlags - returns the file flags on open(2)
  */
@@ -614,6 +614,37 @@ LockHeldByMe(const LOCKTAG *locktag, LOCKMODE lockmode)
 	return (locallock && locallock->nLocks > 0);
 }
 
+/*
+ * VisitRelationsLockedForWrite -- call 'callback' for each relation of the
+ *		current database that we hold RowExclusiveLock or a stronger lock on
+ *
+ * Changing the rows of a table requires RowExclusiveLock on it, normally
+ * kept until the end of the transaction, so this tells which tables a
+ * transaction about to commit may have changed.  A relation may be visited
+ * more than once.  Nothing is allocated, so this is safe to use while
+ * committing.
+ */
+void
+VisitRelationsLockedForWrite(void (*callback) (Oid relid))
+{
+	HASH_SEQ_STATUS status;
+	LOCALLOCK  *locallock;
+
+	hash_seq_init(&status, LockMethodLocalHash);
+
+	while ((locallock = (LOCALLOCK *) hash_seq_search(&status)) != NULL)
+	{
+		LOCKTAG    *locktag = &locallock->tag.lock;
+
+		if (locallock->nLocks > 0 &&
+			locktag->locktag_type == LOCKTAG_RELATION &&
+			locktag->locktag_lockmethodid == DEFAULT_LOCKMETHOD &&
+			locktag->locktag_field1 == MyDatabaseId &&
+			locallock->tag.mode >= RowExclusiveLock)
+			callback(locktag->locktag_field2);
+	}
+}
+
 #ifdef USE_ASSERT_CHECKING
 /*
  * GetLockMethodLocalHash -- return the hash of local locks, for modules that
@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -711,6 +712,123 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read nblocks consecutive blocks, starting at blocknum, into
+ *		the given buffers.
+ *
+ *		This behaves like calling mdread() for each block, but all blocks
+ *		that lie in the same segment file are read with one system call.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		int			nbytes;
+		MdfdVec    *v;
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode,
+											reln->smgr_rnode.backend);
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Stop at the end of the segment, or when the iovec array is full */
+		iovcnt = Min(nblocks, PG_IOV_MAX);
+		iovcnt = Min(iovcnt, RELSEG_SIZE - blocknum % ((BlockNumber) RELSEG_SIZE));
+		for (int i = 0; i < iovcnt; i++)
+		{
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = BLCKSZ;
+		}
+
+		nbytes = FileReadV(v->mdfd_vfd, iov, iovcnt, seekpos,
+						   WAIT_EVENT_DATA_FILE_READ);
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode,
+										   reln->smgr_rnode.backend,
+										   nbytes,
+										   BLCKSZ * iovcnt);
+
+		if (nbytes != BLCKSZ * iovcnt)
+		{
+			int			nfull;
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + iovcnt - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			/*
+			 * Short read.  The blocks read completely are fine; the first
+			 * incomplete one and those after it are past EOF, which is
+			 * handled as in mdread().
+			 */
+			nfull = nbytes / BLCKSZ;
+			if (!(zero_damaged_pages || InRecovery))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
+								blocknum + nfull, FilePathName(v->mdfd_vfd),
+								nbytes % BLCKSZ, BLCKSZ)));
+			for (int i = nfull; i < iovcnt; i++)
+				MemSet(buffers[i], 0, BLCKSZ);
+		}
+
+		buffers += iovcnt;
+		blocknum += iovcnt;
+		nblocks -= iovcnt;
+	}
+}
+
+/*
+ *	mdfd() -- Get the kernel file descriptor and file offset of a block, for
+ *		performing I/O on it without going through md.c.
+ *
+ *		*nblocks is reduced to the number of blocks, starting at blocknum,
+ *		that lie in the same segment file.  The file descriptor stays valid
+ *		only until the file is closed, see FileGetRawDesc().
+ */
+int
+mdfd(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+	 off_t *off, BlockNumber *nblocks)
+{
+	BlockNumber segblock = blocknum % ((BlockNumber) RELSEG_SIZE);
+	MdfdVec    *v;
+	int			fd;
+
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+	*off = (off_t) BLCKSZ * segblock;
+	*nblocks = Min(*nblocks, RELSEG_SIZE - segblock);
+
+	fd = FileAccessRawDesc(v->mdfd_vfd);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m",
+						FilePathName(v->mdfd_vfd))));
+
+	return fd;
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -54,6 +54,12 @@ typedef struct f_smgr
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   BlockNumber nblocks);
+	int			(*smgr_fd) (SMgrRelation reln, ForkNumber forknum,
+							BlockNumber blocknum, off_t *off,
+							BlockNumber *nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
@@ -77,6 +83,8 @@ static const f_smgr smgrsw[] = {
 		.smgr_extend = mdextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
+		.smgr_readv = mdreadv,
+		.smgr_fd = mdfd,
 		.smgr_write = mdwrite,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
@@ -535,6 +543,36 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].smgr_read(reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read nblocks consecutive blocks, starting at blocknum,
+ *				   into the supplied buffers.
+ *
+ *		Like calling smgrread() for each block, but lets the storage manager
+ *		combine the reads.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, buffers,
+										nblocks);
+}
+
+/*
+ *	smgrfd() -- get a kernel file descriptor and offset for reading or
+ *				writing blocks directly, starting at blocknum.
+ *
+ *		*nblocks is reduced to the number of blocks the file descriptor can be
+ *		used for.  Used by I/O workers that submit reads to io_uring.
+ */
+int
+smgrfd(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+	   off_t *off, BlockNumber *nblocks)
+{
+	return smgrsw[reln->smgr_which].smgr_fd(reln, forknum, blocknum, off,
+											nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -46,7 +46,19 @@
  *
  * To further make the I/Os more sequential, we can use a larger buffer
  * when reading, and read multiple blocks from the same tape in one go,
- * whenever the buffer becomes empty.
+ * whenever the buffer becomes empty.  When such a buffer is refilled, we
+ * also ask the kernel to start reading the next bufferload in the
+ * background (assuming the tape continues in the blocks that follow, which
+ * is usually the case), so that the merge can go on consuming the other
+ * tapes while that I/O is in progress rather than stalling on each refill.
+ *
+ * On the write side, blocks need not be handed to the BufFile one at a
+ * time.  If the caller has set up a write-behind buffer for the tape set
+ * (see LogicalTapeSetWriteBehind()), consecutive block writes are collected
+ * in it and written with a single call when the run of blocks is broken or
+ * the buffer is full.  Reads of blocks still in that buffer are served from
+ * it.  The buffer is sized and accounted for by the caller, as it is part of
+ * the caller's memory budget.
  *
  * To support the above policy of writing to the lowest free block, the
  * freelist is a min heap.
@@ -124,6 +136,14 @@ typedef struct TapeBlockTrailer
 #define TAPE_WRITE_PREALLOC_MIN 8
 #define TAPE_WRITE_PREALLOC_MAX 128
 
+/*
+ * Maximum number of consecutive blocks collected in the tape set's
+ * write-behind buffer before they are written out with one call, and the
+ * fraction of the caller's memory budget the buffer may take up.
+ */
+#define TAPE_WRITE_BEHIND_BLOCKS 32
+#define TAPE_WRITE_BEHIND_FRACTION 16
+
 /*
  * This data structure represents a single "logical tape" within the set
  * of logical tapes stored in the same file.
@@ -217,10 +237,22 @@ struct LogicalTapeSet
 	long		nFreeBlocks;	/* # of currently free blocks */
 	Size		freeBlocksLen;	/* current allocated length of freeBlocks[] */
 	bool		enable_prealloc;	/* preallocate write blocks? */
+
+	/*
+	 * Write-behind buffer.  Holds nWriteBehind not yet written blocks,
+	 * starting at block writeBehindStart.  Allocated on first write, if
+	 * maxWriteBehind is not zero, in the memory context of the tape set
+	 * itself.
+	 */
+	char	   *writeBehind;
+	long		writeBehindStart;
+	int			nWriteBehind;
+	int			maxWriteBehind;
 };
 
 static LogicalTape *ltsCreateTape(LogicalTapeSet *lts);
 static void ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
+static void ltsFlushWriteBehind(LogicalTapeSet *lts);
 static void ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
 static long ltsGetBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
@@ -259,19 +291,77 @@ ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 		ltsWriteBlock(lts, lts->nBlocksWritten, zerobuf.data);
 	}
 
-	/* Write the requested block */
-	if (BufFileSeekBlock(lts->pfile, blocknum) != 0)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not seek to block %ld of temporary file",
-						blocknum)));
-	BufFileWrite(lts->pfile, buffer, BLCKSZ);
+	/* Without a write-behind buffer, write the requested block right away */
+	if (lts->maxWriteBehind == 0)
+	{
+		if (BufFileSeekBlock(lts->pfile, blocknum) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %ld of temporary file",
+							blocknum)));
+		BufFileWrite(lts->pfile, buffer, BLCKSZ);
+
+		/* Update nBlocksWritten, if we extended the file */
+		if (blocknum == lts->nBlocksWritten)
+			lts->nBlocksWritten++;
+		return;
+	}
+
+	/*
+	 * The first write may happen in a shorter-lived context than the one the
+	 * tape set was created in, so allocate the buffer alongside the tape set.
+	 */
+	if (lts->writeBehind == NULL)
+		lts->writeBehind = MemoryContextAlloc(GetMemoryChunkContext(lts),
+											  lts->maxWriteBehind * BLCKSZ);
+
+	/*
+	 * Overwrite the block in place if it's still in the write-behind buffer.
+	 * Otherwise append it to the buffer, if it continues the buffered run of
+	 * blocks.  If not, or if the buffer is full, write out the buffered
+	 * blocks first and start a new run.
+	 */
+	if (lts->nWriteBehind > 0 &&
+		blocknum >= lts->writeBehindStart &&
+		blocknum < lts->writeBehindStart + lts->nWriteBehind)
+	{
+		memcpy(lts->writeBehind + (blocknum - lts->writeBehindStart) * BLCKSZ,
+			   buffer, BLCKSZ);
+		return;
+	}
+
+	if (lts->nWriteBehind == lts->maxWriteBehind ||
+		(lts->nWriteBehind > 0 &&
+		 blocknum != lts->writeBehindStart + lts->nWriteBehind))
+		ltsFlushWriteBehind(lts);
+
+	if (lts->nWriteBehind == 0)
+		lts->writeBehindStart = blocknum;
+	memcpy(lts->writeBehind + lts->nWriteBehind * BLCKSZ, buffer, BLCKSZ);
+	lts->nWriteBehind++;
 
 	/* Update nBlocksWritten, if we extended the file */
 	if (blocknum == lts->nBlocksWritten)
 		lts->nBlocksWritten++;
 }
 
+/*
+ * Write out the blocks collected in the write-behind buffer, if any.
+ *
+ * Blocks past the end of the underlying file are only ever added to the
+ * buffer in order, so the buffered run never starts past the end of file.
+ */
+static void
+ltsFlushWriteBehind(LogicalTapeSet *lts)
+{
+	if (lts->nWriteBehind == 0)
+		return;
+
+	BufFileWriteBlocks(lts->pfile, lts->writeBehindStart, lts->writeBehind,
+					   lts->nWriteBehind);
+	lts->nWriteBehind = 0;
+}
+
 /*
  * Read a block-sized buffer from the specified block of the underlying file.
  *
@@ -283,6 +373,17 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 {
 	size_t		nread;
 
+	/* The block might not have been written out yet */
+	if (lts->nWriteBehind > 0 &&
+		blocknum >= lts->writeBehindStart &&
+		blocknum < lts->writeBehindStart + lts->nWriteBehind)
+	{
+		memcpy(buffer,
+			   lts->writeBehind + (blocknum - lts->writeBehindStart) * BLCKSZ,
+			   BLCKSZ);
+		return;
+	}
+
 	if (BufFileSeekBlock(lts->pfile, blocknum) != 0)
 		ereport(ERROR,
 				(errcode_for_file_access(),
@@ -337,6 +438,19 @@ ltsReadFillBuffer(LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/*
+	 * Start reading the next bufferload in the background, guessing that it
+	 * is stored in the blocks that follow the next block.  That's true for
+	 * tapes written during the initial run formation, and mostly true for
+	 * the ones written during merge passes.  Frozen tapes use a single-block
+	 * buffer and are read by themselves; the kernel's own read-ahead takes
+	 * care of them.
+	 */
+	if (!lt->frozen && lt->nextBlockNumber != -1L)
+		BufFilePrefetchBlocks(lt->tapeSet->pfile,
+							  lt->nextBlockNumber + lt->offsetBlockNumber,
+							  lt->buffer_size / BLCKSZ);
+
 	return (lt->nbytes > 0);
 }
 
@@ -570,6 +684,10 @@ LogicalTapeSetCreate(bool preallocate, SharedFileSet *fileset, int worker)
 	lts->freeBlocks = (long *) palloc(lts->freeBlocksLen * sizeof(long));
 	lts->nFreeBlocks = 0;
 	lts->enable_prealloc = preallocate;
+	lts->writeBehind = NULL;
+	lts->writeBehindStart = 0L;
+	lts->nWriteBehind = 0;
+	lts->maxWriteBehind = 0;
 
 	lts->fileset = fileset;
 	lts->worker = worker;
@@ -669,6 +787,8 @@ LogicalTapeSetClose(LogicalTapeSet *lts)
 {
 	BufFileClose(lts->pfile);
 	pfree(lts->freeBlocks);
+	if (lts->writeBehind)
+		pfree(lts->writeBehind);
 	pfree(lts);
 }
 
@@ -738,6 +858,44 @@ LogicalTapeClose(LogicalTape *lt)
 	pfree(lt);
 }
 
+/*
+ * Return the size of the write-behind buffer worth using for a tape set
+ * whose user has mem_limit bytes of memory to work with.
+ *
+ * The buffer takes a small fraction of the memory limit, so that it does not
+ * eat much into the space for tuples when work_mem is small.  Zero is
+ * returned when there's not enough memory for a buffer of at least two
+ * blocks, since a single block buffer would only add a copy of each block.
+ */
+Size
+LogicalTapeWriteBehindSize(Size mem_limit)
+{
+	Size		nblocks;
+
+	nblocks = Min(mem_limit / TAPE_WRITE_BEHIND_FRACTION / BLCKSZ,
+				  TAPE_WRITE_BEHIND_BLOCKS);
+	if (nblocks < 2)
+		return 0;
+
+	return nblocks * BLCKSZ;
+}
+
+/*
+ * Set up a write-behind buffer of the given size (in bytes, normally
+ * obtained from LogicalTapeWriteBehindSize()) for the tape set.
+ *
+ * The buffer is allocated on the first write.  The caller is responsible for
+ * counting it against its memory budget.  This must be called before
+ * anything is written to the tape set.
+ */
+void
+LogicalTapeSetWriteBehind(LogicalTapeSet *lts, Size size)
+{
+	Assert(lts->writeBehind == NULL && lts->nWriteBehind == 0);
+
+	lts->maxWriteBehind = Min(size / BLCKSZ, TAPE_WRITE_BEHIND_BLOCKS);
+}
+
 /*
  * Mark a logical tape set as not needing management of free space anymore.
  *
@@ -1041,6 +1199,7 @@ LogicalTapeFreeze(LogicalTape *lt, TapeShare *share)
 	/* Handle extra steps when caller is to share its tapeset */
 	if (share)
 	{
+		ltsFlushWriteBehind(lts);
 		BufFileExportFileSet(lts->pfile);
 		share->firstblocknumber = lt->firstBlockNumber;
 	}
@@ -687,10 +687,8 @@ static void tuplesort_updatemax(Tuplesortstate *state);
  * XXX: For now, these fall back to comparator functions that will compare the
  * leading datum a second time.
  *
- * XXX: For now, there is no specialization for cases where datum1 is
- * authoritative and we don't even need to fall back to a callback at all (that
- * would be true for types like int4/int8/timestamp/date, but not true for
- * abbreviations of text or multi-key sorts.  There could be!  Is it worth it?
+ * Larger inputs with one of these comparators are radix sorted instead, see
+ * radix_sort_tuple().
  */
 
 /* Used if first key's comparator is ssup_datum_unsigned_compare */
@@ -822,6 +820,214 @@ qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Radix sort for SortTuples whose leading key is in datum1 and compared as
+ * an unsigned, int64 or int32 integer by one of the specialized comparators
+ * above.  That covers int2, int4, int8, date and timestamp keys, as well as
+ * abbreviated keys.
+ *
+ * The datum1 values are normalized to unsigned integers that sort in the
+ * requested order, and then sorted in place one byte at a time, starting
+ * with the most significant one (an "American flag sort").  Partitions
+ * smaller than RADIX_SORT_THRESHOLD are left to the specialized quicksorts,
+ * which switch to insertion sort for the smallest ones.  After the last
+ * byte, the tuples of a partition have equal leading keys; unless datum1 is
+ * all there is to compare (onlyKey), they are then sorted by the remaining
+ * keys, or by the full values of abbreviated keys.
+ */
+#define RADIX_SORT_THRESHOLD 64
+
+static inline bool
+radix_sort_supported(SortSupport ssup)
+{
+	return ssup->comparator == ssup_datum_unsigned_cmp ||
+#if SIZEOF_DATUM >= 8
+		ssup->comparator == ssup_datum_signed_cmp ||
+#endif
+		ssup->comparator == ssup_datum_int32_cmp;
+}
+
+/* Return the byte of the normalized datum1 that starts at bit "shift" */
+static pg_attribute_always_inline int
+radix_sort_digit(Datum datum, SortSupport ssup, int shift)
+{
+	Datum		norm;
+
+	if (ssup->comparator == ssup_datum_int32_cmp)
+		norm = (Datum) ((uint32) DatumGetInt32(datum) ^ ((uint32) 1 << 31));
+#if SIZEOF_DATUM >= 8
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+		norm = datum ^ ((Datum) 1 << 63);
+#endif
+	else
+		norm = datum;
+
+	if (ssup->ssup_reverse)
+		norm = ~norm;
+
+	return (int) ((norm >> shift) & 0xFF);
+}
+
+/* Sort with the specialized quicksort for the leading key's comparator */
+static void
+qsort_tuple_datum1(SortTuple *data, size_t n, Tuplesortstate *state)
+{
+	SortSupport ssup = &state->sortKeys[0];
+
+	if (ssup->comparator == ssup_datum_int32_cmp)
+		qsort_tuple_int32(data, n, state);
+#if SIZEOF_DATUM >= 8
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+		qsort_tuple_signed(data, n, state);
+#endif
+	else
+		qsort_tuple_unsigned(data, n, state);
+}
+
+/*
+ * Sort n non-NULL tuples by byte "level" of their normalized datum1, 0 being
+ * the most significant byte, and recurse into the resulting partitions.
+ */
+static void
+radix_sort_tuple(SortTuple *data, size_t n, int level, Tuplesortstate *state)
+{
+	SortSupport ssup = &state->sortKeys[0];
+	int			shift = (SIZEOF_DATUM - 1 - level) * BITS_PER_BYTE;
+	size_t		count[256];
+	size_t		next[256];
+	size_t		end[256];
+	size_t		pos;
+	int			b;
+
+	CHECK_FOR_INTERRUPTS();
+
+	memset(count, 0, sizeof(count));
+	for (pos = 0; pos < n; pos++)
+		count[radix_sort_digit(data[pos].datum1, ssup, shift)]++;
+
+	pos = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = pos;
+		pos += count[b];
+		end[b] = pos;
+	}
+
+	/*
+	 * Move every tuple into its partition, unless all of them are in the
+	 * same one already.  Each tuple taken out of place is carried along to
+	 * the next free slot of its own partition, displacing the tuple there,
+	 * until one that belongs into the current partition comes back.
+	 */
+	if (count[radix_sort_digit(data[0].datum1, ssup, shift)] < n)
+	{
+		for (b = 0; b < 256; b++)
+		{
+			while (next[b] < end[b])
+			{
+				SortTuple	tup = data[next[b]];
+				int			d = radix_sort_digit(tup.datum1, ssup, shift);
+
+				while (d != b)
+				{
+					SortTuple	tmp = data[next[d]];
+
+					data[next[d]++] = tup;
+					tup = tmp;
+					d = radix_sort_digit(tup.datum1, ssup, shift);
+				}
+				data[next[b]++] = tup;
+			}
+		}
+	}
+
+	pos = 0;
+	for (b = 0; b < 256; b++)
+	{
+		size_t		size = count[b];
+
+		if (size > 1)
+		{
+			if (level < SIZEOF_DATUM - 1)
+			{
+				if (size < RADIX_SORT_THRESHOLD)
+					qsort_tuple_datum1(data + pos, size, state);
+				else
+					radix_sort_tuple(data + pos, size, level + 1, state);
+			}
+			else if (state->onlyKey == NULL)
+			{
+				/* equal leading keys, sort by the tiebreak comparator */
+				qsort_tuple_datum1(data + pos, size, state);
+			}
+		}
+		pos += size;
+	}
+}
+
+/*
+ * Sort all memtuples by radix sort.  The caller checked that the leading
+ * key's comparator is supported.
+ */
+static void
+tuplesort_radix_sort(Tuplesortstate *state)
+{
+	SortTuple  *data = state->memtuples;
+	size_t		n = state->memtupcount;
+	SortSupport ssup = &state->sortKeys[0];
+	SortTuple  *nulls;
+	SortTuple  *notnulls;
+	size_t		nnulls = 0;
+	size_t		i;
+	int			level;
+
+	/* Move the NULLs to the side of the requested NULLS FIRST/LAST order */
+	if (ssup->ssup_nulls_first)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (data[i].isnull1)
+			{
+				SortTuple	tmp = data[i];
+
+				data[i] = data[nnulls];
+				data[nnulls++] = tmp;
+			}
+		}
+		nulls = data;
+		notnulls = data + nnulls;
+	}
+	else
+	{
+		for (i = n; i > 0; i--)
+		{
+			if (data[i - 1].isnull1)
+			{
+				SortTuple	tmp = data[i - 1];
+
+				nnulls++;
+				data[i - 1] = data[n - nnulls];
+				data[n - nnulls] = tmp;
+			}
+		}
+		nulls = data + n - nnulls;
+		notnulls = data;
+	}
+
+	/* NULLs compare equal in the leading key */
+	if (nnulls > 1 && state->onlyKey == NULL)
+		qsort_tuple_datum1(nulls, nnulls, state);
+
+	/* int32 keys only use the low bytes of datum1 */
+	level = (ssup->comparator == ssup_datum_int32_cmp) ?
+		SIZEOF_DATUM - sizeof(int32) : 0;
+
+	if (n - nnulls < RADIX_SORT_THRESHOLD)
+		qsort_tuple_datum1(notnulls, n - nnulls, state);
+	else
+		radix_sort_tuple(notnulls, n - nnulls, level, state);
+}
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -2842,6 +3048,8 @@ merge_read_buffer_size(int64 avail_mem, int nInputTapes, int nInputRuns,
 static void
 inittapes(Tuplesortstate *state, bool mergeruns)
 {
+	Size		writeBehindSpace;
+
 	Assert(!LEADER(state));
 
 	if (mergeruns)
@@ -2869,6 +3077,14 @@ inittapes(Tuplesortstate *state, bool mergeruns)
 							 state->shared ? &state->shared->fileset : NULL,
 							 state->worker);
 
+	/*
+	 * Let the tape set coalesce its block writes, and charge the buffer it
+	 * needs for that to our memory budget.
+	 */
+	writeBehindSpace = LogicalTapeWriteBehindSize(state->allowedMem);
+	LogicalTapeSetWriteBehind(state->tapeset, writeBehindSpace);
+	USEMEM(state, writeBehindSpace);
+
 	state->currentRun = 0;
 
 	/*
@@ -3663,7 +3879,13 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 		 */
 		if (state->haveDatum1 && state->sortKeys)
 		{
-			if (state->sortKeys[0].comparator == ssup_datum_unsigned_cmp)
+			if (state->memtupcount >= RADIX_SORT_THRESHOLD &&
+				radix_sort_supported(&state->sortKeys[0]))
+			{
+				tuplesort_radix_sort(state);
+				return;
+			}
+			else if (state->sortKeys[0].comparator == ssup_datum_unsigned_cmp)
 			{
 				qsort_tuple_unsigned(state->memtuples,
 									 state->memtupcount,
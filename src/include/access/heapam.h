@@ -22,6 +22,7 @@
 #include "access/tableam.h"
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
+#include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
@@ -65,6 +66,15 @@ typedef struct HeapScanDescData
 
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
+	/*
+	 * Pinned buffers of the pages after rs_cblock that a forward scan has
+	 * already read or started reading, see heap_scan_read_buffer().  Those
+	 * from rs_nextreadbuf up to rs_nreadbuf are still to be returned.
+	 */
+	int			rs_nreadbuf;
+	int			rs_nextreadbuf;
+	Buffer		rs_readbuf[2 * MAX_IO_COMBINE_LIMIT];
+
 	/*
 	 * For parallel scans to store page allocation data.  NULL when not
 	 * performing a parallel scan.
@@ -273,6 +273,17 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * Hint to the CPU that the cache line containing addr is going to be read
+ * soon.  This never faults, so addr need not point to valid memory.  Useful
+ * to overlap the cache misses of several independent lookups.
+ */
+#if __GNUC__ >= 3
+#define pg_prefetch_mem(addr)	__builtin_prefetch(addr)
+#else
+#define pg_prefetch_mem(addr)	((void) (addr))
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
@@ -0,0 +1,94 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batch-at-a-time tuple protocol between executor nodes.
+ *
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "executor/executor.h"
+
+/*
+ * TupleBatch
+ *
+ * A set of up to maxrows tuples returned by ExecProcNodeBatch().  Every row
+ * lives in its own slot, so a batch can be consumed exactly like a sequence
+ * of ExecProcNode() results.  The batch and its slots are owned by the node
+ * that returned it and stay valid until the next call on that node (or a
+ * rescan), just like the slot returned by ExecProcNode().
+ */
+typedef struct TupleBatch
+{
+	int			maxrows;		/* number of allocated slots */
+	int			nrows;			/* number of valid rows, 0 .. maxrows */
+	TupleTableSlot **slots;		/* row i is in slots[i] */
+} TupleBatch;
+
+/*
+ * Upper limit of executor_batch_size.  Every row of a batch may keep a
+ * buffer pinned until the batch is consumed, and several scans of one query
+ * can hold full batches at once, so batches must stay small compared to the
+ * number of buffers a backend may pin.
+ */
+#define MAX_EXECUTOR_BATCH_SIZE 64
+
+/* GUC: number of rows per batch, 1 disables batch execution */
+extern PGDLLIMPORT int executor_batch_size;
+
+extern TupleBatch *ExecInitTupleBatch(EState *estate, TupleDesc desc,
+									  const TupleTableSlotOps *tts_ops);
+extern void ExecClearTupleBatch(TupleBatch *batch);
+extern TupleBatch *ExecGetResultBatch(PlanState *planstate);
+extern TupleBatch *ExecProcNodeBatchDefault(PlanState *node);
+extern bool ExecSupportsBatch(PlanState *node);
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Execute the given node to return the next batch of tuples, or NULL
+ *		when there are no more.  A returned batch is never empty.  Nodes
+ *		without a batch implementation return the rows of ExecProcNode().
+ * ----------------------------------------------------------------
+ */
+#ifndef FRONTEND
+static inline TupleBatch *
+ExecProcNodeBatch(PlanState *node)
+{
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	return node->ExecProcNodeBatch(node);
+}
+
+/*
+ * ExecProjectBatchRow
+ *
+ * Project a single row into the given slot of a batch rather than into the
+ * projection's own result slot.  The slot must have the projection's result
+ * descriptor.
+ */
+static inline TupleTableSlot *
+ExecProjectBatchRow(ProjectionInfo *projInfo, TupleTableSlot *slot)
+{
+	TupleTableSlot *resultslot = projInfo->pi_state.resultslot;
+
+	Assert(slot->tts_tupleDescriptor->natts ==
+		   resultslot->tts_tupleDescriptor->natts);
+
+	projInfo->pi_state.resultslot = slot;
+	ExecProject(projInfo);
+	projInfo->pi_state.resultslot = resultslot;
+
+	return slot;
+}
+#endif
+
+#endif							/* EXECBATCH_H */
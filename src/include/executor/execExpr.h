@@ -27,6 +27,8 @@ struct ScalarArrayOpExprHashTable;
 #define EEO_FLAG_INTERPRETER_INITIALIZED	(1 << 1)
 /* jump-threading is in use */
 #define EEO_FLAG_DIRECT_THREADED			(1 << 2)
+/* ExecReadyVectorQual() has been called, vecprog may be set */
+#define EEO_FLAG_VECTOR_INITIALIZED			(1 << 3)
 
 /* Typical API for out-of-line evaluation subroutines */
 typedef void (*ExecEvalSubroutine) (ExprState *state,
@@ -708,6 +710,73 @@ typedef struct SubscriptExecSteps
 } SubscriptExecSteps;
 
 
+/*
+ * Vectorized qual evaluation.
+ *
+ * A qual over a batch of scan tuples can be compiled into an ExprVecProgram
+ * in addition to its regular steps.  Each step of the program is executed
+ * for all rows of the batch before the next one, operating on registers
+ * that hold one Datum / null flag per row.  The rows still under
+ * consideration are tracked in a selection vector, which every
+ * EEVOP_QUAL step narrows to the rows its conjunct accepted; that is the
+ * batch equivalent of EEOP_QUAL's short-circuiting.
+ *
+ * Only a prefix of the qual's conjuncts made of scan Vars, constants and
+ * functions with a kernel (see ExecVectorKernel()) is compiled this way,
+ * the remaining conjuncts are evaluated row by row by the residual qual.
+ */
+
+/*
+ * Kernel for a two-argument strict function.  Evaluates r[i] = f(a[i], b[i])
+ * for the n rows listed in sel, or rows 0 .. n-1 if sel is NULL.  The result
+ * is null if either argument is.
+ */
+typedef void (*ExprVecKernel) (int n, const int *sel,
+							   const Datum *a, const bool *anull,
+							   const Datum *b, const bool *bnull,
+							   Datum *r, bool *rnull);
+
+typedef enum ExprVecOp
+{
+	/* fetch scan attribute attnum into resreg */
+	EEVOP_SCAN_VAR,
+
+	/* resreg = kernel(argreg[0], argreg[1]) */
+	EEVOP_FUNC,
+
+	/* drop rows for which argreg[0] is false or null from the selection */
+	EEVOP_QUAL
+} ExprVecOp;
+
+typedef struct ExprVecStep
+{
+	ExprVecOp	op;
+	int			resreg;
+	int			argreg[2];
+	AttrNumber	attnum;			/* EEVOP_SCAN_VAR */
+	ExprVecKernel kernel;		/* EEVOP_FUNC */
+} ExprVecStep;
+
+typedef struct ExprVecProgram
+{
+	int			maxrows;		/* rows per call, registers' length */
+
+	ExprVecStep *steps;
+	int			nsteps;
+
+	/* registers, each an array of maxrows values and null flags */
+	int			nregs;
+	Datum	  **values;
+	bool	  **nulls;
+
+	/* workspace for the selection vector */
+	int		   *sel;
+
+	/* conjuncts that could not be vectorized, or NULL */
+	ExprState  *residual;
+} ExprVecProgram;
+
+
 /* functions in execExpr.c */
 extern void ExprEvalPushStep(ExprState *es, const ExprEvalStep *s);
 
@@ -717,6 +786,7 @@ extern ExprEvalOp ExecEvalStepOp(ExprState *state, ExprEvalStep *op);
 
 extern Datum ExecInterpExprStillValid(ExprState *state, ExprContext *econtext, bool *isNull);
 extern void CheckExprStillValid(ExprState *state, ExprContext *econtext);
+extern ExprVecKernel ExecVectorKernel(Oid funcid);
 
 /*
  * Non fast-path execution functions. These are externs instead of statics in
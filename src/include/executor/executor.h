@@ -241,6 +241,7 @@ extern Node *MultiExecProcNode(PlanState *node);
 extern void ExecEndNode(PlanState *node);
 extern bool ExecShutdownNode(PlanState *node);
 extern void ExecSetTupleBound(int64 tuples_needed, PlanState *child_node);
+extern void ExecSetReadToCompletion(PlanState *child_node);
 
 
 /* ----------------------------------------------------------------
@@ -267,6 +268,7 @@ extern ExprState *ExecInitExpr(Expr *node, PlanState *parent);
 extern ExprState *ExecInitExprWithParams(Expr *node, ParamListInfo ext_params);
 extern ExprState *ExecInitQual(List *qual, PlanState *parent);
 extern ExprState *ExecInitCheck(List *qual, PlanState *parent);
+extern void ExecReadyVectorQual(ExprState *state, int maxrows);
 extern List *ExecInitExprList(List *nodes, PlanState *parent);
 extern ExprState *ExecBuildAggTrans(AggState *aggstate, struct AggStatePerPhaseData *phase,
 									bool doSort, bool doHash, bool nullcheck);
@@ -434,6 +436,13 @@ ExecQualAndReset(ExprState *state, ExprContext *econtext)
 
 extern bool ExecCheck(ExprState *state, ExprContext *context);
 
+/*
+ * prototypes from functions in execExprInterp.c
+ */
+extern int	ExecVectorQual(ExprState *state, ExprContext *econtext,
+						   TupleTableSlot **slots, int nrows,
+						   const int **sel);
+
 /*
  * prototypes from functions in execSRF.c
  */
@@ -457,9 +466,12 @@ extern Datum ExecMakeFunctionResultSet(SetExprState *fcache,
  */
 typedef TupleTableSlot *(*ExecScanAccessMtd) (ScanState *node);
 typedef bool (*ExecScanRecheckMtd) (ScanState *node, TupleTableSlot *slot);
+typedef bool (*ExecScanSlotAccessMtd) (ScanState *node, TupleTableSlot *slot);
 
 extern TupleTableSlot *ExecScan(ScanState *node, ExecScanAccessMtd accessMtd,
 								ExecScanRecheckMtd recheckMtd);
+extern struct TupleBatch *ExecScanBatch(ScanState *node,
+										ExecScanSlotAccessMtd accessMtd);
 extern void ExecAssignScanProjectionInfo(ScanState *node);
 extern void ExecAssignScanProjectionInfoWithVarno(ScanState *node, int varno);
 extern void ExecScanReScan(ScanState *node);
@@ -80,6 +80,15 @@ typedef struct HashJoinTupleData
 #define HJTUPLE_MINTUPLE(hjtup)  \
 	((MinimalTuple) ((char *) (hjtup) + HJTUPLE_OVERHEAD))
 
+/*
+ * Every tuple in an unshared bucket sets one of the 16 bits of the bucket's
+ * tag, chosen by the top bits of its hash value (the low ones determine the
+ * bucket and batch numbers).  A probe whose bit is clear cannot match any
+ * tuple of the bucket.  Tags are only cleared when all buckets are rebuilt,
+ * so tuples moved to a later batch may leave false positives behind.
+ */
+#define HJ_BUCKET_TAG(hashvalue)	((uint16) (1 << ((hashvalue) >> 28)))
+
 /*
  * If the outer relation's distribution is sufficiently nonuniform, we attempt
  * to optimize the join by treating the hash values corresponding to the outer
@@ -110,6 +119,23 @@ typedef struct HashSkewBucket
 #define SKEW_HASH_MEM_PERCENT  2
 #define SKEW_MIN_OUTER_FRACTION  0.01
 
+/*
+ * A runtime filter on the outer scan (see ExecHashRuntimeFilterPass) is only
+ * set up if the planner expects it to remove at least
+ * RUNTIME_FILTER_MIN_REMOVED of the outer tuples.  It is only used if at most
+ * RUNTIME_FILTER_MAX_BITS_SET of its bloom filter's bits are set, and disabled
+ * again if it removed less than RUNTIME_FILTER_MIN_REMOVED of the first
+ * RUNTIME_FILTER_MIN_PROBED tuples.  Its bloom filter may take up to
+ * RUNTIME_FILTER_HASH_MEM_PERCENT of the hash table's memory, and is not built
+ * if that leaves less than RUNTIME_FILTER_MIN_BITS_PER_TUPLE bits per
+ * expected inner tuple.
+ */
+#define RUNTIME_FILTER_HASH_MEM_PERCENT  25
+#define RUNTIME_FILTER_MIN_BITS_PER_TUPLE  8
+#define RUNTIME_FILTER_MAX_BITS_SET  0.5
+#define RUNTIME_FILTER_MIN_PROBED  4096
+#define RUNTIME_FILTER_MIN_REMOVED  0.1
+
 /*
  * To reduce palloc overhead, the HashJoinTuples for the current batch are
  * packed in 32kB buffers instead of pallocing each tuple individually.
@@ -299,6 +325,21 @@ typedef struct HashJoinTableData
 		dsa_pointer_atomic *shared;
 	}			buckets;
 
+	/*
+	 * bucketTags[i] summarizes the hash values of the tuples in the i'th
+	 * unshared bucket (see HJ_BUCKET_TAG), NULL for a shared table.  It is
+	 * kept apart from the tuples, so that a probe of a bucket that cannot
+	 * contain a match doesn't have to touch them.
+	 */
+	uint16	   *bucketTags;
+
+	/*
+	 * Bloom filter over the hash values of all inner tuples, used by a
+	 * runtime filter on the outer scan (see ExecHashRuntimeFilterPass), or
+	 * NULL if there is none.  It lives in hashCxt.
+	 */
+	struct bloom_filter *bloom;
+
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
 
 	bool		skewEnabled;	/* are we using skew optimization? */
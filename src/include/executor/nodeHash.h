@@ -49,6 +49,12 @@ extern bool ExecHashGetHashValue(HashJoinTable hashtable,
 								 bool outer_tuple,
 								 bool keep_nulls,
 								 uint32 *hashvalue);
+extern void ExecHashTableAddBloomFilter(HashJoinTable hashtable,
+										double ntuples);
+extern void ExecHashRuntimeFilterStart(HashJoinRuntimeFilter *filter,
+									   HashJoinTable hashtable);
+extern bool ExecHashRuntimeFilterPass(HashJoinRuntimeFilter *filter,
+									  ExprContext *econtext);
 extern void ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 									  uint32 hashvalue,
 									  int *bucketno,
@@ -16,6 +16,9 @@
 
 #include "nodes/execnodes.h"
 
+/* GUC: memory limit of each cached hashed subplan result, in kB */
+extern PGDLLIMPORT int subplan_cache_size;
+
 extern SubPlanState *ExecInitSubPlan(SubPlan *subplan, PlanState *parent);
 
 extern Datum ExecSubPlan(SubPlanState *node, ExprContext *econtext, bool *isNull);
@@ -26,4 +29,9 @@ extern void ExecSetParamPlan(SubPlanState *node, ExprContext *econtext);
 
 extern void ExecSetParamPlanMulti(const Bitmapset *params, ExprContext *econtext);
 
+extern Size SubPlanCacheShmemSize(void);
+extern void SubPlanCacheShmemInit(void);
+extern void SubPlanCacheBeginCommit(bool prepared);
+extern void SubPlanCacheEndCommit(void);
+
 #endif							/* NODESUBPLAN_H */
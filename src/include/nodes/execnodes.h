@@ -114,6 +114,9 @@ typedef struct ExprState
 
 	Datum	   *innermost_domainval;
 	bool	   *innermost_domainnull;
+
+	/* batch evaluation of a qual, see ExecReadyVectorQual() */
+	struct ExprVecProgram *vecprog;
 } ExprState;
 
 
@@ -662,6 +665,9 @@ typedef struct EState
 
 	bool		es_use_parallel_mode;	/* can we use parallel workers? */
 
+	int			es_batch_size;	/* rows per TupleBatch, 1 if batch execution
+								 * is disabled */
+
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
 
@@ -785,6 +791,10 @@ typedef struct TupleHashTableData
 	ExprState  *cur_eq_func;	/* comparator for input vs. table */
 	uint32		hash_iv;		/* hash-function IV */
 	ExprContext *exprcontext;	/* expression context */
+	/* The following fields are used if all key columns are fixed-width: */
+	Size		keylen;			/* length of a packed key, or 0 */
+	struct TupleHashKeyCol *keycols;	/* how to pack each key column */
+	char	   *inputkey;		/* packed key of current input tuple */
 }			TupleHashTableData;
 
 typedef tuplehash_iterator TupleHashIterator;
@@ -941,6 +951,8 @@ typedef struct SubPlanState
 	FmgrInfo   *lhs_hash_funcs; /* hash functions for lefthand datatype(s) */
 	FmgrInfo   *cur_eq_funcs;	/* equality functions for LHS vs. table */
 	ExprState  *cur_eq_comp;	/* equality comparator for LHS vs. table */
+	TupleTableSlot *cacheslot;	/* for rows copied into the subplan cache */
+	struct SubPlanCacheTables *cachetables; /* cached tables in use, or NULL */
 } SubPlanState;
 
 /*
@@ -984,6 +996,16 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 ExecProcNodeBatchMtd
+ *
+ * This is the method called by ExecProcNodeBatch to return the next batch
+ * of tuples from an executor node.  It returns NULL if no more tuples are
+ * available.  See executor/execBatch.h.
+ * ----------------
+ */
+typedef struct TupleBatch *(*ExecProcNodeBatchMtd) (struct PlanState *pstate);
+
 /* ----------------
  *		PlanState node
  *
@@ -1004,6 +1026,10 @@ typedef struct PlanState
 	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
 	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
 										 * wrapper */
+	ExecProcNodeBatchMtd ExecProcNodeBatch; /* function to return next batch
+											 * of tuples */
+	ExecProcNodeBatchMtd ExecProcNodeBatchReal; /* actual function, if above
+												 * is a wrapper */
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
@@ -1036,6 +1062,9 @@ typedef struct PlanState
 	TupleTableSlot *ps_ResultTupleSlot; /* slot for my result tuples */
 	ExprContext *ps_ExprContext;	/* node's expression-evaluation context */
 	ProjectionInfo *ps_ProjInfo;	/* info for doing tuple projection */
+	struct TupleBatch *ps_ResultBatch;	/* batch for my result tuples, made
+										 * on first use */
+	bool		ps_BatchDone;	/* no more batches until rescan */
 
 	bool		async_capable;	/* true if node is async-capable */
 
@@ -1416,6 +1445,9 @@ typedef struct BitmapOrState
  *		currentRelation    relation being scanned (NULL if none)
  *		currentScanDesc    current scan descriptor for scan (NULL if none)
  *		ScanTupleSlot	   pointer to slot in tuple table holding scan tuple
+ *		ScanBatch		   scan tuples of ExecScanBatch() (NULL if not used)
+ *		RuntimeFilter	   filter on the join keys of a hash join above,
+ *						   applied after the quals (NULL if none)
  * ----------------
  */
 typedef struct ScanState
@@ -1424,6 +1456,8 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	struct TupleBatch *ss_ScanBatch;
+	struct HashJoinRuntimeFilter *ss_RuntimeFilter;
 } ScanState;
 
 /* ----------------
@@ -2040,6 +2074,12 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_BatchProbe			true if outer tuples are fetched in batches
+ *		hj_ProbeSlots			outer tuples of the current batch that can
+ *								match, with hash values in hj_ProbeHashValues
+ *		hj_ProbeCount			number of them
+ *		hj_ProbePos				index of the next one to process
+ *		hj_RuntimeFilter		filter pushed down to the outer scan, or NULL
  * ----------------
  */
 
@@ -2047,6 +2087,29 @@ typedef struct MergeJoinState
 typedef struct HashJoinTupleData *HashJoinTuple;
 typedef struct HashJoinTableData *HashJoinTable;
 
+/* ----------------
+ *	 HashJoinRuntimeFilter information
+ *
+ *		A hash join whose outer side is a plain relation scan lets the scan
+ *		discard tuples that cannot have a join partner, using a bloom filter
+ *		over the hash values of the inner tuples (see nodeHash.c).
+ *
+ *		hashkeys				the join's outer hash keys, evaluated over
+ *								the scan tuple (list of ExprState nodes)
+ *		hashtable				hash table whose bloom filter is used, or
+ *								NULL while the filter is inactive
+ *		nprobed					number of tuples checked so far
+ *		nremoved				number of them discarded
+ * ----------------
+ */
+typedef struct HashJoinRuntimeFilter
+{
+	List	   *hashkeys;
+	HashJoinTable hashtable;
+	double		nprobed;
+	double		nremoved;
+} HashJoinRuntimeFilter;
+
 typedef struct HashJoinState
 {
 	JoinState	js;				/* its first field is NodeTag */
@@ -2067,6 +2130,12 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	bool		hj_BatchProbe;
+	int			hj_ProbeCount;
+	int			hj_ProbePos;
+	TupleTableSlot **hj_ProbeSlots;
+	uint32	   *hj_ProbeHashValues;
+	HashJoinRuntimeFilter *hj_RuntimeFilter;
 } HashJoinState;
 
 
@@ -2203,6 +2272,20 @@ typedef struct SortState
 	bool		am_worker;		/* are we a worker? */
 	bool		datumSort;		/* Datum sort instead of tuple sort? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+
+	/* these fields are used by Parallel Sort: */
+	struct ParallelSortState *pstate;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor *psample;	/* shared sample */
+	struct SharedTuplestoreAccessor **pparts;	/* one per partition */
+	MemoryContext paccessorcxt; /* leader's context for psample, pparts */
+	bool		pattached;		/* attached to the shared barrier? */
+	struct BufFile *pfile;		/* sorted partition being read, or NULL */
+	int			pcurpart;		/* number of that partition */
+	int			pmarkpart;		/* partition of the marked position */
+	int			pmarkfileno;	/* file and offset of the marked position */
+	off_t		pmarkoffset;
+	char	   *preadbuf;		/* buffer for tuples read from pfile */
+	Size		preadbuflen;	/* allocated size of preadbuf */
 } SortState;
 
 /* ----------------
@@ -2396,6 +2479,18 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+
+	/* these fields are used when the input is read in batches: */
+	bool		batch_input;	/* use ExecProcNodeBatch on outer plan? */
+	struct TupleBatch *input_batch; /* current batch of input tuples */
+	int			input_batch_pos;	/* next tuple to return from it */
+
+	/* these fields are used by Parallel HashAggregate: */
+	struct ParallelHashAggState *hash_pstate;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor **hash_pparts;	/* one per partition */
+	int			hash_pcurpart;	/* partition being aggregated, or -1 */
+	bool		hash_pattached; /* attached to the shared barrier? */
+	bool		hash_ppartitioned;	/* done writing our input partitions? */
 } AggState;
 
 /* ----------------
@@ -765,6 +765,8 @@ typedef struct SubPlan
 								 * simpler handling of null values */
 	bool		parallel_safe;	/* is the subplan parallel-safe? */
 	/* Note: parallel_safe does not consider contents of testexpr or args */
+	bool		cacheable;		/* may a hashed subplan's result be reused by
+								 * later executions of the plan? */
 	/* Information for passing params into and out of the subselect: */
 	/* setParam and parParam are lists of integers (param IDs) */
 	List	   *setParam;		/* initplan subqueries have to set these
@@ -164,6 +164,7 @@ extern MergePath *create_mergejoin_path(PlannerInfo *root,
 										JoinPathExtraData *extra,
 										Path *outer_path,
 										Path *inner_path,
+										bool parallel_sort,
 										List *restrict_clauses,
 										List *pathkeys,
 										Relids required_outer,
@@ -126,6 +126,9 @@ extern BgwHandleStatus
 			WaitForBackgroundWorkerShutdown(BackgroundWorkerHandle *);
 extern const char *GetBackgroundWorkerTypeByPid(pid_t pid);
 
+/* Number of slots, including the ones reserved for I/O workers */
+extern int	BackgroundWorkerSlots(void);
+
 /* Terminate a bgworker */
 extern void TerminateBackgroundWorker(BackgroundWorkerHandle *handle);
 
@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------
+ *
+ * aio.h
+ *	  Asynchronous I/O on shared buffers, performed by I/O worker processes.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/aio.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef AIO_H
+#define AIO_H
+
+#include "storage/block.h"
+#include "storage/bufmgr.h"
+#include "storage/relfilenode.h"
+
+/* Possible values for io_method */
+typedef enum IoMethod
+{
+	IOMETHOD_SYNC,				/* backends perform their own I/O */
+	IOMETHOD_WORKER,			/* I/O workers use plain system calls */
+#ifdef USE_LIBURING
+	IOMETHOD_IO_URING			/* I/O workers batch their reads in io_uring */
+#endif
+} IoMethod;
+
+typedef enum PgAioOp
+{
+	PGAIO_OP_READ,
+	PGAIO_OP_WRITE
+} PgAioOp;
+
+/*
+ * An asynchronous I/O request.
+ *
+ * A read covers nblocks consecutive blocks of a relation fork and goes
+ * straight into the given shared buffers.  A write is of a single block,
+ * from a copy of the page in the request's bounce buffer, so that the buffer
+ * can be modified while the write is in flight.
+ *
+ * The issuer marks the buffers BM_IO_IN_PROGRESS and gives the request a pin
+ * of its own on each of them.  Whoever completes the request (normally an
+ * I/O worker) ends the I/O and drops those pins, see AioCompleteBufferIO().
+ * The issuer does not need to stay around for that.
+ */
+typedef struct PgAioRequest
+{
+	PgAioOp		op;
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blocknum;
+	int			nblocks;
+	Buffer		buffers[MAX_IO_COMBINE_LIMIT];
+} PgAioRequest;
+
+/* GUC variables */
+extern PGDLLIMPORT int io_method;
+extern PGDLLIMPORT int io_workers;
+
+/* upper limit for io_workers */
+#define MAX_IO_WORKERS 32
+
+extern Size AioShmemSize(void);
+extern void AioShmemInit(void);
+extern void AioWorkersRegister(void);
+extern int	AioWorkerSlots(void);
+
+extern PgAioRequest *pgaio_acquire(void);
+extern char *pgaio_bounce_buffer(PgAioRequest *req);
+extern void pgaio_release(PgAioRequest *req);
+extern void pgaio_submit(PgAioRequest *req);
+extern void pgaio_complete(PgAioRequest *req, bool success);
+
+/* for I/O workers */
+extern void pgaio_worker_attach(int id);
+extern int	pgaio_worker_dequeue(int id, PgAioRequest **reqs, int maxreqs,
+								 bool detach);
+
+/* in aio_worker.c */
+extern void IoWorkerMain(Datum main_arg) pg_attribute_noreturn();
+
+#endif							/* AIO_H */
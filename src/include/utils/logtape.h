@@ -64,6 +64,8 @@ extern void LogicalTapeClose(LogicalTape *lt);
 extern void LogicalTapeSetClose(LogicalTapeSet *lts);
 extern LogicalTape *LogicalTapeCreate(LogicalTapeSet *lts);
 extern LogicalTape *LogicalTapeImport(LogicalTapeSet *lts, int worker, TapeShare *shared);
+extern Size LogicalTapeWriteBehindSize(Size mem_limit);
+extern void LogicalTapeSetWriteBehind(LogicalTapeSet *lts, Size size);
 extern void LogicalTapeSetForgetFreeSpace(LogicalTapeSet *lts);
 extern size_t LogicalTapeRead(LogicalTape *lt, void *ptr, size_t size);
 extern void LogicalTapeWrite(LogicalTape *lt, void *ptr, size_t size);
@@ -0,0 +1,89 @@
+# Check that reads and writes handed to I/O workers give the same results
+# as performing them synchronously, for each io_method this build supports.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my @methods = ('worker');
+push @methods, 'io_uring' if check_pg_config("#define USE_LIBURING 1");
+
+foreach my $method (@methods)
+{
+	my $node = PostgreSQL::Test::Cluster->new("io_$method");
+	$node->init;
+
+	# Small shared_buffers, so that the tables don't fit and get read back.
+	# The I/O workers have slots of their own, so they must all start even
+	# with more of them than max_worker_processes.
+	$node->append_conf(
+		'postgresql.conf', qq{
+io_method = $method
+io_workers = 2
+max_worker_processes = 1
+shared_buffers = 4MB
+max_connections = 10
+effective_io_concurrency = 16
+maintenance_io_concurrency = 16
+log_min_messages = debug1
+});
+	$node->start;
+
+	# I/O workers don't show up in pg_stat_activity, so look for them in the
+	# log, which also tells whether they managed to set up io_uring
+	my $using = $method eq 'io_uring' ? ', using io_uring' : '';
+	foreach my $id (0, 1)
+	{
+		$node->wait_for_log(qr/I\/O worker $id started\Q$using\E$/m);
+		pass("$method: I/O worker $id started");
+	}
+
+	$node->safe_psql(
+		'postgres', q{
+CREATE TABLE io_test (id int, filler text);
+INSERT INTO io_test SELECT g, repeat('x', 200) FROM generate_series(1, 50000) g;
+CREATE INDEX io_test_id ON io_test (id);
+CHECKPOINT;
+});
+
+	# Sequential scan reading ahead through the workers
+	is( $node->safe_psql(
+			'postgres', "SELECT count(*), sum(id) FROM io_test"),
+		'50000|1250025000',
+		"$method: sequential scan");
+
+	# Bitmap heap scan, which prefetches its pages
+	is( $node->safe_psql(
+			'postgres', q{
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SELECT count(*), sum(id) FROM io_test WHERE id % 7 = 0 AND id BETWEEN 1000 AND 40000;
+}),
+		'5572|114223214',
+		"$method: bitmap heap scan");
+
+	# VACUUM, which prefetches the pages it scans, and a checkpoint writing
+	# the pages it dirtied through the workers
+	$node->safe_psql(
+		'postgres', q{
+DELETE FROM io_test WHERE id % 2 = 0;
+VACUUM io_test;
+UPDATE io_test SET filler = repeat('y', 200) WHERE id % 3 = 0;
+CHECKPOINT;
+});
+
+	# Read everything back from disk after a clean restart
+	$node->restart;
+	is( $node->safe_psql(
+			'postgres',
+			"SELECT count(*), sum(id), count(*) FILTER (WHERE filler LIKE 'y%') FROM io_test"
+		),
+		'25000|625000000|8333',
+		"$method: contents after VACUUM and checkpoint");
+
+	$node->stop;
+}
+
+done_testing();
@@ -1130,6 +1130,20 @@ explain (costs off)
    where (hundred, thousand) in (select twothousand, twothousand from onek);
 reset enable_memoize;
 
+-- Hash aggregation with fixed-width keys, which are compared in packed form
+set enable_sort = false;
+select a, b, count(*)
+  from (select (case when g % 7 = 0 then null else g % 3 end)::int8 as a,
+               '2022-01-01'::date + g % 2 as b
+        from generate_series(1, 42) g) s
+ group by a, b order by a, b;
+select u, flag, count(*)
+  from (select ('00000000-0000-0000-0000-00000000000' || g % 3)::uuid as u,
+               g % 2 = 0 as flag
+        from generate_series(1, 12) g) s
+ group by u, flag order by u, flag;
+reset enable_sort;
+
 --
 -- Hash Aggregation Spill tests
 --
@@ -1260,3 +1274,32 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+-- Test aggregation over batches of scan tuples, with a batch size that
+-- doesn't divide the number of input rows
+set executor_batch_size = 7;
+select count(*), sum(unique1), max(ten) from tenk1 where ten % 3 = 0;
+select four, count(*), sum(unique1) from tenk1 where ten < 5
+  group by four order by four;
+select sum(x) from (select unique1 * 2 + 1 as x from tenk1 where two = 0) s;
+-- rescans of the batched scan
+select a, (select count(*) from tenk1 t where t.ten < a)
+  from (values (1), (5), (10)) v(a);
+-- quals over the scan tuples of a batch are evaluated column-wise
+create temp table vec_t as
+  select case when g % 13 = 0 then null else g % 100 end as a,
+         case when g % 17 = 0 then null else g * 1000000000::int8 end as b,
+         case when g % 19 = 0 then null else g / 8.0::float8 end as c,
+         case when g % 23 = 0 then null else date '2000-01-01' + g % 50 end as d
+  from generate_series(1, 1000) g;
+select count(*), sum(a) from vec_t where a > 10 and b < 500000000000;
+select count(*), sum(b) from vec_t
+  where a + 10 >= 50 and c * 2 < 200 and d <> '2000-01-05';
+select count(*), max(a) from vec_t where a < 50 and a % 7 = 0;
+select count(*) from vec_t where 5 < b and b <= 100000000000 and a - 3 <> a * 2;
+select count(*), min(c) from vec_t where d >= '2000-02-10' and c - 1 >= 50;
+-- overflow is only reported for rows that reach the arithmetic
+select count(*) from vec_t where a > 200 and b * 100000000000 > 0;
+select count(*) from vec_t where a >= 0 and b * 100000000000 > 0;
+drop table vec_t;
+reset executor_batch_size;
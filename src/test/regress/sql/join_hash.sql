@@ -556,3 +556,89 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+-- Probe the hash table with batches of outer tuples, using a batch size
+-- that doesn't divide the outer relation, NULL keys and several batches
+BEGIN;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_nestloop = off;
+SET LOCAL max_parallel_workers_per_gather = 0;
+SET LOCAL executor_batch_size = 7;
+SET LOCAL work_mem = '128kB';
+SET LOCAL hash_mem_multiplier = 1.0;
+CREATE TABLE hjbatch_outer AS
+  SELECT CASE WHEN g % 10 = 0 THEN NULL ELSE g % 30000 END AS k, g
+  FROM generate_series(1, 50000) g;
+CREATE TABLE hjbatch_inner AS
+  SELECT g AS k, g * 2 AS v FROM generate_series(1, 60000, 3) g;
+ANALYZE hjbatch_outer, hjbatch_inner;
+SELECT count(*), sum(o.g), sum(i.v)
+  FROM hjbatch_outer o JOIN hjbatch_inner i ON o.k = i.k;
+SELECT count(*), count(i.k)
+  FROM hjbatch_outer o LEFT JOIN hjbatch_inner i ON o.k = i.k;
+SELECT count(*) FROM hjbatch_outer o
+  WHERE NOT EXISTS (SELECT 1 FROM hjbatch_inner i WHERE o.k = i.k);
+-- A join that isn't read to completion computes no outer rows ahead of the
+-- ones it returns; the second one would fail here
+SET LOCAL work_mem = '4MB';
+SELECT o.g, o.x
+  FROM (SELECT k, g, 1 / (g - 2) AS x FROM hjbatch_outer OFFSET 0) o
+  JOIN hjbatch_inner i ON o.k = i.k
+  LIMIT 1;
+ROLLBACK;
+
+-- Discard outer tuples without a join partner in the outer scan, with the
+-- per-tuple and the batched scan
+BEGIN;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL enable_nestloop = off;
+SET LOCAL max_parallel_workers_per_gather = 0;
+CREATE TABLE hjrf_fact AS
+  SELECT g, g % 1000 AS k FROM generate_series(1, 100000) g;
+CREATE TABLE hjrf_dim AS
+  SELECT d AS id, d * 10 AS w FROM generate_series(0, 1000, 50) d;
+ANALYZE hjrf_fact, hjrf_dim;
+SET LOCAL executor_batch_size = 1;
+SELECT count(*), sum(f.g), sum(d.w)
+  FROM hjrf_fact f JOIN hjrf_dim d ON f.k + 1 = d.id WHERE f.g > 5000;
+SELECT count(*) FROM hjrf_fact f WHERE f.k + 1 IN (SELECT id FROM hjrf_dim);
+SELECT count(*), count(f.g)
+  FROM hjrf_dim d LEFT JOIN hjrf_fact f ON f.k + 1 = d.id;
+SET LOCAL executor_batch_size = 64;
+SELECT count(*), sum(f.g), sum(d.w)
+  FROM hjrf_fact f JOIN hjrf_dim d ON f.k + 1 = d.id WHERE f.g > 5000;
+SELECT count(*) FROM hjrf_fact f WHERE f.k + 1 IN (SELECT id FROM hjrf_dim);
+SELECT count(*), count(f.g)
+  FROM hjrf_dim d LEFT JOIN hjrf_fact f ON f.k + 1 = d.id;
+-- The filter removes the outer tuples without a partner in the scan, both
+-- when the join needs several batches and when the inner side fits in one
+SET LOCAL work_mem = '2MB';
+CREATE TABLE hjrf_wide_dim AS
+  SELECT d AS id, repeat('x', 200) AS pad FROM generate_series(1, 20000) d;
+CREATE TABLE hjrf_long_fact AS SELECT g FROM generate_series(1, 200000) g;
+ANALYZE hjrf_wide_dim, hjrf_long_fact;
+CREATE FUNCTION hjrf_removed(query text, OUT batches int, OUT removed int)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan jsonb;
+BEGIN
+  EXECUTE 'EXPLAIN (ANALYZE, FORMAT JSON) ' || query INTO plan;
+  batches := jsonb_path_query_first(plan,
+    '$.** ? (@."Node Type" == "Hash")."Original Hash Batches"')::int;
+  removed := jsonb_path_query_first(plan,
+    '$.** ? (@."Relation Name" == "hjrf_long_fact")."Rows Removed by Filter"')::int;
+END;
+$$;
+SELECT batches > 1 AS batched, removed > 100000 AS filtered
+  FROM hjrf_removed('SELECT count(*), sum(length(d.pad))
+                       FROM hjrf_long_fact f JOIN hjrf_wide_dim d ON f.g = d.id * 5
+                      WHERE f.g > 0');
+SELECT count(*), sum(length(d.pad))
+  FROM hjrf_long_fact f JOIN hjrf_wide_dim d ON f.g = d.id * 5 WHERE f.g > 0;
+SET LOCAL work_mem = '64MB';
+SELECT batches > 1 AS batched, removed > 100000 AS filtered
+  FROM hjrf_removed('SELECT count(*), sum(length(d.pad))
+                       FROM hjrf_long_fact f JOIN hjrf_wide_dim d ON f.g = d.id * 5
+                      WHERE f.g > 0');
+ROLLBACK;
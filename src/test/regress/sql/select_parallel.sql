@@ -255,6 +255,17 @@ explain (costs off)
 	select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
 select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
 
+-- sorting both sides, the inner one may be sorted by all workers together
+set enable_indexscan to off;
+set enable_bitmapscan to off;
+explain (costs off)
+select count(*), sum(tenk1.unique1), sum(tenk2.two)
+  from tenk1, tenk2 where tenk1.unique1 = tenk2.hundred;
+select count(*), sum(tenk1.unique1), sum(tenk2.two)
+  from tenk1, tenk2 where tenk1.unique1 = tenk2.hundred;
+reset enable_indexscan;
+reset enable_bitmapscan;
+
 reset enable_hashjoin;
 reset enable_nestloop;
 
@@ -314,6 +325,19 @@ reset enable_material;
 
 reset enable_hashagg;
 
+-- test Parallel HashAggregate, which divides the groups among the workers
+select count(*), sum(n), sum(s) from
+  (select unique1 % 5000 as g, count(*) as n, sum(unique2) as s
+   from tenk1 group by 1) ss;
+
+-- array_agg has no combine function, so partial aggregation can't be used
+explain (costs off)
+select unique1 % 5000 as g, array_agg(unique1) as a
+  from tenk1 group by 1;
+select count(*), sum(cardinality(a)) from
+  (select unique1 % 5000 as g, array_agg(unique1) as a
+   from tenk1 group by 1) ss;
+
 -- check parallelized int8 aggregate (bug #14897)
 explain (costs off)
 select avg(unique1::int8) from tenk1;
@@ -519,6 +519,56 @@ select * from int8_tbl where q1 in (select c1 from inner_text);
 
 rollback;  -- to get rid of the bogus operator
 
+--
+-- Test reuse of a hashed subplan's result by later executions of a plan
+--
+create table cached_outer (a int);
+create table cached_inner (b int);
+create table cached_other (c int);
+insert into cached_outer values (1), (2), (3), (null);
+insert into cached_inner values (1), (2);
+prepare cached_q as
+  select a, a in (select b from cached_inner) as in_inner from cached_outer;
+explain (verbose, costs off) execute cached_q;
+execute cached_q;
+execute cached_q;
+execute cached_q;
+insert into cached_inner values (3), (null);
+execute cached_q;
+delete from cached_inner where b = 1;
+execute cached_q;
+-- changes made by our own transaction must be seen, too
+begin;
+execute cached_q;
+delete from cached_inner where b is null;
+execute cached_q;
+rollback;
+execute cached_q;
+-- instrumentation shows whether the sub-select was run; a repeatable read
+-- transaction keeps the snapshot, so that concurrent sessions don't matter
+insert into cached_inner values (4);
+begin isolation level repeatable read;
+-- the table has changed since the result was stored, so it's rebuilt
+explain (analyze, costs off, summary off, timing off) execute cached_q;
+-- and then reused
+explain (analyze, costs off, summary off, timing off) execute cached_q;
+execute cached_q;
+commit;
+-- a change to a table the sub-select doesn't read leaves the result alone
+insert into cached_other values (1);
+explain (analyze, costs off, summary off, timing off) execute cached_q;
+deallocate cached_q;
+-- views are expanded, so a sub-select reading one is cached, too
+create view cached_view as select b from cached_inner;
+prepare cached_v as
+  select a, a in (select b from cached_view) as in_inner from cached_outer;
+execute cached_v;
+execute cached_v;
+explain (analyze, costs off, summary off, timing off) execute cached_v;
+deallocate cached_v;
+drop view cached_view;
+drop table cached_outer, cached_inner, cached_other;
+
 --
 -- Test resolution of hashed vs non-hashed implementation of EXISTS subplan
 --
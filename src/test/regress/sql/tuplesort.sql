@@ -49,6 +49,20 @@ SELECT abort_increasing, noabort_increasing FROM abbrev_abort_uuids ORDER BY abo
 SELECT abort_increasing, noabort_increasing FROM abbrev_abort_uuids ORDER BY noabort_increasing NULLS FIRST LIMIT 5;
 
 
+----
+-- Check radix sorting of pass-by-value leading keys, with ties broken by
+-- the following keys
+----
+
+CREATE TEMP TABLE radix_ints AS
+    SELECT CASE WHEN g % 101 = 0 THEN NULL ELSE (g * 7919) % 2003 - 1000 END AS i4,
+           (g % 1000 - 500)::int8 * 10000000000 AS i8, g
+    FROM generate_series(1, 10000) g;
+
+SELECT i4, g FROM radix_ints ORDER BY i4 DESC NULLS FIRST, g OFFSET 10000 - 5;
+SELECT i4 FROM radix_ints ORDER BY i4 NULLS FIRST OFFSET 10000 - 5;
+SELECT i8, g FROM radix_ints ORDER BY i8, g DESC OFFSET 10000 - 5;
+
 ----
 -- Check index creation uses of tuplesort wrt. abbreviated keys
 ----